@@ -37,4 +37,23 @@ def get_doc_classes():
         "SteamworksConstants",
         "HBSteamUGCItemUpdateProgress",
         "HBSteamUGCUserItemVoteResult",
+        "HBSteamVoiceChat",
+        "HBSteamNetworkingUtils",
+        "HBSteamSchemaMessage",
+        "HBSteamSnapshotReplicator",
+        "HBSteamInputTransport",
+        "HBSteamClockSync",
+        "HBLobbyListSnapshot",
+        "HBSteamMatchmakingServers",
+        "HBSteamServerList",
+        "HBSteamGameServer",
+        "HBLobbyStateStore",
+        "HBSteamHostMigration",
+        "HBSteamAvatarCache",
+        "HBSteamAvatarAtlas",
+        "HBSteamFriendsSnapshot",
+        "HBSteamPersonaRequests",
+        "HBSteamRichPresence",
+        "HBSteamImageCache",
+        "HBSteamPeerGroup",
     ]
@@ -33,6 +33,7 @@
 #include "core/config/project_settings.h"
 #include "steamworks.h"
 #include "steamworks_constants.gen.h"
+#include "steamworks_messages.gen.h"
 
 Steamworks *steamworks_singleton;
 void initialize_steamworks_module(ModuleInitializationLevel p_level) {
@@ -59,11 +60,23 @@ void initialize_steamworks_module(ModuleInitializationLevel p_level) {
 	GDREGISTER_ABSTRACT_CLASS(HBSteamInput);
 	GDREGISTER_ABSTRACT_CLASS(HBSteamFriends);
 	GDREGISTER_ABSTRACT_CLASS(HBSteamFriend);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamFriendsSnapshot);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamAvatarCache);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamAvatarAtlas);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamImageCache);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamPersonaRequests);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamRichPresence);
 	GDREGISTER_ABSTRACT_CLASS(HBSteamLobby);
 	GDREGISTER_ABSTRACT_CLASS(HBSteamMatchmaking);
 	GDREGISTER_ABSTRACT_CLASS(HBLobbyListQuery);
+	GDREGISTER_ABSTRACT_CLASS(HBLobbyListSnapshot);
+	GDREGISTER_ABSTRACT_CLASS(HBLobbyStateStore);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamMatchmakingServers);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamServerList);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamGameServer);
 	GDREGISTER_ABSTRACT_CLASS(SteamworksConstants);
 	GDREGISTER_ABSTRACT_CLASS(HBSteamNetworking);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamNetworkingUtils);
 	GDREGISTER_ABSTRACT_CLASS(SteamP2PPacket);
 	GDREGISTER_ABSTRACT_CLASS(HBSteamUGCQuery);
 	GDREGISTER_ABSTRACT_CLASS(HBSteamUGCItem);
@@ -81,6 +94,14 @@ void initialize_steamworks_module(ModuleInitializationLevel p_level) {
 	GDREGISTER_ABSTRACT_CLASS(HBSteamUGCItemUpdateProgress);
 	GDREGISTER_ABSTRACT_CLASS(HBSteamNetworkingMessages);
 	GDREGISTER_ABSTRACT_CLASS(HBSteamNetworkingMessage);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamPeerGroup);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamSnapshotReplicator);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamInputTransport);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamClockSync);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamHostMigration);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamVoiceChat);
+	GDREGISTER_ABSTRACT_CLASS(HBSteamSchemaMessage);
+	register_steam_schema_messages();
 }
 
 void uninitialize_steamworks_module(ModuleInitializationLevel p_level) {
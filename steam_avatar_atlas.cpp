@@ -0,0 +1,268 @@
+/**************************************************************************/
+/*  steam_avatar_atlas.cpp                                                */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_avatar_atlas.h"
+
+#include "steamworks.h"
+
+bool HBSteamAvatarAtlas::_allocate_in_page(uint32_t p_page, const Size2i &p_size, Rect2i &r_rect) {
+	Page &page = pages[p_page];
+	int slot_width = p_size.width + SLOT_PADDING * 2;
+	int slot_height = p_size.height + SLOT_PADDING * 2;
+	for (Shelf &shelf : page.shelves) {
+		if (shelf.height == slot_height && shelf.next_x + slot_width <= page_size) {
+			r_rect = Rect2i(shelf.next_x + SLOT_PADDING, shelf.y + SLOT_PADDING, p_size.width, p_size.height);
+			shelf.next_x += slot_width;
+			return true;
+		}
+	}
+	if (page.next_y + slot_height > page_size || slot_width > page_size) {
+		return false;
+	}
+	Shelf shelf;
+	shelf.y = page.next_y;
+	shelf.height = slot_height;
+	shelf.next_x = slot_width;
+	page.shelves.push_back(shelf);
+	page.next_y += slot_height;
+	r_rect = Rect2i(SLOT_PADDING, shelf.y + SLOT_PADDING, p_size.width, p_size.height);
+	return true;
+}
+
+int HBSteamAvatarAtlas::_allocate_slot(const Size2i &p_size) {
+	Slot slot;
+	for (uint32_t i = 0; i < pages.size(); i++) {
+		if (_allocate_in_page(i, p_size, slot.rect)) {
+			slot.page = i;
+			slots.push_back(slot);
+			return slots.size() - 1;
+		}
+	}
+	if (pages.size() < (uint32_t)max_pages) {
+		Page page;
+		page.image = Image::create_empty(page_size, page_size, false, Image::FORMAT_RGBA8);
+		page.texture = ImageTexture::create_from_image(page.image);
+		pages.push_back(page);
+		if (_allocate_in_page(pages.size() - 1, p_size, slot.rect)) {
+			slot.page = pages.size() - 1;
+			slots.push_back(slot);
+			return slots.size() - 1;
+		}
+	}
+
+	// Out of space, take over the least recently used slot of the same size.
+	int lru_slot = -1;
+	for (uint32_t i = 0; i < slots.size(); i++) {
+		if (slots[i].rect.size == p_size && (lru_slot == -1 || slots[i].last_used < slots[lru_slot].last_used)) {
+			lru_slot = i;
+		}
+	}
+	if (lru_slot == -1) {
+		return -1;
+	}
+	Slot &evicted = slots[lru_slot];
+	slot_lookup[evicted.size].erase(evicted.steam_id);
+	// Whoever still holds the evicted region keeps showing the right avatar, just from its own texture.
+	evicted.texture->set_atlas(avatar_cache->get_avatar(evicted.steam_id, evicted.size));
+	evicted.texture->set_region(Rect2());
+	evicted.texture.unref();
+	evictions++;
+	return lru_slot;
+}
+
+int HBSteamAvatarAtlas::_place_avatar(uint64_t p_steam_id, HBSteamAvatarCache::AvatarSize p_size, const Ref<Image> &p_image) {
+	int slot_index = _allocate_slot(p_image->get_size());
+	if (slot_index == -1) {
+		return -1;
+	}
+	Slot &slot = slots[slot_index];
+	slot.steam_id = p_steam_id;
+	slot.size = p_size;
+	slot.last_used = ++use_tick;
+	slot.texture.instantiate();
+	slot.texture->set_atlas(pages[slot.page].texture);
+	slot.texture->set_region(Rect2(slot.rect));
+	slot_lookup[p_size].insert(p_steam_id, slot_index);
+	_blit(slot, p_image);
+	return slot_index;
+}
+
+void HBSteamAvatarAtlas::_blit(Slot &p_slot, const Ref<Image> &p_image) {
+	Page &page = pages[p_slot.page];
+	Ref<Image> image = p_image;
+	if (image->get_format() != Image::FORMAT_RGBA8) {
+		image = p_image->duplicate();
+		image->convert(Image::FORMAT_RGBA8);
+	}
+	page.image->blit_rect(image, Rect2i(Point2i(), p_slot.rect.size), p_slot.rect.position);
+	page.dirty = true;
+	blits++;
+	_queue_upload();
+}
+
+void HBSteamAvatarAtlas::_queue_upload() {
+	// Pages are uploaded once per frame no matter how many avatars were packed into them.
+	if (!upload_queued) {
+		upload_queued = true;
+		Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamAvatarAtlas::flush));
+	}
+}
+
+void HBSteamAvatarAtlas::_on_avatar_loaded(int64_t p_steam_id, int p_size, const Ref<Texture2D> &p_texture) {
+	HBSteamAvatarCache::AvatarSize size = (HBSteamAvatarCache::AvatarSize)p_size;
+	if (const uint32_t *slot_index = slot_lookup[size].getptr(p_steam_id)) {
+		// The avatar changed, replace it in place if it's still the same size.
+		Slot &slot = slots[*slot_index];
+		Ref<Image> image = avatar_cache->get_avatar_image(p_steam_id, size);
+		if (image.is_valid() && image->get_size() == slot.rect.size) {
+			_blit(slot, image);
+			return;
+		}
+	}
+	if (!pending_avatars[size].erase(p_steam_id)) {
+		return;
+	}
+	Ref<Image> image = avatar_cache->get_avatar_image(p_steam_id, size);
+	if (image.is_null() || _place_avatar(p_steam_id, size, image) == -1) {
+		// Doesn't fit, fall back to the avatar's own texture.
+		emit_signal("avatar_loaded", p_steam_id, p_size, p_texture);
+		return;
+	}
+	emit_signal("avatar_loaded", p_steam_id, p_size, slots[slot_lookup[size][p_steam_id]].texture);
+}
+
+void HBSteamAvatarAtlas::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_avatar", "steam_id", "size"), &HBSteamAvatarAtlas::get_avatar, DEFVAL(HBSteamAvatarCache::AVATAR_SIZE_MEDIUM));
+	ClassDB::bind_method(D_METHOD("has_avatar", "steam_id", "size"), &HBSteamAvatarAtlas::has_avatar, DEFVAL(HBSteamAvatarCache::AVATAR_SIZE_MEDIUM));
+	ClassDB::bind_method(D_METHOD("flush"), &HBSteamAvatarAtlas::flush);
+	ClassDB::bind_method(D_METHOD("clear"), &HBSteamAvatarAtlas::clear);
+	ClassDB::bind_method(D_METHOD("get_page_count"), &HBSteamAvatarAtlas::get_page_count);
+	ClassDB::bind_method(D_METHOD("get_page_texture", "page"), &HBSteamAvatarAtlas::get_page_texture);
+	ClassDB::bind_method(D_METHOD("get_stats"), &HBSteamAvatarAtlas::get_stats);
+	ClassDB::bind_method(D_METHOD("get_page_size"), &HBSteamAvatarAtlas::get_page_size);
+	ClassDB::bind_method(D_METHOD("get_max_pages"), &HBSteamAvatarAtlas::get_max_pages);
+	ClassDB::bind_method(D_METHOD("get_avatar_cache"), &HBSteamAvatarAtlas::get_avatar_cache);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "page_size"), "", "get_page_size");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_pages"), "", "get_max_pages");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "avatar_cache", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamAvatarCache"), "", "get_avatar_cache");
+
+	ADD_SIGNAL(MethodInfo("avatar_loaded", PropertyInfo(Variant::INT, "steam_id"), PropertyInfo(Variant::INT, "size"), PropertyInfo(Variant::OBJECT, "texture", PROPERTY_HINT_RESOURCE_TYPE, "Texture2D")));
+}
+
+Ref<Texture2D> HBSteamAvatarAtlas::get_avatar(uint64_t p_steam_id, HBSteamAvatarCache::AvatarSize p_size) {
+	ERR_FAIL_INDEX_V(p_size, HBSteamAvatarCache::AVATAR_SIZE_MAX, Ref<Texture2D>());
+	if (const uint32_t *slot_index = slot_lookup[p_size].getptr(p_steam_id)) {
+		Slot &slot = slots[*slot_index];
+		slot.last_used = ++use_tick;
+		hits++;
+		return slot.texture;
+	}
+	misses++;
+	Ref<Image> image = avatar_cache->get_avatar_image(p_steam_id, p_size);
+	if (image.is_null()) {
+		pending_avatars[p_size].insert(p_steam_id);
+		return Ref<Texture2D>();
+	}
+	int slot_index = _place_avatar(p_steam_id, p_size, image);
+	if (slot_index == -1) {
+		return avatar_cache->get_avatar(p_steam_id, p_size);
+	}
+	return slots[slot_index].texture;
+}
+
+bool HBSteamAvatarAtlas::has_avatar(uint64_t p_steam_id, HBSteamAvatarCache::AvatarSize p_size) const {
+	ERR_FAIL_INDEX_V(p_size, HBSteamAvatarCache::AVATAR_SIZE_MAX, false);
+	return slot_lookup[p_size].has(p_steam_id);
+}
+
+void HBSteamAvatarAtlas::flush() {
+	upload_queued = false;
+	for (Page &page : pages) {
+		if (page.dirty) {
+			page.dirty = false;
+			page.texture->update(page.image);
+			uploads++;
+		}
+	}
+}
+
+void HBSteamAvatarAtlas::clear() {
+	for (Slot &slot : slots) {
+		slot.texture->set_atlas(avatar_cache->get_avatar(slot.steam_id, slot.size));
+		slot.texture->set_region(Rect2());
+	}
+	slots.clear();
+	pages.clear();
+	for (int i = 0; i < HBSteamAvatarCache::AVATAR_SIZE_MAX; i++) {
+		slot_lookup[i].clear();
+		pending_avatars[i].clear();
+	}
+}
+
+int HBSteamAvatarAtlas::get_page_count() const {
+	return pages.size();
+}
+
+Ref<Texture2D> HBSteamAvatarAtlas::get_page_texture(int p_page) const {
+	ERR_FAIL_INDEX_V(p_page, (int)pages.size(), Ref<Texture2D>());
+	return pages[p_page].texture;
+}
+
+Dictionary HBSteamAvatarAtlas::get_stats() const {
+	Dictionary stats;
+	stats["pages"] = pages.size();
+	stats["slots"] = slots.size();
+	stats["hits"] = hits;
+	stats["misses"] = misses;
+	stats["evictions"] = evictions;
+	stats["blits"] = blits;
+	stats["uploads"] = uploads;
+	return stats;
+}
+
+int HBSteamAvatarAtlas::get_page_size() const {
+	return page_size;
+}
+
+int HBSteamAvatarAtlas::get_max_pages() const {
+	return max_pages;
+}
+
+Ref<HBSteamAvatarCache> HBSteamAvatarAtlas::get_avatar_cache() const {
+	return avatar_cache;
+}
+
+HBSteamAvatarAtlas::HBSteamAvatarAtlas(const Ref<HBSteamAvatarCache> &p_avatar_cache, int p_page_size, int p_max_pages) {
+	avatar_cache = p_avatar_cache;
+	page_size = p_page_size;
+	max_pages = p_max_pages;
+	avatar_cache->connect("avatar_loaded", callable_mp(this, &HBSteamAvatarAtlas::_on_avatar_loaded));
+}
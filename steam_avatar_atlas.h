@@ -0,0 +1,118 @@
+/**************************************************************************/
+/*  steam_avatar_atlas.h                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_AVATAR_ATLAS_H
+#define STEAM_AVATAR_ATLAS_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/hash_set.h"
+#include "core/templates/local_vector.h"
+#include "scene/resources/atlas_texture.h"
+#include "steam_avatar_cache.h"
+
+// Packs avatars from an HBSteamAvatarCache into a few large textures, so long friend and lobby
+// lists draw from a handful of textures and batch, instead of uploading one texture per avatar.
+class HBSteamAvatarAtlas : public RefCounted {
+	GDCLASS(HBSteamAvatarAtlas, RefCounted);
+
+	// Transparent border around every slot, so filtering doesn't bleed neighbours in.
+	static const int SLOT_PADDING = 1;
+
+	// Avatars of one size are all the same size, so each shelf holds a single size and freed
+	// slots can be reused by the next avatar of that size as is.
+	struct Shelf {
+		int y = 0;
+		int height = 0;
+		int next_x = 0;
+	};
+
+	struct Page {
+		Ref<Image> image;
+		Ref<ImageTexture> texture;
+		LocalVector<Shelf> shelves;
+		int next_y = 0;
+		bool dirty = false;
+	};
+	LocalVector<Page> pages;
+
+	struct Slot {
+		uint32_t page = 0;
+		Rect2i rect;
+		uint64_t steam_id = 0;
+		HBSteamAvatarCache::AvatarSize size = HBSteamAvatarCache::AVATAR_SIZE_MEDIUM;
+		uint64_t last_used = 0;
+		Ref<AtlasTexture> texture;
+	};
+	LocalVector<Slot> slots;
+	HashMap<uint64_t, uint32_t> slot_lookup[HBSteamAvatarCache::AVATAR_SIZE_MAX];
+	// Avatars that were asked for before they loaded.
+	HashSet<uint64_t> pending_avatars[HBSteamAvatarCache::AVATAR_SIZE_MAX];
+
+	Ref<HBSteamAvatarCache> avatar_cache;
+	int page_size = 1024;
+	int max_pages = 2;
+	uint64_t use_tick = 0;
+	bool upload_queued = false;
+
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+	uint64_t blits = 0;
+	uint64_t uploads = 0;
+
+	bool _allocate_in_page(uint32_t p_page, const Size2i &p_size, Rect2i &r_rect);
+	int _allocate_slot(const Size2i &p_size);
+	int _place_avatar(uint64_t p_steam_id, HBSteamAvatarCache::AvatarSize p_size, const Ref<Image> &p_image);
+	void _blit(Slot &p_slot, const Ref<Image> &p_image);
+	void _queue_upload();
+	void _on_avatar_loaded(int64_t p_steam_id, int p_size, const Ref<Texture2D> &p_texture);
+
+protected:
+	static void _bind_methods();
+
+public:
+	Ref<Texture2D> get_avatar(uint64_t p_steam_id, HBSteamAvatarCache::AvatarSize p_size = HBSteamAvatarCache::AVATAR_SIZE_MEDIUM);
+	bool has_avatar(uint64_t p_steam_id, HBSteamAvatarCache::AvatarSize p_size = HBSteamAvatarCache::AVATAR_SIZE_MEDIUM) const;
+	void flush();
+	void clear();
+
+	int get_page_count() const;
+	Ref<Texture2D> get_page_texture(int p_page) const;
+	Dictionary get_stats() const;
+
+	int get_page_size() const;
+	int get_max_pages() const;
+	Ref<HBSteamAvatarCache> get_avatar_cache() const;
+
+	HBSteamAvatarAtlas(const Ref<HBSteamAvatarCache> &p_avatar_cache, int p_page_size, int p_max_pages);
+};
+
+#endif // STEAM_AVATAR_ATLAS_H
@@ -0,0 +1,361 @@
+/**************************************************************************/
+/*  steam_avatar_cache.cpp                                                */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_avatar_cache.h"
+
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/object/worker_thread_pool.h"
+#include "core/templates/hashfuncs.h"
+#include "steam/steam_api_flat.h"
+#include "steam_avatar_atlas.h"
+#include "steam_image_cache.h"
+#include "steamworks.h"
+
+static const uint32_t DISK_CACHE_MAGIC = 0x56414248; // "HBAV"
+// Large avatars are 184x184, anything much bigger than that in the disk cache is garbage.
+static const uint32_t MAX_AVATAR_DIMENSION = 1024;
+
+int HBSteamAvatarCache::get_avatar_image_handle(uint64_t p_steam_id, AvatarSize p_size) {
+	ISteamFriends *friends = Steamworks::get_singleton()->get_friends()->get_interface();
+	switch (p_size) {
+		case AVATAR_SIZE_SMALL:
+			return SteamAPI_ISteamFriends_GetSmallFriendAvatar(friends, p_steam_id);
+		case AVATAR_SIZE_MEDIUM:
+			return SteamAPI_ISteamFriends_GetMediumFriendAvatar(friends, p_steam_id);
+		case AVATAR_SIZE_LARGE:
+			// Returns -1 and triggers AvatarImageLoaded_t if the image isn't downloaded yet.
+			return SteamAPI_ISteamFriends_GetLargeFriendAvatar(friends, p_steam_id);
+		default:
+			return 0;
+	}
+}
+
+String HBSteamAvatarCache::_get_disk_cache_file(const String &p_disk_cache_path, uint64_t p_steam_id, AvatarSize p_size) {
+	return p_disk_cache_path.path_join(vformat("%d_%d.avatar", (int64_t)p_steam_id, (int)p_size));
+}
+
+void HBSteamAvatarCache::_refresh_avatar(uint64_t p_steam_id, AvatarSize p_size, Avatar &p_avatar) {
+	int image_handle = get_avatar_image_handle(p_steam_id, p_size);
+	if (image_handle > 0) {
+		if (image_handle == p_avatar.image_handle && p_avatar.state != AVATAR_STATE_WAITING) {
+			return;
+		}
+		p_avatar.image_handle = image_handle;
+		if (p_avatar.state != AVATAR_STATE_LOADED) {
+			p_avatar.state = AVATAR_STATE_LOADING;
+		}
+		_queue_job(p_steam_id, p_size, image_handle, p_avatar.hash);
+		return;
+	}
+	if (image_handle == 0) {
+		ISteamFriends *friends = Steamworks::get_singleton()->get_friends()->get_interface();
+		if (!SteamAPI_ISteamFriends_RequestUserInformation(friends, p_steam_id, false)) {
+			// Steam already knows everything about this user, they just don't have an avatar.
+			p_avatar.state = AVATAR_STATE_LOADED;
+			return;
+		}
+	}
+	if (p_avatar.state != AVATAR_STATE_LOADED) {
+		p_avatar.state = AVATAR_STATE_WAITING;
+	}
+	if (use_disk_cache && p_avatar.texture.is_null() && !p_avatar.disk_load_queued) {
+		p_avatar.disk_load_queued = true;
+		_queue_job(p_steam_id, p_size, 0, 0);
+	}
+}
+
+void HBSteamAvatarCache::_queue_job(uint64_t p_steam_id, AvatarSize p_size, int p_image_handle, uint32_t p_known_hash) {
+	LoadJob job;
+	job.steam_id = p_steam_id;
+	job.size = p_size;
+	job.image_handle = p_image_handle;
+	job.known_hash = p_known_hash;
+	queued_jobs.push_back(job);
+	// Everything requested this frame goes out as a single group task.
+	if (!dispatch_queued && load_batch_owner.is_null()) {
+		dispatch_queued = true;
+		Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamAvatarCache::_dispatch_jobs));
+	}
+}
+
+void HBSteamAvatarCache::_dispatch_jobs() {
+	dispatch_queued = false;
+	if (queued_jobs.is_empty() || load_batch_owner.is_valid()) {
+		return;
+	}
+	if (use_disk_cache && !disk_cache_dir_created) {
+		disk_cache_dir_created = DirAccess::make_dir_recursive_absolute(disk_cache_path) == OK;
+	}
+	load_batch.utils = Steamworks::get_singleton()->get_utils()->get_interface();
+	load_batch.disk_cache_path = disk_cache_path;
+	load_batch.use_disk_cache = use_disk_cache && disk_cache_dir_created;
+	load_batch.generate_mipmaps = generate_mipmaps;
+	SWAP(load_batch.jobs, queued_jobs);
+	load_batch_owner = Ref<HBSteamAvatarCache>(this);
+	WorkerThreadPool::GroupID group_id = WorkerThreadPool::get_singleton()->add_template_group_task(this, &HBSteamAvatarCache::_load_avatar, &load_batch, load_batch.jobs.size(), -1, false, "Load Steam avatars");
+	Steamworks::get_singleton()->add_worker_group_task_callback(group_id, callable_mp(this, &HBSteamAvatarCache::_on_load_batch_completed));
+}
+
+void HBSteamAvatarCache::_load_avatar(uint32_t p_index, LoadBatch *p_batch) {
+	LoadJob &job = p_batch->jobs[p_index];
+	uint32_t width = 0;
+	uint32_t height = 0;
+	Vector<uint8_t> data;
+	String cache_file = _get_disk_cache_file(p_batch->disk_cache_path, job.steam_id, job.size);
+
+	if (job.image_handle != 0) {
+		if (!HBSteamImageCache::read_image(p_batch->utils, job.image_handle, width, height, data)) {
+			return;
+		}
+		job.hash = hash_murmur3_buffer(data.ptr(), data.size());
+		if (job.hash == job.known_hash) {
+			return;
+		}
+		if (p_batch->use_disk_cache) {
+			Ref<FileAccess> file = FileAccess::open(cache_file, FileAccess::WRITE);
+			if (file.is_valid()) {
+				file->store_32(DISK_CACHE_MAGIC);
+				file->store_32(width);
+				file->store_32(height);
+				file->store_32(job.hash);
+				file->store_buffer(data.ptr(), data.size());
+			}
+		}
+	} else {
+		Ref<FileAccess> file = FileAccess::open(cache_file, FileAccess::READ);
+		if (file.is_null() || file->get_32() != DISK_CACHE_MAGIC) {
+			return;
+		}
+		width = file->get_32();
+		height = file->get_32();
+		uint32_t hash = file->get_32();
+		if (width == 0 || height == 0 || width > MAX_AVATAR_DIMENSION || height > MAX_AVATAR_DIMENSION) {
+			return;
+		}
+		data.resize(width * height * 4);
+		if (file->get_buffer(data.ptrw(), data.size()) != (uint64_t)data.size() || hash_murmur3_buffer(data.ptr(), data.size()) != hash) {
+			return;
+		}
+		job.hash = hash;
+	}
+
+	job.image = Image::create_from_data(width, height, false, Image::FORMAT_RGBA8, data);
+	if (job.image.is_valid() && p_batch->generate_mipmaps) {
+		job.image->generate_mipmaps();
+	}
+}
+
+void HBSteamAvatarCache::_on_load_batch_completed() {
+	for (const LoadJob &job : load_batch.jobs) {
+		UserAvatars *user_avatars = avatars.getptr(job.steam_id);
+		if (!user_avatars) {
+			// Cleared while it was loading.
+			continue;
+		}
+		Avatar &avatar = user_avatars->sizes[job.size];
+		bool from_steam = job.image_handle != 0;
+		if (from_steam) {
+			if (job.image_handle != avatar.image_handle) {
+				// A newer image was queued after this one.
+				continue;
+			}
+			if (job.image.is_null()) {
+				if (job.hash != 0 && job.hash == avatar.hash) {
+					// Same image as the one we loaded from disk.
+					avatar.state = AVATAR_STATE_LOADED;
+					unchanged_loads++;
+				} else if (avatar.state != AVATAR_STATE_LOADED) {
+					avatar.state = AVATAR_STATE_NONE;
+				}
+				continue;
+			}
+			avatar.state = AVATAR_STATE_LOADED;
+			steam_loads++;
+		} else {
+			avatar.disk_load_queued = false;
+			if (job.image.is_null() || avatar.texture.is_valid()) {
+				continue;
+			}
+			disk_loads++;
+		}
+
+		avatar.hash = job.hash;
+		avatar.image = job.image;
+		if (avatar.texture.is_valid()) {
+			avatar.texture->set_image(job.image);
+		} else {
+			avatar.texture = ImageTexture::create_from_image(job.image);
+		}
+		emit_signal("avatar_loaded", (int64_t)job.steam_id, (int)job.size, avatar.texture);
+		HBSteamFriend::notify_avatar_loaded(job.steam_id, job.size, avatar.texture);
+	}
+	load_batch.jobs.clear();
+
+	Ref<HBSteamAvatarCache> self = load_batch_owner;
+	load_batch_owner.unref();
+	if (!queued_jobs.is_empty()) {
+		_dispatch_jobs();
+	}
+}
+
+void HBSteamAvatarCache::_on_persona_state_change(Ref<SteamworksCallbackData> p_callback) {
+	const PersonaStateChange_t *state_change = p_callback->get_data<PersonaStateChange_t>();
+	if (!(state_change->m_nChangeFlags & k_EPersonaChangeAvatar)) {
+		return;
+	}
+	UserAvatars *user_avatars = avatars.getptr(state_change->m_ulSteamID);
+	if (!user_avatars) {
+		return;
+	}
+	for (int i = 0; i < AVATAR_SIZE_MAX; i++) {
+		if (user_avatars->sizes[i].state != AVATAR_STATE_NONE) {
+			_refresh_avatar(state_change->m_ulSteamID, (AvatarSize)i, user_avatars->sizes[i]);
+		}
+	}
+}
+
+void HBSteamAvatarCache::_on_avatar_image_loaded(Ref<SteamworksCallbackData> p_callback) {
+	const AvatarImageLoaded_t *image_loaded = p_callback->get_data<AvatarImageLoaded_t>();
+	uint64_t steam_id = image_loaded->m_steamID.ConvertToUint64();
+	UserAvatars *user_avatars = avatars.getptr(steam_id);
+	if (!user_avatars) {
+		return;
+	}
+	for (int i = 0; i < AVATAR_SIZE_MAX; i++) {
+		if (user_avatars->sizes[i].state == AVATAR_STATE_WAITING) {
+			_refresh_avatar(steam_id, (AvatarSize)i, user_avatars->sizes[i]);
+		}
+	}
+}
+
+void HBSteamAvatarCache::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_avatar", "steam_id", "size"), &HBSteamAvatarCache::get_avatar, DEFVAL(AVATAR_SIZE_MEDIUM));
+	ClassDB::bind_method(D_METHOD("get_avatar_image", "steam_id", "size"), &HBSteamAvatarCache::get_avatar_image, DEFVAL(AVATAR_SIZE_MEDIUM));
+	ClassDB::bind_method(D_METHOD("is_avatar_loaded", "steam_id", "size"), &HBSteamAvatarCache::is_avatar_loaded, DEFVAL(AVATAR_SIZE_MEDIUM));
+	ClassDB::bind_method(D_METHOD("create_atlas", "page_size", "max_pages"), &HBSteamAvatarCache::create_atlas, DEFVAL(1024), DEFVAL(2));
+	ClassDB::bind_method(D_METHOD("clear"), &HBSteamAvatarCache::clear);
+	ClassDB::bind_method(D_METHOD("get_stats"), &HBSteamAvatarCache::get_stats);
+	ClassDB::bind_method(D_METHOD("set_use_disk_cache", "use_disk_cache"), &HBSteamAvatarCache::set_use_disk_cache);
+	ClassDB::bind_method(D_METHOD("get_use_disk_cache"), &HBSteamAvatarCache::get_use_disk_cache);
+	ClassDB::bind_method(D_METHOD("set_disk_cache_path", "disk_cache_path"), &HBSteamAvatarCache::set_disk_cache_path);
+	ClassDB::bind_method(D_METHOD("get_disk_cache_path"), &HBSteamAvatarCache::get_disk_cache_path);
+	ClassDB::bind_method(D_METHOD("set_generate_mipmaps", "generate_mipmaps"), &HBSteamAvatarCache::set_generate_mipmaps);
+	ClassDB::bind_method(D_METHOD("get_generate_mipmaps"), &HBSteamAvatarCache::get_generate_mipmaps);
+
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_disk_cache"), "set_use_disk_cache", "get_use_disk_cache");
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "disk_cache_path", PROPERTY_HINT_DIR), "set_disk_cache_path", "get_disk_cache_path");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "generate_mipmaps"), "set_generate_mipmaps", "get_generate_mipmaps");
+
+	ADD_SIGNAL(MethodInfo("avatar_loaded", PropertyInfo(Variant::INT, "steam_id"), PropertyInfo(Variant::INT, "size"), PropertyInfo(Variant::OBJECT, "texture", PROPERTY_HINT_RESOURCE_TYPE, "Texture2D")));
+
+	BIND_ENUM_CONSTANT(AVATAR_SIZE_SMALL);
+	BIND_ENUM_CONSTANT(AVATAR_SIZE_MEDIUM);
+	BIND_ENUM_CONSTANT(AVATAR_SIZE_LARGE);
+}
+
+Ref<Texture2D> HBSteamAvatarCache::get_avatar(uint64_t p_steam_id, AvatarSize p_size) {
+	ERR_FAIL_COND_V_MSG(p_steam_id == 0, Ref<Texture2D>(), "An invalid steam user ID was given.");
+	ERR_FAIL_INDEX_V(p_size, AVATAR_SIZE_MAX, Ref<Texture2D>());
+	requests++;
+	Avatar &avatar = avatars[p_steam_id].sizes[p_size];
+	if (avatar.state == AVATAR_STATE_LOADED) {
+		hits++;
+	} else if (avatar.state == AVATAR_STATE_NONE) {
+		_refresh_avatar(p_steam_id, p_size, avatar);
+	}
+	return avatar.texture;
+}
+
+Ref<Image> HBSteamAvatarCache::get_avatar_image(uint64_t p_steam_id, AvatarSize p_size) {
+	if (get_avatar(p_steam_id, p_size).is_null()) {
+		return Ref<Image>();
+	}
+	return avatars[p_steam_id].sizes[p_size].image;
+}
+
+bool HBSteamAvatarCache::is_avatar_loaded(uint64_t p_steam_id, AvatarSize p_size) const {
+	ERR_FAIL_INDEX_V(p_size, AVATAR_SIZE_MAX, false);
+	const UserAvatars *user_avatars = avatars.getptr(p_steam_id);
+	return user_avatars && user_avatars->sizes[p_size].state == AVATAR_STATE_LOADED;
+}
+
+Ref<HBSteamAvatarAtlas> HBSteamAvatarCache::create_atlas(int p_page_size, int p_max_pages) {
+	ERR_FAIL_COND_V_MSG(p_page_size < 256 || p_page_size > 8192, Ref<HBSteamAvatarAtlas>(), "Avatar atlas pages must be between 256 and 8192 pixels wide.");
+	ERR_FAIL_COND_V_MSG(p_max_pages < 1, Ref<HBSteamAvatarAtlas>(), "Avatar atlases need at least one page.");
+	return memnew(HBSteamAvatarAtlas(Ref<HBSteamAvatarCache>(this), p_page_size, p_max_pages));
+}
+
+void HBSteamAvatarCache::clear() {
+	avatars.clear();
+	queued_jobs.clear();
+}
+
+Dictionary HBSteamAvatarCache::get_stats() const {
+	Dictionary stats;
+	stats["users"] = avatars.size();
+	stats["requests"] = requests;
+	stats["hits"] = hits;
+	stats["steam_loads"] = steam_loads;
+	stats["disk_loads"] = disk_loads;
+	stats["unchanged_loads"] = unchanged_loads;
+	stats["pending_loads"] = queued_jobs.size() + load_batch.jobs.size();
+	return stats;
+}
+
+void HBSteamAvatarCache::set_use_disk_cache(bool p_use_disk_cache) {
+	use_disk_cache = p_use_disk_cache;
+}
+
+bool HBSteamAvatarCache::get_use_disk_cache() const {
+	return use_disk_cache;
+}
+
+void HBSteamAvatarCache::set_disk_cache_path(const String &p_disk_cache_path) {
+	disk_cache_path = p_disk_cache_path;
+	disk_cache_dir_created = false;
+}
+
+String HBSteamAvatarCache::get_disk_cache_path() const {
+	return disk_cache_path;
+}
+
+void HBSteamAvatarCache::set_generate_mipmaps(bool p_generate_mipmaps) {
+	generate_mipmaps = p_generate_mipmaps;
+}
+
+bool HBSteamAvatarCache::get_generate_mipmaps() const {
+	return generate_mipmaps;
+}
+
+HBSteamAvatarCache::HBSteamAvatarCache() {
+	Steamworks::get_singleton()->add_callback(PersonaStateChange_t::k_iCallback, callable_mp(this, &HBSteamAvatarCache::_on_persona_state_change));
+	Steamworks::get_singleton()->add_callback(AvatarImageLoaded_t::k_iCallback, callable_mp(this, &HBSteamAvatarCache::_on_avatar_image_loaded));
+}
@@ -0,0 +1,149 @@
+/**************************************************************************/
+/*  steam_avatar_cache.h                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_AVATAR_CACHE_H
+#define STEAM_AVATAR_CACHE_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+#include "scene/resources/image_texture.h"
+#include "steamworks_callback_data.h"
+
+class ISteamUtils;
+class HBSteamAvatarAtlas;
+
+// Avatars are converted on the worker thread pool and shared between every HBSteamFriend, so a
+// friend object going away doesn't lose its avatar. Converted avatars are also written to disk,
+// so the next run can show them before Steam has downloaded them again.
+class HBSteamAvatarCache : public RefCounted {
+	GDCLASS(HBSteamAvatarCache, RefCounted);
+
+public:
+	enum AvatarSize {
+		AVATAR_SIZE_SMALL,
+		AVATAR_SIZE_MEDIUM,
+		AVATAR_SIZE_LARGE,
+		AVATAR_SIZE_MAX,
+	};
+
+private:
+	enum AvatarState {
+		AVATAR_STATE_NONE,
+		// Steam doesn't have the image yet, PersonaStateChange_t or AvatarImageLoaded_t will tell us when it does.
+		AVATAR_STATE_WAITING,
+		AVATAR_STATE_LOADING,
+		AVATAR_STATE_LOADED,
+	};
+
+	struct Avatar {
+		AvatarState state = AVATAR_STATE_NONE;
+		// Kept when the avatar changes, the new image is swapped into it so everyone holding it sees the change.
+		Ref<ImageTexture> texture;
+		// Kept on the CPU so atlases can pack it without reading the texture back.
+		Ref<Image> image;
+		int image_handle = 0;
+		uint32_t hash = 0;
+		bool disk_load_queued = false;
+	};
+	struct UserAvatars {
+		Avatar sizes[AVATAR_SIZE_MAX];
+	};
+	HashMap<uint64_t, UserAvatars> avatars;
+
+	struct LoadJob {
+		uint64_t steam_id = 0;
+		AvatarSize size = AVATAR_SIZE_MEDIUM;
+		// Steam image to convert, 0 reads the avatar from the disk cache instead.
+		int image_handle = 0;
+		// Hash of the image we already have, Steam images that match it aren't converted again.
+		uint32_t known_hash = 0;
+		uint32_t hash = 0;
+		Ref<Image> image;
+	};
+	struct LoadBatch {
+		ISteamUtils *utils = nullptr;
+		String disk_cache_path;
+		bool use_disk_cache = false;
+		bool generate_mipmaps = false;
+		LocalVector<LoadJob> jobs;
+	};
+	// The batch being converted by the worker threads, new jobs wait in queued_jobs until it's done.
+	LoadBatch load_batch;
+	Ref<HBSteamAvatarCache> load_batch_owner;
+	LocalVector<LoadJob> queued_jobs;
+	bool dispatch_queued = false;
+
+	bool use_disk_cache = true;
+	String disk_cache_path = "user://steam_avatar_cache";
+	bool disk_cache_dir_created = false;
+	bool generate_mipmaps = true;
+
+	uint64_t requests = 0;
+	uint64_t hits = 0;
+	uint64_t steam_loads = 0;
+	uint64_t disk_loads = 0;
+	uint64_t unchanged_loads = 0;
+
+	static String _get_disk_cache_file(const String &p_disk_cache_path, uint64_t p_steam_id, AvatarSize p_size);
+	void _refresh_avatar(uint64_t p_steam_id, AvatarSize p_size, Avatar &p_avatar);
+	void _queue_job(uint64_t p_steam_id, AvatarSize p_size, int p_image_handle, uint32_t p_known_hash);
+	void _dispatch_jobs();
+	void _load_avatar(uint32_t p_index, LoadBatch *p_batch);
+	void _on_load_batch_completed();
+	void _on_persona_state_change(Ref<SteamworksCallbackData> p_callback);
+	void _on_avatar_image_loaded(Ref<SteamworksCallbackData> p_callback);
+
+protected:
+	static void _bind_methods();
+
+public:
+	Ref<Texture2D> get_avatar(uint64_t p_steam_id, AvatarSize p_size = AVATAR_SIZE_MEDIUM);
+	Ref<Image> get_avatar_image(uint64_t p_steam_id, AvatarSize p_size = AVATAR_SIZE_MEDIUM);
+	bool is_avatar_loaded(uint64_t p_steam_id, AvatarSize p_size = AVATAR_SIZE_MEDIUM) const;
+	// Steam's image handle for an avatar, 0 if the user has none and -1 while a large avatar is downloading.
+	static int get_avatar_image_handle(uint64_t p_steam_id, AvatarSize p_size);
+	Ref<HBSteamAvatarAtlas> create_atlas(int p_page_size = 1024, int p_max_pages = 2);
+	void clear();
+	Dictionary get_stats() const;
+
+	void set_use_disk_cache(bool p_use_disk_cache);
+	bool get_use_disk_cache() const;
+	void set_disk_cache_path(const String &p_disk_cache_path);
+	String get_disk_cache_path() const;
+	void set_generate_mipmaps(bool p_generate_mipmaps);
+	bool get_generate_mipmaps() const;
+
+	HBSteamAvatarCache();
+};
+
+VARIANT_ENUM_CAST(HBSteamAvatarCache::AvatarSize);
+
+#endif // STEAM_AVATAR_CACHE_H
@@ -0,0 +1,267 @@
+/**************************************************************************/
+/*  steam_clock_sync.cpp                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_clock_sync.h"
+
+#include "core/io/marshalls.h"
+#include "core/os/os.h"
+#include "core/templates/sort_array.h"
+#include "steam/steam_api_flat.h"
+#include "steamworks.h"
+
+// Pings carry the sender's clock, pongs echo it back along with the responder's clock.
+static const uint32_t PING_SIZE = sizeof(uint8_t) + sizeof(uint64_t);
+static const uint32_t PONG_SIZE = sizeof(uint8_t) + sizeof(uint64_t) * 2;
+// Samples whose round trip is this many times the median are treated as spikes.
+static const int64_t OUTLIER_RTT_FACTOR = 2;
+static const int64_t OUTLIER_RTT_MARGIN_USEC = 2000;
+
+HBSteamClockSync::Peer &HBSteamClockSync::_get_or_create_peer(int p_peer) {
+	if (Peer *peer = peers.getptr(p_peer)) {
+		return *peer;
+	}
+	return peers.insert(p_peer, Peer())->value;
+}
+
+void HBSteamClockSync::_send_pings(uint64_t p_now) {
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	uint8_t ping[PING_SIZE];
+	ping[0] = PACKET_PING;
+	for (int peer : peer_group->get_peer_list()) {
+		Peer &state = _get_or_create_peer(peer);
+		// Fill the window quickly so new peers get a usable estimate early.
+		uint64_t interval_usec = ping_interval * 1000000.0f;
+		if (state.sample_count < SAMPLE_WINDOW_SIZE) {
+			interval_usec /= 4;
+		}
+		if (state.last_ping_usec != 0 && p_now - state.last_ping_usec < interval_usec) {
+			continue;
+		}
+		state.last_ping_usec = p_now;
+		encode_uint64(p_now, ping + 1);
+		networking_messages->send_raw_message_to_peer(ping, PING_SIZE, peer, k_nSteamNetworkingSend_UnreliableNoDelay, channel);
+	}
+}
+
+void HBSteamClockSync::_receive_packets() {
+	Steamworks::get_singleton()->get_networking_messages()->receive_messages(channel, this, &HBSteamClockSync::_receive_packet);
+}
+
+void HBSteamClockSync::_receive_packet(int p_peer, const uint8_t *p_data, uint32_t p_size) {
+	if (p_peer == HBSteamNetworkingMessages::INVALID_PEER || p_size == 0) {
+		return;
+	}
+	uint64_t now = OS::get_singleton()->get_ticks_usec();
+	switch (p_data[0]) {
+		case PACKET_PING: {
+			ERR_FAIL_COND_MSG(p_size != PING_SIZE, "Steamworks: Received a malformed clock sync ping.");
+			uint8_t pong[PONG_SIZE];
+			pong[0] = PACKET_PONG;
+			memcpy(pong + 1, p_data + 1, sizeof(uint64_t));
+			encode_uint64(now, pong + 1 + sizeof(uint64_t));
+			Steamworks::get_singleton()->get_networking_messages()->send_raw_message_to_peer(pong, PONG_SIZE, p_peer, k_nSteamNetworkingSend_UnreliableNoDelay, channel);
+		} break;
+		case PACKET_PONG: {
+			ERR_FAIL_COND_MSG(p_size != PONG_SIZE, "Steamworks: Received a malformed clock sync pong.");
+			uint64_t sent_usec = decode_uint64(p_data + 1);
+			uint64_t peer_usec = decode_uint64(p_data + 1 + sizeof(uint64_t));
+			if (sent_usec > now) {
+				return;
+			}
+			// The peer's clock was read roughly halfway through the round trip.
+			int64_t rtt_usec = now - sent_usec;
+			int64_t offset_usec = (int64_t)peer_usec - (int64_t)(sent_usec + rtt_usec / 2);
+			_add_sample(p_peer, _get_or_create_peer(p_peer), offset_usec, rtt_usec);
+		} break;
+		default: {
+			ERR_FAIL_MSG("Steamworks: Received an unknown clock sync packet.");
+		}
+	}
+}
+
+void HBSteamClockSync::_add_sample(int p_peer, Peer &p_state, int64_t p_offset_usec, int64_t p_rtt_usec) {
+	if (p_state.sample_count == SAMPLE_WINDOW_SIZE && p_rtt_usec > p_state.rtt_usec * OUTLIER_RTT_FACTOR + OUTLIER_RTT_MARGIN_USEC) {
+		// A run of slow samples means the route changed rather than a spike, so let them in.
+		p_state.rejected_samples++;
+		if (++p_state.consecutive_rejections < SAMPLE_WINDOW_SIZE / 2) {
+			return;
+		}
+	}
+	p_state.consecutive_rejections = 0;
+
+	bool was_synchronized = p_state.sample_count > 0;
+	Sample &sample = p_state.samples[p_state.next_sample];
+	sample.offset_usec = p_offset_usec;
+	sample.rtt_usec = p_rtt_usec;
+	p_state.next_sample = (p_state.next_sample + 1) % SAMPLE_WINDOW_SIZE;
+	p_state.sample_count = MIN(p_state.sample_count + 1, (uint32_t)SAMPLE_WINDOW_SIZE);
+
+	_update_estimate(p_state);
+	if (!was_synchronized) {
+		emit_signal("peer_synchronized", p_peer);
+	}
+}
+
+void HBSteamClockSync::_update_estimate(Peer &p_state) const {
+	// Like NTP's clock filter, the sample with the shortest round trip had the least
+	// queuing delay and so the most symmetric path, its offset is the most trustworthy.
+	int64_t rtts[SAMPLE_WINDOW_SIZE];
+	const Sample *best = &p_state.samples[0];
+	for (uint32_t i = 0; i < p_state.sample_count; i++) {
+		rtts[i] = p_state.samples[i].rtt_usec;
+		if (p_state.samples[i].rtt_usec < best->rtt_usec) {
+			best = &p_state.samples[i];
+		}
+	}
+	SortArray<int64_t> sorter;
+	sorter.sort(rtts, p_state.sample_count);
+	p_state.rtt_usec = rtts[p_state.sample_count / 2];
+
+	if (p_state.sample_count == 1) {
+		p_state.offset_usec = best->offset_usec;
+	} else {
+		// Slew towards the new estimate instead of stepping, so interpolation doesn't jump.
+		p_state.offset_usec += (best->offset_usec - p_state.offset_usec) / 4;
+	}
+}
+
+void HBSteamClockSync::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("poll"), &HBSteamClockSync::poll);
+	ClassDB::bind_method(D_METHOD("is_peer_synchronized", "peer"), &HBSteamClockSync::is_peer_synchronized);
+	ClassDB::bind_method(D_METHOD("get_local_time"), &HBSteamClockSync::get_local_time);
+	ClassDB::bind_method(D_METHOD("get_peer_time", "peer"), &HBSteamClockSync::get_peer_time);
+	ClassDB::bind_method(D_METHOD("get_estimated_server_time"), &HBSteamClockSync::get_estimated_server_time);
+	ClassDB::bind_method(D_METHOD("get_peer_offset_usec", "peer"), &HBSteamClockSync::get_peer_offset_usec);
+	ClassDB::bind_method(D_METHOD("get_peer_rtt_ms", "peer"), &HBSteamClockSync::get_peer_rtt_ms);
+	ClassDB::bind_method(D_METHOD("get_peer_stats", "peer"), &HBSteamClockSync::get_peer_stats);
+	ClassDB::bind_method(D_METHOD("reset_peer", "peer"), &HBSteamClockSync::reset_peer);
+	ClassDB::bind_method(D_METHOD("set_server_peer", "server_peer"), &HBSteamClockSync::set_server_peer);
+	ClassDB::bind_method(D_METHOD("get_server_peer"), &HBSteamClockSync::get_server_peer);
+	ClassDB::bind_method(D_METHOD("set_ping_interval", "ping_interval"), &HBSteamClockSync::set_ping_interval);
+	ClassDB::bind_method(D_METHOD("get_ping_interval"), &HBSteamClockSync::get_ping_interval);
+	ClassDB::bind_method(D_METHOD("get_peer_group"), &HBSteamClockSync::get_peer_group);
+	ClassDB::bind_method(D_METHOD("get_channel"), &HBSteamClockSync::get_channel);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "server_peer"), "set_server_peer", "get_server_peer");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "ping_interval", PROPERTY_HINT_RANGE, "0.05,10,0.01,suffix:s"), "set_ping_interval", "get_ping_interval");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "peer_group", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamPeerGroup"), "", "get_peer_group");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "channel"), "", "get_channel");
+
+	ADD_SIGNAL(MethodInfo("peer_synchronized", PropertyInfo(Variant::INT, "peer")));
+}
+
+void HBSteamClockSync::poll() {
+	if (peer_group.is_valid()) {
+		_send_pings(OS::get_singleton()->get_ticks_usec());
+	}
+	_receive_packets();
+}
+
+bool HBSteamClockSync::is_peer_synchronized(int p_peer) const {
+	const Peer *peer = peers.getptr(p_peer);
+	return peer && peer->sample_count > 0;
+}
+
+double HBSteamClockSync::get_local_time() const {
+	return OS::get_singleton()->get_ticks_usec() / 1000000.0;
+}
+
+double HBSteamClockSync::get_peer_time(int p_peer) const {
+	return (OS::get_singleton()->get_ticks_usec() + get_peer_offset_usec(p_peer)) / 1000000.0;
+}
+
+double HBSteamClockSync::get_estimated_server_time() const {
+	if (server_peer == HBSteamNetworkingMessages::INVALID_PEER) {
+		// We are the server.
+		return get_local_time();
+	}
+	return get_peer_time(server_peer);
+}
+
+int64_t HBSteamClockSync::get_peer_offset_usec(int p_peer) const {
+	const Peer *peer = peers.getptr(p_peer);
+	if (!peer || peer->sample_count == 0) {
+		return 0;
+	}
+	return peer->offset_usec;
+}
+
+float HBSteamClockSync::get_peer_rtt_ms(int p_peer) const {
+	const Peer *peer = peers.getptr(p_peer);
+	if (!peer || peer->sample_count == 0) {
+		return 0.0f;
+	}
+	return peer->rtt_usec / 1000.0f;
+}
+
+Dictionary HBSteamClockSync::get_peer_stats(int p_peer) const {
+	const Peer *peer = peers.getptr(p_peer);
+	ERR_FAIL_NULL_V_MSG(peer, Dictionary(), vformat("Peer %d has no clock sync state.", p_peer));
+	Dictionary stats;
+	stats["offset_usec"] = peer->offset_usec;
+	stats["rtt_ms"] = peer->rtt_usec / 1000.0f;
+	stats["samples"] = peer->sample_count;
+	stats["rejected_samples"] = peer->rejected_samples;
+	return stats;
+}
+
+void HBSteamClockSync::reset_peer(int p_peer) {
+	peers.erase(p_peer);
+}
+
+void HBSteamClockSync::set_server_peer(int p_server_peer) {
+	server_peer = p_server_peer;
+}
+
+int HBSteamClockSync::get_server_peer() const {
+	return server_peer;
+}
+
+void HBSteamClockSync::set_ping_interval(float p_ping_interval) {
+	ping_interval = MAX(p_ping_interval, 0.05f);
+}
+
+float HBSteamClockSync::get_ping_interval() const {
+	return ping_interval;
+}
+
+Ref<HBSteamPeerGroup> HBSteamClockSync::get_peer_group() const {
+	return peer_group;
+}
+
+int HBSteamClockSync::get_channel() const {
+	return channel;
+}
+
+HBSteamClockSync::HBSteamClockSync(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel) {
+	peer_group = p_peer_group;
+	channel = p_channel;
+	Steamworks::get_singleton()->get_networking_messages()->connect("peer_released", callable_mp(this, &HBSteamClockSync::reset_peer));
+}
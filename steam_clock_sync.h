@@ -0,0 +1,105 @@
+/**************************************************************************/
+/*  steam_clock_sync.h                                                    */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_CLOCK_SYNC_H
+#define STEAM_CLOCK_SYNC_H
+
+#include "core/object/ref_counted.h"
+
+class HBSteamPeerGroup;
+
+// Estimates the clock offset and round trip time to each peer from timestamped
+// ping/pong exchanges, the same way NTP does.
+class HBSteamClockSync : public RefCounted {
+	GDCLASS(HBSteamClockSync, RefCounted);
+
+	static const int SAMPLE_WINDOW_SIZE = 8;
+
+	enum PacketType {
+		PACKET_PING,
+		PACKET_PONG,
+	};
+
+	struct Sample {
+		int64_t offset_usec = 0;
+		int64_t rtt_usec = 0;
+	};
+
+	struct Peer {
+		Sample samples[SAMPLE_WINDOW_SIZE];
+		uint32_t sample_count = 0;
+		uint32_t next_sample = 0;
+
+		int64_t offset_usec = 0;
+		int64_t rtt_usec = 0;
+		uint64_t last_ping_usec = 0;
+		uint32_t consecutive_rejections = 0;
+		uint64_t rejected_samples = 0;
+	};
+	HashMap<int, Peer> peers;
+
+	Ref<HBSteamPeerGroup> peer_group;
+	int channel = 0;
+	int server_peer = -1;
+	float ping_interval = 0.5f;
+
+	Peer &_get_or_create_peer(int p_peer);
+	void _send_pings(uint64_t p_now);
+	void _receive_packets();
+	void _receive_packet(int p_peer, const uint8_t *p_data, uint32_t p_size);
+	void _add_sample(int p_peer, Peer &p_state, int64_t p_offset_usec, int64_t p_rtt_usec);
+	void _update_estimate(Peer &p_state) const;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void poll();
+
+	bool is_peer_synchronized(int p_peer) const;
+	double get_local_time() const;
+	double get_peer_time(int p_peer) const;
+	double get_estimated_server_time() const;
+	int64_t get_peer_offset_usec(int p_peer) const;
+	float get_peer_rtt_ms(int p_peer) const;
+	Dictionary get_peer_stats(int p_peer) const;
+	void reset_peer(int p_peer);
+
+	void set_server_peer(int p_server_peer);
+	int get_server_peer() const;
+	void set_ping_interval(float p_ping_interval);
+	float get_ping_interval() const;
+	Ref<HBSteamPeerGroup> get_peer_group() const;
+	int get_channel() const;
+
+	HBSteamClockSync(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel);
+};
+
+#endif // STEAM_CLOCK_SYNC_H
@@ -0,0 +1,119 @@
+/**************************************************************************/
+/*  steam_delta_codec.cpp                                                 */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_delta_codec.h"
+
+void HBDeltaCodec::_write_varint(uint32_t p_value, LocalVector<uint8_t> &r_out) {
+	while (p_value >= 0x80) {
+		r_out.push_back(uint8_t(p_value) | 0x80);
+		p_value >>= 7;
+	}
+	r_out.push_back(uint8_t(p_value));
+}
+
+bool HBDeltaCodec::_read_varint(const uint8_t *p_data, uint32_t p_size, uint32_t &r_pos, uint32_t &r_value) {
+	r_value = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (r_pos >= p_size) {
+			return false;
+		}
+		uint8_t byte = p_data[r_pos++];
+		r_value |= uint32_t(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool HBDeltaCodec::encode(const uint8_t *p_data, uint32_t p_size, const uint8_t *p_baseline, uint32_t p_baseline_size, uint32_t p_max_size, LocalVector<uint8_t> &r_out) {
+	r_out.clear();
+
+#define DELTA_AT(m_index) (p_data[m_index] ^ ((m_index) < p_baseline_size ? p_baseline[m_index] : 0))
+
+	uint32_t i = 0;
+	while (i < p_size) {
+		uint32_t zero_start = i;
+		while (i < p_size && DELTA_AT(i) == 0) {
+			i++;
+		}
+		if (i == p_size) {
+			break;
+		}
+		// Single unchanged bytes are cheaper to keep inside the literal run
+		// than to split the run for them.
+		uint32_t literal_start = i;
+		while (i < p_size && (DELTA_AT(i) != 0 || (i + 1 < p_size && DELTA_AT(i + 1) != 0))) {
+			i++;
+		}
+
+		_write_varint(literal_start - zero_start, r_out);
+		_write_varint(i - literal_start, r_out);
+		for (uint32_t j = literal_start; j < i; j++) {
+			r_out.push_back(DELTA_AT(j));
+		}
+		if (r_out.size() >= p_max_size) {
+			return false;
+		}
+	}
+
+#undef DELTA_AT
+
+	return r_out.size() < p_max_size;
+}
+
+bool HBDeltaCodec::decode(const uint8_t *p_delta, uint32_t p_delta_size, const uint8_t *p_baseline, uint32_t p_baseline_size, uint8_t *r_data, uint32_t p_size) {
+	uint32_t copy_size = MIN(p_size, p_baseline_size);
+	memcpy(r_data, p_baseline, copy_size);
+	if (copy_size < p_size) {
+		memset(r_data + copy_size, 0, p_size - copy_size);
+	}
+
+	uint32_t read_pos = 0;
+	uint32_t write_pos = 0;
+	while (read_pos < p_delta_size) {
+		uint32_t zero_run = 0;
+		uint32_t literal_count = 0;
+		if (!_read_varint(p_delta, p_delta_size, read_pos, zero_run) || !_read_varint(p_delta, p_delta_size, read_pos, literal_count)) {
+			return false;
+		}
+		if (zero_run > p_size - write_pos) {
+			return false;
+		}
+		write_pos += zero_run;
+		if (literal_count > p_size - write_pos || literal_count > p_delta_size - read_pos) {
+			return false;
+		}
+		for (uint32_t i = 0; i < literal_count; i++) {
+			r_data[write_pos++] ^= p_delta[read_pos++];
+		}
+	}
+	return true;
+}
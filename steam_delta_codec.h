@@ -0,0 +1,54 @@
+/**************************************************************************/
+/*  steam_delta_codec.h                                                   */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_DELTA_CODEC_H
+#define STEAM_DELTA_CODEC_H
+
+#include "core/templates/local_vector.h"
+
+// XORs data against a baseline and run-length encodes the result, unchanged bytes
+// come out as zero so they collapse into a single run. Bytes past the end of the
+// baseline are XOR'd against zero.
+//
+// Encoded data is a list of (zero run length, literal count, literals...) groups,
+// with both lengths stored as LEB128 varints, trailing unchanged bytes are implicit.
+class HBDeltaCodec {
+	static void _write_varint(uint32_t p_value, LocalVector<uint8_t> &r_out);
+	static bool _read_varint(const uint8_t *p_data, uint32_t p_size, uint32_t &r_pos, uint32_t &r_value);
+
+public:
+	// Returns false if the delta doesn't end up smaller than p_max_size, in which case
+	// sending the data as is is cheaper. r_out is reused, so it stops allocating once warm.
+	static bool encode(const uint8_t *p_data, uint32_t p_size, const uint8_t *p_baseline, uint32_t p_baseline_size, uint32_t p_max_size, LocalVector<uint8_t> &r_out);
+	// r_data must be p_size bytes long, returns false if the delta is malformed.
+	static bool decode(const uint8_t *p_delta, uint32_t p_delta_size, const uint8_t *p_baseline, uint32_t p_baseline_size, uint8_t *r_data, uint32_t p_size);
+};
+
+#endif // STEAM_DELTA_CODEC_H
@@ -29,11 +29,20 @@
 /**************************************************************************/
 
 #include "steam_friends.h"
-#include "scene/resources/image_texture.h"
 #include "steam/steam_api_flat.h"
 #include "sw_error_macros.h"
 
-HashMap<uint64_t, HBSteamFriend*> HBSteamFriend::friend_cache = HashMap<uint64_t, HBSteamFriend*>();
+HashMap<uint64_t, HBSteamFriend *> HBSteamFriend::friend_cache = HashMap<uint64_t, HBSteamFriend *>();
+List<Ref<HBSteamFriend>> HBSteamFriend::retained_friends = List<Ref<HBSteamFriend>>();
+int HBSteamFriend::cache_capacity = 256;
+int64_t HBSteamFriend::cache_memory_budget = 1024 * 1024;
+uint64_t HBSteamFriend::cache_hits = 0;
+uint64_t HBSteamFriend::cache_misses = 0;
+uint64_t HBSteamFriend::cache_evictions = 0;
+LocalVector<HBSteamFriendsSnapshot *> HBSteamFriendsSnapshot::live_snapshots = LocalVector<HBSteamFriendsSnapshot *>();
+
+// Rough footprint of a retained friend, the object itself plus its cache bookkeeping.
+static const int64_t RETAINED_FRIEND_SIZE = sizeof(HBSteamFriend) + sizeof(List<Ref<HBSteamFriend>>::Element) + sizeof(HashMapElement<uint64_t, HBSteamFriend *>);
 
 void HBSteamFriends::_on_lobby_join_requested(Ref<SteamworksCallbackData> p_callback) {
 	const GameLobbyJoinRequested_t *req = p_callback->get_data<GameLobbyJoinRequested_t>();
@@ -41,10 +50,31 @@ void HBSteamFriends::_on_lobby_join_requested(Ref<SteamworksCallbackData> p_call
 	emit_signal("lobby_join_requested", HBSteamLobby::from_id(req->m_steamIDLobby.ConvertToUint64()));
 }
 
+void HBSteamFriends::_on_persona_state_change(Ref<SteamworksCallbackData> p_callback) {
+	const PersonaStateChange_t *state_change = p_callback->get_data<PersonaStateChange_t>();
+	HBSteamFriend::notify_persona_state_change(state_change->m_ulSteamID);
+	HBSteamFriendsSnapshot::notify_persona_state_change(state_change->m_ulSteamID, state_change->m_nChangeFlags);
+}
+
 void HBSteamFriends::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("activate_game_overlay_invite_dialog", "lobby"), &HBSteamFriends::activate_game_overlay_invite_dialog);
 	ClassDB::bind_method(D_METHOD("activate_game_overlay_to_web_page", "web_page", "modal"), &HBSteamFriends::activate_game_overlay_to_web_page);
 	ClassDB::bind_method(D_METHOD("set_rich_presence", "key", "value"), &HBSteamFriends::set_rich_presence);
+	ClassDB::bind_method(D_METHOD("get_friends_snapshot", "friend_flags"), &HBSteamFriends::get_friends_snapshot, DEFVAL(SWC::FRIEND_FLAG_IMMEDIATE));
+	ClassDB::bind_method(D_METHOD("get_avatar_cache"), &HBSteamFriends::get_avatar_cache);
+	ClassDB::bind_method(D_METHOD("get_persona_requests"), &HBSteamFriends::get_persona_requests);
+	ClassDB::bind_method(D_METHOD("get_rich_presence"), &HBSteamFriends::get_rich_presence);
+	ClassDB::bind_method(D_METHOD("set_friend_cache_capacity", "friend_cache_capacity"), &HBSteamFriends::set_friend_cache_capacity);
+	ClassDB::bind_method(D_METHOD("get_friend_cache_capacity"), &HBSteamFriends::get_friend_cache_capacity);
+	ClassDB::bind_method(D_METHOD("set_friend_cache_memory_budget", "friend_cache_memory_budget"), &HBSteamFriends::set_friend_cache_memory_budget);
+	ClassDB::bind_method(D_METHOD("get_friend_cache_memory_budget"), &HBSteamFriends::get_friend_cache_memory_budget);
+	ClassDB::bind_method(D_METHOD("get_friend_cache_stats"), &HBSteamFriends::get_friend_cache_stats);
+	ClassDB::bind_method(D_METHOD("clear_friend_cache"), &HBSteamFriends::clear_friend_cache);
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "avatar_cache", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamAvatarCache"), "", "get_avatar_cache");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "persona_requests", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamPersonaRequests"), "", "get_persona_requests");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "rich_presence", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamRichPresence"), "", "get_rich_presence");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "friend_cache_capacity", PROPERTY_HINT_RANGE, "0,4096,1,or_greater"), "set_friend_cache_capacity", "get_friend_cache_capacity");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "friend_cache_memory_budget", PROPERTY_HINT_RANGE, "0,16777216,1,or_greater,suffix:B"), "set_friend_cache_memory_budget", "get_friend_cache_memory_budget");
 	ADD_SIGNAL(MethodInfo("lobby_join_requested", PropertyInfo(Variant::OBJECT, "lobby", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamLobby")));
 }
 
@@ -52,6 +82,12 @@ void HBSteamFriends::init_interface() {
 	steam_friends = SteamAPI_SteamFriends();
 	SW_ERR_FAIL_COND_MSG(steam_friends == nullptr, "Steamworks: Failed to initialize Steam Friends, something catastrophic must have happened");
 	Steamworks::get_singleton()->add_callback(GameLobbyJoinRequested_t::k_iCallback, callable_mp(this, &HBSteamFriends::_on_lobby_join_requested));
+	// Dispatched from here rather than from every friend object, so friends coming and going doesn't
+	// keep adding callables to the callback list.
+	Steamworks::get_singleton()->add_callback(PersonaStateChange_t::k_iCallback, callable_mp(this, &HBSteamFriends::_on_persona_state_change));
+	avatar_cache.instantiate();
+	persona_requests.instantiate();
+	rich_presence.instantiate();
 }
 
 bool HBSteamFriends::is_valid() const {
@@ -71,28 +107,288 @@ void HBSteamFriends::activate_game_overlay_to_web_page(const String &p_web_page,
 }
 
 void HBSteamFriends::set_rich_presence(const String &p_key, const String &p_value) {
-	SteamAPI_ISteamFriends_SetRichPresence(steam_friends, p_key.utf8().get_data(), p_value.utf8().get_data());
+	// Queued like any other change, flushing here would also push out whatever else is waiting on the interval.
+	rich_presence->set_value(p_key, p_value);
+}
+
+Ref<HBSteamFriendsSnapshot> HBSteamFriends::get_friends_snapshot(BitField<SWC::FriendFlags> p_friend_flags) const {
+	Ref<HBSteamFriendsSnapshot> snapshot;
+	snapshot.instantiate();
+	snapshot->build(p_friend_flags);
+	return snapshot;
+}
+
+Ref<HBSteamAvatarCache> HBSteamFriends::get_avatar_cache() const {
+	return avatar_cache;
+}
+
+Ref<HBSteamPersonaRequests> HBSteamFriends::get_persona_requests() const {
+	return persona_requests;
+}
+
+Ref<HBSteamRichPresence> HBSteamFriends::get_rich_presence() const {
+	return rich_presence;
+}
+
+void HBSteamFriends::set_friend_cache_capacity(int p_friend_cache_capacity) {
+	HBSteamFriend::set_cache_capacity(p_friend_cache_capacity);
+}
+
+int HBSteamFriends::get_friend_cache_capacity() const {
+	return HBSteamFriend::get_cache_capacity();
+}
+
+void HBSteamFriends::set_friend_cache_memory_budget(int64_t p_friend_cache_memory_budget) {
+	HBSteamFriend::set_cache_memory_budget(p_friend_cache_memory_budget);
+}
+
+int64_t HBSteamFriends::get_friend_cache_memory_budget() const {
+	return HBSteamFriend::get_cache_memory_budget();
+}
+
+Dictionary HBSteamFriends::get_friend_cache_stats() const {
+	return HBSteamFriend::get_cache_stats();
+}
+
+void HBSteamFriends::clear_friend_cache() {
+	HBSteamFriend::clear_cache();
 }
 
 ISteamFriends *HBSteamFriends::get_interface() const {
 	return steam_friends;
 }
 
+void HBSteamFriendsSnapshot::_bind_methods() {
+	ClassDB::bind_method("get_friend_flags", &HBSteamFriendsSnapshot::get_friend_flags);
+	ClassDB::bind_method("get_friend_count", &HBSteamFriendsSnapshot::get_friend_count);
+	ClassDB::bind_method("get_steam_ids", &HBSteamFriendsSnapshot::get_steam_ids);
+	ClassDB::bind_method("get_persona_states", &HBSteamFriendsSnapshot::get_persona_states);
+	ClassDB::bind_method("get_persona_names", &HBSteamFriendsSnapshot::get_persona_names);
+	ClassDB::bind_method("get_game_ids", &HBSteamFriendsSnapshot::get_game_ids);
+	ClassDB::bind_method("get_relationships", &HBSteamFriendsSnapshot::get_relationships);
+	ClassDB::bind_method(D_METHOD("find_friend", "steam_id"), &HBSteamFriendsSnapshot::find_friend);
+	ClassDB::bind_method(D_METHOD("get_friend", "index"), &HBSteamFriendsSnapshot::get_friend);
+	ClassDB::bind_method("get_version", &HBSteamFriendsSnapshot::get_version);
+
+	ADD_SIGNAL(MethodInfo("friend_updated", PropertyInfo(Variant::INT, "index")));
+	ADD_SIGNAL(MethodInfo("friends_changed"));
+}
+
+void HBSteamFriendsSnapshot::_read_friend(int p_index) {
+	ISteamFriends *friends = Steamworks::get_singleton()->get_friends()->get_interface();
+	uint64_t steam_id = steam_ids[p_index];
+	persona_states.set(p_index, SteamAPI_ISteamFriends_GetFriendPersonaState(friends, steam_id));
+	persona_names.set(p_index, String::utf8(SteamAPI_ISteamFriends_GetFriendPersonaName(friends, steam_id)));
+	relationships.set(p_index, SteamAPI_ISteamFriends_GetFriendRelationship(friends, steam_id));
+	FriendGameInfo_t game_info;
+	uint64_t game_id = 0;
+	if (SteamAPI_ISteamFriends_GetFriendGamePlayed(friends, steam_id, &game_info)) {
+		game_id = game_info.m_gameID.ConvertToUint64();
+	}
+	game_ids.set(p_index, game_id);
+}
+
+void HBSteamFriendsSnapshot::_on_persona_state_change(uint64_t p_steam_id, int p_change_flags) {
+	const int *index = friend_indices.getptr(p_steam_id);
+	if (p_change_flags & k_EPersonaChangeRelationshipChanged) {
+		// Someone was added to or removed from the list, which shifts every index after them
+		ISteamFriends *friends = Steamworks::get_singleton()->get_friends()->get_interface();
+		bool has_friend = SteamAPI_ISteamFriends_HasFriend(friends, p_steam_id, friend_flags);
+		if (has_friend != (index != nullptr)) {
+			build(friend_flags);
+			emit_signal("friends_changed");
+			return;
+		}
+	}
+	if (!index) {
+		return;
+	}
+	_read_friend(*index);
+	version++;
+	emit_signal("friend_updated", *index);
+}
+
+void HBSteamFriendsSnapshot::build(BitField<SWC::FriendFlags> p_friend_flags) {
+	ISteamFriends *friends = Steamworks::get_singleton()->get_friends()->get_interface();
+	friend_flags = p_friend_flags;
+	int friend_count = MAX(SteamAPI_ISteamFriends_GetFriendCount(friends, friend_flags), 0);
+	steam_ids.resize(friend_count);
+	persona_states.resize(friend_count);
+	persona_names.resize(friend_count);
+	game_ids.resize(friend_count);
+	relationships.resize(friend_count);
+	friend_indices.clear();
+
+	for (int i = 0; i < friend_count; i++) {
+		uint64_t steam_id = SteamAPI_ISteamFriends_GetFriendByIndex(friends, i, friend_flags);
+		steam_ids.set(i, steam_id);
+		friend_indices.insert(steam_id, i);
+		_read_friend(i);
+	}
+	version++;
+
+	if (!registered) {
+		registered = true;
+		live_snapshots.push_back(this);
+	}
+}
+
+void HBSteamFriendsSnapshot::notify_persona_state_change(uint64_t p_steam_id, int p_change_flags) {
+	if (live_snapshots.is_empty()) {
+		return;
+	}
+	// Signal handlers might drop the last reference to a snapshot, keep them alive until we are done.
+	LocalVector<Ref<HBSteamFriendsSnapshot>> snapshots;
+	snapshots.reserve(live_snapshots.size());
+	for (HBSteamFriendsSnapshot *snapshot : live_snapshots) {
+		snapshots.push_back(Ref<HBSteamFriendsSnapshot>(snapshot));
+	}
+	for (const Ref<HBSteamFriendsSnapshot> &snapshot : snapshots) {
+		snapshot->_on_persona_state_change(p_steam_id, p_change_flags);
+	}
+}
+
+HBSteamFriendsSnapshot::~HBSteamFriendsSnapshot() {
+	if (registered) {
+		live_snapshots.erase(this);
+	}
+}
+
+BitField<SWC::FriendFlags> HBSteamFriendsSnapshot::get_friend_flags() const {
+	return friend_flags;
+}
+
+int HBSteamFriendsSnapshot::get_friend_count() const {
+	return steam_ids.size();
+}
+
+PackedInt64Array HBSteamFriendsSnapshot::get_steam_ids() const {
+	return steam_ids;
+}
+
+PackedInt32Array HBSteamFriendsSnapshot::get_persona_states() const {
+	return persona_states;
+}
+
+PackedStringArray HBSteamFriendsSnapshot::get_persona_names() const {
+	return persona_names;
+}
+
+PackedInt64Array HBSteamFriendsSnapshot::get_game_ids() const {
+	return game_ids;
+}
+
+PackedInt32Array HBSteamFriendsSnapshot::get_relationships() const {
+	return relationships;
+}
+
+int HBSteamFriendsSnapshot::find_friend(uint64_t p_steam_id) const {
+	const int *index = friend_indices.getptr(p_steam_id);
+	return index ? *index : -1;
+}
+
+Ref<HBSteamFriend> HBSteamFriendsSnapshot::get_friend(int p_index) const {
+	ERR_FAIL_INDEX_V(p_index, steam_ids.size(), Ref<HBSteamFriend>());
+	return HBSteamFriend::from_steam_id(steam_ids[p_index]);
+}
+
+uint64_t HBSteamFriendsSnapshot::get_version() const {
+	return version;
+}
+
+void HBSteamFriend::_retain(HBSteamFriend *p_friend) {
+	if (p_friend->retained_element) {
+		retained_friends.move_to_front(p_friend->retained_element);
+		return;
+	}
+	if (cache_capacity == 0) {
+		return;
+	}
+	retained_friends.push_front(Ref<HBSteamFriend>(p_friend));
+	p_friend->retained_element = retained_friends.front();
+	_trim_retained_friends();
+}
+
+void HBSteamFriend::_trim_retained_friends() {
+	while (!retained_friends.is_empty() && (retained_friends.size() > cache_capacity || retained_friends.size() * RETAINED_FRIEND_SIZE > cache_memory_budget)) {
+		// Friends still referenced elsewhere stay alive, they are just no longer kept around by us.
+		retained_friends.back()->get()->retained_element = nullptr;
+		retained_friends.pop_back();
+		cache_evictions++;
+	}
+}
+
 Ref<HBSteamFriend> HBSteamFriend::from_steam_id(uint64_t p_steam_id) {
 	ERR_FAIL_COND_V_MSG(p_steam_id == 0, Ref<HBSteamFriend>(), "An invalid steam user ID was given.");
 	if (friend_cache.has(p_steam_id)) {
 		Ref<HBSteamFriend> cached_friend = friend_cache[p_steam_id];
 		if (cached_friend.is_valid()) {
+			cache_hits++;
+			_retain(cached_friend.ptr());
 			return cached_friend;
 		}
 	}
+	cache_misses++;
 	Ref<HBSteamFriend> steam_friend;
 	steam_friend.instantiate();
 	steam_friend->steam_id = p_steam_id;
 	friend_cache.insert(p_steam_id, steam_friend.ptr());
+	_retain(steam_friend.ptr());
 	return steam_friend;
 }
 
+void HBSteamFriend::notify_persona_state_change(uint64_t p_steam_id) {
+	HBSteamFriend **steam_friend = friend_cache.getptr(p_steam_id);
+	if (steam_friend) {
+		(*steam_friend)->emit_signal("information_updated");
+	}
+}
+
+void HBSteamFriend::notify_avatar_loaded(uint64_t p_steam_id, HBSteamAvatarCache::AvatarSize p_size, const Ref<Texture2D> &p_texture) {
+	HBSteamFriend **steam_friend = friend_cache.getptr(p_steam_id);
+	if (steam_friend) {
+		(*steam_friend)->emit_signal("avatar_loaded", (int)p_size, p_texture);
+	}
+}
+
+void HBSteamFriend::set_cache_capacity(int p_cache_capacity) {
+	ERR_FAIL_COND_MSG(p_cache_capacity < 0, "The friend cache capacity can't be negative.");
+	cache_capacity = p_cache_capacity;
+	_trim_retained_friends();
+}
+
+int HBSteamFriend::get_cache_capacity() {
+	return cache_capacity;
+}
+
+void HBSteamFriend::set_cache_memory_budget(int64_t p_cache_memory_budget) {
+	ERR_FAIL_COND_MSG(p_cache_memory_budget < 0, "The friend cache memory budget can't be negative.");
+	cache_memory_budget = p_cache_memory_budget;
+	_trim_retained_friends();
+}
+
+int64_t HBSteamFriend::get_cache_memory_budget() {
+	return cache_memory_budget;
+}
+
+Dictionary HBSteamFriend::get_cache_stats() {
+	Dictionary stats;
+	stats["live"] = friend_cache.size();
+	stats["retained"] = retained_friends.size();
+	stats["retained_bytes"] = retained_friends.size() * RETAINED_FRIEND_SIZE;
+	stats["hits"] = cache_hits;
+	stats["misses"] = cache_misses;
+	stats["evictions"] = cache_evictions;
+	return stats;
+}
+
+void HBSteamFriend::clear_cache() {
+	for (Ref<HBSteamFriend> &steam_friend : retained_friends) {
+		steam_friend->retained_element = nullptr;
+	}
+	retained_friends.clear();
+}
+
 uint32_t HBSteamFriend::get_account_id() const {
 	// Account id are the lowest 32 bits of the steam ID
 	return steam_id & 0xFFFFFFFF;
@@ -104,55 +400,35 @@ bool HBSteamFriend::request_user_information(bool p_include_avatars) const {
 }
 
 HBSteamFriend::HBSteamFriend() {
-	Steamworks::get_singleton()->add_callback(PersonaStateChange_t::k_iCallback, callable_mp(this, &HBSteamFriend::_on_persona_state_change));
 }
 
 HBSteamFriend::~HBSteamFriend() {
-	friend_cache.erase(steam_id);
-}
-
-void HBSteamFriend::_on_persona_state_change(Ref<SteamworksCallbackData> p_callback) {
-	const PersonaStateChange_t *state_change = p_callback->get_data<PersonaStateChange_t>();
-	if (state_change->m_ulSteamID == steam_id) {
-		if (state_change->m_nChangeFlags & k_EPersonaChangeAvatar) {
-			avatar.unref();
-		}
-		emit_signal("information_updated");
+	HBSteamFriend **cached_friend = friend_cache.getptr(steam_id);
+	if (cached_friend && *cached_friend == this) {
+		friend_cache.erase(steam_id);
 	}
 }
 
 void HBSteamFriend::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_persona_name"), &HBSteamFriend::get_persona_name);
 	ClassDB::bind_method(D_METHOD("get_steam_id"), &HBSteamFriend::get_steam_id);
-	ClassDB::bind_method(D_METHOD("get_avatar"), &HBSteamFriend::get_avatar);
+	ClassDB::bind_method(D_METHOD("get_avatar", "size"), &HBSteamFriend::get_avatar, DEFVAL(HBSteamAvatarCache::AVATAR_SIZE_MEDIUM));
 	ClassDB::bind_method(D_METHOD("request_user_information", "include_avatars"), &HBSteamFriend::request_user_information);
 	ClassDB::bind_static_method("HBSteamFriend", D_METHOD("from_steam_id", "steam_id"), &HBSteamFriend::from_steam_id);
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "avatar"), "", "get_avatar");
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "persona_name"), "", "get_persona_name");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "steam_id"), "", "get_steam_id");
 	ADD_SIGNAL(MethodInfo("information_updated"));
+	ADD_SIGNAL(MethodInfo("avatar_loaded", PropertyInfo(Variant::INT, "size"), PropertyInfo(Variant::OBJECT, "texture", PROPERTY_HINT_RESOURCE_TYPE, "Texture2D")));
 }
 
 String HBSteamFriend::get_persona_name() const {
 	return String::utf8(SteamAPI_ISteamFriends_GetFriendPersonaName(Steamworks::get_singleton()->get_friends()->get_interface(), steam_id));
 }
 
-Ref<Texture2D> HBSteamFriend::get_avatar() const {
-	if (avatar.is_valid()) {
-		return avatar;
-	}
-	ISteamUtils *utils = Steamworks::get_singleton()->get_utils()->get_interface();
-	int image_handle = SteamAPI_ISteamFriends_GetMediumFriendAvatar(Steamworks::get_singleton()->get_friends()->get_interface(), steam_id);
-	uint32_t width, height;
-	SteamAPI_ISteamUtils_GetImageSize(utils, image_handle, &width, &height);
-	Vector<uint8_t> image_data;
-	image_data.resize(width * height * 4);
-	SteamAPI_ISteamUtils_GetImageRGBA(utils, image_handle, image_data.ptrw(), image_data.size());
-	Ref<Image> image = Image::create_from_data(width, height, false, Image::FORMAT_RGBA8, image_data);
-	if (image.is_valid()) {
-		const_cast<HBSteamFriend *>(this)->avatar = ImageTexture::create_from_image(image);
-	}
-	return avatar;
+Ref<Texture2D> HBSteamFriend::get_avatar(HBSteamAvatarCache::AvatarSize p_size) const {
+	// Avatars load in the background, the cache tells us through notify_avatar_loaded once ours shows up.
+	return Steamworks::get_singleton()->get_friends()->get_avatar_cache()->get_avatar(steam_id, p_size);
 }
 uint64_t HBSteamFriend::get_steam_id() const {
 	return steam_id;
@@ -32,8 +32,14 @@
 #define STEAM_FRIENDS_H
 
 #include "core/object/ref_counted.h"
+#include "core/templates/list.h"
+#include "core/templates/local_vector.h"
 #include "scene/resources/texture.h"
+#include "steam_avatar_cache.h"
+#include "steam_persona_requests.h"
+#include "steam_rich_presence.h"
 #include "steamworks_callback_data.h"
+#include "steamworks_constants.gen.h"
 
 class ISteamFriends;
 class HBSteamLobby;
@@ -42,30 +48,97 @@ class HBSteamFriend : public RefCounted {
 	GDCLASS(HBSteamFriend, RefCounted);
 
 private:
-	Ref<Texture2D> avatar;
 	uint64_t steam_id;
-	static HashMap<uint64_t, HBSteamFriend*> friend_cache;
-	void _on_persona_state_change(Ref<SteamworksCallbackData> p_callback);
+	// Position in retained_friends while the cache holds a reference to us.
+	List<Ref<HBSteamFriend>>::Element *retained_element = nullptr;
+
+	// Every friend object that's alive, so from_steam_id hands out the same object for the same user.
+	static HashMap<uint64_t, HBSteamFriend *> friend_cache;
+	// Recently used friends, most recent first. Keeping them referenced means dropping a Ref doesn't
+	// throw away the object when the same user is looked up again a moment later.
+	static List<Ref<HBSteamFriend>> retained_friends;
+	static int cache_capacity;
+	static int64_t cache_memory_budget;
+	static uint64_t cache_hits;
+	static uint64_t cache_misses;
+	static uint64_t cache_evictions;
+
+	static void _retain(HBSteamFriend *p_friend);
+	static void _trim_retained_friends();
 
 protected:
 	static void _bind_methods();
 
 public:
 	String get_persona_name() const;
-	Ref<Texture2D> get_avatar() const;
+	Ref<Texture2D> get_avatar(HBSteamAvatarCache::AvatarSize p_size = HBSteamAvatarCache::AVATAR_SIZE_MEDIUM) const;
 	uint64_t get_steam_id() const;
 	static Ref<HBSteamFriend> from_steam_id(uint64_t p_steam_id);
+	static void notify_persona_state_change(uint64_t p_steam_id);
+	static void notify_avatar_loaded(uint64_t p_steam_id, HBSteamAvatarCache::AvatarSize p_size, const Ref<Texture2D> &p_texture);
+	static void set_cache_capacity(int p_cache_capacity);
+	static int get_cache_capacity();
+	static void set_cache_memory_budget(int64_t p_cache_memory_budget);
+	static int64_t get_cache_memory_budget();
+	static Dictionary get_cache_stats();
+	static void clear_cache();
 	uint32_t get_account_id() const;
 	bool request_user_information(bool p_include_avatars) const;
 	HBSteamFriend();
 	~HBSteamFriend();
 };
 
+// Columnar copy of the friends list, read once and then kept up to date from persona state
+// changes so friend lists don't have to go through Steam for every friend every frame.
+class HBSteamFriendsSnapshot : public RefCounted {
+	GDCLASS(HBSteamFriendsSnapshot, RefCounted);
+
+	BitField<SWC::FriendFlags> friend_flags = SWC::FRIEND_FLAG_NONE;
+	PackedInt64Array steam_ids;
+	PackedInt32Array persona_states;
+	PackedStringArray persona_names;
+	PackedInt64Array game_ids;
+	PackedInt32Array relationships;
+	HashMap<uint64_t, int> friend_indices;
+	uint64_t version = 0;
+	bool registered = false;
+
+	// Built snapshots, kept up to date by HBSteamFriends' single persona state change callback.
+	static LocalVector<HBSteamFriendsSnapshot *> live_snapshots;
+
+	void _read_friend(int p_index);
+	void _on_persona_state_change(uint64_t p_steam_id, int p_change_flags);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void build(BitField<SWC::FriendFlags> p_friend_flags);
+	BitField<SWC::FriendFlags> get_friend_flags() const;
+	int get_friend_count() const;
+	PackedInt64Array get_steam_ids() const;
+	PackedInt32Array get_persona_states() const;
+	PackedStringArray get_persona_names() const;
+	PackedInt64Array get_game_ids() const;
+	PackedInt32Array get_relationships() const;
+	int find_friend(uint64_t p_steam_id) const;
+	Ref<HBSteamFriend> get_friend(int p_index) const;
+	uint64_t get_version() const;
+
+	static void notify_persona_state_change(uint64_t p_steam_id, int p_change_flags);
+
+	~HBSteamFriendsSnapshot();
+};
+
 class HBSteamFriends : public RefCounted {
 	GDCLASS(HBSteamFriends, RefCounted);
 	ISteamFriends *steam_friends = nullptr;
+	Ref<HBSteamAvatarCache> avatar_cache;
+	Ref<HBSteamPersonaRequests> persona_requests;
+	Ref<HBSteamRichPresence> rich_presence;
 
 	void _on_lobby_join_requested(Ref<SteamworksCallbackData> p_callback);
+	void _on_persona_state_change(Ref<SteamworksCallbackData> p_callback);
 
 protected:
 	static void _bind_methods();
@@ -76,6 +149,16 @@ public:
 	void activate_game_overlay_invite_dialog(Ref<HBSteamLobby> p_lobby) const;
 	void activate_game_overlay_to_web_page(const String &p_web_page, bool p_modal) const;
 	void set_rich_presence(const String &p_key, const String &p_value);
+	Ref<HBSteamFriendsSnapshot> get_friends_snapshot(BitField<SWC::FriendFlags> p_friend_flags = SWC::FRIEND_FLAG_IMMEDIATE) const;
+	Ref<HBSteamAvatarCache> get_avatar_cache() const;
+	Ref<HBSteamPersonaRequests> get_persona_requests() const;
+	Ref<HBSteamRichPresence> get_rich_presence() const;
+	void set_friend_cache_capacity(int p_friend_cache_capacity);
+	int get_friend_cache_capacity() const;
+	void set_friend_cache_memory_budget(int64_t p_friend_cache_memory_budget);
+	int64_t get_friend_cache_memory_budget() const;
+	Dictionary get_friend_cache_stats() const;
+	void clear_friend_cache();
 	ISteamFriends *get_interface() const;
 };
 
@@ -0,0 +1,293 @@
+/**************************************************************************/
+/*  steam_game_server.cpp                                                 */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_game_server.h"
+#include "core/io/ip_address.h"
+#include "steam/steam_api_flat.h"
+#include "steam/steam_gameserver.h"
+#include "steamworks.h"
+#include "sw_error_macros.h"
+
+void HBSteamGameServer::_on_servers_connected(Ref<SteamworksCallbackData> p_callback) {
+	emit_signal("servers_connected");
+}
+
+void HBSteamGameServer::_on_server_connect_failure(Ref<SteamworksCallbackData> p_callback) {
+	const SteamServerConnectFailure_t *failure = p_callback->get_data<SteamServerConnectFailure_t>();
+	emit_signal("server_connect_failure", (SWC::Result)failure->m_eResult, failure->m_bStillRetrying);
+}
+
+void HBSteamGameServer::_on_servers_disconnected(Ref<SteamworksCallbackData> p_callback) {
+	const SteamServersDisconnected_t *disconnected = p_callback->get_data<SteamServersDisconnected_t>();
+	emit_signal("servers_disconnected", (SWC::Result)disconnected->m_eResult);
+}
+
+void HBSteamGameServer::_on_policy_response(Ref<SteamworksCallbackData> p_callback) {
+	const GSPolicyResponse_t *policy = p_callback->get_data<GSPolicyResponse_t>();
+	emit_signal("policy_response", policy->m_bSecure != 0);
+}
+
+void HBSteamGameServer::_on_validate_auth_ticket_response(Ref<SteamworksCallbackData> p_callback) {
+	const ValidateAuthTicketResponse_t *response = p_callback->get_data<ValidateAuthTicketResponse_t>();
+	uint64_t steam_id = response->m_SteamID.ConvertToUint64();
+	AuthSession *session = auth_sessions.getptr(steam_id);
+	if (!session) {
+		// Session was ended before Steam got back to us.
+		return;
+	}
+	session->responded = true;
+	session->response = (SWC::AuthSessionResponse)response->m_eAuthSessionResponse;
+	emit_signal("auth_session_validated", steam_id, session->response, response->m_OwnerSteamID.ConvertToUint64());
+}
+
+void HBSteamGameServer::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_product", "product"), &HBSteamGameServer::set_product);
+	ClassDB::bind_method(D_METHOD("set_game_description", "game_description"), &HBSteamGameServer::set_game_description);
+	ClassDB::bind_method(D_METHOD("set_mod_dir", "mod_dir"), &HBSteamGameServer::set_mod_dir);
+	ClassDB::bind_method(D_METHOD("set_dedicated_server", "dedicated"), &HBSteamGameServer::set_dedicated_server);
+
+	ClassDB::bind_method(D_METHOD("log_on", "token"), &HBSteamGameServer::log_on);
+	ClassDB::bind_method(D_METHOD("log_on_anonymous"), &HBSteamGameServer::log_on_anonymous);
+	ClassDB::bind_method(D_METHOD("log_off"), &HBSteamGameServer::log_off);
+	ClassDB::bind_method(D_METHOD("is_logged_on"), &HBSteamGameServer::is_logged_on);
+	ClassDB::bind_method(D_METHOD("is_secure"), &HBSteamGameServer::is_secure);
+	ClassDB::bind_method(D_METHOD("get_steam_id"), &HBSteamGameServer::get_steam_id);
+	ClassDB::bind_method(D_METHOD("get_public_ip"), &HBSteamGameServer::get_public_ip);
+
+	ClassDB::bind_method(D_METHOD("set_max_player_count", "max_players"), &HBSteamGameServer::set_max_player_count);
+	ClassDB::bind_method(D_METHOD("set_bot_player_count", "bot_players"), &HBSteamGameServer::set_bot_player_count);
+	ClassDB::bind_method(D_METHOD("set_server_name", "server_name"), &HBSteamGameServer::set_server_name);
+	ClassDB::bind_method(D_METHOD("set_map_name", "map_name"), &HBSteamGameServer::set_map_name);
+	ClassDB::bind_method(D_METHOD("set_password_protected", "password_protected"), &HBSteamGameServer::set_password_protected);
+	ClassDB::bind_method(D_METHOD("set_region", "region"), &HBSteamGameServer::set_region);
+	ClassDB::bind_method(D_METHOD("set_game_tags", "tags"), &HBSteamGameServer::set_game_tags);
+	ClassDB::bind_method(D_METHOD("set_game_data", "game_data"), &HBSteamGameServer::set_game_data);
+	ClassDB::bind_method(D_METHOD("set_key_value", "key", "value"), &HBSteamGameServer::set_key_value);
+	ClassDB::bind_method(D_METHOD("clear_all_key_values"), &HBSteamGameServer::clear_all_key_values);
+	ClassDB::bind_method(D_METHOD("set_advertise_server_active", "active"), &HBSteamGameServer::set_advertise_server_active);
+
+	ClassDB::bind_method(D_METHOD("begin_auth_session", "ticket", "steam_id"), &HBSteamGameServer::begin_auth_session);
+	ClassDB::bind_method(D_METHOD("end_auth_session", "steam_id"), &HBSteamGameServer::end_auth_session);
+	ClassDB::bind_method(D_METHOD("end_all_auth_sessions"), &HBSteamGameServer::end_all_auth_sessions);
+	ClassDB::bind_method(D_METHOD("has_auth_session", "steam_id"), &HBSteamGameServer::has_auth_session);
+	ClassDB::bind_method(D_METHOD("is_auth_session_validated", "steam_id"), &HBSteamGameServer::is_auth_session_validated);
+	ClassDB::bind_method(D_METHOD("get_auth_session_steam_ids"), &HBSteamGameServer::get_auth_session_steam_ids);
+	ClassDB::bind_method(D_METHOD("user_has_license_for_app", "steam_id", "app_id"), &HBSteamGameServer::user_has_license_for_app);
+	ClassDB::bind_method(D_METHOD("update_user_data", "steam_id", "player_name", "score"), &HBSteamGameServer::update_user_data);
+
+	ADD_SIGNAL(MethodInfo("servers_connected"));
+	ADD_SIGNAL(MethodInfo("server_connect_failure", PropertyInfo(Variant::INT, "result"), PropertyInfo(Variant::BOOL, "still_retrying")));
+	ADD_SIGNAL(MethodInfo("servers_disconnected", PropertyInfo(Variant::INT, "result")));
+	ADD_SIGNAL(MethodInfo("policy_response", PropertyInfo(Variant::BOOL, "secure")));
+	ADD_SIGNAL(MethodInfo("auth_session_validated", PropertyInfo(Variant::INT, "steam_id"), PropertyInfo(Variant::INT, "response"), PropertyInfo(Variant::INT, "owner_steam_id")));
+}
+
+void HBSteamGameServer::init_interface() {
+	steam_game_server = SteamAPI_SteamGameServer();
+	SW_ERR_FAIL_COND_MSG(steam_game_server == nullptr, "Steamworks: Failed to initialize Steam game server, something catastrophic must have happened");
+	Steamworks::get_singleton()->add_callback(SteamServersConnected_t::k_iCallback, callable_mp(this, &HBSteamGameServer::_on_servers_connected));
+	Steamworks::get_singleton()->add_callback(SteamServerConnectFailure_t::k_iCallback, callable_mp(this, &HBSteamGameServer::_on_server_connect_failure));
+	Steamworks::get_singleton()->add_callback(SteamServersDisconnected_t::k_iCallback, callable_mp(this, &HBSteamGameServer::_on_servers_disconnected));
+	Steamworks::get_singleton()->add_callback(GSPolicyResponse_t::k_iCallback, callable_mp(this, &HBSteamGameServer::_on_policy_response));
+	Steamworks::get_singleton()->add_callback(ValidateAuthTicketResponse_t::k_iCallback, callable_mp(this, &HBSteamGameServer::_on_validate_auth_ticket_response));
+}
+
+bool HBSteamGameServer::is_valid() const {
+	return steam_game_server != nullptr;
+}
+
+ISteamGameServer *HBSteamGameServer::get_interface() const {
+	return steam_game_server;
+}
+
+void HBSteamGameServer::set_product(const String &p_product) {
+	SteamAPI_ISteamGameServer_SetProduct(steam_game_server, p_product.utf8().get_data());
+}
+
+void HBSteamGameServer::set_game_description(const String &p_game_description) {
+	SteamAPI_ISteamGameServer_SetGameDescription(steam_game_server, p_game_description.utf8().get_data());
+}
+
+void HBSteamGameServer::set_mod_dir(const String &p_mod_dir) {
+	SteamAPI_ISteamGameServer_SetModDir(steam_game_server, p_mod_dir.utf8().get_data());
+}
+
+void HBSteamGameServer::set_dedicated_server(bool p_dedicated) {
+	SteamAPI_ISteamGameServer_SetDedicatedServer(steam_game_server, p_dedicated);
+}
+
+void HBSteamGameServer::log_on(const String &p_token) {
+	SteamAPI_ISteamGameServer_LogOn(steam_game_server, p_token.utf8().get_data());
+}
+
+void HBSteamGameServer::log_on_anonymous() {
+	SteamAPI_ISteamGameServer_LogOnAnonymous(steam_game_server);
+}
+
+void HBSteamGameServer::log_off() {
+	SteamAPI_ISteamGameServer_LogOff(steam_game_server);
+}
+
+bool HBSteamGameServer::is_logged_on() const {
+	return SteamAPI_ISteamGameServer_BLoggedOn(steam_game_server);
+}
+
+bool HBSteamGameServer::is_secure() const {
+	return SteamAPI_ISteamGameServer_BSecure(steam_game_server);
+}
+
+uint64_t HBSteamGameServer::get_steam_id() const {
+	return SteamAPI_ISteamGameServer_GetSteamID(steam_game_server);
+}
+
+String HBSteamGameServer::get_public_ip() const {
+	SteamIPAddress_t address = SteamAPI_ISteamGameServer_GetPublicIP(steam_game_server);
+	if (!address.IsSet()) {
+		return String();
+	}
+	IPAddress ip;
+	if (address.m_eType == k_ESteamIPTypeIPv4) {
+		// Steam gives us the address in host order.
+		uint8_t bytes[4] = {
+			(uint8_t)(address.m_unIPv4 >> 24),
+			(uint8_t)(address.m_unIPv4 >> 16),
+			(uint8_t)(address.m_unIPv4 >> 8),
+			(uint8_t)address.m_unIPv4,
+		};
+		ip.set_ipv4(bytes);
+	} else {
+		ip.set_ipv6(address.m_rgubIPv6);
+	}
+	return ip;
+}
+
+void HBSteamGameServer::set_max_player_count(int p_max_players) {
+	SteamAPI_ISteamGameServer_SetMaxPlayerCount(steam_game_server, p_max_players);
+}
+
+void HBSteamGameServer::set_bot_player_count(int p_bot_players) {
+	SteamAPI_ISteamGameServer_SetBotPlayerCount(steam_game_server, p_bot_players);
+}
+
+void HBSteamGameServer::set_server_name(const String &p_server_name) {
+	SteamAPI_ISteamGameServer_SetServerName(steam_game_server, p_server_name.utf8().get_data());
+}
+
+void HBSteamGameServer::set_map_name(const String &p_map_name) {
+	SteamAPI_ISteamGameServer_SetMapName(steam_game_server, p_map_name.utf8().get_data());
+}
+
+void HBSteamGameServer::set_password_protected(bool p_password_protected) {
+	SteamAPI_ISteamGameServer_SetPasswordProtected(steam_game_server, p_password_protected);
+}
+
+void HBSteamGameServer::set_region(const String &p_region) {
+	SteamAPI_ISteamGameServer_SetRegion(steam_game_server, p_region.utf8().get_data());
+}
+
+void HBSteamGameServer::set_game_tags(const PackedStringArray &p_tags) {
+	String tags = String(",").join(p_tags);
+	ERR_FAIL_COND_MSG(tags.utf8().length() >= k_cbMaxGameServerTags, vformat("Game tags must be shorter than %d bytes.", k_cbMaxGameServerTags));
+	SteamAPI_ISteamGameServer_SetGameTags(steam_game_server, tags.utf8().get_data());
+}
+
+void HBSteamGameServer::set_game_data(const String &p_game_data) {
+	ERR_FAIL_COND_MSG(p_game_data.utf8().length() >= k_cbMaxGameServerGameData, vformat("Game data must be shorter than %d bytes.", k_cbMaxGameServerGameData));
+	SteamAPI_ISteamGameServer_SetGameData(steam_game_server, p_game_data.utf8().get_data());
+}
+
+void HBSteamGameServer::set_key_value(const String &p_key, const String &p_value) {
+	SteamAPI_ISteamGameServer_SetKeyValue(steam_game_server, p_key.utf8().get_data(), p_value.utf8().get_data());
+}
+
+void HBSteamGameServer::clear_all_key_values() {
+	SteamAPI_ISteamGameServer_ClearAllKeyValues(steam_game_server);
+}
+
+void HBSteamGameServer::set_advertise_server_active(bool p_active) {
+	SteamAPI_ISteamGameServer_SetAdvertiseServerActive(steam_game_server, p_active);
+}
+
+SWC::BeginAuthSessionResult HBSteamGameServer::begin_auth_session(const PackedByteArray &p_ticket, uint64_t p_steam_id) {
+	ERR_FAIL_COND_V_MSG(p_ticket.is_empty(), SWC::BEGIN_AUTH_SESSION_RESULT_INVALID_TICKET, "Auth session ticket is empty.");
+	EBeginAuthSessionResult result = SteamAPI_ISteamGameServer_BeginAuthSession(steam_game_server, p_ticket.ptr(), p_ticket.size(), p_steam_id);
+	if (result == k_EBeginAuthSessionResultOK) {
+		auth_sessions.insert(p_steam_id, AuthSession());
+	}
+	return (SWC::BeginAuthSessionResult)result;
+}
+
+void HBSteamGameServer::end_auth_session(uint64_t p_steam_id) {
+	if (!auth_sessions.erase(p_steam_id)) {
+		return;
+	}
+	SteamAPI_ISteamGameServer_EndAuthSession(steam_game_server, p_steam_id);
+}
+
+void HBSteamGameServer::end_all_auth_sessions() {
+	for (const KeyValue<uint64_t, AuthSession> &kv : auth_sessions) {
+		SteamAPI_ISteamGameServer_EndAuthSession(steam_game_server, kv.key);
+	}
+	auth_sessions.clear();
+}
+
+bool HBSteamGameServer::has_auth_session(uint64_t p_steam_id) const {
+	return auth_sessions.has(p_steam_id);
+}
+
+bool HBSteamGameServer::is_auth_session_validated(uint64_t p_steam_id) const {
+	const AuthSession *session = auth_sessions.getptr(p_steam_id);
+	return session && session->responded && session->response == SWC::AUTH_SESSION_RESPONSE_OK;
+}
+
+PackedInt64Array HBSteamGameServer::get_auth_session_steam_ids() const {
+	PackedInt64Array steam_ids;
+	steam_ids.resize(auth_sessions.size());
+	int64_t *steam_ids_w = steam_ids.ptrw();
+	int i = 0;
+	for (const KeyValue<uint64_t, AuthSession> &kv : auth_sessions) {
+		steam_ids_w[i++] = kv.key;
+	}
+	return steam_ids;
+}
+
+SWC::UserHasLicenseForAppResult HBSteamGameServer::user_has_license_for_app(uint64_t p_steam_id, uint32_t p_app_id) {
+	return (SWC::UserHasLicenseForAppResult)SteamAPI_ISteamGameServer_UserHasLicenseForApp(steam_game_server, p_steam_id, p_app_id);
+}
+
+bool HBSteamGameServer::update_user_data(uint64_t p_steam_id, const String &p_player_name, int p_score) {
+	return SteamAPI_ISteamGameServer_BUpdateUserData(steam_game_server, p_steam_id, p_player_name.utf8().get_data(), p_score);
+}
+
+HBSteamGameServer::~HBSteamGameServer() {
+	if (steam_game_server) {
+		end_all_auth_sessions();
+	}
+}
@@ -0,0 +1,105 @@
+/**************************************************************************/
+/*  steam_game_server.h                                                   */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_GAME_SERVER_H
+#define STEAM_GAME_SERVER_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "steam_friends.h"
+#include "steamworks_callback_data.h"
+#include "steamworks_constants.gen.h"
+
+class ISteamGameServer;
+
+class HBSteamGameServer : public RefCounted {
+	GDCLASS(HBSteamGameServer, RefCounted);
+	ISteamGameServer *steam_game_server = nullptr;
+
+	struct AuthSession {
+		bool responded = false;
+		SWC::AuthSessionResponse response = SWC::AUTH_SESSION_RESPONSE_OK;
+	};
+	// Users we have called BeginAuthSession for, Steam requires EndAuthSession
+	// for every one of them, even after a failed validation.
+	HashMap<uint64_t, AuthSession> auth_sessions;
+
+	void _on_servers_connected(Ref<SteamworksCallbackData> p_callback);
+	void _on_server_connect_failure(Ref<SteamworksCallbackData> p_callback);
+	void _on_servers_disconnected(Ref<SteamworksCallbackData> p_callback);
+	void _on_policy_response(Ref<SteamworksCallbackData> p_callback);
+	void _on_validate_auth_ticket_response(Ref<SteamworksCallbackData> p_callback);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void init_interface();
+	bool is_valid() const;
+	ISteamGameServer *get_interface() const;
+
+	void set_product(const String &p_product);
+	void set_game_description(const String &p_game_description);
+	void set_mod_dir(const String &p_mod_dir);
+	void set_dedicated_server(bool p_dedicated);
+
+	void log_on(const String &p_token);
+	void log_on_anonymous();
+	void log_off();
+	bool is_logged_on() const;
+	bool is_secure() const;
+	uint64_t get_steam_id() const;
+	String get_public_ip() const;
+
+	void set_max_player_count(int p_max_players);
+	void set_bot_player_count(int p_bot_players);
+	void set_server_name(const String &p_server_name);
+	void set_map_name(const String &p_map_name);
+	void set_password_protected(bool p_password_protected);
+	void set_region(const String &p_region);
+	void set_game_tags(const PackedStringArray &p_tags);
+	void set_game_data(const String &p_game_data);
+	void set_key_value(const String &p_key, const String &p_value);
+	void clear_all_key_values();
+	void set_advertise_server_active(bool p_active);
+
+	SWC::BeginAuthSessionResult begin_auth_session(const PackedByteArray &p_ticket, uint64_t p_steam_id);
+	void end_auth_session(uint64_t p_steam_id);
+	void end_all_auth_sessions();
+	bool has_auth_session(uint64_t p_steam_id) const;
+	bool is_auth_session_validated(uint64_t p_steam_id) const;
+	PackedInt64Array get_auth_session_steam_ids() const;
+	SWC::UserHasLicenseForAppResult user_has_license_for_app(uint64_t p_steam_id, uint32_t p_app_id);
+	bool update_user_data(uint64_t p_steam_id, const String &p_player_name, int p_score);
+
+	~HBSteamGameServer();
+};
+
+#endif // STEAM_GAME_SERVER_H
@@ -0,0 +1,613 @@
+/**************************************************************************/
+/*  steam_host_migration.cpp                                              */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_host_migration.h"
+
+#include "core/io/compression.h"
+#include "core/io/marshalls.h"
+#include "core/os/os.h"
+#include "core/templates/sort_array.h"
+#include "steam/steam_api_flat.h"
+#include "steam_matchmaking.h"
+#include "steamworks.h"
+
+static const char *PING_LOCATION_MEMBER_KEY = "hm_ping";
+static const char *ELIGIBLE_MEMBER_KEY = "hm_eligible";
+static const char *SUCCESSORS_LOBBY_KEY = "hm_successors";
+// Ping locations get refined as the relay network is measured, but republishing them on
+// every change would flood the lobby with member data updates.
+static const uint64_t PING_PUBLISH_INTERVAL_USEC = 5000000;
+// Members we can't estimate a ping for rank behind everyone we can.
+static const int UNKNOWN_PING_SCORE = INT32_MAX;
+
+struct SuccessorCandidate {
+	uint64_t steam_id = 0;
+	int score = 0;
+};
+
+struct SuccessorCandidateComparator {
+	_FORCE_INLINE_ bool operator()(const SuccessorCandidate &p_a, const SuccessorCandidate &p_b) const {
+		if (p_a.score != p_b.score) {
+			return p_a.score < p_b.score;
+		}
+		return p_a.steam_id < p_b.steam_id;
+	}
+};
+
+bool HBSteamHostMigration::_is_member(uint64_t p_steam_id) const {
+	return p_steam_id != 0 && lobby->get_member_ids().has((int64_t)p_steam_id);
+}
+
+uint64_t HBSteamHostMigration::_get_lobby_owner() const {
+	Ref<HBSteamFriend> owner = lobby->get_owner();
+	return owner.is_valid() ? owner->get_steam_id() : 0;
+}
+
+void HBSteamHostMigration::_read_member(uint64_t p_steam_id) {
+	Ref<HBSteamFriend> member = HBSteamFriend::from_steam_id(p_steam_id);
+	MemberInfo &info = members[p_steam_id];
+	info.ping_location = lobby->get_member_data(member, PING_LOCATION_MEMBER_KEY).utf8();
+	info.eligible = lobby->get_member_data(member, ELIGIBLE_MEMBER_KEY) != "0";
+	ranking_dirty = true;
+}
+
+void HBSteamHostMigration::_publish_ping_location(uint64_t p_now) {
+	if (last_ping_publish_usec != 0 && p_now - last_ping_publish_usec < PING_PUBLISH_INTERVAL_USEC) {
+		return;
+	}
+	last_ping_publish_usec = p_now;
+	String ping_location = Steamworks::get_singleton()->get_networking_utils()->get_local_ping_location();
+	if (ping_location.is_empty() || ping_location == published_ping_location) {
+		return;
+	}
+	published_ping_location = ping_location;
+	lobby->set_member_data(PING_LOCATION_MEMBER_KEY, ping_location);
+	members[local_steam_id].ping_location = ping_location.utf8();
+	ranking_dirty = true;
+}
+
+PackedInt64Array HBSteamHostMigration::_rank_successors(uint64_t p_excluded) const {
+	Ref<HBSteamNetworkingUtils> networking_utils = Steamworks::get_singleton()->get_networking_utils();
+	PackedInt64Array member_ids = lobby->get_member_ids();
+
+	LocalVector<uint64_t> ids;
+	LocalVector<SteamNetworkPingLocation_t> locations;
+	LocalVector<bool> has_location;
+	ids.reserve(member_ids.size());
+	locations.resize(member_ids.size());
+	has_location.reserve(member_ids.size());
+	for (int64_t member_id : member_ids) {
+		if ((uint64_t)member_id == p_excluded) {
+			continue;
+		}
+		const MemberInfo *info = members.getptr(member_id);
+		has_location.push_back(info && networking_utils->parse_ping_location(info->ping_location, locations[ids.size()]));
+		ids.push_back(member_id);
+	}
+
+	// The new host has to serve everyone left, so rank by the worst ping it would have to any of them.
+	LocalVector<SuccessorCandidate> candidates;
+	candidates.reserve(ids.size());
+	for (uint32_t i = 0; i < ids.size(); i++) {
+		const MemberInfo *info = members.getptr(ids[i]);
+		if (info && !info->eligible) {
+			continue;
+		}
+		SuccessorCandidate candidate;
+		candidate.steam_id = ids[i];
+		if (!has_location[i]) {
+			candidate.score = UNKNOWN_PING_SCORE;
+		} else {
+			for (uint32_t j = 0; j < ids.size(); j++) {
+				if (j == i || !has_location[j]) {
+					continue;
+				}
+				int ping = SteamAPI_ISteamNetworkingUtils_EstimatePingTimeBetweenTwoLocations(networking_utils->get_interface(), locations[i], locations[j]);
+				candidate.score = MAX(candidate.score, ping);
+			}
+		}
+		candidates.push_back(candidate);
+	}
+	SortArray<SuccessorCandidate, SuccessorCandidateComparator> sorter;
+	sorter.sort(candidates.ptr(), candidates.size());
+
+	PackedInt64Array ranked;
+	ranked.resize(candidates.size());
+	for (uint32_t i = 0; i < candidates.size(); i++) {
+		ranked.set(i, candidates[i].steam_id);
+	}
+	return ranked;
+}
+
+void HBSteamHostMigration::_read_published_successors() {
+	if (is_host()) {
+		return;
+	}
+	PackedStringArray published = lobby->get_data(SUCCESSORS_LOBBY_KEY).split(",", false);
+	PackedInt64Array published_successors_ids;
+	published_successors_ids.resize(published.size());
+	for (int i = 0; i < published.size(); i++) {
+		published_successors_ids.set(i, published[i].to_int());
+	}
+	if (published_successors_ids != successors) {
+		successors = published_successors_ids;
+		emit_signal("successors_changed");
+	}
+}
+
+void HBSteamHostMigration::_publish_successors() {
+	// Only the lobby owner can write lobby data, a new host publishes once ownership catches up.
+	if (_get_lobby_owner() != local_steam_id) {
+		return;
+	}
+	String value;
+	for (int i = 0; i < successors.size(); i++) {
+		if (i > 0) {
+			value += ",";
+		}
+		value += itos(successors[i]);
+	}
+	if (value != published_successors && lobby->set_data(SUCCESSORS_LOBBY_KEY, value)) {
+		published_successors = value;
+	}
+}
+
+bool HBSteamHostMigration::_compress_state() {
+	if (!state_dirty) {
+		return !state_message.is_empty();
+	}
+	state_dirty = false;
+	streamed_to.clear();
+	state_message.clear();
+
+	int raw_size = authoritative_state.size();
+	state_message.resize(STATE_HEADER_SIZE + Compression::get_max_compressed_buffer_size(raw_size, Compression::MODE_ZSTD));
+	int compressed_size = Compression::compress(state_message.ptr() + STATE_HEADER_SIZE, authoritative_state.ptr(), raw_size, Compression::MODE_ZSTD);
+	ERR_FAIL_COND_V_MSG(compressed_size < 0, false, "Steamworks: Failed to compress the host migration state.");
+	state_message.resize(STATE_HEADER_SIZE + compressed_size);
+	if (state_message.size() > (uint32_t)k_cbMaxSteamNetworkingSocketsMessageSizeSend) {
+		state_message.clear();
+		ERR_FAIL_V_MSG(false, vformat("Steamworks: Host migration state compresses to %d bytes, which is more than a message can hold.", compressed_size));
+	}
+	state_sequence++;
+	state_message[0] = MESSAGE_STATE;
+	encode_uint32(state_sequence, state_message.ptr() + 1);
+	encode_uint32(raw_size, state_message.ptr() + 5);
+	state_bytes_raw += raw_size;
+	return true;
+}
+
+void HBSteamHostMigration::_stream_state(uint64_t p_now) {
+	if (authoritative_state.is_empty() || successors.is_empty()) {
+		return;
+	}
+	if (state_dirty && p_now - last_state_stream_usec >= (uint64_t)(state_stream_interval * 1000000.0f)) {
+		last_state_stream_usec = p_now;
+		if (!_compress_state()) {
+			return;
+		}
+	}
+	if (state_message.is_empty()) {
+		return;
+	}
+	// Successors that were just promoted get the state we already have right away.
+	int count = MIN(streamed_successor_count, successors.size());
+	for (int i = 0; i < count; i++) {
+		uint64_t successor = successors[i];
+		if (!streamed_to.has(successor)) {
+			_send_state_to(successor, state_message.ptr(), state_message.size());
+		}
+	}
+}
+
+void HBSteamHostMigration::_send_state_to(uint64_t p_steam_id, const uint8_t *p_data, uint32_t p_size) {
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	SWC::Result result = networking_messages->send_raw_message_to_peer(p_data, p_size, networking_messages->get_peer_handle(p_steam_id), k_nSteamNetworkingSend_Reliable, channel);
+	if (result == SWC::RESULT_OK) {
+		streamed_to.push_back(p_steam_id);
+		states_sent++;
+		state_bytes_sent += p_size;
+	}
+}
+
+void HBSteamHostMigration::_broadcast_host(uint64_t p_host_steam_id) {
+	uint8_t announce[ANNOUNCE_SIZE];
+	announce[0] = MESSAGE_HOST_ANNOUNCE;
+	encode_uint64(p_host_steam_id, announce + 1);
+	peer_group->send_raw_to_group(announce, ANNOUNCE_SIZE, k_nSteamNetworkingSend_Reliable, channel);
+}
+
+void HBSteamHostMigration::_receive_messages() {
+	Steamworks::get_singleton()->get_networking_messages()->receive_messages(channel, this, &HBSteamHostMigration::_receive_message);
+}
+
+void HBSteamHostMigration::_receive_message(int p_peer, const uint8_t *p_data, uint32_t p_size) {
+	if (p_peer == HBSteamNetworkingMessages::INVALID_PEER || p_size == 0) {
+		return;
+	}
+	const uint64_t sender = Steamworks::get_singleton()->get_networking_messages()->get_peer_steam_id(p_peer);
+	switch (p_data[0]) {
+		case MESSAGE_STATE: {
+			ERR_FAIL_COND_MSG(p_size < STATE_HEADER_SIZE, "Steamworks: Received a malformed host migration state.");
+			if (sender != host_steam_id) {
+				// Leftovers from a host we already moved away from.
+				return;
+			}
+			uint32_t sequence = decode_uint32(p_data + 1);
+			uint32_t raw_size = decode_uint32(p_data + 5);
+			ERR_FAIL_COND_MSG(raw_size > MAX_STATE_SIZE, "Steamworks: Received a host migration state that is too large.");
+			if (has_latest_state && sequence <= latest_state_sequence) {
+				return;
+			}
+			latest_state.resize(p_size - STATE_HEADER_SIZE);
+			memcpy(latest_state.ptrw(), p_data + STATE_HEADER_SIZE, p_size - STATE_HEADER_SIZE);
+			latest_state_raw_size = raw_size;
+			latest_state_sequence = sequence;
+			has_latest_state = true;
+			states_received++;
+		} break;
+		case MESSAGE_HOST_ANNOUNCE: {
+			ERR_FAIL_COND_MSG(p_size != ANNOUNCE_SIZE, "Steamworks: Received a malformed host announcement.");
+			uint64_t new_host = decode_uint64(p_data + 1);
+			if (new_host == host_steam_id) {
+				return;
+			}
+			// Either the host is handing off, or a new host claims the place of one that left.
+			bool from_host = sender == host_steam_id;
+			bool from_new_host = sender == new_host && (!_is_member(host_steam_id) || new_host == _get_lobby_owner());
+			if ((from_host || from_new_host) && _is_member(new_host)) {
+				_set_host(new_host);
+			}
+		} break;
+		default: {
+			ERR_FAIL_MSG("Steamworks: Received an unknown host migration message.");
+		}
+	}
+}
+
+uint64_t HBSteamHostMigration::_pick_successor() const {
+	// Every member picks from the list the host published, so they agree without talking to each other.
+	for (int64_t successor : successors) {
+		if ((uint64_t)successor == host_steam_id || !_is_member(successor)) {
+			continue;
+		}
+		const MemberInfo *info = members.getptr(successor);
+		if (!info || info->eligible) {
+			return successor;
+		}
+	}
+	PackedInt64Array ranked = _rank_successors(host_steam_id);
+	if (!ranked.is_empty()) {
+		return ranked[0];
+	}
+	uint64_t owner = _get_lobby_owner();
+	return owner != host_steam_id ? owner : 0;
+}
+
+void HBSteamHostMigration::_on_host_lost() {
+	uint64_t successor = _pick_successor();
+	if (successor != 0) {
+		migrations++;
+		_set_host(successor);
+	}
+}
+
+void HBSteamHostMigration::_set_host(uint64_t p_host_steam_id) {
+	uint64_t previous_host = host_steam_id;
+	host_steam_id = p_host_steam_id;
+	uint64_t owner = _get_lobby_owner();
+	migration_target = owner == p_host_steam_id ? 0 : p_host_steam_id;
+	if (migration_target != 0 && owner == local_steam_id) {
+		// Whoever Steam made the owner passes it on, so lobby data ends up with the host.
+		lobby->set_lobby_owner(HBSteamFriend::from_steam_id(p_host_steam_id));
+	}
+	ranking_dirty = true;
+	streamed_to.clear();
+
+	int host_peer = get_host_peer();
+	emit_signal("host_changed", (int64_t)host_steam_id, host_peer, (int64_t)previous_host);
+
+	if (host_steam_id != local_steam_id) {
+		if (previous_host == local_steam_id) {
+			published_successors = String();
+			_read_published_successors();
+		}
+		return;
+	}
+	if (previous_host == local_steam_id) {
+		return;
+	}
+	// Pick up where the previous host left off and rank our own successors right away, in case
+	// we don't last long either.
+	if (has_latest_state) {
+		authoritative_state = get_latest_state();
+		state_sequence = latest_state_sequence;
+		state_dirty = !authoritative_state.is_empty();
+	}
+	successors = _rank_successors(local_steam_id);
+	ranking_dirty = false;
+	emit_signal("successors_changed");
+	_broadcast_host(local_steam_id);
+	_publish_successors();
+	emit_signal("became_host", authoritative_state);
+}
+
+void HBSteamHostMigration::_on_member_joined(const Ref<HBSteamFriend> &p_member) {
+	ERR_FAIL_COND(!p_member.is_valid());
+	_read_member(p_member->get_steam_id());
+}
+
+void HBSteamHostMigration::_on_member_left(const Ref<HBSteamFriend> &p_member) {
+	ERR_FAIL_COND(!p_member.is_valid());
+	uint64_t steam_id = p_member->get_steam_id();
+	members.erase(steam_id);
+	streamed_to.erase(steam_id);
+	ranking_dirty = true;
+	if (steam_id == host_steam_id) {
+		_on_host_lost();
+	}
+}
+
+void HBSteamHostMigration::_on_member_data_updated(const Ref<HBSteamFriend> &p_member) {
+	if (p_member.is_valid() && _is_member(p_member->get_steam_id())) {
+		_read_member(p_member->get_steam_id());
+	}
+}
+
+void HBSteamHostMigration::_on_lobby_data_changed(const PackedStringArray &p_changed_keys, const PackedStringArray &p_removed_keys) {
+	if (p_changed_keys.has(SUCCESSORS_LOBBY_KEY) || p_removed_keys.has(SUCCESSORS_LOBBY_KEY)) {
+		_read_published_successors();
+	}
+}
+
+void HBSteamHostMigration::_on_lobby_data_updated() {
+	// Ownership changes come through here without changing any data.
+	uint64_t owner = _get_lobby_owner();
+	if (owner == 0) {
+		return;
+	}
+	if (host_steam_id == 0) {
+		_set_host(owner);
+		return;
+	}
+	if (!_is_member(host_steam_id)) {
+		_on_host_lost();
+		return;
+	}
+	if (migration_target != 0) {
+		if (owner == migration_target) {
+			migration_target = 0;
+			if (is_host()) {
+				_publish_successors();
+			}
+		} else if (owner == local_steam_id) {
+			lobby->set_lobby_owner(HBSteamFriend::from_steam_id(migration_target));
+		}
+		return;
+	}
+	if (owner != host_steam_id) {
+		// Ownership was moved by something other than us, follow it.
+		_set_host(owner);
+	}
+}
+
+void HBSteamHostMigration::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("poll"), &HBSteamHostMigration::poll);
+	ClassDB::bind_method(D_METHOD("hand_off"), &HBSteamHostMigration::hand_off);
+	ClassDB::bind_method(D_METHOD("set_authoritative_state", "state"), &HBSteamHostMigration::set_authoritative_state);
+	ClassDB::bind_method(D_METHOD("get_authoritative_state"), &HBSteamHostMigration::get_authoritative_state);
+	ClassDB::bind_method(D_METHOD("get_latest_state"), &HBSteamHostMigration::get_latest_state);
+	ClassDB::bind_method(D_METHOD("has_latest_state"), &HBSteamHostMigration::has_latest_state);
+	ClassDB::bind_method(D_METHOD("get_latest_state_sequence"), &HBSteamHostMigration::get_latest_state_sequence);
+	ClassDB::bind_method(D_METHOD("is_host"), &HBSteamHostMigration::is_host);
+	ClassDB::bind_method(D_METHOD("get_host_steam_id"), &HBSteamHostMigration::get_host_steam_id);
+	ClassDB::bind_method(D_METHOD("get_host"), &HBSteamHostMigration::get_host);
+	ClassDB::bind_method(D_METHOD("get_host_peer"), &HBSteamHostMigration::get_host_peer);
+	ClassDB::bind_method(D_METHOD("get_successors"), &HBSteamHostMigration::get_successors);
+	ClassDB::bind_method(D_METHOD("set_eligible", "eligible"), &HBSteamHostMigration::set_eligible);
+	ClassDB::bind_method(D_METHOD("is_eligible"), &HBSteamHostMigration::is_eligible);
+	ClassDB::bind_method(D_METHOD("get_stats"), &HBSteamHostMigration::get_stats);
+	ClassDB::bind_method(D_METHOD("set_state_stream_interval", "state_stream_interval"), &HBSteamHostMigration::set_state_stream_interval);
+	ClassDB::bind_method(D_METHOD("get_state_stream_interval"), &HBSteamHostMigration::get_state_stream_interval);
+	ClassDB::bind_method(D_METHOD("set_streamed_successor_count", "streamed_successor_count"), &HBSteamHostMigration::set_streamed_successor_count);
+	ClassDB::bind_method(D_METHOD("get_streamed_successor_count"), &HBSteamHostMigration::get_streamed_successor_count);
+	ClassDB::bind_method(D_METHOD("get_peer_group"), &HBSteamHostMigration::get_peer_group);
+	ClassDB::bind_method(D_METHOD("get_lobby"), &HBSteamHostMigration::get_lobby);
+	ClassDB::bind_method(D_METHOD("get_channel"), &HBSteamHostMigration::get_channel);
+
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "eligible"), "set_eligible", "is_eligible");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "state_stream_interval", PROPERTY_HINT_RANGE, "0,10,0.01,suffix:s"), "set_state_stream_interval", "get_state_stream_interval");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "streamed_successor_count", PROPERTY_HINT_RANGE, "0,16,1"), "set_streamed_successor_count", "get_streamed_successor_count");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "peer_group", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamPeerGroup"), "", "get_peer_group");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "lobby", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamLobby"), "", "get_lobby");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "channel"), "", "get_channel");
+
+	ADD_SIGNAL(MethodInfo("host_changed", PropertyInfo(Variant::INT, "host_steam_id"), PropertyInfo(Variant::INT, "host_peer"), PropertyInfo(Variant::INT, "previous_host_steam_id")));
+	ADD_SIGNAL(MethodInfo("became_host", PropertyInfo(Variant::PACKED_BYTE_ARRAY, "state")));
+	ADD_SIGNAL(MethodInfo("successors_changed"));
+}
+
+void HBSteamHostMigration::poll() {
+	uint64_t now = OS::get_singleton()->get_ticks_usec();
+	_publish_ping_location(now);
+	_receive_messages();
+	if (!is_host()) {
+		return;
+	}
+	if (ranking_dirty) {
+		ranking_dirty = false;
+		PackedInt64Array ranked = _rank_successors(local_steam_id);
+		if (ranked != successors) {
+			successors = ranked;
+			emit_signal("successors_changed");
+		}
+	}
+	_publish_successors();
+	_stream_state(now);
+}
+
+bool HBSteamHostMigration::hand_off() {
+	ERR_FAIL_COND_V_MSG(!is_host(), false, "Only the host can hand off hosting.");
+	uint64_t successor = _pick_successor();
+	ERR_FAIL_COND_V_MSG(successor == 0, false, "There is no eligible member to hand off hosting to.");
+	// The successor gets the newest state before the announcement, both are reliable on the
+	// same channel so they arrive in order.
+	if (!authoritative_state.is_empty() && _compress_state() && !streamed_to.has(successor)) {
+		_send_state_to(successor, state_message.ptr(), state_message.size());
+	}
+	_broadcast_host(successor);
+	_set_host(successor);
+	return true;
+}
+
+void HBSteamHostMigration::set_authoritative_state(const PackedByteArray &p_state) {
+	ERR_FAIL_COND_MSG((uint32_t)p_state.size() > MAX_STATE_SIZE, vformat("Host migration state can't be larger than %d bytes.", MAX_STATE_SIZE));
+	authoritative_state = p_state;
+	state_dirty = true;
+}
+
+PackedByteArray HBSteamHostMigration::get_authoritative_state() const {
+	return authoritative_state;
+}
+
+PackedByteArray HBSteamHostMigration::get_latest_state() const {
+	if (!has_latest_state) {
+		return PackedByteArray();
+	}
+	PackedByteArray state;
+	state.resize(latest_state_raw_size);
+	int size = Compression::decompress(state.ptrw(), latest_state_raw_size, latest_state.ptr(), latest_state.size(), Compression::MODE_ZSTD);
+	ERR_FAIL_COND_V_MSG(size != (int)latest_state_raw_size, PackedByteArray(), "Steamworks: Failed to decompress the host migration state.");
+	return state;
+}
+
+bool HBSteamHostMigration::has_latest_state() const {
+	return has_latest_state;
+}
+
+int HBSteamHostMigration::get_latest_state_sequence() const {
+	return has_latest_state ? (int)latest_state_sequence : -1;
+}
+
+bool HBSteamHostMigration::is_host() const {
+	return host_steam_id != 0 && host_steam_id == local_steam_id;
+}
+
+uint64_t HBSteamHostMigration::get_host_steam_id() const {
+	return host_steam_id;
+}
+
+Ref<HBSteamFriend> HBSteamHostMigration::get_host() const {
+	if (host_steam_id == 0) {
+		return Ref<HBSteamFriend>();
+	}
+	return HBSteamFriend::from_steam_id(host_steam_id);
+}
+
+int HBSteamHostMigration::get_host_peer() const {
+	if (host_steam_id == 0 || is_host()) {
+		return HBSteamNetworkingMessages::INVALID_PEER;
+	}
+	return Steamworks::get_singleton()->get_networking_messages()->get_peer_handle(host_steam_id);
+}
+
+PackedInt64Array HBSteamHostMigration::get_successors() const {
+	return successors;
+}
+
+void HBSteamHostMigration::set_eligible(bool p_eligible) {
+	lobby->set_member_data(ELIGIBLE_MEMBER_KEY, p_eligible ? "1" : "0");
+	members[local_steam_id].eligible = p_eligible;
+	ranking_dirty = true;
+}
+
+bool HBSteamHostMigration::is_eligible() const {
+	const MemberInfo *info = members.getptr(local_steam_id);
+	return !info || info->eligible;
+}
+
+Dictionary HBSteamHostMigration::get_stats() const {
+	Dictionary stats;
+	stats["states_sent"] = states_sent;
+	stats["state_bytes_sent"] = state_bytes_sent;
+	stats["state_bytes_raw"] = state_bytes_raw;
+	stats["states_received"] = states_received;
+	stats["migrations"] = migrations;
+	return stats;
+}
+
+void HBSteamHostMigration::set_state_stream_interval(float p_state_stream_interval) {
+	state_stream_interval = MAX(p_state_stream_interval, 0.0f);
+}
+
+float HBSteamHostMigration::get_state_stream_interval() const {
+	return state_stream_interval;
+}
+
+void HBSteamHostMigration::set_streamed_successor_count(int p_streamed_successor_count) {
+	streamed_successor_count = MAX(p_streamed_successor_count, 0);
+}
+
+int HBSteamHostMigration::get_streamed_successor_count() const {
+	return streamed_successor_count;
+}
+
+Ref<HBSteamPeerGroup> HBSteamHostMigration::get_peer_group() const {
+	return peer_group;
+}
+
+Ref<HBSteamLobby> HBSteamHostMigration::get_lobby() const {
+	return lobby;
+}
+
+int HBSteamHostMigration::get_channel() const {
+	return channel;
+}
+
+HBSteamHostMigration::HBSteamHostMigration(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel) {
+	peer_group = p_peer_group;
+	channel = p_channel;
+	lobby = peer_group->get_tracked_lobby();
+	local_steam_id = Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id();
+	// Ranking needs everyone's ping location, start measuring ours as early as possible.
+	Steamworks::get_singleton()->get_networking_utils()->init_relay_network_access();
+
+	lobby->connect("member_joined", callable_mp(this, &HBSteamHostMigration::_on_member_joined));
+	lobby->connect("member_left", callable_mp(this, &HBSteamHostMigration::_on_member_left));
+	lobby->connect("lobby_member_data_updated", callable_mp(this, &HBSteamHostMigration::_on_member_data_updated));
+	lobby->connect("lobby_data_changed", callable_mp(this, &HBSteamHostMigration::_on_lobby_data_changed));
+	lobby->connect("lobby_data_updated", callable_mp(this, &HBSteamHostMigration::_on_lobby_data_updated));
+
+	for (int64_t member_id : lobby->get_member_ids()) {
+		_read_member(member_id);
+	}
+	host_steam_id = _get_lobby_owner();
+	_read_published_successors();
+}
@@ -0,0 +1,156 @@
+/**************************************************************************/
+/*  steam_host_migration.h                                                */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_HOST_MIGRATION_H
+#define STEAM_HOST_MIGRATION_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+
+class HBSteamPeerGroup;
+class HBSteamLobby;
+class HBSteamFriend;
+
+// Keeps a ranked list of successors for the host of a lobby and streams them the authoritative
+// state ahead of time, so when the host leaves every member already agrees on who takes over and
+// the new host has a recent state to resume from.
+class HBSteamHostMigration : public RefCounted {
+	GDCLASS(HBSteamHostMigration, RefCounted);
+
+	static const int STATE_HEADER_SIZE = 9;
+	static const int ANNOUNCE_SIZE = 9;
+	static const uint32_t MAX_STATE_SIZE = 16 * 1024 * 1024;
+
+	enum MessageType {
+		MESSAGE_STATE,
+		MESSAGE_HOST_ANNOUNCE,
+	};
+
+	struct MemberInfo {
+		CharString ping_location;
+		bool eligible = true;
+	};
+	HashMap<uint64_t, MemberInfo> members;
+
+	Ref<HBSteamPeerGroup> peer_group;
+	Ref<HBSteamLobby> lobby;
+	int channel = 0;
+	uint64_t local_steam_id = 0;
+	uint64_t host_steam_id = 0;
+	// Set while the Steam lobby ownership hasn't caught up with the host we migrated to.
+	uint64_t migration_target = 0;
+
+	PackedInt64Array successors;
+	bool ranking_dirty = true;
+	String published_successors;
+
+	String published_ping_location;
+	uint64_t last_ping_publish_usec = 0;
+
+	PackedByteArray authoritative_state;
+	bool state_dirty = false;
+	uint32_t state_sequence = 0;
+	// Header and compressed state of the current sequence, ready to send.
+	uint64_t last_state_stream_usec = 0;
+	float state_stream_interval = 0.25f;
+	int streamed_successor_count = 1;
+	LocalVector<uint8_t> state_message;
+	// Successors that got the current state, so newly promoted ones get it right away.
+	LocalVector<uint64_t> streamed_to;
+
+	// Latest state received from the host, kept compressed until it's needed.
+	PackedByteArray latest_state;
+	uint32_t latest_state_raw_size = 0;
+	uint32_t latest_state_sequence = 0;
+	bool has_latest_state = false;
+
+	uint64_t states_sent = 0;
+	uint64_t state_bytes_sent = 0;
+	uint64_t state_bytes_raw = 0;
+	uint64_t states_received = 0;
+	uint64_t migrations = 0;
+
+	bool _is_member(uint64_t p_steam_id) const;
+	uint64_t _get_lobby_owner() const;
+	void _read_member(uint64_t p_steam_id);
+	void _publish_ping_location(uint64_t p_now);
+	PackedInt64Array _rank_successors(uint64_t p_excluded) const;
+	void _read_published_successors();
+	void _publish_successors();
+	bool _compress_state();
+	void _stream_state(uint64_t p_now);
+	void _send_state_to(uint64_t p_steam_id, const uint8_t *p_data, uint32_t p_size);
+	void _broadcast_host(uint64_t p_host_steam_id);
+	void _receive_messages();
+	void _receive_message(int p_peer, const uint8_t *p_data, uint32_t p_size);
+	uint64_t _pick_successor() const;
+	void _on_host_lost();
+	void _set_host(uint64_t p_host_steam_id);
+	void _on_member_joined(const Ref<HBSteamFriend> &p_member);
+	void _on_member_left(const Ref<HBSteamFriend> &p_member);
+	void _on_member_data_updated(const Ref<HBSteamFriend> &p_member);
+	void _on_lobby_data_changed(const PackedStringArray &p_changed_keys, const PackedStringArray &p_removed_keys);
+	void _on_lobby_data_updated();
+
+protected:
+	static void _bind_methods();
+
+public:
+	void poll();
+	bool hand_off();
+
+	void set_authoritative_state(const PackedByteArray &p_state);
+	PackedByteArray get_authoritative_state() const;
+	PackedByteArray get_latest_state() const;
+	bool has_latest_state() const;
+	int get_latest_state_sequence() const;
+
+	bool is_host() const;
+	uint64_t get_host_steam_id() const;
+	Ref<HBSteamFriend> get_host() const;
+	int get_host_peer() const;
+	PackedInt64Array get_successors() const;
+	void set_eligible(bool p_eligible);
+	bool is_eligible() const;
+	Dictionary get_stats() const;
+
+	void set_state_stream_interval(float p_state_stream_interval);
+	float get_state_stream_interval() const;
+	void set_streamed_successor_count(int p_streamed_successor_count);
+	int get_streamed_successor_count() const;
+	Ref<HBSteamPeerGroup> get_peer_group() const;
+	Ref<HBSteamLobby> get_lobby() const;
+	int get_channel() const;
+
+	HBSteamHostMigration(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel);
+};
+
+#endif // STEAM_HOST_MIGRATION_H
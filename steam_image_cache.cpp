@@ -0,0 +1,268 @@
+/**************************************************************************/
+/*  steam_image_cache.cpp                                                 */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_image_cache.h"
+
+#include "core/object/worker_thread_pool.h"
+#include "servers/rendering_server.h"
+#include "steam/steam_api_flat.h"
+#include "steamworks.h"
+
+bool HBSteamImageCache::read_image(ISteamUtils *p_utils, int p_image_handle, uint32_t &r_width, uint32_t &r_height, Vector<uint8_t> &r_data) {
+	if (!SteamAPI_ISteamUtils_GetImageSize(p_utils, p_image_handle, &r_width, &r_height) || r_width == 0 || r_height == 0) {
+		return false;
+	}
+	r_data.resize(r_width * r_height * 4);
+	return SteamAPI_ISteamUtils_GetImageRGBA(p_utils, p_image_handle, r_data.ptrw(), r_data.size());
+}
+
+void HBSteamImageCache::_queue_conversion(int p_image_handle) {
+	queued_handles.push_back(p_image_handle);
+	// Everything requested this frame goes out as a single group task.
+	if (!dispatch_queued && convert_batch_owner.is_null()) {
+		dispatch_queued = true;
+		Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamImageCache::_dispatch_conversions));
+	}
+}
+
+void HBSteamImageCache::_dispatch_conversions() {
+	dispatch_queued = false;
+	if (queued_handles.is_empty() || convert_batch_owner.is_valid()) {
+		return;
+	}
+	convert_batch.utils = Steamworks::get_singleton()->get_utils()->get_interface();
+	convert_batch.generate_mipmaps = generate_mipmaps;
+	convert_batch.compress_mode = Image::COMPRESS_MAX;
+	if (compress_textures) {
+		RenderingServer *rs = RenderingServer::get_singleton();
+		if (rs->has_os_feature("s3tc")) {
+			convert_batch.compress_mode = Image::COMPRESS_S3TC;
+		} else if (rs->has_os_feature("etc2")) {
+			convert_batch.compress_mode = Image::COMPRESS_ETC2;
+		}
+	}
+	for (int image_handle : queued_handles) {
+		const Entry *entry = entries.getptr(image_handle);
+		if (!entry || entry->texture.is_valid()) {
+			// Cleared or already converted since it was queued.
+			continue;
+		}
+		ConvertJob job;
+		job.image_handle = image_handle;
+		convert_batch.jobs.push_back(job);
+	}
+	queued_handles.clear();
+	if (convert_batch.jobs.is_empty()) {
+		return;
+	}
+	convert_batch_owner = Ref<HBSteamImageCache>(this);
+	WorkerThreadPool::GroupID group_id = WorkerThreadPool::get_singleton()->add_template_group_task(this, &HBSteamImageCache::_convert_image, &convert_batch, convert_batch.jobs.size(), -1, false, "Convert Steam images");
+	Steamworks::get_singleton()->add_worker_group_task_callback(group_id, callable_mp(this, &HBSteamImageCache::_on_convert_batch_completed));
+}
+
+void HBSteamImageCache::_convert_image(uint32_t p_index, ConvertBatch *p_batch) {
+	ConvertJob &job = p_batch->jobs[p_index];
+	uint32_t width = 0;
+	uint32_t height = 0;
+	Vector<uint8_t> data;
+	if (!read_image(p_batch->utils, job.image_handle, width, height, data)) {
+		return;
+	}
+	Ref<Image> image = Image::create_from_data(width, height, false, Image::FORMAT_RGBA8, data);
+	if (image.is_null()) {
+		return;
+	}
+	if (p_batch->generate_mipmaps) {
+		image->generate_mipmaps();
+	}
+	// Block compression works on 4x4 blocks, every size Steam uses for avatars and icons is a multiple of 4.
+	if (p_batch->compress_mode != Image::COMPRESS_MAX && width % 4 == 0 && height % 4 == 0) {
+		// Compress a copy, a failed compression keeps the uncompressed image instead of whatever it left behind.
+		Ref<Image> compressed;
+		compressed.instantiate();
+		compressed->copy_internals_from(image);
+		if (compressed->compress(p_batch->compress_mode, Image::COMPRESS_SOURCE_SRGB) == OK) {
+			image = compressed;
+		} else {
+			job.compression_failed = true;
+		}
+	}
+	job.image = image;
+}
+
+void HBSteamImageCache::_on_convert_batch_completed() {
+	for (const ConvertJob &job : convert_batch.jobs) {
+		Entry *entry = entries.getptr(job.image_handle);
+		if (!entry || entry->texture.is_valid()) {
+			continue;
+		}
+		if (job.image.is_null()) {
+			// Invalid handle, forget about it so it can be asked for again.
+			entries.erase(job.image_handle);
+			failures++;
+			continue;
+		}
+		if (job.compression_failed) {
+			compression_failures++;
+			WARN_PRINT_ONCE("Compressing a Steam image failed, it will be kept uncompressed.");
+		}
+		entry->image = job.image;
+		entry->texture = ImageTexture::create_from_image(job.image);
+		entry->bytes = job.image->get_data().size();
+		cache_bytes += entry->bytes;
+		conversions++;
+		emit_signal("image_loaded", job.image_handle, entry->texture);
+	}
+	convert_batch.jobs.clear();
+
+	Ref<HBSteamImageCache> self = convert_batch_owner;
+	convert_batch_owner.unref();
+	_evict();
+	if (!queued_handles.is_empty()) {
+		_dispatch_conversions();
+	}
+}
+
+void HBSteamImageCache::_evict() {
+	while (cache_bytes > memory_budget) {
+		int lru_handle = 0;
+		uint64_t lru_last_used = UINT64_MAX;
+		for (const KeyValue<int, Entry> &E : entries) {
+			if (E.value.texture.is_valid() && E.value.last_used < lru_last_used) {
+				lru_handle = E.key;
+				lru_last_used = E.value.last_used;
+			}
+		}
+		if (lru_handle == 0) {
+			break;
+		}
+		// Whoever still holds the texture keeps it, we just stop handing it out.
+		cache_bytes -= entries[lru_handle].bytes;
+		entries.erase(lru_handle);
+		evictions++;
+	}
+}
+
+void HBSteamImageCache::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_texture", "image_handle"), &HBSteamImageCache::get_texture);
+	ClassDB::bind_method(D_METHOD("get_image", "image_handle"), &HBSteamImageCache::get_image);
+	ClassDB::bind_method(D_METHOD("is_loaded", "image_handle"), &HBSteamImageCache::is_loaded);
+	ClassDB::bind_method(D_METHOD("clear"), &HBSteamImageCache::clear);
+	ClassDB::bind_method(D_METHOD("get_stats"), &HBSteamImageCache::get_stats);
+	ClassDB::bind_method(D_METHOD("set_memory_budget", "memory_budget"), &HBSteamImageCache::set_memory_budget);
+	ClassDB::bind_method(D_METHOD("get_memory_budget"), &HBSteamImageCache::get_memory_budget);
+	ClassDB::bind_method(D_METHOD("set_compress_textures", "compress_textures"), &HBSteamImageCache::set_compress_textures);
+	ClassDB::bind_method(D_METHOD("get_compress_textures"), &HBSteamImageCache::get_compress_textures);
+	ClassDB::bind_method(D_METHOD("set_generate_mipmaps", "generate_mipmaps"), &HBSteamImageCache::set_generate_mipmaps);
+	ClassDB::bind_method(D_METHOD("get_generate_mipmaps"), &HBSteamImageCache::get_generate_mipmaps);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "memory_budget", PROPERTY_HINT_RANGE, "0,1073741824,1,or_greater,suffix:B"), "set_memory_budget", "get_memory_budget");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "compress_textures"), "set_compress_textures", "get_compress_textures");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "generate_mipmaps"), "set_generate_mipmaps", "get_generate_mipmaps");
+
+	ADD_SIGNAL(MethodInfo("image_loaded", PropertyInfo(Variant::INT, "image_handle"), PropertyInfo(Variant::OBJECT, "texture", PROPERTY_HINT_RESOURCE_TYPE, "Texture2D")));
+}
+
+Ref<Texture2D> HBSteamImageCache::get_texture(int p_image_handle) {
+	ERR_FAIL_COND_V_MSG(p_image_handle <= 0, Ref<Texture2D>(), "An invalid Steam image handle was given.");
+	Entry *entry = entries.getptr(p_image_handle);
+	if (entry) {
+		entry->last_used = ++use_tick;
+		if (entry->texture.is_valid()) {
+			hits++;
+		}
+		return entry->texture;
+	}
+	misses++;
+	Entry new_entry;
+	new_entry.last_used = ++use_tick;
+	entries.insert(p_image_handle, new_entry);
+	_queue_conversion(p_image_handle);
+	return Ref<Texture2D>();
+}
+
+Ref<Image> HBSteamImageCache::get_image(int p_image_handle) {
+	if (get_texture(p_image_handle).is_null()) {
+		return Ref<Image>();
+	}
+	return entries[p_image_handle].image;
+}
+
+bool HBSteamImageCache::is_loaded(int p_image_handle) const {
+	const Entry *entry = entries.getptr(p_image_handle);
+	return entry && entry->texture.is_valid();
+}
+
+void HBSteamImageCache::clear() {
+	entries.clear();
+	queued_handles.clear();
+	cache_bytes = 0;
+}
+
+Dictionary HBSteamImageCache::get_stats() const {
+	Dictionary stats;
+	stats["images"] = entries.size();
+	stats["bytes"] = cache_bytes;
+	stats["hits"] = hits;
+	stats["misses"] = misses;
+	stats["hit_rate"] = hits + misses > 0 ? (double)hits / (hits + misses) : 0.0;
+	stats["conversions"] = conversions;
+	stats["failures"] = failures;
+	stats["compression_failures"] = compression_failures;
+	stats["evictions"] = evictions;
+	stats["pending"] = queued_handles.size() + convert_batch.jobs.size();
+	return stats;
+}
+
+void HBSteamImageCache::set_memory_budget(int64_t p_memory_budget) {
+	ERR_FAIL_COND_MSG(p_memory_budget < 0, "The image cache memory budget can't be negative.");
+	memory_budget = p_memory_budget;
+	_evict();
+}
+
+int64_t HBSteamImageCache::get_memory_budget() const {
+	return memory_budget;
+}
+
+void HBSteamImageCache::set_compress_textures(bool p_compress_textures) {
+	compress_textures = p_compress_textures;
+}
+
+bool HBSteamImageCache::get_compress_textures() const {
+	return compress_textures;
+}
+
+void HBSteamImageCache::set_generate_mipmaps(bool p_generate_mipmaps) {
+	generate_mipmaps = p_generate_mipmaps;
+}
+
+bool HBSteamImageCache::get_generate_mipmaps() const {
+	return generate_mipmaps;
+}
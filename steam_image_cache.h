@@ -0,0 +1,112 @@
+/**************************************************************************/
+/*  steam_image_cache.h                                                   */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_IMAGE_CACHE_H
+#define STEAM_IMAGE_CACHE_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+#include "scene/resources/image_texture.h"
+
+class ISteamUtils;
+
+// Steam hands out images (achievement icons, avatars...) as integer handles whose pixels never
+// change, so every user of a handle can share one converted image and texture. Conversion happens
+// on the worker thread pool and the least recently used images are dropped to stay within budget.
+class HBSteamImageCache : public RefCounted {
+	GDCLASS(HBSteamImageCache, RefCounted);
+
+	struct Entry {
+		Ref<Image> image;
+		Ref<ImageTexture> texture;
+		int64_t bytes = 0;
+		uint64_t last_used = 0;
+	};
+	HashMap<int, Entry> entries;
+	uint64_t use_tick = 0;
+	int64_t cache_bytes = 0;
+
+	struct ConvertJob {
+		int image_handle = 0;
+		Ref<Image> image;
+		bool compression_failed = false;
+	};
+	struct ConvertBatch {
+		ISteamUtils *utils = nullptr;
+		bool generate_mipmaps = false;
+		// COMPRESS_MAX leaves images uncompressed.
+		Image::CompressMode compress_mode = Image::COMPRESS_MAX;
+		LocalVector<ConvertJob> jobs;
+	};
+	// The batch being converted by the worker threads, new handles wait in queued_handles until it's done.
+	ConvertBatch convert_batch;
+	Ref<HBSteamImageCache> convert_batch_owner;
+	LocalVector<int> queued_handles;
+	bool dispatch_queued = false;
+
+	int64_t memory_budget = 32 * 1024 * 1024;
+	bool compress_textures = false;
+	bool generate_mipmaps = false;
+
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t conversions = 0;
+	uint64_t failures = 0;
+	uint64_t compression_failures = 0;
+	uint64_t evictions = 0;
+
+	void _queue_conversion(int p_image_handle);
+	void _dispatch_conversions();
+	void _convert_image(uint32_t p_index, ConvertBatch *p_batch);
+	void _on_convert_batch_completed();
+	void _evict();
+
+protected:
+	static void _bind_methods();
+
+public:
+	static bool read_image(ISteamUtils *p_utils, int p_image_handle, uint32_t &r_width, uint32_t &r_height, Vector<uint8_t> &r_data);
+
+	Ref<Texture2D> get_texture(int p_image_handle);
+	Ref<Image> get_image(int p_image_handle);
+	bool is_loaded(int p_image_handle) const;
+	void clear();
+	Dictionary get_stats() const;
+
+	void set_memory_budget(int64_t p_memory_budget);
+	int64_t get_memory_budget() const;
+	void set_compress_textures(bool p_compress_textures);
+	bool get_compress_textures() const;
+	void set_generate_mipmaps(bool p_generate_mipmaps);
+	bool get_generate_mipmaps() const;
+};
+
+#endif // STEAM_IMAGE_CACHE_H
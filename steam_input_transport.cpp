@@ -0,0 +1,300 @@
+/**************************************************************************/
+/*  steam_input_transport.cpp                                             */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_input_transport.h"
+
+#include "core/io/marshalls.h"
+#include "steam/steam_api_flat.h"
+#include "steam_delta_codec.h"
+#include "steamworks.h"
+
+// Wire format:
+//   uint32 newest frame, uint8 frame count
+//   for every frame, oldest first: uint8 input size, uint8 delta size, delta against the
+//   previous frame in the packet (the oldest frame is XOR'd against nothing)
+static const int PACKET_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t);
+static const int FRAME_HEADER_SIZE = 2;
+
+HBSteamInputTransport::RemotePeer &HBSteamInputTransport::_get_or_create_remote_peer(int p_peer) {
+	if (RemotePeer *peer = remote_peers.getptr(p_peer)) {
+		return *peer;
+	}
+	return remote_peers.insert(p_peer, RemotePeer())->value;
+}
+
+void HBSteamInputTransport::_receive_packets() {
+	Steamworks::get_singleton()->get_networking_messages()->receive_messages(channel, this, &HBSteamInputTransport::_receive_packet);
+}
+
+void HBSteamInputTransport::_receive_packet(int p_peer, const uint8_t *p_data, uint32_t p_size) {
+	if (p_peer == HBSteamNetworkingMessages::INVALID_PEER) {
+		return;
+	}
+	ERR_FAIL_COND_MSG(p_size < (uint32_t)PACKET_HEADER_SIZE, "Steamworks: Received a truncated input packet.");
+	RemotePeer &peer = _get_or_create_remote_peer(p_peer);
+
+	uint32_t newest_frame = decode_uint32(p_data);
+	uint32_t frame_count = p_data[sizeof(uint32_t)];
+	ERR_FAIL_COND_MSG(frame_count == 0 || frame_count > newest_frame + 1, "Steamworks: Received a malformed input packet.");
+
+	uint8_t previous[MAX_INPUT_SIZE];
+	uint32_t previous_size = 0;
+	uint8_t input[MAX_INPUT_SIZE];
+	uint32_t pos = PACKET_HEADER_SIZE;
+	for (uint32_t i = 0; i < frame_count; i++) {
+		ERR_FAIL_COND_MSG(p_size - pos < (uint32_t)FRAME_HEADER_SIZE, "Steamworks: Received a truncated input packet.");
+		uint32_t input_size = p_data[pos];
+		uint32_t delta_size = p_data[pos + 1];
+		pos += FRAME_HEADER_SIZE;
+		ERR_FAIL_COND_MSG(input_size > MAX_INPUT_SIZE || delta_size > p_size - pos, "Steamworks: Received a malformed input packet.");
+		bool ok = HBDeltaCodec::decode(p_data + pos, delta_size, previous, previous_size, input, input_size);
+		ERR_FAIL_COND_MSG(!ok, "Steamworks: Received a malformed input delta.");
+		pos += delta_size;
+
+		uint32_t frame = newest_frame - (frame_count - 1 - i);
+		_store_input(peer, frame, input, input_size, frame != newest_frame);
+
+		memcpy(previous, input, input_size);
+		previous_size = input_size;
+	}
+}
+
+void HBSteamInputTransport::_store_input(RemotePeer &p_peer, uint32_t p_frame, const uint8_t *p_data, uint8_t p_size, bool p_redundant) {
+	if (p_peer.has_frame && p_frame + INPUT_RING_SIZE <= p_peer.latest_frame) {
+		p_peer.stale_inputs++;
+		return;
+	}
+	InputSlot &slot = p_peer.inputs[p_frame % INPUT_RING_SIZE];
+	if (slot.frame == p_frame && slot.received) {
+		p_peer.duplicate_inputs++;
+		return;
+	}
+	if (slot.frame == p_frame && slot.requested) {
+		p_peer.late_inputs++;
+	}
+	if (p_redundant) {
+		// The packet this frame was first sent in got lost or reordered.
+		p_peer.redundancy_hits++;
+	}
+	slot.frame = p_frame;
+	slot.received = true;
+	slot.requested = false;
+	slot.size = p_size;
+	memcpy(slot.data, p_data, p_size);
+	p_peer.inputs_received++;
+	if (!p_peer.has_frame || p_frame > p_peer.latest_frame) {
+		p_peer.has_frame = true;
+		p_peer.latest_frame = p_frame;
+	}
+}
+
+void HBSteamInputTransport::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("send_input", "frame", "input"), &HBSteamInputTransport::send_input);
+	ClassDB::bind_method(D_METHOD("poll"), &HBSteamInputTransport::poll);
+	ClassDB::bind_method(D_METHOD("has_input", "peer", "frame"), &HBSteamInputTransport::has_input);
+	ClassDB::bind_method(D_METHOD("get_input", "peer", "frame"), &HBSteamInputTransport::get_input);
+	ClassDB::bind_method(D_METHOD("get_latest_frame", "peer"), &HBSteamInputTransport::get_latest_frame);
+	ClassDB::bind_method(D_METHOD("reset_peer", "peer"), &HBSteamInputTransport::reset_peer);
+	ClassDB::bind_method(D_METHOD("get_peers"), &HBSteamInputTransport::get_peers);
+	ClassDB::bind_method(D_METHOD("get_peer_late_input_count", "peer"), &HBSteamInputTransport::get_peer_late_input_count);
+	ClassDB::bind_method(D_METHOD("get_peer_redundancy_hit_count", "peer"), &HBSteamInputTransport::get_peer_redundancy_hit_count);
+	ClassDB::bind_method(D_METHOD("get_peer_stats", "peer"), &HBSteamInputTransport::get_peer_stats);
+	ClassDB::bind_method(D_METHOD("set_redundancy", "redundancy"), &HBSteamInputTransport::set_redundancy);
+	ClassDB::bind_method(D_METHOD("get_redundancy"), &HBSteamInputTransport::get_redundancy);
+	ClassDB::bind_method(D_METHOD("get_peer_group"), &HBSteamInputTransport::get_peer_group);
+	ClassDB::bind_method(D_METHOD("get_channel"), &HBSteamInputTransport::get_channel);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "redundancy", PROPERTY_HINT_RANGE, vformat("1,%d,1", MAX_REDUNDANCY)), "set_redundancy", "get_redundancy");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "peer_group", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamPeerGroup"), "", "get_peer_group");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "channel"), "", "get_channel");
+
+	BIND_CONSTANT(INPUT_RING_SIZE);
+	BIND_CONSTANT(MAX_INPUT_SIZE);
+	BIND_CONSTANT(MAX_REDUNDANCY);
+}
+
+SWC::Result HBSteamInputTransport::send_input(int p_frame, const PackedByteArray &p_input) {
+	ERR_FAIL_COND_V(p_frame < 0, SWC::RESULT_FAIL);
+	return send_raw_input(p_frame, p_input.ptr(), p_input.size());
+}
+
+SWC::Result HBSteamInputTransport::send_raw_input(uint32_t p_frame, const uint8_t *p_input, uint32_t p_size) {
+	ERR_FAIL_COND_V_MSG(p_size > MAX_INPUT_SIZE, SWC::RESULT_FAIL, vformat("Inputs can't be bigger than %d bytes.", MAX_INPUT_SIZE));
+	ERR_FAIL_COND_V_MSG(has_local_frame && p_frame <= latest_local_frame, SWC::RESULT_FAIL, "Input frames must be sent in increasing order.");
+	ERR_FAIL_COND_V(!peer_group.is_valid(), SWC::RESULT_FAIL);
+
+	InputSlot &slot = local_inputs[p_frame % INPUT_RING_SIZE];
+	slot.frame = p_frame;
+	slot.received = true;
+	slot.size = p_size;
+	memcpy(slot.data, p_input, p_size);
+	has_local_frame = true;
+	latest_local_frame = p_frame;
+
+	// Repeat as many of the previous frames as we have, stopping at the first gap.
+	uint32_t frame_count = 1;
+	while (frame_count < (uint32_t)redundancy && frame_count <= p_frame) {
+		const InputSlot &previous = local_inputs[(p_frame - frame_count) % INPUT_RING_SIZE];
+		if (!previous.received || previous.frame != p_frame - frame_count) {
+			break;
+		}
+		frame_count++;
+	}
+
+	packet_buffer.resize(PACKET_HEADER_SIZE);
+	encode_uint32(p_frame, packet_buffer.ptr());
+	packet_buffer[sizeof(uint32_t)] = frame_count;
+
+	const InputSlot *previous = nullptr;
+	for (uint32_t i = 0; i < frame_count; i++) {
+		const InputSlot &input = local_inputs[(p_frame - (frame_count - 1 - i)) % INPUT_RING_SIZE];
+		// Inputs rarely change between frames, so the deltas are usually a couple of bytes.
+		HBDeltaCodec::encode(input.data, input.size, previous ? previous->data : nullptr, previous ? previous->size : 0, UINT8_MAX, delta_buffer);
+		packet_buffer.push_back(input.size);
+		packet_buffer.push_back(delta_buffer.size());
+		for (uint32_t j = 0; j < delta_buffer.size(); j++) {
+			packet_buffer.push_back(delta_buffer[j]);
+		}
+		previous = &input;
+	}
+
+	return peer_group->send_raw_to_group(packet_buffer.ptr(), packet_buffer.size(), k_nSteamNetworkingSend_UnreliableNoDelay, channel);
+}
+
+void HBSteamInputTransport::poll() {
+	_receive_packets();
+}
+
+bool HBSteamInputTransport::has_input(int p_peer, int p_frame) const {
+	const RemotePeer *peer = remote_peers.getptr(p_peer);
+	if (!peer || p_frame < 0) {
+		return false;
+	}
+	const InputSlot &slot = peer->inputs[p_frame % INPUT_RING_SIZE];
+	return slot.received && slot.frame == (uint32_t)p_frame;
+}
+
+PackedByteArray HBSteamInputTransport::get_input(int p_peer, int p_frame) {
+	PackedByteArray out;
+	ERR_FAIL_COND_V(p_frame < 0, out);
+	uint32_t size = 0;
+	const uint8_t *input = get_raw_input(p_peer, p_frame, size);
+	if (input) {
+		out.resize(size);
+		memcpy(out.ptrw(), input, size);
+	}
+	return out;
+}
+
+const uint8_t *HBSteamInputTransport::get_raw_input(int p_peer, uint32_t p_frame, uint32_t &r_size) {
+	r_size = 0;
+	RemotePeer &peer = _get_or_create_remote_peer(p_peer);
+	InputSlot &slot = peer.inputs[p_frame % INPUT_RING_SIZE];
+	if (slot.frame == p_frame && slot.received) {
+		r_size = slot.size;
+		return slot.data;
+	}
+	// Remember that the game needed this frame, if it shows up later it counts as late.
+	if (!slot.received || slot.frame < p_frame) {
+		slot.frame = p_frame;
+		slot.received = false;
+		slot.requested = true;
+	}
+	return nullptr;
+}
+
+int HBSteamInputTransport::get_latest_frame(int p_peer) const {
+	const RemotePeer *peer = remote_peers.getptr(p_peer);
+	if (!peer || !peer->has_frame) {
+		return -1;
+	}
+	return peer->latest_frame;
+}
+
+void HBSteamInputTransport::reset_peer(int p_peer) {
+	remote_peers.erase(p_peer);
+}
+
+PackedInt32Array HBSteamInputTransport::get_peers() const {
+	PackedInt32Array out;
+	for (const KeyValue<int, RemotePeer> &kv : remote_peers) {
+		out.push_back(kv.key);
+	}
+	return out;
+}
+
+int HBSteamInputTransport::get_peer_late_input_count(int p_peer) const {
+	const RemotePeer *peer = remote_peers.getptr(p_peer);
+	ERR_FAIL_NULL_V_MSG(peer, 0, vformat("No input was received from peer %d.", p_peer));
+	return peer->late_inputs;
+}
+
+int HBSteamInputTransport::get_peer_redundancy_hit_count(int p_peer) const {
+	const RemotePeer *peer = remote_peers.getptr(p_peer);
+	ERR_FAIL_NULL_V_MSG(peer, 0, vformat("No input was received from peer %d.", p_peer));
+	return peer->redundancy_hits;
+}
+
+Dictionary HBSteamInputTransport::get_peer_stats(int p_peer) const {
+	const RemotePeer *peer = remote_peers.getptr(p_peer);
+	ERR_FAIL_NULL_V_MSG(peer, Dictionary(), vformat("No input was received from peer %d.", p_peer));
+	Dictionary stats;
+	stats["inputs_received"] = peer->inputs_received;
+	stats["redundancy_hits"] = peer->redundancy_hits;
+	stats["duplicate_inputs"] = peer->duplicate_inputs;
+	stats["late_inputs"] = peer->late_inputs;
+	stats["stale_inputs"] = peer->stale_inputs;
+	stats["latest_frame"] = get_latest_frame(p_peer);
+	return stats;
+}
+
+void HBSteamInputTransport::set_redundancy(int p_redundancy) {
+	redundancy = CLAMP(p_redundancy, 1, MAX_REDUNDANCY);
+}
+
+int HBSteamInputTransport::get_redundancy() const {
+	return redundancy;
+}
+
+Ref<HBSteamPeerGroup> HBSteamInputTransport::get_peer_group() const {
+	return peer_group;
+}
+
+int HBSteamInputTransport::get_channel() const {
+	return channel;
+}
+
+HBSteamInputTransport::HBSteamInputTransport(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel, int p_redundancy) {
+	peer_group = p_peer_group;
+	channel = p_channel;
+	set_redundancy(p_redundancy);
+	packet_buffer.reserve(PACKET_HEADER_SIZE + MAX_REDUNDANCY * (FRAME_HEADER_SIZE + UINT8_MAX));
+	Steamworks::get_singleton()->get_networking_messages()->connect("peer_released", callable_mp(this, &HBSteamInputTransport::reset_peer));
+}
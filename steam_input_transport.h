@@ -0,0 +1,118 @@
+/**************************************************************************/
+/*  steam_input_transport.h                                               */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_INPUT_TRANSPORT_H
+#define STEAM_INPUT_TRANSPORT_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/local_vector.h"
+#include "steamworks_constants.gen.h"
+
+class HBSteamPeerGroup;
+
+// Sends per-frame input over an unreliable channel, every packet repeats the previous
+// frames so a lost packet is covered by the next one instead of waiting on a resend.
+class HBSteamInputTransport : public RefCounted {
+	GDCLASS(HBSteamInputTransport, RefCounted);
+
+public:
+	static const int INPUT_RING_SIZE = 128;
+	static const int MAX_INPUT_SIZE = 64;
+	static const int MAX_REDUNDANCY = 32;
+
+private:
+
+	struct InputSlot {
+		uint32_t frame = 0;
+		bool received = false;
+		// Set when the game asked for this frame before it arrived.
+		bool requested = false;
+		uint8_t size = 0;
+		uint8_t data[MAX_INPUT_SIZE];
+	};
+
+	struct RemotePeer {
+		InputSlot inputs[INPUT_RING_SIZE];
+		bool has_frame = false;
+		uint32_t latest_frame = 0;
+
+		uint64_t inputs_received = 0;
+		uint64_t redundancy_hits = 0;
+		uint64_t duplicate_inputs = 0;
+		uint64_t late_inputs = 0;
+		uint64_t stale_inputs = 0;
+	};
+	HashMap<int, RemotePeer> remote_peers;
+
+	InputSlot local_inputs[INPUT_RING_SIZE];
+	bool has_local_frame = false;
+	uint32_t latest_local_frame = 0;
+
+	Ref<HBSteamPeerGroup> peer_group;
+	int channel = 0;
+	int redundancy = 8;
+
+	LocalVector<uint8_t> packet_buffer;
+	LocalVector<uint8_t> delta_buffer;
+
+	RemotePeer &_get_or_create_remote_peer(int p_peer);
+	void _receive_packets();
+	void _receive_packet(int p_peer, const uint8_t *p_data, uint32_t p_size);
+	void _store_input(RemotePeer &p_peer, uint32_t p_frame, const uint8_t *p_data, uint8_t p_size, bool p_redundant);
+
+protected:
+	static void _bind_methods();
+
+public:
+	SWC::Result send_input(int p_frame, const PackedByteArray &p_input);
+	SWC::Result send_raw_input(uint32_t p_frame, const uint8_t *p_input, uint32_t p_size);
+
+	void poll();
+
+	bool has_input(int p_peer, int p_frame) const;
+	PackedByteArray get_input(int p_peer, int p_frame);
+	const uint8_t *get_raw_input(int p_peer, uint32_t p_frame, uint32_t &r_size);
+	int get_latest_frame(int p_peer) const;
+	void reset_peer(int p_peer);
+	PackedInt32Array get_peers() const;
+
+	int get_peer_late_input_count(int p_peer) const;
+	int get_peer_redundancy_hit_count(int p_peer) const;
+	Dictionary get_peer_stats(int p_peer) const;
+
+	void set_redundancy(int p_redundancy);
+	int get_redundancy() const;
+	Ref<HBSteamPeerGroup> get_peer_group() const;
+	int get_channel() const;
+
+	HBSteamInputTransport(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel, int p_redundancy);
+};
+
+#endif // STEAM_INPUT_TRANSPORT_H
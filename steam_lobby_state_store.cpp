@@ -0,0 +1,491 @@
+/**************************************************************************/
+/*  steam_lobby_state_store.cpp                                           */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_lobby_state_store.h"
+#include "steam_matchmaking.h"
+#include "steamworks.h"
+
+// Separators between entries and between the fields of an entry, these can't be used in keys or values.
+static const char32_t RECORD_SEPARATOR = 0x1E;
+static const char32_t FIELD_SEPARATOR = 0x1F;
+
+static bool has_separators(const String &p_string) {
+	return p_string.find_char(RECORD_SEPARATOR) != -1 || p_string.find_char(FIELD_SEPARATOR) != -1;
+}
+
+uint64_t HBLobbyStateStore::_get_local_writer() const {
+	return owner ? OWNER_WRITER : local_steam_id;
+}
+
+bool HBLobbyStateStore::_is_local_owner() const {
+	Ref<HBSteamFriend> lobby_owner = lobby->get_owner();
+	return lobby_owner.is_valid() && lobby_owner->get_steam_id() == local_steam_id;
+}
+
+String HBLobbyStateStore::_get_chunk_key(int p_chunk) const {
+	return prefix + ":" + itos(p_chunk);
+}
+
+String HBLobbyStateStore::_get_chunk_count_key() const {
+	return prefix + ":n";
+}
+
+PackedStringArray HBLobbyStateStore::_encode_entries(const HashMap<String, Entry> &p_entries) {
+	PackedStringArray chunks;
+	String chunk;
+	int chunk_size = 0;
+	for (const KeyValue<String, Entry> &kv : p_entries) {
+		// Erased entries are kept without a value so the erase wins over older writes.
+		String record = kv.key + String::chr(FIELD_SEPARATOR) + itos(kv.value.version);
+		if (!kv.value.erased) {
+			record += String::chr(FIELD_SEPARATOR) + kv.value.value;
+		}
+		int record_size = record.utf8().length();
+		if (chunk_size > 0 && chunk_size + 1 + record_size > MAX_CHUNK_SIZE) {
+			chunks.push_back(chunk);
+			chunk = String();
+			chunk_size = 0;
+		}
+		if (chunk_size > 0) {
+			chunk += String::chr(RECORD_SEPARATOR);
+			chunk_size++;
+		}
+		chunk += record;
+		chunk_size += record_size;
+	}
+	if (chunk_size > 0) {
+		chunks.push_back(chunk);
+	}
+	return chunks;
+}
+
+void HBLobbyStateStore::_decode_chunk(const String &p_chunk, HashMap<String, Entry> &r_entries) {
+	if (p_chunk.is_empty()) {
+		return;
+	}
+	PackedStringArray records = p_chunk.split(String::chr(RECORD_SEPARATOR));
+	for (const String &record : records) {
+		PackedStringArray fields = record.split(String::chr(FIELD_SEPARATOR));
+		if (fields.size() < 2 || fields.size() > 3 || fields[0].is_empty()) {
+			continue;
+		}
+		Entry entry;
+		entry.version = fields[1].to_int();
+		entry.erased = fields.size() == 2;
+		if (!entry.erased) {
+			entry.value = fields[2];
+		}
+		r_entries[fields[0]] = entry;
+	}
+}
+
+void HBLobbyStateStore::_read_writer(uint64_t p_writer, PackedStringArray &r_changed_keys, PackedStringArray &r_removed_keys) {
+	Ref<HBSteamFriend> member;
+	if (p_writer != OWNER_WRITER) {
+		member = HBSteamFriend::from_steam_id(p_writer);
+	}
+	String count_key = _get_chunk_count_key();
+	String chunk_count = member.is_valid() ? lobby->get_member_data(member, count_key) : lobby->get_data(count_key);
+	if (chunk_count.is_empty()) {
+		return;
+	}
+	HashMap<String, Entry> entries;
+	int count = CLAMP(chunk_count.to_int(), 0, MAX_CHUNKS);
+	for (int i = 0; i < count; i++) {
+		String chunk_key = _get_chunk_key(i);
+		_decode_chunk(member.is_valid() ? lobby->get_member_data(member, chunk_key) : lobby->get_data(chunk_key), entries);
+	}
+	_set_writer_entries(p_writer, entries, r_changed_keys, r_removed_keys);
+}
+
+void HBLobbyStateStore::_set_writer_entries(uint64_t p_writer, const HashMap<String, Entry> &p_entries, PackedStringArray &r_changed_keys, PackedStringArray &r_removed_keys) {
+	HashMap<String, Entry> &existing_entries = writer_entries[p_writer];
+	for (const KeyValue<String, Entry> &kv : p_entries) {
+		clock = MAX(clock, kv.value.version);
+		// Entries missing from what we read are kept, chunks can be read halfway through an update
+		// and erasing is explicit anyway.
+		const Entry *existing = existing_entries.getptr(kv.key);
+		if (existing && existing->version >= kv.value.version) {
+			continue;
+		}
+		existing_entries[kv.key] = kv.value;
+		_resolve_key(kv.key, r_changed_keys, r_removed_keys);
+	}
+}
+
+void HBLobbyStateStore::_resolve_key(const String &p_key, PackedStringArray &r_changed_keys, PackedStringArray &r_removed_keys) {
+	const Entry *winner = nullptr;
+	uint64_t winner_writer = 0;
+	for (const KeyValue<uint64_t, HashMap<String, Entry>> &kv : writer_entries) {
+		const Entry *entry = kv.value.getptr(p_key);
+		if (!entry) {
+			continue;
+		}
+		bool wins = !winner || entry->version > winner->version;
+		if (winner && entry->version == winner->version) {
+			// Last writer wins, the owner breaks ties and after that the writer ID, so every member agrees.
+			if (kv.key == OWNER_WRITER || winner_writer == OWNER_WRITER) {
+				wins = kv.key == OWNER_WRITER;
+			} else {
+				wins = kv.key > winner_writer;
+			}
+		}
+		if (wins) {
+			winner = entry;
+			winner_writer = kv.key;
+		}
+	}
+
+	ResolvedEntry *resolved = values.getptr(p_key);
+	if (!winner || winner->erased) {
+		if (resolved) {
+			values.erase(p_key);
+			r_changed_keys.erase(p_key);
+			if (!r_removed_keys.has(p_key)) {
+				r_removed_keys.push_back(p_key);
+			}
+		}
+		return;
+	}
+	if (resolved && resolved->value == winner->value) {
+		resolved->version = winner->version;
+		resolved->writer = winner_writer;
+		return;
+	}
+	ResolvedEntry new_entry;
+	new_entry.version = winner->version;
+	new_entry.writer = winner_writer;
+	new_entry.value = winner->value;
+	values[p_key] = new_entry;
+	if (!r_changed_keys.has(p_key)) {
+		r_changed_keys.push_back(p_key);
+	}
+	r_removed_keys.erase(p_key);
+}
+
+void HBLobbyStateStore::_write_local_entry(const String &p_key, const Entry &p_entry) {
+	local_entries[p_key] = p_entry;
+	writer_entries[_get_local_writer()][p_key] = p_entry;
+	_resolve_key(p_key, pending_changed_keys, pending_removed_keys);
+	local_dirty = true;
+	_queue_flush();
+}
+
+void HBLobbyStateStore::_write_chunk(bool p_as_owner, const String &p_key, const String &p_value) {
+	if (p_as_owner) {
+		lobby->set_data(p_key, p_value);
+	} else {
+		lobby->set_member_data(p_key, p_value);
+	}
+}
+
+void HBLobbyStateStore::_update_owner(PackedStringArray &r_changed_keys, PackedStringArray &r_removed_keys) {
+	bool is_owner = _is_local_owner();
+	if (is_owner == owner) {
+		return;
+	}
+	HashMap<String, Entry> previous_entries = writer_entries[_get_local_writer()];
+	writer_entries.erase(_get_local_writer());
+	if (is_owner) {
+		// Take over what the previous owner published, so nothing it wrote gets lost.
+		_read_writer(OWNER_WRITER, r_changed_keys, r_removed_keys);
+		for (const KeyValue<String, Entry> &kv : writer_entries[OWNER_WRITER]) {
+			const Entry *local_entry = local_entries.getptr(kv.key);
+			if (!local_entry || local_entry->version < kv.value.version) {
+				local_entries[kv.key] = kv.value;
+			}
+		}
+	}
+	owner = is_owner;
+	writer_entries[_get_local_writer()] = local_entries;
+	for (const KeyValue<String, Entry> &kv : previous_entries) {
+		_resolve_key(kv.key, r_changed_keys, r_removed_keys);
+	}
+	for (const KeyValue<String, Entry> &kv : local_entries) {
+		_resolve_key(kv.key, r_changed_keys, r_removed_keys);
+	}
+	local_dirty = true;
+	_queue_flush();
+}
+
+void HBLobbyStateStore::_emit_changes(const PackedStringArray &p_changed_keys, const PackedStringArray &p_removed_keys) {
+	if (!p_changed_keys.is_empty() || !p_removed_keys.is_empty()) {
+		emit_signal("values_changed", p_changed_keys, p_removed_keys);
+	}
+}
+
+void HBLobbyStateStore::_queue_flush() {
+	if (flush_queued) {
+		return;
+	}
+	flush_queued = true;
+	Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBLobbyStateStore::_on_flush_frame));
+}
+
+void HBLobbyStateStore::_on_flush_frame() {
+	flush_queued = false;
+	flush();
+}
+
+void HBLobbyStateStore::_on_lobby_data_changed(const PackedStringArray &p_changed_keys, const PackedStringArray &p_removed_keys) {
+	PackedStringArray changed_keys;
+	PackedStringArray removed_keys;
+	_update_owner(changed_keys, removed_keys);
+	if (!owner) {
+		String key_prefix = prefix + ":";
+		bool store_changed = false;
+		for (const String &key : p_changed_keys) {
+			if (key.begins_with(key_prefix)) {
+				store_changed = true;
+				break;
+			}
+		}
+		if (store_changed) {
+			_read_writer(OWNER_WRITER, changed_keys, removed_keys);
+		}
+	}
+	_emit_changes(changed_keys, removed_keys);
+}
+
+void HBLobbyStateStore::_on_lobby_data_updated() {
+	// Owner changes come through here without changing any data.
+	PackedStringArray changed_keys;
+	PackedStringArray removed_keys;
+	_update_owner(changed_keys, removed_keys);
+	_emit_changes(changed_keys, removed_keys);
+}
+
+void HBLobbyStateStore::_on_member_data_updated(const Ref<HBSteamFriend> &p_member) {
+	if (!p_member.is_valid() || p_member->get_steam_id() == local_steam_id) {
+		return;
+	}
+	PackedStringArray changed_keys;
+	PackedStringArray removed_keys;
+	_read_writer(p_member->get_steam_id(), changed_keys, removed_keys);
+	_emit_changes(changed_keys, removed_keys);
+}
+
+void HBLobbyStateStore::_on_member_left(const Ref<HBSteamFriend> &p_member) {
+	if (!p_member.is_valid()) {
+		return;
+	}
+	HashMap<String, Entry> *member_entries = writer_entries.getptr(p_member->get_steam_id());
+	if (!member_entries) {
+		return;
+	}
+	HashMap<String, Entry> entries = *member_entries;
+	writer_entries.erase(p_member->get_steam_id());
+	PackedStringArray changed_keys;
+	PackedStringArray removed_keys;
+	for (const KeyValue<String, Entry> &kv : entries) {
+		_resolve_key(kv.key, changed_keys, removed_keys);
+	}
+	_emit_changes(changed_keys, removed_keys);
+}
+
+void HBLobbyStateStore::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_value", "key", "value"), &HBLobbyStateStore::set_value);
+	ClassDB::bind_method(D_METHOD("erase_value", "key"), &HBLobbyStateStore::erase_value);
+	ClassDB::bind_method(D_METHOD("get_value", "key", "default"), &HBLobbyStateStore::get_value, DEFVAL(""));
+	ClassDB::bind_method(D_METHOD("has_value", "key"), &HBLobbyStateStore::has_value);
+	ClassDB::bind_method(D_METHOD("get_keys"), &HBLobbyStateStore::get_keys);
+	ClassDB::bind_method(D_METHOD("get_values"), &HBLobbyStateStore::get_values);
+	ClassDB::bind_method(D_METHOD("get_version", "key"), &HBLobbyStateStore::get_version);
+	ClassDB::bind_method(D_METHOD("get_writer", "key"), &HBLobbyStateStore::get_writer);
+	ClassDB::bind_method(D_METHOD("get_version_vector", "key"), &HBLobbyStateStore::get_version_vector);
+	ClassDB::bind_method(D_METHOD("get_clock"), &HBLobbyStateStore::get_clock);
+	ClassDB::bind_method(D_METHOD("flush"), &HBLobbyStateStore::flush);
+	ClassDB::bind_method(D_METHOD("refresh"), &HBLobbyStateStore::refresh);
+	ClassDB::bind_method(D_METHOD("get_lobby"), &HBLobbyStateStore::get_lobby);
+	ClassDB::bind_method(D_METHOD("get_prefix"), &HBLobbyStateStore::get_prefix);
+
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "lobby", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamLobby"), "", "get_lobby");
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "prefix"), "", "get_prefix");
+
+	ADD_SIGNAL(MethodInfo("values_changed", PropertyInfo(Variant::PACKED_STRING_ARRAY, "changed_keys"), PropertyInfo(Variant::PACKED_STRING_ARRAY, "removed_keys")));
+
+	BIND_CONSTANT(OWNER_WRITER);
+	BIND_CONSTANT(MAX_CHUNK_SIZE);
+	BIND_CONSTANT(MAX_CHUNKS);
+}
+
+void HBLobbyStateStore::set_value(const String &p_key, const String &p_value) {
+	ERR_FAIL_COND_MSG(p_key.is_empty(), "State store keys can't be empty.");
+	ERR_FAIL_COND_MSG(has_separators(p_key) || has_separators(p_value), "State store keys and values can't contain the ASCII record (0x1E) or unit (0x1F) separators.");
+	// Two separators and up to 20 digits of version go along with the key and value.
+	ERR_FAIL_COND_MSG(p_key.utf8().length() + p_value.utf8().length() + 22 > MAX_CHUNK_SIZE, vformat("State store entries must fit in %d bytes.", MAX_CHUNK_SIZE));
+	const ResolvedEntry *resolved = values.getptr(p_key);
+	if (resolved && resolved->writer == _get_local_writer() && resolved->value == p_value) {
+		// We already published the winning value.
+		return;
+	}
+	Entry entry;
+	entry.version = ++clock;
+	entry.value = p_value;
+	_write_local_entry(p_key, entry);
+}
+
+void HBLobbyStateStore::erase_value(const String &p_key) {
+	if (!values.has(p_key) && !local_entries.has(p_key)) {
+		return;
+	}
+	Entry entry;
+	entry.version = ++clock;
+	entry.erased = true;
+	_write_local_entry(p_key, entry);
+}
+
+String HBLobbyStateStore::get_value(const String &p_key, const String &p_default) const {
+	const ResolvedEntry *resolved = values.getptr(p_key);
+	return resolved ? resolved->value : p_default;
+}
+
+bool HBLobbyStateStore::has_value(const String &p_key) const {
+	return values.has(p_key);
+}
+
+PackedStringArray HBLobbyStateStore::get_keys() const {
+	PackedStringArray keys;
+	for (const KeyValue<String, ResolvedEntry> &kv : values) {
+		keys.push_back(kv.key);
+	}
+	return keys;
+}
+
+Dictionary HBLobbyStateStore::get_values() const {
+	Dictionary out;
+	for (const KeyValue<String, ResolvedEntry> &kv : values) {
+		out[kv.key] = kv.value.value;
+	}
+	return out;
+}
+
+uint64_t HBLobbyStateStore::get_version(const String &p_key) const {
+	const ResolvedEntry *resolved = values.getptr(p_key);
+	return resolved ? resolved->version : 0;
+}
+
+uint64_t HBLobbyStateStore::get_writer(const String &p_key) const {
+	const ResolvedEntry *resolved = values.getptr(p_key);
+	return resolved ? resolved->writer : 0;
+}
+
+Dictionary HBLobbyStateStore::get_version_vector(const String &p_key) const {
+	Dictionary version_vector;
+	for (const KeyValue<uint64_t, HashMap<String, Entry>> &kv : writer_entries) {
+		const Entry *entry = kv.value.getptr(p_key);
+		if (entry) {
+			version_vector[kv.key] = entry->version;
+		}
+	}
+	return version_vector;
+}
+
+uint64_t HBLobbyStateStore::get_clock() const {
+	return clock;
+}
+
+void HBLobbyStateStore::flush() {
+	_update_owner(pending_changed_keys, pending_removed_keys);
+
+	if (local_dirty) {
+		local_dirty = false;
+		PackedStringArray chunks = _encode_entries(local_entries);
+		if (chunks.size() > MAX_CHUNKS) {
+			ERR_PRINT(vformat("Lobby state store \"%s\" needs %d chunks but only %d are allowed, not publishing it.", prefix, chunks.size(), MAX_CHUNKS));
+		} else {
+			if (published_as_owner != owner) {
+				// Only the owner can write lobby data, so whatever we published there is left
+				// for the new owner to replace, but our old member data can be cleared.
+				if (!published_as_owner) {
+					for (int i = 0; i < published_chunks.size(); i++) {
+						_write_chunk(false, _get_chunk_key(i), String());
+					}
+					_write_chunk(false, _get_chunk_count_key(), String());
+				}
+				published_chunks.clear();
+				published_as_owner = owner;
+			}
+			// Only chunks that changed are written.
+			for (int i = 0; i < chunks.size(); i++) {
+				if (i >= published_chunks.size() || published_chunks[i] != chunks[i]) {
+					_write_chunk(owner, _get_chunk_key(i), chunks[i]);
+				}
+			}
+			for (int i = chunks.size(); i < published_chunks.size(); i++) {
+				_write_chunk(owner, _get_chunk_key(i), String());
+			}
+			if (chunks.size() != published_chunks.size()) {
+				_write_chunk(owner, _get_chunk_count_key(), itos(chunks.size()));
+			}
+			published_chunks = chunks;
+		}
+	}
+
+	PackedStringArray changed_keys = pending_changed_keys;
+	PackedStringArray removed_keys = pending_removed_keys;
+	pending_changed_keys.clear();
+	pending_removed_keys.clear();
+	_emit_changes(changed_keys, removed_keys);
+}
+
+void HBLobbyStateStore::refresh() {
+	PackedStringArray changed_keys;
+	PackedStringArray removed_keys;
+	_update_owner(changed_keys, removed_keys);
+	if (!owner) {
+		_read_writer(OWNER_WRITER, changed_keys, removed_keys);
+	}
+	for (int64_t member : lobby->get_member_ids()) {
+		if ((uint64_t)member != local_steam_id) {
+			_read_writer(member, changed_keys, removed_keys);
+		}
+	}
+	_emit_changes(changed_keys, removed_keys);
+}
+
+Ref<HBSteamLobby> HBLobbyStateStore::get_lobby() const {
+	return lobby;
+}
+
+String HBLobbyStateStore::get_prefix() const {
+	return prefix;
+}
+
+HBLobbyStateStore::HBLobbyStateStore(const Ref<HBSteamLobby> &p_lobby, const String &p_prefix) {
+	lobby = p_lobby;
+	prefix = p_prefix;
+	local_steam_id = Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id();
+	lobby->connect("lobby_data_changed", callable_mp(this, &HBLobbyStateStore::_on_lobby_data_changed));
+	lobby->connect("lobby_data_updated", callable_mp(this, &HBLobbyStateStore::_on_lobby_data_updated));
+	lobby->connect("lobby_member_data_updated", callable_mp(this, &HBLobbyStateStore::_on_member_data_updated));
+	lobby->connect("member_left", callable_mp(this, &HBLobbyStateStore::_on_member_left));
+	refresh();
+}
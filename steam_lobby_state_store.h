@@ -0,0 +1,128 @@
+/**************************************************************************/
+/*  steam_lobby_state_store.h                                             */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_LOBBY_STATE_STORE_H
+#define STEAM_LOBBY_STATE_STORE_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+
+class HBSteamLobby;
+class HBSteamFriend;
+
+// Versioned key-value map replicated through lobby data. Every member publishes the entries it
+// wrote in its own member data and the lobby owner publishes its entries in the lobby data, so no
+// P2P traffic is needed. Entries carry Lamport versions and conflicts resolve to the highest
+// version, with the owner winning ties.
+class HBLobbyStateStore : public RefCounted {
+	GDCLASS(HBLobbyStateStore, RefCounted);
+
+public:
+	// Writer ID used for the entries the lobby owner publishes in the lobby data.
+	static const uint64_t OWNER_WRITER = 0;
+	// Logical entries are packed into values of at most this many bytes.
+	static const int MAX_CHUNK_SIZE = 2048;
+	static const int MAX_CHUNKS = 32;
+
+private:
+	struct Entry {
+		uint64_t version = 0;
+		String value;
+		bool erased = false;
+	};
+	struct ResolvedEntry {
+		uint64_t version = 0;
+		uint64_t writer = 0;
+		String value;
+	};
+
+	Ref<HBSteamLobby> lobby;
+	String prefix;
+	uint64_t local_steam_id = 0;
+	bool owner = false;
+	uint64_t clock = 0;
+
+	// Entries as last published by each writer, including our own.
+	HashMap<uint64_t, HashMap<String, Entry>> writer_entries;
+	HashMap<String, ResolvedEntry> values;
+
+	HashMap<String, Entry> local_entries;
+	bool local_dirty = false;
+	bool flush_queued = false;
+	// Where our entries currently live, and what we last wrote there.
+	bool published_as_owner = false;
+	PackedStringArray published_chunks;
+	PackedStringArray pending_changed_keys;
+	PackedStringArray pending_removed_keys;
+
+	uint64_t _get_local_writer() const;
+	bool _is_local_owner() const;
+	String _get_chunk_key(int p_chunk) const;
+	String _get_chunk_count_key() const;
+	static PackedStringArray _encode_entries(const HashMap<String, Entry> &p_entries);
+	static void _decode_chunk(const String &p_chunk, HashMap<String, Entry> &r_entries);
+	void _read_writer(uint64_t p_writer, PackedStringArray &r_changed_keys, PackedStringArray &r_removed_keys);
+	void _set_writer_entries(uint64_t p_writer, const HashMap<String, Entry> &p_entries, PackedStringArray &r_changed_keys, PackedStringArray &r_removed_keys);
+	void _resolve_key(const String &p_key, PackedStringArray &r_changed_keys, PackedStringArray &r_removed_keys);
+	void _write_local_entry(const String &p_key, const Entry &p_entry);
+	void _write_chunk(bool p_as_owner, const String &p_key, const String &p_value);
+	void _update_owner(PackedStringArray &r_changed_keys, PackedStringArray &r_removed_keys);
+	void _emit_changes(const PackedStringArray &p_changed_keys, const PackedStringArray &p_removed_keys);
+	void _queue_flush();
+	void _on_flush_frame();
+	void _on_lobby_data_changed(const PackedStringArray &p_changed_keys, const PackedStringArray &p_removed_keys);
+	void _on_lobby_data_updated();
+	void _on_member_data_updated(const Ref<HBSteamFriend> &p_member);
+	void _on_member_left(const Ref<HBSteamFriend> &p_member);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_value(const String &p_key, const String &p_value);
+	void erase_value(const String &p_key);
+	String get_value(const String &p_key, const String &p_default = "") const;
+	bool has_value(const String &p_key) const;
+	PackedStringArray get_keys() const;
+	Dictionary get_values() const;
+	uint64_t get_version(const String &p_key) const;
+	uint64_t get_writer(const String &p_key) const;
+	Dictionary get_version_vector(const String &p_key) const;
+	uint64_t get_clock() const;
+	void flush();
+	void refresh();
+
+	Ref<HBSteamLobby> get_lobby() const;
+	String get_prefix() const;
+
+	HBLobbyStateStore(const Ref<HBSteamLobby> &p_lobby, const String &p_prefix);
+};
+
+#endif // STEAM_LOBBY_STATE_STORE_H
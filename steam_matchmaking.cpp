@@ -30,12 +30,20 @@
 
 #include "steam_matchmaking.h"
 
+#include "core/os/os.h"
+
 #include "steam/steam_api_flat.h"
+#include "steam_lobby_state_store.h"
 #include "sw_error_macros.h"
 
+// Lobby data key the host's relay ping location is published under.
+static const char *PING_LOCATION_LOBBY_KEY = "ping_location";
+
 void HBSteamMatchmaking::_bind_methods() {
 	ClassDB::bind_method("create_lobby_list_query", &HBSteamMatchmaking::create_lobby_list_query);
 	ClassDB::bind_method("is_valid", &HBSteamMatchmaking::is_valid);
+	ClassDB::bind_method("clear_lobby_list_cache", &HBSteamMatchmaking::clear_lobby_list_cache);
+	ClassDB::bind_method("get_lobby_list_cache_stats", &HBSteamMatchmaking::get_lobby_list_cache_stats);
 }
 
 void HBSteamMatchmaking::init_interface() {
@@ -57,6 +65,90 @@ Ref<HBLobbyListQuery> HBSteamMatchmaking::create_lobby_list_query() {
 	return list_query;
 }
 
+void HBSteamMatchmaking::_on_lobby_list_cache_result(Ref<SteamworksCallbackData> p_callback_data, bool p_io_failure, const String &p_fingerprint) {
+	LobbyListCacheEntry *entry = lobby_list_cache.getptr(p_fingerprint);
+	if (!entry) {
+		// Cache was cleared while the request was in flight
+		return;
+	}
+	entry->in_flight_call = 0;
+	if (p_io_failure) {
+		return;
+	}
+
+	const LobbyMatchList_t *lobby_list_info = p_callback_data->get_data<LobbyMatchList_t>();
+	entry->lobby_ids.clear();
+	for (int i = 0; i < (int)lobby_list_info->m_nLobbiesMatching; i++) {
+		uint64_t lobby_id = SteamAPI_ISteamMatchmaking_GetLobbyByIndex(steam_matchmaking, i);
+		if (lobby_id == 0) {
+			continue;
+		}
+		entry->lobby_ids.push_back(lobby_id);
+	}
+	entry->received_usec = OS::get_singleton()->get_ticks_usec();
+	entry->has_result = true;
+
+	// Evict the oldest results once there are too many different queries around
+	while (lobby_list_cache.size() > MAX_LOBBY_LIST_CACHE_ENTRIES) {
+		String oldest_fingerprint;
+		uint64_t oldest_usec = UINT64_MAX;
+		for (const KeyValue<String, LobbyListCacheEntry> &kv : lobby_list_cache) {
+			if (kv.value.in_flight_call == 0 && kv.value.received_usec < oldest_usec) {
+				oldest_fingerprint = kv.key;
+				oldest_usec = kv.value.received_usec;
+			}
+		}
+		if (oldest_usec == UINT64_MAX) {
+			break;
+		}
+		lobby_list_cache.erase(oldest_fingerprint);
+	}
+}
+
+HBSteamMatchmaking::LobbyListCacheState HBSteamMatchmaking::get_cached_lobby_list(const String &p_fingerprint, float p_ttl, LocalVector<uint64_t> &r_lobby_ids) {
+	const LobbyListCacheEntry *entry = lobby_list_cache.getptr(p_fingerprint);
+	if (!entry || !entry->has_result) {
+		return LOBBY_LIST_CACHE_MISS;
+	}
+	r_lobby_ids = entry->lobby_ids;
+	uint64_t age_usec = OS::get_singleton()->get_ticks_usec() - entry->received_usec;
+	if (age_usec < (uint64_t)(p_ttl * 1000000.0f)) {
+		lobby_list_cache_hits++;
+		return LOBBY_LIST_CACHE_FRESH;
+	}
+	lobby_list_stale_hits++;
+	return LOBBY_LIST_CACHE_STALE;
+}
+
+uint64_t HBSteamMatchmaking::share_in_flight_lobby_list_request(const String &p_fingerprint) {
+	const LobbyListCacheEntry *entry = lobby_list_cache.getptr(p_fingerprint);
+	if (!entry || entry->in_flight_call == 0) {
+		return 0;
+	}
+	lobby_list_shared_requests++;
+	return entry->in_flight_call;
+}
+
+void HBSteamMatchmaking::track_lobby_list_request(const String &p_fingerprint, uint64_t p_api_call) {
+	lobby_list_cache[p_fingerprint].in_flight_call = p_api_call;
+	lobby_list_requests++;
+	Steamworks::get_singleton()->add_call_result_callback(p_api_call, callable_mp(this, &HBSteamMatchmaking::_on_lobby_list_cache_result).bind(p_fingerprint));
+}
+
+void HBSteamMatchmaking::clear_lobby_list_cache() {
+	lobby_list_cache.clear();
+}
+
+Dictionary HBSteamMatchmaking::get_lobby_list_cache_stats() const {
+	Dictionary stats;
+	stats["requests_sent"] = lobby_list_requests;
+	stats["requests_shared"] = lobby_list_shared_requests;
+	stats["cache_hits"] = lobby_list_cache_hits;
+	stats["stale_hits"] = lobby_list_stale_hits;
+	stats["cached_queries"] = lobby_list_cache.size();
+	return stats;
+}
+
 void HBSteamLobby::_join_lobby(uint64_t p_lobby_id) {
 	lobby_id = p_lobby_id;
 	SteamAPICall_t call = SteamAPI_ISteamMatchmaking_JoinLobby(Steamworks::get_singleton()->get_matchmaking()->get_interface(), p_lobby_id);
@@ -71,6 +163,8 @@ void HBSteamLobby::_create_lobby(SteamworksConstants::LobbyType p_lobby_type, in
 void HBSteamLobby::_on_lobby_entered(Ref<SteamworksCallbackData> p_callback_data) {
 	const LobbyEnter_t *lobby_enter = p_callback_data->get_data<LobbyEnter_t>();
 	if (lobby_enter->m_ulSteamIDLobby == lobby_id) {
+		joined = lobby_enter->m_EChatRoomEnterResponse == k_EChatRoomEnterResponseSuccess;
+		roster_cached = false;
 		emit_signal("lobby_entered", lobby_enter->m_EChatRoomEnterResponse);
 		Steamworks::get_singleton()->add_callback(LobbyChatMsg_t::k_iCallback, callable_mp(this, &HBSteamLobby::_on_lobby_chat_msg));
 	}
@@ -79,16 +173,51 @@ void HBSteamLobby::_on_lobby_entered(Ref<SteamworksCallbackData> p_callback_data
 void HBSteamLobby::_on_lobby_created(Ref<SteamworksCallbackData> p_callback_data, bool p_io_failure) {
 	const LobbyCreated_t *lobby_created = p_callback_data->get_data<LobbyCreated_t>();
 	lobby_id = lobby_created->m_ulSteamIDLobby;
+	if (lobby_created->m_eResult == k_EResultOK && !publish_ping_location()) {
+		// Relay access may not have measured anything yet, publish once it has.
+		Steamworks::get_singleton()->get_networking_utils()->init_relay_network_access();
+		if (!ping_location_pending) {
+			ping_location_pending = true;
+			Steamworks::get_singleton()->add_callback(SteamRelayNetworkStatus_t::k_iCallback, callable_mp(this, &HBSteamLobby::_on_relay_network_status));
+		}
+	}
 	emit_signal("lobby_created", (SWC::Result)lobby_created->m_eResult);
 }
 
+void HBSteamLobby::_on_relay_network_status(Ref<SteamworksCallbackData> p_callback_data) {
+	if (!ping_location_pending || lobby_id == 0) {
+		return;
+	}
+	const SteamRelayNetworkStatus_t *status = p_callback_data->get_data<SteamRelayNetworkStatus_t>();
+	if (status->m_eAvail != k_ESteamNetworkingAvailability_Current) {
+		return;
+	}
+	ping_location_pending = !publish_ping_location();
+}
+
+static bool is_valid_chat_frame(const uint8_t *p_data, int p_size) {
+	// At least one message, and the message sizes have to add up to the whole entry.
+	int offset = 1;
+	if (offset + HBSteamLobby::CHAT_FRAME_MESSAGE_HEADER_SIZE > p_size) {
+		return false;
+	}
+	while (offset < p_size) {
+		if (offset + HBSteamLobby::CHAT_FRAME_MESSAGE_HEADER_SIZE > p_size) {
+			return false;
+		}
+		offset += HBSteamLobby::CHAT_FRAME_MESSAGE_HEADER_SIZE + (p_data[offset] | (p_data[offset + 1] << 8));
+	}
+	return offset == p_size;
+}
+
 void HBSteamLobby::_on_lobby_chat_msg(Ref<SteamworksCallbackData> p_callback_data) {
 	const LobbyChatMsg_t *msg = p_callback_data->get_data<LobbyChatMsg_t>();
 	if (msg->m_ulSteamIDLobby != lobby_id) {
 		return;
 	}
-	Vector<uint8_t> msg_data;
-	msg_data.resize(4000);
+	if (chat_scratch_buffer.is_empty()) {
+		chat_scratch_buffer.resize(MAX_CHAT_ENTRY_SIZE);
+	}
 
 	uint64_t steam_id_user = msg->m_ulSteamIDUser;
 	// This is unused because we already have steam_id_user and because we don't deal with
@@ -97,10 +226,168 @@ void HBSteamLobby::_on_lobby_chat_msg(Ref<SteamworksCallbackData> p_callback_dat
 
 	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
 	EChatEntryType entry_type;
-	int bytes_received = SteamAPI_ISteamMatchmaking_GetLobbyChatEntry(mm, lobby_id, msg->m_iChatID, (CSteamID *)&_steam_id_ret, msg_data.ptrw(), msg_data.size(), &entry_type);
-	msg_data.resize(bytes_received);
+	int bytes_received = SteamAPI_ISteamMatchmaking_GetLobbyChatEntry(mm, lobby_id, msg->m_iChatID, (CSteamID *)&_steam_id_ret, chat_scratch_buffer.ptr(), chat_scratch_buffer.size(), &entry_type);
+	const uint8_t *data = chat_scratch_buffer.ptr();
+
+	// send_chat_binary frames anything starting with the marker, so entries that start with it are always frames.
+	if (entry_type != k_EChatEntryTypeChatMsg || bytes_received < 1 || data[0] != CHAT_FRAME_MARKER) {
+		_receive_chat_message(steam_id_user, (SWC::ChatEntryType)entry_type, data, bytes_received);
+		return;
+	}
+	ERR_FAIL_COND_MSG(!is_valid_chat_frame(data, bytes_received), vformat("Steamworks: Received a malformed framed chat entry from %d.", steam_id_user));
+	int offset = 1;
+	while (offset < bytes_received) {
+		int message_size = data[offset] | (data[offset + 1] << 8);
+		offset += CHAT_FRAME_MESSAGE_HEADER_SIZE;
+		_receive_chat_message(steam_id_user, (SWC::ChatEntryType)entry_type, data + offset, message_size);
+		offset += message_size;
+	}
+}
+
+void HBSteamLobby::_receive_chat_message(uint64_t p_sender, SWC::ChatEntryType p_entry_type, const uint8_t *p_data, int p_size) {
+	if (!batch_chat_messages) {
+		PackedByteArray message;
+		message.resize(p_size);
+		memcpy(message.ptrw(), p_data, p_size);
+		emit_signal("chat_message_received", HBSteamFriend::from_steam_id(p_sender), p_entry_type, message);
+		return;
+	}
+
+	if (chat_batch_offsets.is_empty()) {
+		chat_batch_offsets.push_back(0);
+	}
+	chat_batch_sender_ids.push_back(p_sender);
+	chat_batch_entry_types.push_back(p_entry_type);
+	int offset = chat_batch_data.size();
+	chat_batch_data.resize(offset + p_size);
+	memcpy(chat_batch_data.ptrw() + offset, p_data, p_size);
+	chat_batch_offsets.push_back(chat_batch_data.size());
+
+	if (!chat_batch_flush_queued) {
+		chat_batch_flush_queued = true;
+		Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamLobby::_on_chat_batch_frame));
+	}
+}
+
+void HBSteamLobby::_on_chat_batch_frame() {
+	chat_batch_flush_queued = false;
+	if (chat_batch_sender_ids.is_empty()) {
+		return;
+	}
+	// Hand the arrays over before emitting, so handlers can't see a batch being refilled.
+	PackedInt64Array sender_ids = chat_batch_sender_ids;
+	PackedInt32Array entry_types = chat_batch_entry_types;
+	PackedInt32Array offsets = chat_batch_offsets;
+	PackedByteArray data = chat_batch_data;
+	chat_batch_sender_ids = PackedInt64Array();
+	chat_batch_entry_types = PackedInt32Array();
+	chat_batch_offsets = PackedInt32Array();
+	chat_batch_data = PackedByteArray();
+	emit_signal("chat_messages_received", sender_ids, entry_types, offsets, data);
+}
+
+void HBSteamLobby::_on_chat_frame_flush() {
+	chat_frame_flush_queued = false;
+	flush_chat_messages();
+}
+
+void HBSteamLobby::_rebuild_roster() const {
+	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
+	int lobby_member_count = SteamAPI_ISteamMatchmaking_GetNumLobbyMembers(mm, lobby_id);
+
+	PackedInt64Array member_ids;
+	member_ids.resize(lobby_member_count);
+	int64_t *ids = member_ids.ptrw();
+	for (int i = 0; i < lobby_member_count; i++) {
+		ids[i] = SteamAPI_ISteamMatchmaking_GetLobbyMemberByIndex(mm, lobby_id, i);
+	}
+
+	// Lobbies we aren't in get rebuilt on every call, so only count actual changes.
+	bool changed = member_ids != roster_member_ids;
+	if (changed) {
+		roster_member_ids = member_ids;
+	}
+	if (tracked_member_data_keys.is_empty()) {
+		changed |= !roster_member_data.is_empty();
+		roster_member_data.clear();
+	} else {
+		for (int64_t member_id : member_ids) {
+			changed |= _refresh_member_data_snapshot(member_id);
+		}
+		if (roster_member_data.size() != (uint32_t)member_ids.size()) {
+			// Drop snapshots of members that left.
+			HashMap<uint64_t, Dictionary> member_data;
+			for (int64_t member_id : member_ids) {
+				member_data.insert(member_id, roster_member_data[member_id]);
+			}
+			roster_member_data = member_data;
+		}
+	}
+
+	// We only get told about membership changes for lobbies we are in, anything else has to
+	// be asked for again next time.
+	roster_cached = joined;
+	if (changed) {
+		roster_version++;
+	}
+}
+
+bool HBSteamLobby::_refresh_member_data_snapshot(uint64_t p_member) const {
+	if (tracked_member_data_keys.is_empty()) {
+		return false;
+	}
+	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
+	Dictionary snapshot;
+	for (const String &key : tracked_member_data_keys) {
+		const char *value = SteamAPI_ISteamMatchmaking_GetLobbyMemberData(mm, lobby_id, p_member, key.utf8().get_data());
+		if (value && value[0] != '\0') {
+			snapshot[key] = String::utf8(value);
+		}
+	}
+	Dictionary *old_snapshot = roster_member_data.getptr(p_member);
+	if (old_snapshot && *old_snapshot == snapshot) {
+		return false;
+	}
+	snapshot.make_read_only();
+	roster_member_data[p_member] = snapshot;
+	return true;
+}
 
-	emit_signal("chat_message_received", HBSteamFriend::from_steam_id(steam_id_user), entry_type, msg_data);
+void HBSteamLobby::_refresh_lobby_data(PackedStringArray *r_changed_keys, PackedStringArray *r_removed_keys) const {
+	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
+	int data_count = SteamAPI_ISteamMatchmaking_GetLobbyDataCount(mm, lobby_id);
+
+	char key_buffer[k_nMaxLobbyKeyLength];
+	char data_buffer[k_cubChatMetadataMax];
+
+	Dictionary new_lobby_data;
+	for (int i = 0; i < data_count; i++) {
+		bool success = SteamAPI_ISteamMatchmaking_GetLobbyDataByIndex(mm, lobby_id, i, key_buffer, sizeof(key_buffer), data_buffer, sizeof(data_buffer));
+		if (!success) {
+			continue;
+		}
+		String key = String::utf8(key_buffer);
+		String value = String::utf8(data_buffer);
+		if (r_changed_keys) {
+			const Variant *old_value = lobby_data.getptr(key);
+			if ((!old_value || *old_value != value) && !r_changed_keys->has(key)) {
+				r_changed_keys->push_back(key);
+			}
+		}
+		new_lobby_data[key] = value;
+	}
+
+	if (r_removed_keys) {
+		for (const KeyValue<Variant, Variant> &kv : lobby_data) {
+			if (!new_lobby_data.has(kv.key)) {
+				r_removed_keys->push_back(kv.key);
+			}
+		}
+	}
+
+	new_lobby_data.make_read_only();
+	lobby_data = new_lobby_data;
+	lobby_data_cached = true;
 }
 
 void HBSteamLobby::_on_lobby_data_updated(Ref<SteamworksCallbackData> p_callback_data) {
@@ -109,8 +396,20 @@ void HBSteamLobby::_on_lobby_data_updated(Ref<SteamworksCallbackData> p_callback
 		return;
 	}
 	if (update->m_ulSteamIDMember == lobby_id) {
+		if (update->m_bSuccess) {
+			PackedStringArray changed_keys = pending_changed_keys;
+			PackedStringArray removed_keys;
+			pending_changed_keys.clear();
+			_refresh_lobby_data(&changed_keys, &removed_keys);
+			if (!changed_keys.is_empty() || !removed_keys.is_empty()) {
+				emit_signal("lobby_data_changed", changed_keys, removed_keys);
+			}
+		}
 		emit_signal("lobby_data_updated");
 	} else {
+		if (roster_cached && roster_member_ids.has(update->m_ulSteamIDMember) && _refresh_member_data_snapshot(update->m_ulSteamIDMember)) {
+			roster_version++;
+		}
 		emit_signal("lobby_member_data_updated", HBSteamFriend::from_steam_id(update->m_ulSteamIDMember));
 	}
 }
@@ -123,6 +422,24 @@ void HBSteamLobby::_on_lobby_chat_updated(Ref<SteamworksCallbackData> p_callback
 	// I'm pretty sure kicking and banning doesn't actually work this way anymore
 	// so we don't have a explicit signal for that
 	int leave_mask = EChatMemberStateChange::k_EChatMemberStateChangeDisconnected | EChatMemberStateChange::k_EChatMemberStateChangeBanned | EChatMemberStateChange::k_EChatMemberStateChangeKicked | EChatMemberStateChange::k_EChatMemberStateChangeLeft;
+	// Update the roster before emitting anything so listeners already see the new member list
+	if (roster_cached) {
+		const int64_t changed_member = update->m_ulSteamIDUserChanged;
+		int member_idx = roster_member_ids.find(changed_member);
+		if (update->m_rgfChatMemberStateChange & leave_mask) {
+			if (member_idx != -1) {
+				roster_member_ids.remove_at(member_idx);
+				roster_member_data.erase(changed_member);
+				roster_version++;
+			}
+		} else if (update->m_rgfChatMemberStateChange & k_EChatMemberStateChangeEntered) {
+			if (member_idx == -1) {
+				roster_member_ids.push_back(changed_member);
+				_refresh_member_data_snapshot(changed_member);
+				roster_version++;
+			}
+		}
+	}
 	if (update->m_rgfChatMemberStateChange & leave_mask) {
 		emit_signal("member_left", HBSteamFriend::from_steam_id(update->m_ulSteamIDUserChanged));
 	} else if (update->m_rgfChatMemberStateChange & k_EChatMemberStateChangeEntered) {
@@ -140,31 +457,66 @@ void HBSteamLobby::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_member_data", "member", "key"), &HBSteamLobby::get_member_data);
 	ClassDB::bind_method(D_METHOD("get_members"), &HBSteamLobby::get_members);
 	ClassDB::bind_method(D_METHOD("get_members_count"), &HBSteamLobby::get_members_count);
+	ClassDB::bind_method(D_METHOD("get_member_ids"), &HBSteamLobby::get_member_ids);
+	ClassDB::bind_method(D_METHOD("get_roster_version"), &HBSteamLobby::get_roster_version);
+	ClassDB::bind_method(D_METHOD("get_member_data_snapshot", "member"), &HBSteamLobby::get_member_data_snapshot);
 	ClassDB::bind_method(D_METHOD("send_chat_string", "message"), &HBSteamLobby::send_chat_string);
 	ClassDB::bind_method(D_METHOD("send_chat_binary", "message"), &HBSteamLobby::send_chat_binary);
+	ClassDB::bind_method(D_METHOD("queue_chat_message", "message"), &HBSteamLobby::queue_chat_message);
+	ClassDB::bind_method(D_METHOD("flush_chat_messages"), &HBSteamLobby::flush_chat_messages);
+	ClassDB::bind_method(D_METHOD("has_queued_chat_messages"), &HBSteamLobby::has_queued_chat_messages);
 	ClassDB::bind_method(D_METHOD("set_member_data", "key", "data"), &HBSteamLobby::set_member_data);
+	ClassDB::bind_method(D_METHOD("create_state_store", "prefix"), &HBSteamLobby::create_state_store);
 	ClassDB::bind_method(D_METHOD("set_lobby_joinable", "joinable"), &HBSteamLobby::set_lobby_joinable);
 	ClassDB::bind_method(D_METHOD("leave_lobby"), &HBSteamLobby::leave_lobby);
 	ClassDB::bind_method(D_METHOD("get_lobby_id"), &HBSteamLobby::get_lobby_id);
 	ClassDB::bind_method(D_METHOD("is_owned_by_local_user"), &HBSteamLobby::is_owned_by_local_user);
 	ClassDB::bind_method(D_METHOD("get_all_lobby_data"), &HBSteamLobby::get_all_lobby_data);
+	ClassDB::bind_method(D_METHOD("publish_ping_location"), &HBSteamLobby::publish_ping_location);
+	ClassDB::bind_method(D_METHOD("get_ping_location"), &HBSteamLobby::get_ping_location);
 
 	ClassDB::bind_method(D_METHOD("get_max_members"), &HBSteamLobby::get_max_members);
 	ClassDB::bind_method(D_METHOD("set_max_members", "max_members"), &HBSteamLobby::set_max_members);
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_members"), "set_max_members", "get_max_members");
 
+	ClassDB::bind_method(D_METHOD("flush_writes"), &HBSteamLobby::flush_writes);
+	ClassDB::bind_method(D_METHOD("has_pending_writes"), &HBSteamLobby::has_pending_writes);
+	ClassDB::bind_method(D_METHOD("get_saved_write_count"), &HBSteamLobby::get_saved_write_count);
+	ClassDB::bind_method(D_METHOD("get_write_stats"), &HBSteamLobby::get_write_stats);
+
+	ClassDB::bind_method(D_METHOD("set_coalesce_writes", "coalesce_writes"), &HBSteamLobby::set_coalesce_writes);
+	ClassDB::bind_method(D_METHOD("get_coalesce_writes"), &HBSteamLobby::get_coalesce_writes);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "coalesce_writes"), "set_coalesce_writes", "get_coalesce_writes");
+
+	ClassDB::bind_method(D_METHOD("set_write_coalescing_window", "window"), &HBSteamLobby::set_write_coalescing_window);
+	ClassDB::bind_method(D_METHOD("get_write_coalescing_window"), &HBSteamLobby::get_write_coalescing_window);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "write_coalescing_window", PROPERTY_HINT_RANGE, "0,5,0.01,suffix:s"), "set_write_coalescing_window", "get_write_coalescing_window");
+
+	ClassDB::bind_method(D_METHOD("set_batch_chat_messages", "batch_chat_messages"), &HBSteamLobby::set_batch_chat_messages);
+	ClassDB::bind_method(D_METHOD("get_batch_chat_messages"), &HBSteamLobby::get_batch_chat_messages);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "batch_chat_messages"), "set_batch_chat_messages", "get_batch_chat_messages");
+
+	ClassDB::bind_method(D_METHOD("set_tracked_member_data_keys", "keys"), &HBSteamLobby::set_tracked_member_data_keys);
+	ClassDB::bind_method(D_METHOD("get_tracked_member_data_keys"), &HBSteamLobby::get_tracked_member_data_keys);
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_STRING_ARRAY, "tracked_member_data_keys"), "set_tracked_member_data_keys", "get_tracked_member_data_keys");
+
 	ClassDB::bind_static_method("HBSteamLobby", D_METHOD("create_lobby", "lobby_type", "max_members"), &HBSteamLobby::create_lobby);
 	ClassDB::bind_static_method("HBSteamLobby", D_METHOD("from_id", "lobby_id"), &HBSteamLobby::from_id);
 	ADD_SIGNAL(MethodInfo("lobby_entered", PropertyInfo(Variant::INT, "result")));
 	ADD_SIGNAL(MethodInfo("lobby_created", PropertyInfo(Variant::INT, "result")));
 	ADD_SIGNAL(MethodInfo("lobby_data_updated"));
+	ADD_SIGNAL(MethodInfo("lobby_data_changed", PropertyInfo(Variant::PACKED_STRING_ARRAY, "changed_keys"), PropertyInfo(Variant::PACKED_STRING_ARRAY, "removed_keys")));
 	ADD_SIGNAL(MethodInfo("lobby_member_data_updated", PropertyInfo(Variant::OBJECT, "member", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend")));
 	ADD_SIGNAL(MethodInfo("chat_message_received", PropertyInfo(Variant::OBJECT, "sender", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend"), PropertyInfo(Variant::INT, "type"), PropertyInfo(Variant::PACKED_BYTE_ARRAY, "data")));
+	ADD_SIGNAL(MethodInfo("chat_messages_received", PropertyInfo(Variant::PACKED_INT64_ARRAY, "sender_ids"), PropertyInfo(Variant::PACKED_INT32_ARRAY, "types"), PropertyInfo(Variant::PACKED_INT32_ARRAY, "offsets"), PropertyInfo(Variant::PACKED_BYTE_ARRAY, "data")));
 	ADD_SIGNAL(MethodInfo("lobby_chat_updated", PropertyInfo(Variant::OBJECT, "changed", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend"), PropertyInfo(Variant::OBJECT, "making_change", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend"), PropertyInfo(Variant::INT, "change")));
 	ADD_SIGNAL(MethodInfo("member_joined", PropertyInfo(Variant::OBJECT, "new_member", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend")));
 	ADD_SIGNAL(MethodInfo("member_left", PropertyInfo(Variant::OBJECT, "new_member", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend")));
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "owner", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend"), "", "get_owner");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "lobby_id"), "", "get_lobby_id");
+
+	BIND_CONSTANT(MAX_CHAT_ENTRY_SIZE);
+	BIND_CONSTANT(MAX_FRAMED_CHAT_MESSAGE_SIZE);
 }
 
 void HBSteamLobby::join_lobby() {
@@ -186,6 +538,8 @@ bool HBSteamLobby::set_lobby_owner(Ref<HBSteamFriend> p_new_owner) {
 }
 
 Ref<HBSteamLobby> HBSteamLobby::create_lobby(SteamworksConstants::LobbyType p_lobby_type, int p_max_members) {
+	// Start measuring our ping location now so it's hopefully ready to be published by the time the lobby exists.
+	Steamworks::get_singleton()->get_networking_utils()->init_relay_network_access();
 	Ref<HBSteamLobby> lobby;
 	lobby.instantiate();
 	lobby->_create_lobby(p_lobby_type, p_max_members);
@@ -200,11 +554,11 @@ Ref<HBSteamLobby> HBSteamLobby::from_id(uint64_t lobby_id) {
 }
 
 TypedArray<HBSteamFriend> HBSteamLobby::get_members() const {
-	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
-	int lobby_member_count = SteamAPI_ISteamMatchmaking_GetNumLobbyMembers(mm, lobby_id);
+	if (!roster_cached) {
+		_rebuild_roster();
+	}
 	TypedArray<HBSteamFriend> out;
-	for (int i = 0; i < lobby_member_count; i++) {
-		uint64_t user_steam_id = SteamAPI_ISteamMatchmaking_GetLobbyMemberByIndex(mm, lobby_id, i);
+	for (int64_t user_steam_id : roster_member_ids) {
 		Ref<HBSteamFriend> steam_friend = HBSteamFriend::from_steam_id(user_steam_id);
 		if (steam_friend.is_valid()) {
 			out.push_back(steam_friend);
@@ -214,52 +568,236 @@ TypedArray<HBSteamFriend> HBSteamLobby::get_members() const {
 }
 
 int HBSteamLobby::get_members_count() const {
-	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
-	return SteamAPI_ISteamMatchmaking_GetNumLobbyMembers(mm, lobby_id);
+	if (!roster_cached) {
+		ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
+		return SteamAPI_ISteamMatchmaking_GetNumLobbyMembers(mm, lobby_id);
+	}
+	return roster_member_ids.size();
 }
 
-bool HBSteamLobby::set_data(const String &p_key, const String &p_value) {
+PackedInt64Array HBSteamLobby::get_member_ids() const {
+	if (!roster_cached) {
+		_rebuild_roster();
+	}
+	return roster_member_ids;
+}
+
+uint64_t HBSteamLobby::get_roster_version() const {
+	if (!roster_cached) {
+		_rebuild_roster();
+	}
+	return roster_version;
+}
+
+void HBSteamLobby::set_tracked_member_data_keys(const PackedStringArray &p_keys) {
+	tracked_member_data_keys = p_keys;
+	roster_cached = false;
+}
+
+PackedStringArray HBSteamLobby::get_tracked_member_data_keys() const {
+	return tracked_member_data_keys;
+}
+
+Dictionary HBSteamLobby::get_member_data_snapshot(const Ref<HBSteamFriend> &p_member) const {
+	ERR_FAIL_COND_V_MSG(!p_member.is_valid(), Dictionary(), "Member was invalid");
+	if (!roster_cached) {
+		_rebuild_roster();
+	}
+	const Dictionary *snapshot = roster_member_data.getptr(p_member->get_steam_id());
+	return snapshot ? *snapshot : Dictionary();
+}
+
+bool HBSteamLobby::_write_lobby_data(const String &p_key, const String &p_value) {
+	writes_sent++;
 	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
-	return SteamAPI_ISteamMatchmaking_SetLobbyData(mm, lobby_id, p_key.utf8().get_data(), p_value.utf8().get_data());
+	bool success = SteamAPI_ISteamMatchmaking_SetLobbyData(mm, lobby_id, p_key.utf8().get_data(), p_value.utf8().get_data());
+	if (success) {
+		// Steam applies our own writes locally right away, so the next refresh won't see a difference.
+		if (!pending_changed_keys.has(p_key)) {
+			pending_changed_keys.push_back(p_key);
+		}
+		lobby_data_cached = false;
+	}
+	return success;
 }
 
-void HBSteamLobby::set_member_data(const String &p_key, const String &p_value) {
+void HBSteamLobby::_write_member_data(const String &p_key, const String &p_value) {
+	writes_sent++;
 	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
 	SteamAPI_ISteamMatchmaking_SetLobbyMemberData(mm, lobby_id, p_key.utf8().get_data(), p_value.utf8().get_data());
+	// Our own member data is applied locally right away
+	if (roster_cached && tracked_member_data_keys.has(p_key)) {
+		uint64_t local_user_id = Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id();
+		if (roster_member_ids.has(local_user_id) && _refresh_member_data_snapshot(local_user_id)) {
+			roster_version++;
+		}
+	}
 }
 
-Dictionary HBSteamLobby::get_all_lobby_data() const {
-	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
-	int data_count = SteamAPI_ISteamMatchmaking_GetLobbyDataCount(mm, lobby_id);
+void HBSteamLobby::_queue_write_flush() {
+	if (write_flush_queued) {
+		return;
+	}
+	write_flush_queued = true;
+	pending_writes_since_usec = OS::get_singleton()->get_ticks_usec();
+	Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamLobby::_on_write_flush_frame));
+}
+
+void HBSteamLobby::_on_write_flush_frame() {
+	write_flush_queued = false;
+	if (!has_pending_writes()) {
+		return;
+	}
+	uint64_t window_usec = write_coalescing_window * 1000000.0f;
+	if (OS::get_singleton()->get_ticks_usec() - pending_writes_since_usec < window_usec) {
+		// Keep collecting writes until the window is over
+		write_flush_queued = true;
+		Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamLobby::_on_write_flush_frame));
+		return;
+	}
+	flush_writes();
+}
 
-	Dictionary out;
+bool HBSteamLobby::set_data(const String &p_key, const String &p_value) {
+	if (!coalesce_writes) {
+		writes_requested++;
+		return _write_lobby_data(p_key, p_value);
+	}
+	ERR_FAIL_COND_V_MSG(lobby_id == 0, false, "Lobby ID is invalid");
+	writes_requested++;
+	String *pending_value = pending_lobby_data_writes.getptr(p_key);
+	if (pending_value) {
+		*pending_value = p_value;
+		writes_coalesced++;
+		return true;
+	}
+	if (get_data(p_key) == p_value) {
+		writes_skipped++;
+		return true;
+	}
+	pending_lobby_data_writes.insert(p_key, p_value);
+	_queue_write_flush();
+	return true;
+}
 
-	Vector<char> key_buffer;
-	key_buffer.resize(k_nMaxLobbyKeyLength);
-	Vector<char> data_buffer;
-	data_buffer.resize(k_cubChatMetadataMax);
+void HBSteamLobby::set_member_data(const String &p_key, const String &p_value) {
+	if (!coalesce_writes) {
+		writes_requested++;
+		_write_member_data(p_key, p_value);
+		return;
+	}
+	ERR_FAIL_COND_MSG(lobby_id == 0, "Lobby ID is invalid");
+	writes_requested++;
+	String *pending_value = pending_member_data_writes.getptr(p_key);
+	if (pending_value) {
+		*pending_value = p_value;
+		writes_coalesced++;
+		return;
+	}
+	if (get_member_data(Steamworks::get_singleton()->get_user()->get_local_user(), p_key) == p_value) {
+		writes_skipped++;
+		return;
+	}
+	pending_member_data_writes.insert(p_key, p_value);
+	_queue_write_flush();
+}
 
-	char *key_buffer_w = key_buffer.ptrw();
-	char *data_buffer_w = data_buffer.ptrw();
+void HBSteamLobby::flush_writes() {
+	if (!has_pending_writes()) {
+		return;
+	}
+	HashMap<String, String> lobby_data_writes;
+	HashMap<String, String> member_data_writes;
+	SWAP(lobby_data_writes, pending_lobby_data_writes);
+	SWAP(member_data_writes, pending_member_data_writes);
+	ERR_FAIL_COND_MSG(lobby_id == 0, "Lobby ID is invalid, dropping pending lobby data writes");
+
+	// A key might have been written back to its original value inside the window
+	Dictionary current_lobby_data = get_all_lobby_data();
+	for (const KeyValue<String, String> &kv : lobby_data_writes) {
+		if (current_lobby_data.get(kv.key, String()) == kv.value) {
+			writes_skipped++;
+			continue;
+		}
+		if (!_write_lobby_data(kv.key, kv.value)) {
+			ERR_PRINT(vformat("Failed to write lobby data key \"%s\"", kv.key));
+		}
+	}
 
-	for (int i = 0; i < data_count; i++) {
-		bool success = SteamAPI_ISteamMatchmaking_GetLobbyDataByIndex(mm, lobby_id, i, key_buffer_w, key_buffer.size(), data_buffer_w, data_buffer.size());
-		if (!success) {
+	Ref<HBSteamFriend> local_user = Steamworks::get_singleton()->get_user()->get_local_user();
+	for (const KeyValue<String, String> &kv : member_data_writes) {
+		if (get_member_data(local_user, kv.key) == kv.value) {
+			writes_skipped++;
 			continue;
 		}
-		String key = String::utf8(key_buffer_w);
-		String value = String::utf8(data_buffer_w);
-		out[key] = value;
+		_write_member_data(kv.key, kv.value);
 	}
-	return out;
+}
+
+bool HBSteamLobby::has_pending_writes() const {
+	return !pending_lobby_data_writes.is_empty() || !pending_member_data_writes.is_empty();
+}
+
+void HBSteamLobby::set_coalesce_writes(bool p_coalesce_writes) {
+	coalesce_writes = p_coalesce_writes;
+	if (!coalesce_writes) {
+		flush_writes();
+	}
+}
+
+bool HBSteamLobby::get_coalesce_writes() const {
+	return coalesce_writes;
+}
+
+void HBSteamLobby::set_write_coalescing_window(float p_window) {
+	write_coalescing_window = MAX(p_window, 0.0f);
+}
+
+float HBSteamLobby::get_write_coalescing_window() const {
+	return write_coalescing_window;
+}
+
+uint64_t HBSteamLobby::get_saved_write_count() const {
+	return writes_coalesced + writes_skipped;
+}
+
+Dictionary HBSteamLobby::get_write_stats() const {
+	Dictionary stats;
+	stats["writes_requested"] = writes_requested;
+	stats["writes_sent"] = writes_sent;
+	stats["writes_coalesced"] = writes_coalesced;
+	stats["writes_skipped"] = writes_skipped;
+	stats["writes_saved"] = get_saved_write_count();
+	stats["pending_writes"] = pending_lobby_data_writes.size() + pending_member_data_writes.size();
+	return stats;
+}
+
+Dictionary HBSteamLobby::get_all_lobby_data() const {
+	if (!lobby_data_cached) {
+		_refresh_lobby_data();
+	}
+	return lobby_data;
 }
 
 String HBSteamLobby::get_data(const String &p_key) const {
-	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
-	return String::utf8(SteamAPI_ISteamMatchmaking_GetLobbyData(mm, lobby_id, p_key.utf8().get_data()));
+	const String *pending_value = pending_lobby_data_writes.getptr(p_key);
+	if (pending_value) {
+		return *pending_value;
+	}
+	if (!lobby_data_cached) {
+		_refresh_lobby_data();
+	}
+	const Variant *value = lobby_data.getptr(p_key);
+	return value ? (String)*value : String();
 }
 
 String HBSteamLobby::get_member_data(const Ref<HBSteamFriend> &p_steam_user, const String &p_key) const {
+	if (!pending_member_data_writes.is_empty() && p_steam_user == Steamworks::get_singleton()->get_user()->get_local_user()) {
+		const String *pending_value = pending_member_data_writes.getptr(p_key);
+		if (pending_value) {
+			return *pending_value;
+		}
+	}
 	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
 	return String::utf8(SteamAPI_ISteamMatchmaking_GetLobbyMemberData(mm, lobby_id, p_steam_user->get_steam_id(), p_key.utf8().get_data()));
 }
@@ -275,13 +813,91 @@ void HBSteamLobby::set_max_members(int p_max_members) const {
 	ERR_FAIL_COND_MSG(!SteamAPI_ISteamMatchmaking_SetLobbyMemberLimit(mm, lobby_id, p_max_members), "Setting lobby member limit failed");
 }
 
+bool HBSteamLobby::publish_ping_location() {
+	ERR_FAIL_COND_V_MSG(lobby_id == 0, false, "Lobby ID is invalid");
+	String ping_location = Steamworks::get_singleton()->get_networking_utils()->get_local_ping_location();
+	if (ping_location.is_empty()) {
+		return false;
+	}
+	return set_data(PING_LOCATION_LOBBY_KEY, ping_location);
+}
+
+String HBSteamLobby::get_ping_location() const {
+	return get_data(PING_LOCATION_LOBBY_KEY);
+}
+
 bool HBSteamLobby::send_chat_string(const String &p_chat_string) {
 	return send_chat_binary(p_chat_string.to_utf8_buffer());
 }
 
 bool HBSteamLobby::send_chat_binary(const PackedByteArray &p_buffer) {
 	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
-	return SteamAPI_ISteamMatchmaking_SendLobbyChatMsg(mm, lobby_id, p_buffer.ptr(), p_buffer.size());
+	if (p_buffer.is_empty() || p_buffer[0] != CHAT_FRAME_MARKER) {
+		return SteamAPI_ISteamMatchmaking_SendLobbyChatMsg(mm, lobby_id, p_buffer.ptr(), p_buffer.size());
+	}
+	// Receivers treat anything starting with the marker as framed, so wrap it in a frame of its own.
+	ERR_FAIL_COND_V_MSG(p_buffer.size() > MAX_FRAMED_CHAT_MESSAGE_SIZE, false, vformat("Chat messages starting with byte 0x%X can't be bigger than %d bytes.", CHAT_FRAME_MARKER, MAX_FRAMED_CHAT_MESSAGE_SIZE));
+	LocalVector<uint8_t> frame;
+	frame.resize(1 + CHAT_FRAME_MESSAGE_HEADER_SIZE + p_buffer.size());
+	frame[0] = CHAT_FRAME_MARKER;
+	frame[1] = p_buffer.size() & 0xFF;
+	frame[2] = (p_buffer.size() >> 8) & 0xFF;
+	memcpy(frame.ptr() + 1 + CHAT_FRAME_MESSAGE_HEADER_SIZE, p_buffer.ptr(), p_buffer.size());
+	return SteamAPI_ISteamMatchmaking_SendLobbyChatMsg(mm, lobby_id, frame.ptr(), frame.size());
+}
+
+bool HBSteamLobby::queue_chat_message(const PackedByteArray &p_message) {
+	ERR_FAIL_COND_V_MSG(lobby_id == 0, false, "Lobby ID is invalid");
+	ERR_FAIL_COND_V_MSG(p_message.size() > MAX_FRAMED_CHAT_MESSAGE_SIZE, false, vformat("Framed chat messages can't be bigger than %d bytes.", MAX_FRAMED_CHAT_MESSAGE_SIZE));
+	if (outgoing_chat_frame.size() + CHAT_FRAME_MESSAGE_HEADER_SIZE + p_message.size() > MAX_CHAT_ENTRY_SIZE) {
+		flush_chat_messages();
+	}
+	if (outgoing_chat_frame.is_empty()) {
+		outgoing_chat_frame.push_back(CHAT_FRAME_MARKER);
+	}
+	uint32_t offset = outgoing_chat_frame.size();
+	outgoing_chat_frame.resize(offset + CHAT_FRAME_MESSAGE_HEADER_SIZE + p_message.size());
+	uint8_t *w = outgoing_chat_frame.ptr() + offset;
+	w[0] = p_message.size() & 0xFF;
+	w[1] = (p_message.size() >> 8) & 0xFF;
+	if (!p_message.is_empty()) {
+		memcpy(w + CHAT_FRAME_MESSAGE_HEADER_SIZE, p_message.ptr(), p_message.size());
+	}
+
+	if (!chat_frame_flush_queued) {
+		chat_frame_flush_queued = true;
+		Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamLobby::_on_chat_frame_flush));
+	}
+	return true;
+}
+
+bool HBSteamLobby::flush_chat_messages() {
+	if (outgoing_chat_frame.is_empty()) {
+		return true;
+	}
+	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
+	bool sent = SteamAPI_ISteamMatchmaking_SendLobbyChatMsg(mm, lobby_id, outgoing_chat_frame.ptr(), outgoing_chat_frame.size());
+	// Keeps its capacity for the next frame.
+	outgoing_chat_frame.clear();
+	return sent;
+}
+
+bool HBSteamLobby::has_queued_chat_messages() const {
+	return !outgoing_chat_frame.is_empty();
+}
+
+void HBSteamLobby::set_batch_chat_messages(bool p_batch_chat_messages) {
+	batch_chat_messages = p_batch_chat_messages;
+}
+
+bool HBSteamLobby::get_batch_chat_messages() const {
+	return batch_chat_messages;
+}
+
+Ref<HBLobbyStateStore> HBSteamLobby::create_state_store(const String &p_prefix) {
+	ERR_FAIL_COND_V_MSG(lobby_id == 0, Ref<HBLobbyStateStore>(), "Lobby ID is invalid");
+	ERR_FAIL_COND_V_MSG(p_prefix.is_empty() || p_prefix.contains(":"), Ref<HBLobbyStateStore>(), "State store prefixes must not be empty and can't contain \":\".");
+	return memnew(HBLobbyStateStore(this, p_prefix));
 }
 
 bool HBSteamLobby::set_lobby_joinable(bool p_joinable) {
@@ -299,9 +915,19 @@ uint64_t HBSteamLobby::get_lobby_id() const {
 }
 
 void HBSteamLobby::leave_lobby() {
+	flush_writes();
+	flush_chat_messages();
 	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
 	SteamAPI_ISteamMatchmaking_LeaveLobby(mm, lobby_id);
 	lobby_id = 0;
+	ping_location_pending = false;
+	lobby_data = Dictionary();
+	lobby_data_cached = false;
+	pending_changed_keys.clear();
+	joined = false;
+	roster_cached = false;
+	roster_member_ids.clear();
+	roster_member_data.clear();
 }
 
 HBSteamLobby::HBSteamLobby() {
@@ -311,6 +937,154 @@ HBSteamLobby::HBSteamLobby() {
 	Steamworks::get_singleton()->add_callback(LobbyChatUpdate_t::k_iCallback, callable_mp(this, &HBSteamLobby::_on_lobby_chat_updated));
 }
 
+HBSteamLobby::~HBSteamLobby() {
+	// Coalesced writes and batched chat would otherwise be lost with the last reference,
+	// unless Steam itself is already gone.
+	if (!has_pending_writes() && outgoing_chat_frame.is_empty()) {
+		return;
+	}
+	if (Steamworks::get_singleton() && Steamworks::get_singleton()->get_matchmaking().is_valid()) {
+		flush_writes();
+		flush_chat_messages();
+	}
+}
+
+void HBLobbyListSnapshot::_bind_methods() {
+	ClassDB::bind_method("get_lobby_count", &HBLobbyListSnapshot::get_lobby_count);
+	ClassDB::bind_method("get_lobby_ids", &HBLobbyListSnapshot::get_lobby_ids);
+	ClassDB::bind_method("get_member_counts", &HBLobbyListSnapshot::get_member_counts);
+	ClassDB::bind_method("get_member_limits", &HBLobbyListSnapshot::get_member_limits);
+	ClassDB::bind_method("get_estimated_pings", &HBLobbyListSnapshot::get_estimated_pings);
+	ClassDB::bind_method("get_keys", &HBLobbyListSnapshot::get_keys);
+	ClassDB::bind_method(D_METHOD("get_column", "key"), &HBLobbyListSnapshot::get_column);
+	ClassDB::bind_method(D_METHOD("get_value", "index", "key"), &HBLobbyListSnapshot::get_value);
+	ClassDB::bind_method(D_METHOD("get_lobby", "index"), &HBLobbyListSnapshot::get_lobby);
+	ClassDB::bind_method(D_METHOD("is_lobby_pending", "index"), &HBLobbyListSnapshot::is_lobby_pending);
+	ClassDB::bind_method("get_pending_lobby_count", &HBLobbyListSnapshot::get_pending_lobby_count);
+
+	ADD_SIGNAL(MethodInfo("lobby_updated", PropertyInfo(Variant::INT, "index")));
+}
+
+bool HBLobbyListSnapshot::_read_lobby(int p_index) {
+	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
+	uint64_t lobby_id = lobby_ids[p_index];
+	if (SteamAPI_ISteamMatchmaking_GetLobbyDataCount(mm, lobby_id) == 0) {
+		// Steam doesn't have this lobby's metadata (anymore)
+		return false;
+	}
+	member_counts.set(p_index, SteamAPI_ISteamMatchmaking_GetNumLobbyMembers(mm, lobby_id));
+	member_limits.set(p_index, SteamAPI_ISteamMatchmaking_GetLobbyMemberLimit(mm, lobby_id));
+	for (uint32_t i = 0; i < data_columns.size(); i++) {
+		data_columns[i].set(p_index, String::utf8(SteamAPI_ISteamMatchmaking_GetLobbyData(mm, lobby_id, keys[i].utf8().get_data())));
+	}
+	return true;
+}
+
+void HBLobbyListSnapshot::_on_lobby_data_updated(Ref<SteamworksCallbackData> p_callback_data) {
+	if (pending_lobby_count == 0) {
+		return;
+	}
+	const LobbyDataUpdate_t *update = p_callback_data->get_data<LobbyDataUpdate_t>();
+	if (update->m_ulSteamIDLobby != update->m_ulSteamIDMember) {
+		return;
+	}
+	const int *index = lobby_indices.getptr(update->m_ulSteamIDLobby);
+	if (!index || !lobby_pending[*index]) {
+		return;
+	}
+	// A failed update means the lobby is gone, leave its entry empty
+	if (update->m_bSuccess) {
+		_read_lobby(*index);
+	}
+	lobby_pending[*index] = false;
+	pending_lobby_count--;
+	emit_signal("lobby_updated", *index);
+}
+
+void HBLobbyListSnapshot::build(const LocalVector<uint64_t> &p_lobby_ids, const PackedStringArray &p_keys, const PackedInt32Array &p_estimated_pings) {
+	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
+	int lobby_count = p_lobby_ids.size();
+	keys = p_keys;
+	estimated_pings = p_estimated_pings;
+	lobby_ids.resize(lobby_count);
+	member_counts.resize(lobby_count);
+	member_limits.resize(lobby_count);
+	member_counts.fill(0);
+	member_limits.fill(0);
+	data_columns.resize(keys.size());
+	for (PackedStringArray &column : data_columns) {
+		column.resize(lobby_count);
+	}
+	lobby_pending.resize(lobby_count);
+	lobby_indices.clear();
+	pending_lobby_count = 0;
+
+	for (int i = 0; i < lobby_count; i++) {
+		lobby_ids.set(i, p_lobby_ids[i]);
+		lobby_indices.insert(p_lobby_ids[i], i);
+		lobby_pending[i] = !_read_lobby(i);
+		if (lobby_pending[i]) {
+			SteamAPI_ISteamMatchmaking_RequestLobbyData(mm, p_lobby_ids[i]);
+			pending_lobby_count++;
+		}
+	}
+
+	if (pending_lobby_count > 0) {
+		Steamworks::get_singleton()->add_callback(LobbyDataUpdate_t::k_iCallback, callable_mp(this, &HBLobbyListSnapshot::_on_lobby_data_updated));
+	}
+}
+
+int HBLobbyListSnapshot::get_lobby_count() const {
+	return lobby_ids.size();
+}
+
+PackedInt64Array HBLobbyListSnapshot::get_lobby_ids() const {
+	return lobby_ids;
+}
+
+PackedInt32Array HBLobbyListSnapshot::get_member_counts() const {
+	return member_counts;
+}
+
+PackedInt32Array HBLobbyListSnapshot::get_member_limits() const {
+	return member_limits;
+}
+
+PackedInt32Array HBLobbyListSnapshot::get_estimated_pings() const {
+	return estimated_pings;
+}
+
+PackedStringArray HBLobbyListSnapshot::get_keys() const {
+	return keys;
+}
+
+PackedStringArray HBLobbyListSnapshot::get_column(const String &p_key) const {
+	int key_idx = keys.find(p_key);
+	ERR_FAIL_COND_V_MSG(key_idx == -1, PackedStringArray(), vformat("Key \"%s\" wasn't prefetched.", p_key));
+	return data_columns[key_idx];
+}
+
+String HBLobbyListSnapshot::get_value(int p_index, const String &p_key) const {
+	ERR_FAIL_INDEX_V(p_index, lobby_ids.size(), String());
+	int key_idx = keys.find(p_key);
+	ERR_FAIL_COND_V_MSG(key_idx == -1, String(), vformat("Key \"%s\" wasn't prefetched.", p_key));
+	return data_columns[key_idx][p_index];
+}
+
+Ref<HBSteamLobby> HBLobbyListSnapshot::get_lobby(int p_index) const {
+	ERR_FAIL_INDEX_V(p_index, lobby_ids.size(), Ref<HBSteamLobby>());
+	return HBSteamLobby::from_id(lobby_ids[p_index]);
+}
+
+bool HBLobbyListSnapshot::is_lobby_pending(int p_index) const {
+	ERR_FAIL_INDEX_V(p_index, lobby_ids.size(), false);
+	return lobby_pending[p_index];
+}
+
+int HBLobbyListSnapshot::get_pending_lobby_count() const {
+	return pending_lobby_count;
+}
+
 void HBLobbyListQuery::_bind_methods() {
 	ClassDB::bind_method("filter_distance_close", &HBLobbyListQuery::filter_distance_close);
 	ClassDB::bind_method("filter_distance_far", &HBLobbyListQuery::filter_distance_far);
@@ -323,9 +1097,17 @@ void HBLobbyListQuery::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("with_not_equal", "key", "value"), &HBLobbyListQuery::with_not_equal);
 	ClassDB::bind_method(D_METHOD("with_slots_available", "min_slots"), &HBLobbyListQuery::with_slots_available);
 	ClassDB::bind_method(D_METHOD("with_max_results", "max_results"), &HBLobbyListQuery::with_slots_available);
+	ClassDB::bind_method("sort_by_estimated_ping", &HBLobbyListQuery::sort_by_estimated_ping);
+	ClassDB::bind_method(D_METHOD("with_cache_ttl", "ttl"), &HBLobbyListQuery::with_cache_ttl);
+	ClassDB::bind_method("with_stale_while_revalidate", &HBLobbyListQuery::with_stale_while_revalidate);
+	ClassDB::bind_method(D_METHOD("with_prefetched_keys", "keys"), &HBLobbyListQuery::with_prefetched_keys);
+	ClassDB::bind_method("get_snapshot", &HBLobbyListQuery::get_snapshot);
+	ClassDB::bind_method("get_fingerprint", &HBLobbyListQuery::get_fingerprint);
 	ClassDB::bind_method("request_lobby_list", &HBLobbyListQuery::request_lobby_list);
+	ClassDB::bind_method("get_estimated_pings", &HBLobbyListQuery::get_estimated_pings);
 
 	ADD_SIGNAL(MethodInfo("received_lobby_list", PropertyInfo(Variant::ARRAY, "lobbies", PROPERTY_HINT_ARRAY_TYPE, "HBSteamLobby")));
+	ADD_SIGNAL(MethodInfo("received_lobby_snapshot", PropertyInfo(Variant::OBJECT, "snapshot", PROPERTY_HINT_RESOURCE_TYPE, "HBLobbyListSnapshot")));
 }
 
 void HBLobbyListQuery::_add_numerical_filter(const String &p_key, int p_value, SWC::LobbyComparison p_comparison) {
@@ -343,16 +1125,131 @@ void HBLobbyListQuery::_add_numerical_filter(const String &p_key, int p_value, S
 void HBLobbyListQuery::_on_lobby_list_received(Ref<SteamworksCallbackData> p_callback_data, bool p_io_falure) {
 	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
 	const LobbyMatchList_t *lobby_list_info = p_callback_data->get_data<LobbyMatchList_t>();
-	TypedArray<HBSteamLobby> lobbies;
+	LocalVector<uint64_t> lobby_ids;
 	for (int i = 0; i < (int)lobby_list_info->m_nLobbiesMatching; i++) {
 		uint64_t lobby_id = SteamAPI_ISteamMatchmaking_GetLobbyByIndex(mm, i);
 		if (lobby_id == 0) {
 			continue;
 		}
-		lobbies.push_back(HBSteamLobby::from_id(lobby_id));
+		lobby_ids.push_back(lobby_id);
+	}
+	_process_lobby_list(lobby_ids);
+}
+
+void HBLobbyListQuery::_on_cached_lobby_list_ready() {
+	LocalVector<uint64_t> lobby_ids;
+	SWAP(lobby_ids, cached_lobby_ids);
+	_process_lobby_list(lobby_ids);
+}
+
+void HBLobbyListQuery::_process_lobby_list(const LocalVector<uint64_t> &p_lobby_ids) {
+	if (!sort_by_ping || p_lobby_ids.is_empty()) {
+		estimated_pings.clear();
+		_emit_lobby_list(p_lobby_ids);
+		return;
+	}
+
+	if (ping_batch_owner.is_valid()) {
+		// Only the newest list is worth sorting next, older queued ones are replaced.
+		queued_lobby_ids = p_lobby_ids;
+		has_queued_lobby_list = true;
+		return;
+	}
+
+	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
+
+	// Lobby data has to be read here, but parsing and estimating hundreds of
+	// locations is left to the worker threads.
+	ping_batch.networking_utils = Steamworks::get_singleton()->get_networking_utils().ptr();
+	ping_batch.lobby_ids = p_lobby_ids;
+	ping_batch.locations.resize(p_lobby_ids.size());
+	ping_batch.pings.resize(p_lobby_ids.size());
+	for (uint32_t i = 0; i < p_lobby_ids.size(); i++) {
+		ping_batch.locations[i] = String(SteamAPI_ISteamMatchmaking_GetLobbyData(mm, p_lobby_ids[i], PING_LOCATION_LOBBY_KEY)).utf8();
+	}
+	ping_batch_owner = Ref<HBLobbyListQuery>(this);
+	WorkerThreadPool::GroupID group_id = WorkerThreadPool::get_singleton()->add_template_group_task(this, &HBLobbyListQuery::_estimate_ping, &ping_batch, p_lobby_ids.size(), -1, false, "Estimate Steam lobby pings");
+	Steamworks::get_singleton()->add_worker_group_task_callback(group_id, callable_mp(this, &HBLobbyListQuery::_on_ping_estimation_completed));
+}
+
+void HBLobbyListQuery::_estimate_ping(uint32_t p_index, PingEstimationBatch *p_batch) {
+	SteamNetworkPingLocation_t location;
+	if (!p_batch->networking_utils->parse_ping_location(p_batch->locations[p_index], location)) {
+		p_batch->pings[p_index] = HBSteamNetworkingUtils::PING_UNKNOWN;
+		return;
+	}
+	int ping = SteamAPI_ISteamNetworkingUtils_EstimatePingTimeFromLocalHost(p_batch->networking_utils->get_interface(), location);
+	p_batch->pings[p_index] = ping < 0 ? HBSteamNetworkingUtils::PING_UNKNOWN : ping;
+}
+
+void HBLobbyListQuery::_on_ping_estimation_completed() {
+	struct LobbyPing {
+		uint64_t lobby_id;
+		int ping;
+		int index;
+		bool operator<(const LobbyPing &p_other) const {
+			// Lobbies without a known location go last, otherwise keep Steam's order for ties.
+			bool unknown = ping == HBSteamNetworkingUtils::PING_UNKNOWN;
+			bool other_unknown = p_other.ping == HBSteamNetworkingUtils::PING_UNKNOWN;
+			if (unknown != other_unknown) {
+				return other_unknown;
+			}
+			if (ping != p_other.ping) {
+				return ping < p_other.ping;
+			}
+			return index < p_other.index;
+		}
+	};
+
+	LocalVector<LobbyPing> sorted;
+	sorted.resize(ping_batch.lobby_ids.size());
+	for (uint32_t i = 0; i < sorted.size(); i++) {
+		sorted[i] = { ping_batch.lobby_ids[i], ping_batch.pings[i], (int)i };
+	}
+	sorted.sort();
+
+	LocalVector<uint64_t> lobby_ids;
+	lobby_ids.resize(sorted.size());
+	estimated_pings.resize(sorted.size());
+	int *estimated_pings_w = estimated_pings.ptrw();
+	for (uint32_t i = 0; i < sorted.size(); i++) {
+		lobby_ids[i] = sorted[i].lobby_id;
+		estimated_pings_w[i] = sorted[i].ping;
+	}
+
+	ping_batch.lobby_ids.clear();
+	ping_batch.locations.clear();
+	ping_batch.pings.clear();
+
+	// Might be the last reference to us, so only let go after emitting.
+	Ref<HBLobbyListQuery> self = ping_batch_owner;
+	ping_batch_owner.unref();
+	_emit_lobby_list(lobby_ids);
+
+	if (has_queued_lobby_list) {
+		LocalVector<uint64_t> queued;
+		SWAP(queued, queued_lobby_ids);
+		has_queued_lobby_list = false;
+		_process_lobby_list(queued);
+	}
+}
+
+void HBLobbyListQuery::_emit_lobby_list(const LocalVector<uint64_t> &p_lobby_ids) {
+	TypedArray<HBSteamLobby> lobbies;
+	lobbies.resize(p_lobby_ids.size());
+	for (uint32_t i = 0; i < p_lobby_ids.size(); i++) {
+		lobbies[i] = HBSteamLobby::from_id(p_lobby_ids[i]);
+	}
+
+	if (build_snapshot) {
+		snapshot.instantiate();
+		snapshot->build(p_lobby_ids, prefetched_keys, estimated_pings);
 	}
 
 	emit_signal("received_lobby_list", lobbies);
+	if (build_snapshot) {
+		emit_signal("received_lobby_snapshot", snapshot);
+	}
 }
 
 Ref<HBLobbyListQuery> HBLobbyListQuery::filter_distance_close() {
@@ -418,19 +1315,76 @@ Ref<HBLobbyListQuery> HBLobbyListQuery::with_slots_available(int p_min_slots) {
 	return this;
 }
 
-Ref<HBLobbyListQuery> HBLobbyListQuery::request_lobby_list() {
+Ref<HBLobbyListQuery> HBLobbyListQuery::sort_by_estimated_ping() {
+	sort_by_ping = true;
+	Steamworks::get_singleton()->get_networking_utils()->init_relay_network_access();
+	return this;
+}
+
+PackedInt32Array HBLobbyListQuery::get_estimated_pings() const {
+	return estimated_pings;
+}
+
+Ref<HBLobbyListQuery> HBLobbyListQuery::with_cache_ttl(float p_ttl) {
+	cache_ttl = MAX(p_ttl, 0.0f);
+	return this;
+}
+
+Ref<HBLobbyListQuery> HBLobbyListQuery::with_stale_while_revalidate() {
+	stale_while_revalidate = true;
+	return this;
+}
+
+Ref<HBLobbyListQuery> HBLobbyListQuery::with_prefetched_keys(const PackedStringArray &p_keys) {
+	for (const String &key : p_keys) {
+		ERR_FAIL_COND_V_MSG(key.is_empty(), this, "Prefetched key must not be empty");
+		ERR_FAIL_COND_V_MSG(key.length() > k_nMaxLobbyKeyLength, this, vformat("Prefetched key must not be longer than %d characters.", k_nMaxLobbyKeyLength));
+	}
+	prefetched_keys = p_keys;
+	build_snapshot = true;
+	return this;
+}
+
+Ref<HBLobbyListSnapshot> HBLobbyListQuery::get_snapshot() const {
+	return snapshot;
+}
+
+String HBLobbyListQuery::get_fingerprint() const {
+	// Keys and values are length-prefixed so they can't run into each other. The order numerical
+	// and string filters were added in doesn't change the results, but near value filters are
+	// applied by priority so their order is kept.
+	PackedStringArray unordered_parts;
+	for (const NumericalFilter &filter : numerical_filters) {
+		unordered_parts.push_back(vformat("n%d:%s%d,%d", filter.key.length(), filter.key, (int)filter.comparison, filter.value));
+	}
+	for (const KeyValue<String, String> &kv : string_filters) {
+		unordered_parts.push_back(vformat("s%d:%s%d:%s", kv.key.length(), kv.key, kv.value.length(), kv.value));
+	}
+	unordered_parts.sort();
+
+	String fingerprint = String(";").join(unordered_parts);
+	for (const KeyValue<String, Vector<int>> &kv : near_value_filters) {
+		for (int value : kv.value) {
+			fingerprint += vformat(";v%d:%s%d", kv.key.length(), kv.key, value);
+		}
+	}
+	fingerprint += vformat(";d%d;m%d;a%d", (int)distance_filter, max_results, slots_available);
+	return fingerprint;
+}
+
+void HBLobbyListQuery::_add_request_filters() const {
 	ISteamMatchmaking *mm = Steamworks::get_singleton()->get_matchmaking()->get_interface();
-	for (NumericalFilter &filter : numerical_filters) {
+	for (const NumericalFilter &filter : numerical_filters) {
 		SteamAPI_ISteamMatchmaking_AddRequestLobbyListNumericalFilter(mm, filter.key.utf8().get_data(), filter.value, (ELobbyComparison)filter.comparison);
 	}
 
-	for (KeyValue<String, Vector<int>> &kv : near_value_filters) {
+	for (const KeyValue<String, Vector<int>> &kv : near_value_filters) {
 		for (int value : kv.value) {
 			SteamAPI_ISteamMatchmaking_AddRequestLobbyListNearValueFilter(mm, kv.key.utf8().get_data(), value);
 		}
 	}
 
-	for (KeyValue<String, String> kv : string_filters) {
+	for (const KeyValue<String, String> &kv : string_filters) {
 		SteamAPI_ISteamMatchmaking_AddRequestLobbyListStringFilter(mm, kv.key.utf8().get_data(), kv.value.utf8().get_data(), (ELobbyComparison)SWC::LOBBY_COMPARISON_EQUAL);
 	}
 
@@ -442,8 +1396,32 @@ Ref<HBLobbyListQuery> HBLobbyListQuery::request_lobby_list() {
 	if (slots_available != -1) {
 		SteamAPI_ISteamMatchmaking_AddRequestLobbyListFilterSlotsAvailable(mm, slots_available);
 	}
+}
+
+Ref<HBLobbyListQuery> HBLobbyListQuery::request_lobby_list() {
+	Ref<HBSteamMatchmaking> matchmaking = Steamworks::get_singleton()->get_matchmaking();
+	String fingerprint = get_fingerprint();
+
+	if (cache_ttl > 0.0f) {
+		HBSteamMatchmaking::LobbyListCacheState cache_state = matchmaking->get_cached_lobby_list(fingerprint, cache_ttl, cached_lobby_ids);
+		if (cache_state == HBSteamMatchmaking::LOBBY_LIST_CACHE_FRESH || (cache_state == HBSteamMatchmaking::LOBBY_LIST_CACHE_STALE && stale_while_revalidate)) {
+			// Hand the cached list out on the next frame, callers usually connect after requesting.
+			Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBLobbyListQuery::_on_cached_lobby_list_ready));
+		} else {
+			cached_lobby_ids.clear();
+		}
+		if (cache_state == HBSteamMatchmaking::LOBBY_LIST_CACHE_FRESH) {
+			return this;
+		}
+	}
 
-	SteamAPICall_t api_call = SteamAPI_ISteamMatchmaking_RequestLobbyList(mm);
+	// Identical queries that are already waiting on Steam just get the same result
+	SteamAPICall_t api_call = matchmaking->share_in_flight_lobby_list_request(fingerprint);
+	if (api_call == k_uAPICallInvalid) {
+		_add_request_filters();
+		api_call = SteamAPI_ISteamMatchmaking_RequestLobbyList(matchmaking->get_interface());
+		matchmaking->track_lobby_list_request(fingerprint, api_call);
+	}
 	Steamworks::get_singleton()->add_call_result_callback(api_call, callable_mp(this, &HBLobbyListQuery::_on_lobby_list_received));
 	return this;
 }
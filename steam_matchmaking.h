@@ -32,21 +32,83 @@
 #define STEAM_MATCHMAKING_H
 
 #include "core/object/ref_counted.h"
+#include "core/object/worker_thread_pool.h"
+#include "core/templates/local_vector.h"
 #include "steam_friends.h"
 #include "steamworks_callback_data.h"
 #include "steamworks_constants.gen.h"
 
 class ISteamMatchmaking;
+class HBSteamNetworkingUtils;
+class HBLobbyStateStore;
 
 class HBSteamLobby : public RefCounted {
 	GDCLASS(HBSteamLobby, RefCounted);
 
 private:
 	uint64_t lobby_id;
+
+	// Lobby data as of the last LobbyDataUpdate_t, handed out read-only so reads don't
+	// have to go through Steam.
+	mutable Dictionary lobby_data;
+	mutable bool lobby_data_cached = false;
+	// Keys we changed ourselves, reported with the next lobby_data_changed.
+	PackedStringArray pending_changed_keys;
+
+	// Member roster of the lobby we are in, kept up to date from LobbyChatUpdate_t instead of
+	// being walked from Steam on every call. Bumping roster_version on every change lets callers
+	// skip work when nothing changed.
+	bool joined = false;
+	mutable PackedInt64Array roster_member_ids;
+	mutable bool roster_cached = false;
+	mutable uint64_t roster_version = 0;
+	PackedStringArray tracked_member_data_keys;
+	mutable HashMap<uint64_t, Dictionary> roster_member_data;
+
+	// Write-behind buffer for lobby and member data, collapses repeated writes to the same key
+	// so each key only causes one backend update and LobbyDataUpdate_t broadcast per flush.
+	bool coalesce_writes = false;
+	float write_coalescing_window = 0.0f;
+	HashMap<String, String> pending_lobby_data_writes;
+	HashMap<String, String> pending_member_data_writes;
+	uint64_t pending_writes_since_usec = 0;
+	bool write_flush_queued = false;
+	uint64_t writes_requested = 0;
+	uint64_t writes_sent = 0;
+	uint64_t writes_coalesced = 0;
+	uint64_t writes_skipped = 0;
+
+	// Chat entries are read into a buffer that is reused for every entry. With batching
+	// enabled they are handed out once per frame as packed arrays, instead of one signal
+	// with its own HBSteamFriend and PackedByteArray per entry.
+	LocalVector<uint8_t> chat_scratch_buffer;
+	bool batch_chat_messages = false;
+	bool chat_batch_flush_queued = false;
+	PackedInt64Array chat_batch_sender_ids;
+	PackedInt32Array chat_batch_entry_types;
+	PackedInt32Array chat_batch_offsets;
+	PackedByteArray chat_batch_data;
+	// Framed messages waiting to share a single chat entry.
+	LocalVector<uint8_t> outgoing_chat_frame;
+	bool chat_frame_flush_queued = false;
+	// Set while a lobby we created is waiting for relay access to measure our ping location.
+	bool ping_location_pending = false;
+
+	void _receive_chat_message(uint64_t p_sender, SWC::ChatEntryType p_entry_type, const uint8_t *p_data, int p_size);
+	void _on_chat_batch_frame();
+	void _on_chat_frame_flush();
+	bool _write_lobby_data(const String &p_key, const String &p_value);
+	void _write_member_data(const String &p_key, const String &p_value);
+	void _queue_write_flush();
+	void _on_write_flush_frame();
+	void _rebuild_roster() const;
+	bool _refresh_member_data_snapshot(uint64_t p_member) const;
+	void _refresh_lobby_data(PackedStringArray *r_changed_keys = nullptr, PackedStringArray *r_removed_keys = nullptr) const;
 	void _join_lobby(uint64_t p_lobby_id);
 	void _create_lobby(SteamworksConstants::LobbyType p_lobby_type, int p_max_members);
 	void _on_lobby_entered(Ref<SteamworksCallbackData> p_callback_data);
 	void _on_lobby_created(Ref<SteamworksCallbackData> p_callback_data, bool p_io_failure);
+	void _on_relay_network_status(Ref<SteamworksCallbackData> p_callback_data);
 	void _on_lobby_chat_msg(Ref<SteamworksCallbackData> p_callback_data);
 	void _on_lobby_data_updated(Ref<SteamworksCallbackData> p_callback_data);
 	void _on_lobby_chat_updated(Ref<SteamworksCallbackData> p_callback_data);
@@ -55,6 +117,14 @@ protected:
 	static void _bind_methods();
 
 public:
+	// Steam won't deliver chat entries bigger than this.
+	static const int MAX_CHAT_ENTRY_SIZE = 4096;
+	// Framed chat entries start with a byte that can't appear in UTF-8 text, followed by
+	// every message prefixed with its size as a little endian uint16.
+	static const uint8_t CHAT_FRAME_MARKER = 0xFF;
+	static const int CHAT_FRAME_MESSAGE_HEADER_SIZE = 2;
+	static const int MAX_FRAMED_CHAT_MESSAGE_SIZE = MAX_CHAT_ENTRY_SIZE - 1 - CHAT_FRAME_MESSAGE_HEADER_SIZE;
+
 	void join_lobby();
 	Ref<HBSteamFriend> get_owner() const;
 	bool set_lobby_owner(Ref<HBSteamFriend> p_new_owner);
@@ -62,6 +132,19 @@ public:
 	static Ref<HBSteamLobby> from_id(uint64_t lobby_id);
 	TypedArray<HBSteamFriend> get_members() const;
 	int get_members_count() const;
+	PackedInt64Array get_member_ids() const;
+	uint64_t get_roster_version() const;
+	void set_tracked_member_data_keys(const PackedStringArray &p_keys);
+	PackedStringArray get_tracked_member_data_keys() const;
+	Dictionary get_member_data_snapshot(const Ref<HBSteamFriend> &p_member) const;
+	void set_coalesce_writes(bool p_coalesce_writes);
+	bool get_coalesce_writes() const;
+	void set_write_coalescing_window(float p_window);
+	float get_write_coalescing_window() const;
+	void flush_writes();
+	bool has_pending_writes() const;
+	uint64_t get_saved_write_count() const;
+	Dictionary get_write_stats() const;
 	bool set_data(const String &p_key, const String &p_value);
 	void set_member_data(const String &p_key, const String &p_value);
 	Dictionary get_all_lobby_data() const;
@@ -69,14 +152,60 @@ public:
 	String get_member_data(const Ref<HBSteamFriend> &p_steam_user, const String &p_key) const;
 	int get_max_members() const;
 	void set_max_members(int p_max_members) const;
+	bool publish_ping_location();
+	String get_ping_location() const;
 	bool send_chat_string(const String &p_chat_string);
 	bool send_chat_binary(const PackedByteArray &p_buffer);
+	bool queue_chat_message(const PackedByteArray &p_message);
+	bool flush_chat_messages();
+	bool has_queued_chat_messages() const;
+	void set_batch_chat_messages(bool p_batch_chat_messages);
+	bool get_batch_chat_messages() const;
+	Ref<HBLobbyStateStore> create_state_store(const String &p_prefix);
 	bool set_lobby_joinable(bool p_joinable);
 	bool is_owned_by_local_user() const;
 	uint64_t get_lobby_id() const;
 	String get_lobby_name() const;
 	void leave_lobby();
 	HBSteamLobby();
+	~HBSteamLobby();
+};
+
+// Columnar copy of the data of a lobby list, read once when the list arrives so browsers
+// don't have to go through Steam for every lobby and key every frame.
+class HBLobbyListSnapshot : public RefCounted {
+	GDCLASS(HBLobbyListSnapshot, RefCounted);
+
+	PackedInt64Array lobby_ids;
+	PackedInt32Array member_counts;
+	PackedInt32Array member_limits;
+	PackedInt32Array estimated_pings;
+	PackedStringArray keys;
+	// One column per key, with a value for every lobby.
+	LocalVector<PackedStringArray> data_columns;
+	HashMap<uint64_t, int> lobby_indices;
+	LocalVector<bool> lobby_pending;
+	int pending_lobby_count = 0;
+
+	bool _read_lobby(int p_index);
+	void _on_lobby_data_updated(Ref<SteamworksCallbackData> p_callback_data);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void build(const LocalVector<uint64_t> &p_lobby_ids, const PackedStringArray &p_keys, const PackedInt32Array &p_estimated_pings);
+	int get_lobby_count() const;
+	PackedInt64Array get_lobby_ids() const;
+	PackedInt32Array get_member_counts() const;
+	PackedInt32Array get_member_limits() const;
+	PackedInt32Array get_estimated_pings() const;
+	PackedStringArray get_keys() const;
+	PackedStringArray get_column(const String &p_key) const;
+	String get_value(int p_index, const String &p_key) const;
+	Ref<HBSteamLobby> get_lobby(int p_index) const;
+	bool is_lobby_pending(int p_index) const;
+	int get_pending_lobby_count() const;
 };
 
 class HBLobbyListQuery : public RefCounted {
@@ -93,6 +222,28 @@ class HBLobbyListQuery : public RefCounted {
 	SWC::LobbyDistanceFilter distance_filter = SWC::LobbyDistanceFilter::LOBBY_DISTANCE_FILTER_DEFAULT;
 	int max_results = -1;
 	int slots_available = -1;
+	bool sort_by_ping = false;
+	float cache_ttl = 0.0f;
+	bool stale_while_revalidate = false;
+	bool build_snapshot = false;
+	PackedStringArray prefetched_keys;
+	Ref<HBLobbyListSnapshot> snapshot;
+	// Cached result waiting to be handed out on the next frame, so callers get a chance to connect first.
+	LocalVector<uint64_t> cached_lobby_ids;
+
+	struct PingEstimationBatch {
+		HBSteamNetworkingUtils *networking_utils = nullptr;
+		LocalVector<uint64_t> lobby_ids;
+		LocalVector<CharString> locations;
+		LocalVector<int> pings;
+	};
+	PingEstimationBatch ping_batch;
+	// Keeps the query alive while the ping estimation runs on the worker threads.
+	Ref<HBLobbyListQuery> ping_batch_owner;
+	PackedInt32Array estimated_pings;
+	// Newest list received while another one was being sorted, handled once that one is done.
+	LocalVector<uint64_t> queued_lobby_ids;
+	bool has_queued_lobby_list = false;
 
 protected:
 	static void _bind_methods();
@@ -100,6 +251,12 @@ protected:
 private:
 	void _add_numerical_filter(const String &p_key, int p_value, SWC::LobbyComparison p_comparison);
 	void _on_lobby_list_received(Ref<SteamworksCallbackData> p_callback_data, bool p_io_falure);
+	void _on_cached_lobby_list_ready();
+	void _process_lobby_list(const LocalVector<uint64_t> &p_lobby_ids);
+	void _add_request_filters() const;
+	void _estimate_ping(uint32_t p_index, PingEstimationBatch *p_batch);
+	void _on_ping_estimation_completed();
+	void _emit_lobby_list(const LocalVector<uint64_t> &p_lobby_ids);
 
 public:
 	Ref<HBLobbyListQuery> filter_distance_close();
@@ -113,13 +270,36 @@ public:
 	Ref<HBLobbyListQuery> with_max_results(int p_max_results);
 	Ref<HBLobbyListQuery> with_not_equal(const String &p_key, int p_value);
 	Ref<HBLobbyListQuery> with_slots_available(int p_min_slots);
+	Ref<HBLobbyListQuery> sort_by_estimated_ping();
+	Ref<HBLobbyListQuery> with_cache_ttl(float p_ttl);
+	Ref<HBLobbyListQuery> with_stale_while_revalidate();
+	Ref<HBLobbyListQuery> with_prefetched_keys(const PackedStringArray &p_keys);
+	String get_fingerprint() const;
 	Ref<HBLobbyListQuery> request_lobby_list();
+	PackedInt32Array get_estimated_pings() const;
+	Ref<HBLobbyListSnapshot> get_snapshot() const;
 };
 
 class HBSteamMatchmaking : public RefCounted {
 	GDCLASS(HBSteamMatchmaking, RefCounted);
 	ISteamMatchmaking *steam_matchmaking = nullptr;
 
+	// Lobby list results keyed by HBLobbyListQuery::get_fingerprint, also used to share a
+	// single RequestLobbyList call between identical queries that are in flight at the same time.
+	struct LobbyListCacheEntry {
+		LocalVector<uint64_t> lobby_ids;
+		uint64_t received_usec = 0;
+		bool has_result = false;
+		uint64_t in_flight_call = 0;
+	};
+	HashMap<String, LobbyListCacheEntry> lobby_list_cache;
+	uint64_t lobby_list_requests = 0;
+	uint64_t lobby_list_cache_hits = 0;
+	uint64_t lobby_list_stale_hits = 0;
+	uint64_t lobby_list_shared_requests = 0;
+
+	void _on_lobby_list_cache_result(Ref<SteamworksCallbackData> p_callback_data, bool p_io_failure, const String &p_fingerprint);
+
 protected:
 	static void _bind_methods();
 
@@ -128,6 +308,19 @@ public:
 	bool is_valid() const;
 	ISteamMatchmaking *get_interface() const;
 	Ref<HBLobbyListQuery> create_lobby_list_query();
+
+	static constexpr int MAX_LOBBY_LIST_CACHE_ENTRIES = 32;
+
+	enum LobbyListCacheState {
+		LOBBY_LIST_CACHE_MISS,
+		LOBBY_LIST_CACHE_FRESH,
+		LOBBY_LIST_CACHE_STALE,
+	};
+	LobbyListCacheState get_cached_lobby_list(const String &p_fingerprint, float p_ttl, LocalVector<uint64_t> &r_lobby_ids);
+	uint64_t share_in_flight_lobby_list_request(const String &p_fingerprint);
+	void track_lobby_list_request(const String &p_fingerprint, uint64_t p_api_call);
+	void clear_lobby_list_cache();
+	Dictionary get_lobby_list_cache_stats() const;
 };
 
 #endif // STEAM_MATCHMAKING_H
@@ -0,0 +1,649 @@
+/**************************************************************************/
+/*  steam_matchmaking_servers.cpp                                         */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_matchmaking_servers.h"
+
+#include "core/templates/sort_array.h"
+#include "steam/steam_api_flat.h"
+#include "steamworks.h"
+#include "sw_error_macros.h"
+
+// These are plain interfaces without data members or virtual destructors, so their layout is the
+// same across compilers, unlike the rest of the C++ API we avoid.
+struct HBSteamServerList::ListResponse : public ISteamMatchmakingServerListResponse {
+	HBSteamServerList *list = nullptr;
+
+	void ServerResponded(HServerListRequest p_request, int p_server) override {
+		list->_on_server_responded(p_request, p_server);
+	}
+	void ServerFailedToRespond(HServerListRequest p_request, int p_server) override {
+		list->_on_server_failed_to_respond(p_request, p_server);
+	}
+	void RefreshComplete(HServerListRequest p_request, EMatchMakingServerResponse p_response) override {
+		list->_on_refresh_complete(p_request, p_response);
+	}
+};
+
+struct HBSteamServerList::ServerQuery {
+	struct PingResponse : public ISteamMatchmakingPingResponse {
+		ServerQuery *query = nullptr;
+
+		void ServerResponded(gameserveritem_t &p_server) override {
+			query->ping = p_server.m_nPing;
+			query->list->_on_query_finished(query, true);
+		}
+		void ServerFailedToRespond() override {
+			query->list->_on_query_finished(query, false);
+		}
+	};
+
+	struct RulesResponse : public ISteamMatchmakingRulesResponse {
+		ServerQuery *query = nullptr;
+
+		void RulesResponded(const char *p_rule, const char *p_value) override {
+			query->rules[String::utf8(p_rule)] = String::utf8(p_value);
+		}
+		void RulesFailedToRespond() override {
+			query->list->_on_query_finished(query, false);
+		}
+		void RulesRefreshComplete() override {
+			query->list->_on_query_finished(query, true);
+		}
+	};
+
+	HBSteamServerList *list = nullptr;
+	int row = -1;
+	QueryType type = QUERY_PING;
+	HServerQuery handle = HSERVERQUERY_INVALID;
+	bool finished = false;
+	bool success = false;
+	int ping = 0;
+	Dictionary rules;
+	PingResponse ping_response;
+	RulesResponse rules_response;
+};
+
+void HBSteamServerList::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("refresh"), &HBSteamServerList::refresh);
+	ClassDB::bind_method(D_METHOD("cancel"), &HBSteamServerList::cancel);
+	ClassDB::bind_method(D_METHOD("is_refreshing"), &HBSteamServerList::is_refreshing);
+
+	ClassDB::bind_method(D_METHOD("get_row_count"), &HBSteamServerList::get_row_count);
+	ClassDB::bind_method(D_METHOD("get_failed_server_count"), &HBSteamServerList::get_failed_server_count);
+	ClassDB::bind_method(D_METHOD("get_names"), &HBSteamServerList::get_names);
+	ClassDB::bind_method(D_METHOD("get_maps"), &HBSteamServerList::get_maps);
+	ClassDB::bind_method(D_METHOD("get_game_descriptions"), &HBSteamServerList::get_game_descriptions);
+	ClassDB::bind_method(D_METHOD("get_tags"), &HBSteamServerList::get_tags);
+	ClassDB::bind_method(D_METHOD("get_addresses"), &HBSteamServerList::get_addresses);
+	ClassDB::bind_method(D_METHOD("get_steam_ids"), &HBSteamServerList::get_steam_ids);
+	ClassDB::bind_method(D_METHOD("get_pings"), &HBSteamServerList::get_pings);
+	ClassDB::bind_method(D_METHOD("get_player_counts"), &HBSteamServerList::get_player_counts);
+	ClassDB::bind_method(D_METHOD("get_max_player_counts"), &HBSteamServerList::get_max_player_counts);
+	ClassDB::bind_method(D_METHOD("get_bot_player_counts"), &HBSteamServerList::get_bot_player_counts);
+	ClassDB::bind_method(D_METHOD("get_server_versions"), &HBSteamServerList::get_server_versions);
+	ClassDB::bind_method(D_METHOD("get_password_protected"), &HBSteamServerList::get_password_protected);
+	ClassDB::bind_method(D_METHOD("get_vac_secured"), &HBSteamServerList::get_vac_secured);
+
+	ClassDB::bind_method(D_METHOD("get_sorted_rows", "column", "ascending", "rows"), &HBSteamServerList::get_sorted_rows, DEFVAL(true), DEFVAL(PackedInt32Array()));
+	ClassDB::bind_method(D_METHOD("filter_rows_by_range", "column", "min", "max", "rows"), &HBSteamServerList::filter_rows_by_range, DEFVAL(PackedInt32Array()));
+	ClassDB::bind_method(D_METHOD("filter_rows_by_text", "column", "text", "rows"), &HBSteamServerList::filter_rows_by_text, DEFVAL(PackedInt32Array()));
+
+	ClassDB::bind_method(D_METHOD("ping_server", "row"), &HBSteamServerList::ping_server);
+	ClassDB::bind_method(D_METHOD("request_server_rules", "row"), &HBSteamServerList::request_server_rules);
+	ClassDB::bind_method(D_METHOD("get_server_rules", "row"), &HBSteamServerList::get_server_rules);
+	ClassDB::bind_method(D_METHOD("get_in_flight_query_count"), &HBSteamServerList::get_in_flight_query_count);
+	ClassDB::bind_method(D_METHOD("get_queued_query_count"), &HBSteamServerList::get_queued_query_count);
+
+	ClassDB::bind_method(D_METHOD("set_max_in_flight_queries", "max_in_flight_queries"), &HBSteamServerList::set_max_in_flight_queries);
+	ClassDB::bind_method(D_METHOD("get_max_in_flight_queries"), &HBSteamServerList::get_max_in_flight_queries);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_in_flight_queries", PROPERTY_HINT_RANGE, "1,64,1"), "set_max_in_flight_queries", "get_max_in_flight_queries");
+
+	ADD_SIGNAL(MethodInfo("server_responded", PropertyInfo(Variant::PACKED_INT32_ARRAY, "rows")));
+	ADD_SIGNAL(MethodInfo("refresh_completed", PropertyInfo(Variant::INT, "response")));
+	ADD_SIGNAL(MethodInfo("server_pinged", PropertyInfo(Variant::INT, "row"), PropertyInfo(Variant::INT, "ping")));
+	ADD_SIGNAL(MethodInfo("server_rules_received", PropertyInfo(Variant::INT, "row"), PropertyInfo(Variant::DICTIONARY, "rules")));
+	ADD_SIGNAL(MethodInfo("server_query_failed", PropertyInfo(Variant::INT, "row")));
+
+	BIND_ENUM_CONSTANT(COLUMN_NAME);
+	BIND_ENUM_CONSTANT(COLUMN_MAP);
+	BIND_ENUM_CONSTANT(COLUMN_GAME_DESCRIPTION);
+	BIND_ENUM_CONSTANT(COLUMN_TAGS);
+	BIND_ENUM_CONSTANT(COLUMN_PING);
+	BIND_ENUM_CONSTANT(COLUMN_PLAYERS);
+	BIND_ENUM_CONSTANT(COLUMN_MAX_PLAYERS);
+	BIND_ENUM_CONSTANT(COLUMN_BOT_PLAYERS);
+	BIND_ENUM_CONSTANT(COLUMN_SERVER_VERSION);
+}
+
+void HBSteamServerList::_on_server_responded(void *p_request, int p_server) {
+	if (p_request != request_handle) {
+		return;
+	}
+	ISteamMatchmakingServers *mms = Steamworks::get_singleton()->get_matchmaking_servers()->get_interface();
+	const gameserveritem_t *server = SteamAPI_ISteamMatchmakingServers_GetServerDetails(mms, request_handle, p_server);
+	if (!server) {
+		return;
+	}
+
+	// Refreshing the list reports servers we already know about again
+	int row;
+	const int *existing_row = server_rows.getptr(p_server);
+	if (existing_row) {
+		row = *existing_row;
+	} else {
+		row = names.size();
+		server_rows.insert(p_server, row);
+		names.push_back(String());
+		maps.push_back(String());
+		game_descriptions.push_back(String());
+		tags.push_back(String());
+		addresses.push_back(String());
+		steam_ids.push_back(0);
+		pings.push_back(0);
+		players.push_back(0);
+		max_players.push_back(0);
+		bot_players.push_back(0);
+		server_versions.push_back(0);
+		password_protected.push_back(0);
+		vac_secured.push_back(0);
+		ips.push_back(0);
+		query_ports.push_back(0);
+	}
+
+	names.set(row, String::utf8(server->GetName()));
+	maps.set(row, String::utf8(server->m_szMap));
+	game_descriptions.set(row, String::utf8(server->m_szGameDescription));
+	tags.set(row, String::utf8(server->m_szGameTags));
+	addresses.set(row, server->m_NetAdr.GetConnectionAddressString());
+	steam_ids.set(row, server->m_steamID.ConvertToUint64());
+	pings.set(row, server->m_nPing);
+	players.set(row, server->m_nPlayers);
+	max_players.set(row, server->m_nMaxPlayers);
+	bot_players.set(row, server->m_nBotPlayers);
+	server_versions.set(row, server->m_nServerVersion);
+	password_protected.set(row, server->m_bPassword);
+	vac_secured.set(row, server->m_bSecure);
+	ips[row] = server->m_NetAdr.GetIP();
+	query_ports[row] = server->m_NetAdr.GetQueryPort();
+
+	responded_batch.push_back(row);
+	_queue_batch_flush();
+}
+
+void HBSteamServerList::_on_server_failed_to_respond(void *p_request, int p_server) {
+	if (p_request != request_handle) {
+		return;
+	}
+	failed_server_count++;
+}
+
+void HBSteamServerList::_on_refresh_complete(void *p_request, int p_response) {
+	if (p_request != request_handle) {
+		return;
+	}
+	refreshing = false;
+	refresh_response = p_response;
+	refresh_complete_pending = true;
+	_queue_batch_flush();
+}
+
+void HBSteamServerList::_on_query_finished(ServerQuery *p_query, bool p_success) {
+	if (p_query->finished) {
+		return;
+	}
+	p_query->finished = true;
+	p_query->success = p_success;
+	// Steam is done with the query, it doesn't need to be cancelled anymore
+	p_query->handle = HSERVERQUERY_INVALID;
+	in_flight_queries.erase(p_query);
+	finished_queries.push_back(p_query);
+	_queue_query_pump();
+}
+
+void HBSteamServerList::_queue_batch_flush() {
+	if (batch_flush_queued) {
+		return;
+	}
+	batch_flush_queued = true;
+	Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamServerList::_flush_responded_batch));
+}
+
+void HBSteamServerList::_flush_responded_batch() {
+	batch_flush_queued = false;
+	// Thousands of servers can answer within a few frames, hand them out once per frame
+	if (!responded_batch.is_empty()) {
+		PackedInt32Array rows = responded_batch;
+		responded_batch.clear();
+		emit_signal("server_responded", rows);
+	}
+	if (refresh_complete_pending) {
+		refresh_complete_pending = false;
+		emit_signal("refresh_completed", refresh_response);
+	}
+}
+
+void HBSteamServerList::_queue_query(int p_row, QueryType p_type) {
+	ERR_FAIL_INDEX(p_row, names.size());
+	QueuedQuery query;
+	query.row = p_row;
+	query.type = p_type;
+	queued_queries.push_back(query);
+	_queue_query_pump();
+}
+
+void HBSteamServerList::_queue_query_pump() {
+	if (query_pump_queued) {
+		return;
+	}
+	query_pump_queued = true;
+	Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamServerList::_pump_queries));
+}
+
+void HBSteamServerList::_pump_queries() {
+	query_pump_queued = false;
+	// Scripts might drop the last reference to us while handling the results.
+	Ref<HBSteamServerList> self = this;
+
+	// Results are handed out here instead of from Steam's callbacks so nothing gets freed
+	// while Steam is still calling into it.
+	LocalVector<ServerQuery *> finished;
+	SWAP(finished, finished_queries);
+	for (ServerQuery *query : finished) {
+		if (!query->success) {
+			emit_signal("server_query_failed", query->row);
+		} else if (query->type == QUERY_PING) {
+			pings.set(query->row, query->ping);
+			emit_signal("server_pinged", query->row, query->ping);
+		} else {
+			query->rules.make_read_only();
+			server_rules[query->row] = query->rules;
+			emit_signal("server_rules_received", query->row, query->rules);
+		}
+		memdelete(query);
+	}
+
+	ISteamMatchmakingServers *mms = Steamworks::get_singleton()->get_matchmaking_servers()->get_interface();
+	uint32_t started = 0;
+	while (started < queued_queries.size() && (int)in_flight_queries.size() < max_in_flight_queries) {
+		const QueuedQuery &queued = queued_queries[started++];
+		ServerQuery *query = memnew(ServerQuery);
+		query->list = this;
+		query->row = queued.row;
+		query->type = queued.type;
+		query->ping_response.query = query;
+		query->rules_response.query = query;
+		in_flight_queries.push_back(query);
+		if (queued.type == QUERY_PING) {
+			query->handle = SteamAPI_ISteamMatchmakingServers_PingServer(mms, ips[queued.row], query_ports[queued.row], &query->ping_response);
+		} else {
+			query->handle = SteamAPI_ISteamMatchmakingServers_ServerRules(mms, ips[queued.row], query_ports[queued.row], &query->rules_response);
+		}
+		if (query->handle == HSERVERQUERY_INVALID) {
+			_on_query_finished(query, false);
+		}
+	}
+	if (started > 0) {
+		LocalVector<QueuedQuery> remaining;
+		for (uint32_t i = started; i < queued_queries.size(); i++) {
+			remaining.push_back(queued_queries[i]);
+		}
+		queued_queries = remaining;
+	}
+}
+
+void HBSteamServerList::_cancel_queries() {
+	ISteamMatchmakingServers *mms = nullptr;
+	if (Steamworks::get_singleton() && Steamworks::get_singleton()->is_valid()) {
+		mms = Steamworks::get_singleton()->get_matchmaking_servers()->get_interface();
+	}
+	for (ServerQuery *query : in_flight_queries) {
+		if (mms && query->handle != HSERVERQUERY_INVALID) {
+			SteamAPI_ISteamMatchmakingServers_CancelServerQuery(mms, query->handle);
+		}
+		memdelete(query);
+	}
+	for (ServerQuery *query : finished_queries) {
+		memdelete(query);
+	}
+	in_flight_queries.clear();
+	finished_queries.clear();
+	queued_queries.clear();
+}
+
+void HBSteamServerList::_release_request() {
+	if (request_handle && Steamworks::get_singleton() && Steamworks::get_singleton()->is_valid()) {
+		// Also cancels the query if it's still running
+		SteamAPI_ISteamMatchmakingServers_ReleaseRequest(Steamworks::get_singleton()->get_matchmaking_servers()->get_interface(), request_handle);
+	}
+	request_handle = nullptr;
+	refreshing = false;
+	if (list_response) {
+		memdelete(list_response);
+		list_response = nullptr;
+	}
+}
+
+int HBSteamServerList::_get_int_value(ServerColumn p_column, int p_row) const {
+	switch (p_column) {
+		case COLUMN_PING:
+			return pings[p_row];
+		case COLUMN_PLAYERS:
+			return players[p_row];
+		case COLUMN_MAX_PLAYERS:
+			return max_players[p_row];
+		case COLUMN_BOT_PLAYERS:
+			return bot_players[p_row];
+		case COLUMN_SERVER_VERSION:
+			return server_versions[p_row];
+		default:
+			return 0;
+	}
+}
+
+const String &HBSteamServerList::_get_string_value(ServerColumn p_column, int p_row) const {
+	switch (p_column) {
+		case COLUMN_MAP:
+			return maps[p_row];
+		case COLUMN_GAME_DESCRIPTION:
+			return game_descriptions[p_row];
+		case COLUMN_TAGS:
+			return tags[p_row];
+		case COLUMN_NAME:
+		default:
+			return names[p_row];
+	}
+}
+
+bool HBSteamServerList::_is_string_column(ServerColumn p_column) const {
+	return p_column == COLUMN_NAME || p_column == COLUMN_MAP || p_column == COLUMN_GAME_DESCRIPTION || p_column == COLUMN_TAGS;
+}
+
+void HBSteamServerList::start_request(int p_list_type, const Dictionary &p_filters) {
+	ERR_FAIL_COND_MSG(request_handle != nullptr, "Server list was already requested.");
+	ISteamMatchmakingServers *mms = Steamworks::get_singleton()->get_matchmaking_servers()->get_interface();
+	AppId_t app_id = Steamworks::get_singleton()->get_app_id();
+
+	LocalVector<MatchMakingKeyValuePair_t> filters;
+	for (const KeyValue<Variant, Variant> &kv : p_filters) {
+		filters.push_back(MatchMakingKeyValuePair_t(String(kv.key).utf8().get_data(), String(kv.value).utf8().get_data()));
+	}
+	LocalVector<MatchMakingKeyValuePair_t *> filter_ptrs;
+	for (MatchMakingKeyValuePair_t &filter : filters) {
+		filter_ptrs.push_back(&filter);
+	}
+
+	list_response = memnew(ListResponse);
+	list_response->list = this;
+	refreshing = true;
+	switch (p_list_type) {
+		case HBSteamMatchmakingServers::SERVER_LIST_INTERNET: {
+			request_handle = SteamAPI_ISteamMatchmakingServers_RequestInternetServerList(mms, app_id, filter_ptrs.ptr(), filter_ptrs.size(), list_response);
+		} break;
+		case HBSteamMatchmakingServers::SERVER_LIST_LAN: {
+			request_handle = SteamAPI_ISteamMatchmakingServers_RequestLANServerList(mms, app_id, list_response);
+		} break;
+		case HBSteamMatchmakingServers::SERVER_LIST_FRIENDS: {
+			request_handle = SteamAPI_ISteamMatchmakingServers_RequestFriendsServerList(mms, app_id, filter_ptrs.ptr(), filter_ptrs.size(), list_response);
+		} break;
+		case HBSteamMatchmakingServers::SERVER_LIST_FAVORITES: {
+			request_handle = SteamAPI_ISteamMatchmakingServers_RequestFavoritesServerList(mms, app_id, filter_ptrs.ptr(), filter_ptrs.size(), list_response);
+		} break;
+	}
+}
+
+void HBSteamServerList::refresh() {
+	ERR_FAIL_COND_MSG(request_handle == nullptr, "Server list was never requested.");
+	ISteamMatchmakingServers *mms = Steamworks::get_singleton()->get_matchmaking_servers()->get_interface();
+	SteamAPI_ISteamMatchmakingServers_RefreshQuery(mms, request_handle);
+	refreshing = true;
+}
+
+void HBSteamServerList::cancel() {
+	ERR_FAIL_COND_MSG(request_handle == nullptr, "Server list was never requested.");
+	ISteamMatchmakingServers *mms = Steamworks::get_singleton()->get_matchmaking_servers()->get_interface();
+	SteamAPI_ISteamMatchmakingServers_CancelQuery(mms, request_handle);
+	refreshing = false;
+}
+
+bool HBSteamServerList::is_refreshing() const {
+	return refreshing;
+}
+
+int HBSteamServerList::get_row_count() const {
+	return names.size();
+}
+
+int HBSteamServerList::get_failed_server_count() const {
+	return failed_server_count;
+}
+
+PackedStringArray HBSteamServerList::get_names() const {
+	return names;
+}
+
+PackedStringArray HBSteamServerList::get_maps() const {
+	return maps;
+}
+
+PackedStringArray HBSteamServerList::get_game_descriptions() const {
+	return game_descriptions;
+}
+
+PackedStringArray HBSteamServerList::get_tags() const {
+	return tags;
+}
+
+PackedStringArray HBSteamServerList::get_addresses() const {
+	return addresses;
+}
+
+PackedInt64Array HBSteamServerList::get_steam_ids() const {
+	return steam_ids;
+}
+
+PackedInt32Array HBSteamServerList::get_pings() const {
+	return pings;
+}
+
+PackedInt32Array HBSteamServerList::get_player_counts() const {
+	return players;
+}
+
+PackedInt32Array HBSteamServerList::get_max_player_counts() const {
+	return max_players;
+}
+
+PackedInt32Array HBSteamServerList::get_bot_player_counts() const {
+	return bot_players;
+}
+
+PackedInt32Array HBSteamServerList::get_server_versions() const {
+	return server_versions;
+}
+
+PackedByteArray HBSteamServerList::get_password_protected() const {
+	return password_protected;
+}
+
+PackedByteArray HBSteamServerList::get_vac_secured() const {
+	return vac_secured;
+}
+
+PackedInt32Array HBSteamServerList::get_sorted_rows(ServerColumn p_column, bool p_ascending, const PackedInt32Array &p_rows) const {
+	struct RowComparator {
+		const HBSteamServerList *list = nullptr;
+		ServerColumn column = COLUMN_NAME;
+		bool string_column = false;
+		bool ascending = true;
+
+		bool operator()(int p_a, int p_b) const {
+			int result;
+			if (string_column) {
+				result = list->_get_string_value(column, p_a).naturalnocasecmp_to(list->_get_string_value(column, p_b));
+			} else {
+				int a = list->_get_int_value(column, p_a);
+				int b = list->_get_int_value(column, p_b);
+				result = a < b ? -1 : (a > b ? 1 : 0);
+			}
+			if (result == 0) {
+				// Keep the order servers responded in for ties
+				return p_a < p_b;
+			}
+			return ascending ? result < 0 : result > 0;
+		}
+	};
+
+	PackedInt32Array rows = p_rows;
+	if (rows.is_empty()) {
+		rows.resize(names.size());
+		int *rows_w = rows.ptrw();
+		for (int i = 0; i < names.size(); i++) {
+			rows_w[i] = i;
+		}
+	}
+	for (int row : rows) {
+		ERR_FAIL_INDEX_V(row, names.size(), PackedInt32Array());
+	}
+
+	SortArray<int, RowComparator> sorter;
+	sorter.compare.list = this;
+	sorter.compare.column = p_column;
+	sorter.compare.string_column = _is_string_column(p_column);
+	sorter.compare.ascending = p_ascending;
+	sorter.sort(rows.ptrw(), rows.size());
+	return rows;
+}
+
+PackedInt32Array HBSteamServerList::filter_rows_by_range(ServerColumn p_column, int p_min, int p_max, const PackedInt32Array &p_rows) const {
+	ERR_FAIL_COND_V_MSG(_is_string_column(p_column), PackedInt32Array(), "Column doesn't hold numbers, use filter_rows_by_text instead.");
+	PackedInt32Array out;
+	int row_count = p_rows.is_empty() ? names.size() : p_rows.size();
+	for (int i = 0; i < row_count; i++) {
+		int row = p_rows.is_empty() ? i : p_rows[i];
+		ERR_CONTINUE(row < 0 || row >= names.size());
+		int value = _get_int_value(p_column, row);
+		if (value >= p_min && value <= p_max) {
+			out.push_back(row);
+		}
+	}
+	return out;
+}
+
+PackedInt32Array HBSteamServerList::filter_rows_by_text(ServerColumn p_column, const String &p_text, const PackedInt32Array &p_rows) const {
+	ERR_FAIL_COND_V_MSG(!_is_string_column(p_column), PackedInt32Array(), "Column doesn't hold text, use filter_rows_by_range instead.");
+	PackedInt32Array out;
+	int row_count = p_rows.is_empty() ? names.size() : p_rows.size();
+	for (int i = 0; i < row_count; i++) {
+		int row = p_rows.is_empty() ? i : p_rows[i];
+		ERR_CONTINUE(row < 0 || row >= names.size());
+		if (_get_string_value(p_column, row).findn(p_text) != -1) {
+			out.push_back(row);
+		}
+	}
+	return out;
+}
+
+void HBSteamServerList::ping_server(int p_row) {
+	_queue_query(p_row, QUERY_PING);
+}
+
+void HBSteamServerList::request_server_rules(int p_row) {
+	_queue_query(p_row, QUERY_RULES);
+}
+
+Dictionary HBSteamServerList::get_server_rules(int p_row) const {
+	const Dictionary *rules = server_rules.getptr(p_row);
+	return rules ? *rules : Dictionary();
+}
+
+int HBSteamServerList::get_in_flight_query_count() const {
+	return in_flight_queries.size();
+}
+
+int HBSteamServerList::get_queued_query_count() const {
+	return queued_queries.size();
+}
+
+void HBSteamServerList::set_max_in_flight_queries(int p_max_in_flight_queries) {
+	max_in_flight_queries = MAX(p_max_in_flight_queries, 1);
+}
+
+int HBSteamServerList::get_max_in_flight_queries() const {
+	return max_in_flight_queries;
+}
+
+HBSteamServerList::~HBSteamServerList() {
+	_cancel_queries();
+	_release_request();
+}
+
+void HBSteamMatchmakingServers::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("is_valid"), &HBSteamMatchmakingServers::is_valid);
+	ClassDB::bind_method(D_METHOD("request_internet_server_list", "filters"), &HBSteamMatchmakingServers::request_internet_server_list, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("request_lan_server_list"), &HBSteamMatchmakingServers::request_lan_server_list);
+	ClassDB::bind_method(D_METHOD("request_friends_server_list", "filters"), &HBSteamMatchmakingServers::request_friends_server_list, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("request_favorites_server_list", "filters"), &HBSteamMatchmakingServers::request_favorites_server_list, DEFVAL(Dictionary()));
+}
+
+Ref<HBSteamServerList> HBSteamMatchmakingServers::_request_server_list(int p_list_type, const Dictionary &p_filters) {
+	Ref<HBSteamServerList> server_list;
+	server_list.instantiate();
+	server_list->start_request(p_list_type, p_filters);
+	return server_list;
+}
+
+void HBSteamMatchmakingServers::init_interface() {
+	steam_matchmaking_servers = SteamAPI_SteamMatchmakingServers();
+	SW_ERR_FAIL_COND_MSG(steam_matchmaking_servers == nullptr, "Steamworks: Failed to initialize Steam Matchmaking Servers, something catastrophic must have happened");
+}
+
+bool HBSteamMatchmakingServers::is_valid() const {
+	return steam_matchmaking_servers != nullptr;
+}
+
+ISteamMatchmakingServers *HBSteamMatchmakingServers::get_interface() const {
+	return steam_matchmaking_servers;
+}
+
+Ref<HBSteamServerList> HBSteamMatchmakingServers::request_internet_server_list(const Dictionary &p_filters) {
+	return _request_server_list(SERVER_LIST_INTERNET, p_filters);
+}
+
+Ref<HBSteamServerList> HBSteamMatchmakingServers::request_lan_server_list() {
+	return _request_server_list(SERVER_LIST_LAN, Dictionary());
+}
+
+Ref<HBSteamServerList> HBSteamMatchmakingServers::request_friends_server_list(const Dictionary &p_filters) {
+	return _request_server_list(SERVER_LIST_FRIENDS, p_filters);
+}
+
+Ref<HBSteamServerList> HBSteamMatchmakingServers::request_favorites_server_list(const Dictionary &p_filters) {
+	return _request_server_list(SERVER_LIST_FAVORITES, p_filters);
+}
@@ -0,0 +1,193 @@
+/**************************************************************************/
+/*  steam_matchmaking_servers.h                                           */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_MATCHMAKING_SERVERS_H
+#define STEAM_MATCHMAKING_SERVERS_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+#include "steamworks_constants.gen.h"
+
+class ISteamMatchmakingServers;
+
+// Results of a game server list request, stored column by column so the browser can sort and
+// filter thousands of servers without asking Steam again.
+class HBSteamServerList : public RefCounted {
+	GDCLASS(HBSteamServerList, RefCounted);
+
+public:
+	enum ServerColumn {
+		COLUMN_NAME,
+		COLUMN_MAP,
+		COLUMN_GAME_DESCRIPTION,
+		COLUMN_TAGS,
+		COLUMN_PING,
+		COLUMN_PLAYERS,
+		COLUMN_MAX_PLAYERS,
+		COLUMN_BOT_PLAYERS,
+		COLUMN_SERVER_VERSION,
+	};
+
+	static constexpr int DEFAULT_MAX_IN_FLIGHT_QUERIES = 8;
+
+private:
+	// Steam calls these back through its C++ interfaces, they only hold a pointer back to us.
+	struct ListResponse;
+	struct ServerQuery;
+	enum QueryType {
+		QUERY_PING,
+		QUERY_RULES,
+	};
+	struct QueuedQuery {
+		int row = -1;
+		QueryType type = QUERY_PING;
+	};
+
+	ListResponse *list_response = nullptr;
+	void *request_handle = nullptr;
+	bool refreshing = false;
+	bool refresh_complete_pending = false;
+	int refresh_response = 0;
+
+	PackedStringArray names;
+	PackedStringArray maps;
+	PackedStringArray game_descriptions;
+	PackedStringArray tags;
+	PackedStringArray addresses;
+	PackedInt64Array steam_ids;
+	PackedInt32Array pings;
+	PackedInt32Array players;
+	PackedInt32Array max_players;
+	PackedInt32Array bot_players;
+	PackedInt32Array server_versions;
+	PackedByteArray password_protected;
+	PackedByteArray vac_secured;
+	// Needed to query a single server
+	LocalVector<uint32_t> ips;
+	LocalVector<uint16_t> query_ports;
+
+	HashMap<int, int> server_rows;
+	HashMap<int, Dictionary> server_rules;
+	int failed_server_count = 0;
+
+	PackedInt32Array responded_batch;
+	bool batch_flush_queued = false;
+
+	int max_in_flight_queries = DEFAULT_MAX_IN_FLIGHT_QUERIES;
+	LocalVector<QueuedQuery> queued_queries;
+	LocalVector<ServerQuery *> in_flight_queries;
+	LocalVector<ServerQuery *> finished_queries;
+	bool query_pump_queued = false;
+
+	void _on_server_responded(void *p_request, int p_server);
+	void _on_server_failed_to_respond(void *p_request, int p_server);
+	void _on_refresh_complete(void *p_request, int p_response);
+	void _on_query_finished(ServerQuery *p_query, bool p_success);
+	void _queue_batch_flush();
+	void _flush_responded_batch();
+	void _queue_query(int p_row, QueryType p_type);
+	void _queue_query_pump();
+	void _pump_queries();
+	void _cancel_queries();
+	void _release_request();
+	int _get_int_value(ServerColumn p_column, int p_row) const;
+	const String &_get_string_value(ServerColumn p_column, int p_row) const;
+	bool _is_string_column(ServerColumn p_column) const;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void start_request(int p_list_type, const Dictionary &p_filters);
+	void refresh();
+	void cancel();
+	bool is_refreshing() const;
+
+	int get_row_count() const;
+	int get_failed_server_count() const;
+	PackedStringArray get_names() const;
+	PackedStringArray get_maps() const;
+	PackedStringArray get_game_descriptions() const;
+	PackedStringArray get_tags() const;
+	PackedStringArray get_addresses() const;
+	PackedInt64Array get_steam_ids() const;
+	PackedInt32Array get_pings() const;
+	PackedInt32Array get_player_counts() const;
+	PackedInt32Array get_max_player_counts() const;
+	PackedInt32Array get_bot_player_counts() const;
+	PackedInt32Array get_server_versions() const;
+	PackedByteArray get_password_protected() const;
+	PackedByteArray get_vac_secured() const;
+
+	PackedInt32Array get_sorted_rows(ServerColumn p_column, bool p_ascending = true, const PackedInt32Array &p_rows = PackedInt32Array()) const;
+	PackedInt32Array filter_rows_by_range(ServerColumn p_column, int p_min, int p_max, const PackedInt32Array &p_rows = PackedInt32Array()) const;
+	PackedInt32Array filter_rows_by_text(ServerColumn p_column, const String &p_text, const PackedInt32Array &p_rows = PackedInt32Array()) const;
+
+	void ping_server(int p_row);
+	void request_server_rules(int p_row);
+	Dictionary get_server_rules(int p_row) const;
+	int get_in_flight_query_count() const;
+	int get_queued_query_count() const;
+	void set_max_in_flight_queries(int p_max_in_flight_queries);
+	int get_max_in_flight_queries() const;
+
+	~HBSteamServerList();
+};
+
+VARIANT_ENUM_CAST(HBSteamServerList::ServerColumn);
+
+class HBSteamMatchmakingServers : public RefCounted {
+	GDCLASS(HBSteamMatchmakingServers, RefCounted);
+	ISteamMatchmakingServers *steam_matchmaking_servers = nullptr;
+
+	Ref<HBSteamServerList> _request_server_list(int p_list_type, const Dictionary &p_filters);
+
+protected:
+	static void _bind_methods();
+
+public:
+	enum ServerListType {
+		SERVER_LIST_INTERNET,
+		SERVER_LIST_LAN,
+		SERVER_LIST_FRIENDS,
+		SERVER_LIST_FAVORITES,
+	};
+
+	void init_interface();
+	bool is_valid() const;
+	ISteamMatchmakingServers *get_interface() const;
+	Ref<HBSteamServerList> request_internet_server_list(const Dictionary &p_filters = Dictionary());
+	Ref<HBSteamServerList> request_lan_server_list();
+	Ref<HBSteamServerList> request_friends_server_list(const Dictionary &p_filters = Dictionary());
+	Ref<HBSteamServerList> request_favorites_server_list(const Dictionary &p_filters = Dictionary());
+};
+
+#endif // STEAM_MATCHMAKING_SERVERS_H
@@ -0,0 +1,270 @@
+/**************************************************************************/
+/*  steam_message_schema.cpp                                              */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_message_schema.h"
+
+#include "core/math/math_funcs.h"
+#include "steam_networking_messages.h"
+
+HBSteamSchemaMessage::CreateFunc HBSteamSchemaMessage::message_create_funcs[HBSteamSchemaMessage::MAX_MESSAGE_ID + 1] = {};
+
+HBBitWriter::HBBitWriter(uint8_t *p_buffer, uint32_t p_size) {
+	buffer = p_buffer;
+	capacity_bits = p_size * 8;
+}
+
+void HBBitWriter::write_bits(uint64_t p_value, int p_bits) {
+	DEV_ASSERT(p_bits >= 0 && p_bits <= 64);
+	if (unlikely(bit_position + p_bits > capacity_bits)) {
+		overflowed = true;
+		return;
+	}
+	if (p_bits < 64) {
+		p_value &= (uint64_t(1) << p_bits) - 1;
+	}
+	while (p_bits > 0) {
+		const uint32_t bit_offset = bit_position & 7;
+		const int chunk = MIN(8 - (int)bit_offset, p_bits);
+		buffer[bit_position >> 3] |= uint8_t(p_value << bit_offset);
+		p_value >>= chunk;
+		p_bits -= chunk;
+		bit_position += chunk;
+	}
+}
+
+void HBBitWriter::write_int(int64_t p_value, int p_bits) {
+	// Zigzag encoding keeps small negative values small.
+	if (p_bits < 64) {
+		const int64_t max_value = (int64_t(1) << (p_bits - 1)) - 1;
+		p_value = CLAMP(p_value, -max_value - 1, max_value);
+	}
+	write_bits((uint64_t(p_value) << 1) ^ uint64_t(p_value >> 63), p_bits);
+}
+
+void HBBitWriter::write_uint(uint64_t p_value, int p_bits) {
+	if (p_bits < 64) {
+		p_value = MIN(p_value, (uint64_t(1) << p_bits) - 1);
+	}
+	write_bits(p_value, p_bits);
+}
+
+void HBBitWriter::write_float(float p_value) {
+	union {
+		float f;
+		uint32_t u;
+	} value;
+	value.f = p_value;
+	write_bits(value.u, 32);
+}
+
+void HBBitWriter::write_quantized_float(float p_value, float p_min, float p_max, int p_bits) {
+	const uint64_t steps = (uint64_t(1) << p_bits) - 1;
+	const float normalized = (CLAMP(p_value, p_min, p_max) - p_min) / (p_max - p_min);
+	write_bits((uint64_t)Math::round(normalized * steps), p_bits);
+}
+
+void HBBitWriter::write_bytes(const uint8_t *p_data, uint32_t p_size) {
+	if (unlikely(bit_position + p_size * 8 > capacity_bits)) {
+		overflowed = true;
+		return;
+	}
+	if ((bit_position & 7) == 0) {
+		memcpy(buffer + (bit_position >> 3), p_data, p_size);
+		bit_position += p_size * 8;
+		return;
+	}
+	for (uint32_t i = 0; i < p_size; i++) {
+		write_bits(p_data[i], 8);
+	}
+}
+
+HBBitReader::HBBitReader(const uint8_t *p_buffer, uint32_t p_size) {
+	buffer = p_buffer;
+	size_bits = p_size * 8;
+}
+
+uint64_t HBBitReader::read_bits(int p_bits) {
+	DEV_ASSERT(p_bits >= 0 && p_bits <= 64);
+	if (unlikely(bit_position + p_bits > size_bits)) {
+		overflowed = true;
+		bit_position = size_bits;
+		return 0;
+	}
+	uint64_t value = 0;
+	int shift = 0;
+	while (shift < p_bits) {
+		const uint32_t bit_offset = bit_position & 7;
+		const int chunk = MIN(8 - (int)bit_offset, p_bits - shift);
+		const uint64_t bits = (buffer[bit_position >> 3] >> bit_offset) & ((1u << chunk) - 1);
+		value |= bits << shift;
+		shift += chunk;
+		bit_position += chunk;
+	}
+	return value;
+}
+
+int64_t HBBitReader::read_int(int p_bits) {
+	const uint64_t value = read_bits(p_bits);
+	return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+float HBBitReader::read_float() {
+	union {
+		float f;
+		uint32_t u;
+	} value;
+	value.u = read_bits(32);
+	return value.f;
+}
+
+float HBBitReader::read_quantized_float(float p_min, float p_max, int p_bits) {
+	const uint64_t steps = (uint64_t(1) << p_bits) - 1;
+	return p_min + (read_bits(p_bits) / (float)steps) * (p_max - p_min);
+}
+
+uint32_t HBBitReader::read_length(uint32_t p_max_length) {
+	uint32_t length = read_bits(hb_bits_for_value(p_max_length));
+	if (unlikely(length > p_max_length)) {
+		overflowed = true;
+		return 0;
+	}
+	return length;
+}
+
+void HBBitReader::read_bytes(uint8_t *r_data, uint32_t p_size) {
+	if (unlikely(bit_position + p_size * 8 > size_bits)) {
+		overflowed = true;
+		bit_position = size_bits;
+		memset(r_data, 0, p_size);
+		return;
+	}
+	if ((bit_position & 7) == 0) {
+		memcpy(r_data, buffer + (bit_position >> 3), p_size);
+		bit_position += p_size * 8;
+		return;
+	}
+	for (uint32_t i = 0; i < p_size; i++) {
+		r_data[i] = read_bits(8);
+	}
+}
+
+void HBSteamSchemaMessage::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_message_id"), &HBSteamSchemaMessage::get_message_id);
+	ClassDB::bind_method(D_METHOD("encode"), &HBSteamSchemaMessage::encode);
+	ClassDB::bind_method(D_METHOD("send_to_peer", "networking_messages", "peer", "send_flags", "channel"), &HBSteamSchemaMessage::send_to_peer);
+	ClassDB::bind_method(D_METHOD("send_to_group", "peer_group", "send_flags", "channel", "exclude"), &HBSteamSchemaMessage::send_to_group, DEFVAL(HBSteamNetworkingMessages::INVALID_PEER));
+	ClassDB::bind_method(D_METHOD("get_sender_steam_id"), &HBSteamSchemaMessage::get_sender_steam_id);
+	ClassDB::bind_method(D_METHOD("get_sender_peer"), &HBSteamSchemaMessage::get_sender_peer);
+	ClassDB::bind_static_method("HBSteamSchemaMessage", D_METHOD("decode", "data"), &HBSteamSchemaMessage::decode);
+	ClassDB::bind_static_method("HBSteamSchemaMessage", D_METHOD("decode_network_message", "message"), &HBSteamSchemaMessage::decode_network_message);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "sender_steam_id"), "", "get_sender_steam_id");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "sender_peer"), "", "get_sender_peer");
+}
+
+uint32_t HBSteamSchemaMessage::encode_into(uint8_t *p_buffer, uint32_t p_size) const {
+	memset(p_buffer, 0, MIN(p_size, get_max_encoded_size()));
+	HBBitWriter writer(p_buffer, p_size);
+	writer.write_bits(get_message_id(), MESSAGE_ID_BITS);
+	encode_fields(writer);
+	ERR_FAIL_COND_V_MSG(writer.has_overflowed(), 0, vformat("Buffer too small to encode message %s.", get_class()));
+	return writer.get_byte_size();
+}
+
+PackedByteArray HBSteamSchemaMessage::encode() const {
+	PackedByteArray out;
+	out.resize(get_max_encoded_size());
+	uint32_t size = encode_into(out.ptrw(), out.size());
+	out.resize(size);
+	return out;
+}
+
+// Messages are encoded straight into this buffer before handing them to Steam, which copies them.
+static thread_local LocalVector<uint8_t> send_buffer;
+
+SWC::Result HBSteamSchemaMessage::send_to_peer(const Ref<HBSteamNetworkingMessages> &p_messages, int p_peer, int p_send_flags, int p_channel) const {
+	ERR_FAIL_COND_V(!p_messages.is_valid(), SWC::RESULT_FAIL);
+	if (send_buffer.size() < get_max_encoded_size()) {
+		send_buffer.resize(get_max_encoded_size());
+	}
+	uint32_t size = encode_into(send_buffer.ptr(), send_buffer.size());
+	ERR_FAIL_COND_V(size == 0, SWC::RESULT_FAIL);
+	return p_messages->send_raw_message_to_peer(send_buffer.ptr(), size, p_peer, p_send_flags, p_channel);
+}
+
+SWC::Result HBSteamSchemaMessage::send_to_group(const Ref<HBSteamPeerGroup> &p_group, int p_send_flags, int p_channel, int p_exclude) const {
+	ERR_FAIL_COND_V(!p_group.is_valid(), SWC::RESULT_FAIL);
+	if (send_buffer.size() < get_max_encoded_size()) {
+		send_buffer.resize(get_max_encoded_size());
+	}
+	uint32_t size = encode_into(send_buffer.ptr(), send_buffer.size());
+	ERR_FAIL_COND_V(size == 0, SWC::RESULT_FAIL);
+	return p_group->send_raw_to_group(send_buffer.ptr(), size, p_send_flags, p_channel, p_exclude);
+}
+
+void HBSteamSchemaMessage::register_message_type(int p_message_id, CreateFunc p_create_func) {
+	ERR_FAIL_INDEX(p_message_id, MAX_MESSAGE_ID + 1);
+	ERR_FAIL_COND_MSG(message_create_funcs[p_message_id] != nullptr && message_create_funcs[p_message_id] != p_create_func, vformat("Message ID %d is already in use by another message schema.", p_message_id));
+	message_create_funcs[p_message_id] = p_create_func;
+}
+
+int HBSteamSchemaMessage::peek_message_id(const uint8_t *p_data, uint32_t p_size) {
+	ERR_FAIL_COND_V(p_size == 0, -1);
+	return p_data[0];
+}
+
+Ref<HBSteamSchemaMessage> HBSteamSchemaMessage::decode_raw(const uint8_t *p_data, uint32_t p_size) {
+	int message_id = peek_message_id(p_data, p_size);
+	ERR_FAIL_COND_V(message_id == -1, Ref<HBSteamSchemaMessage>());
+	CreateFunc create_func = message_create_funcs[message_id];
+	ERR_FAIL_NULL_V_MSG(create_func, Ref<HBSteamSchemaMessage>(), vformat("Unknown message ID %d.", message_id));
+
+	Ref<HBSteamSchemaMessage> message = create_func();
+	HBBitReader reader(p_data, p_size);
+	reader.read_bits(MESSAGE_ID_BITS);
+	message->decode_fields(reader);
+	ERR_FAIL_COND_V_MSG(reader.has_overflowed(), Ref<HBSteamSchemaMessage>(), vformat("Truncated or malformed %s message.", message->get_class()));
+	return message;
+}
+
+Ref<HBSteamSchemaMessage> HBSteamSchemaMessage::decode(const PackedByteArray &p_data) {
+	return decode_raw(p_data.ptr(), p_data.size());
+}
+
+Ref<HBSteamSchemaMessage> HBSteamSchemaMessage::decode_network_message(const Ref<HBSteamNetworkingMessage> &p_message) {
+	ERR_FAIL_COND_V(!p_message.is_valid(), Ref<HBSteamSchemaMessage>());
+	const PackedByteArray data = p_message->get_data();
+	Ref<HBSteamSchemaMessage> message = decode_raw(data.ptr(), data.size());
+	if (message.is_valid()) {
+		message->sender_steam_id = p_message->get_sender_steam_id();
+		message->sender_peer = p_message->get_sender_peer();
+	}
+	return message;
+}
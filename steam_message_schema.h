@@ -0,0 +1,142 @@
+/**************************************************************************/
+/*  steam_message_schema.h                                                */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_MESSAGE_SCHEMA_H
+#define STEAM_MESSAGE_SCHEMA_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/local_vector.h"
+#include "steamworks_constants.gen.h"
+
+class HBSteamNetworkingMessage;
+class HBSteamNetworkingMessages;
+class HBSteamPeerGroup;
+
+// Returns the amount of bits needed to store values in the [0, p_max] range.
+constexpr int hb_bits_for_value(uint64_t p_max) {
+	int bits = 0;
+	while (p_max > 0) {
+		bits++;
+		p_max >>= 1;
+	}
+	return bits;
+}
+
+// Writes values LSB first into a caller owned buffer, the buffer must be zeroed
+// beforehand since bits are OR'd into place.
+class HBBitWriter {
+	uint8_t *buffer = nullptr;
+	uint32_t capacity_bits = 0;
+	uint32_t bit_position = 0;
+	bool overflowed = false;
+
+public:
+	void write_bits(uint64_t p_value, int p_bits);
+	void write_bool(bool p_value) { write_bits(p_value ? 1 : 0, 1); }
+	void write_int(int64_t p_value, int p_bits);
+	void write_uint(uint64_t p_value, int p_bits);
+	void write_float(float p_value);
+	void write_quantized_float(float p_value, float p_min, float p_max, int p_bits);
+	void write_length(uint32_t p_length, uint32_t p_max_length) { write_bits(p_length, hb_bits_for_value(p_max_length)); }
+	void write_bytes(const uint8_t *p_data, uint32_t p_size);
+
+	uint32_t get_bit_position() const { return bit_position; }
+	uint32_t get_byte_size() const { return (bit_position + 7) >> 3; }
+	bool has_overflowed() const { return overflowed; }
+
+	HBBitWriter(uint8_t *p_buffer, uint32_t p_size);
+};
+
+class HBBitReader {
+	const uint8_t *buffer = nullptr;
+	uint32_t size_bits = 0;
+	uint32_t bit_position = 0;
+	bool overflowed = false;
+
+public:
+	uint64_t read_bits(int p_bits);
+	bool read_bool() { return read_bits(1) != 0; }
+	int64_t read_int(int p_bits);
+	uint64_t read_uint(int p_bits) { return read_bits(p_bits); }
+	float read_float();
+	float read_quantized_float(float p_min, float p_max, int p_bits);
+	uint32_t read_length(uint32_t p_max_length);
+	void read_bytes(uint8_t *r_data, uint32_t p_size);
+
+	uint32_t get_bit_position() const { return bit_position; }
+	bool has_overflowed() const { return overflowed; }
+
+	HBBitReader(const uint8_t *p_buffer, uint32_t p_size);
+};
+
+// Base class for the message classes generated from the schemas in message_schemas/,
+// every encoded message starts with its 8 bit message ID.
+class HBSteamSchemaMessage : public RefCounted {
+	GDCLASS(HBSteamSchemaMessage, RefCounted);
+
+public:
+	typedef Ref<HBSteamSchemaMessage> (*CreateFunc)();
+	static const int MESSAGE_ID_BITS = 8;
+	static const int MAX_MESSAGE_ID = (1 << MESSAGE_ID_BITS) - 1;
+
+private:
+	static CreateFunc message_create_funcs[MAX_MESSAGE_ID + 1];
+
+	uint64_t sender_steam_id = 0;
+	int sender_peer = -1;
+
+protected:
+	static void _bind_methods();
+
+public:
+	virtual int get_message_id() const = 0;
+	// Upper bound of the encoded size in bytes, including the message ID.
+	virtual uint32_t get_max_encoded_size() const = 0;
+	virtual void encode_fields(HBBitWriter &p_writer) const = 0;
+	virtual void decode_fields(HBBitReader &p_reader) = 0;
+
+	// Returns the amount of bytes written, or 0 if the buffer was too small.
+	uint32_t encode_into(uint8_t *p_buffer, uint32_t p_size) const;
+	PackedByteArray encode() const;
+
+	SWC::Result send_to_peer(const Ref<HBSteamNetworkingMessages> &p_messages, int p_peer, int p_send_flags, int p_channel) const;
+	SWC::Result send_to_group(const Ref<HBSteamPeerGroup> &p_group, int p_send_flags, int p_channel, int p_exclude = -1) const;
+
+	uint64_t get_sender_steam_id() const { return sender_steam_id; }
+	int get_sender_peer() const { return sender_peer; }
+
+	static void register_message_type(int p_message_id, CreateFunc p_create_func);
+	static int peek_message_id(const uint8_t *p_data, uint32_t p_size);
+	static Ref<HBSteamSchemaMessage> decode_raw(const uint8_t *p_data, uint32_t p_size);
+	static Ref<HBSteamSchemaMessage> decode(const PackedByteArray &p_data);
+	static Ref<HBSteamSchemaMessage> decode_network_message(const Ref<HBSteamNetworkingMessage> &p_message);
+};
+
+#endif // STEAM_MESSAGE_SCHEMA_H
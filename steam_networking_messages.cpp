@@ -1,5 +1,9 @@
 #include "steam_networking_messages.h"
 #include "steam/steam_api_flat.h"
+#include "steam_clock_sync.h"
+#include "steam_host_migration.h"
+#include "steam_input_transport.h"
+#include "steam_snapshot_replicator.h"
 #include "sw_error_macros.h"
 
 void HBSteamNetworkingMessages::_on_session_requested(Ref<SteamworksCallbackData> p_callback_data) {
@@ -12,18 +16,95 @@ void HBSteamNetworkingMessages::_on_session_failed(Ref<SteamworksCallbackData> p
 	SteamNetworkingMessagesSessionFailed_t *request = (SteamNetworkingMessagesSessionFailed_t *)p_callback_data->get_data<SteamNetworkingMessagesSessionFailed_t>();
 	uint64_t steam_id = SteamAPI_SteamNetworkingIdentity_GetSteamID64(&request->m_info.m_identityRemote);
 	emit_signal("session_failed", request->m_info.m_eEndReason, HBSteamFriend::from_steam_id(steam_id));
+	if (const int *handle = peer_handles.getptr(steam_id)) {
+		_close_peer(*handle);
+	}
+}
+
+int HBSteamNetworkingMessages::_get_peer_slot(int p_peer) const {
+	if (p_peer < 0) {
+		return -1;
+	}
+	uint32_t slot = p_peer & (MAX_PEERS - 1);
+	if (slot >= peers.size() || peers[slot].identity == nullptr || peers[slot].generation != ((uint32_t)p_peer >> PEER_INDEX_BITS)) {
+		return -1;
+	}
+	return slot;
+}
+
+void HBSteamNetworkingMessages::_close_peer(int p_peer) {
+	PeerInfo &info = peers[_get_peer_slot(p_peer)];
+	info.session_closed = true;
+	if (info.group_refs == 0) {
+		_release_peer(p_peer);
+	}
+}
+
+void HBSteamNetworkingMessages::_release_peer(int p_peer) {
+	uint32_t slot = _get_peer_slot(p_peer);
+	PeerInfo &info = peers[slot];
+	peer_handles.erase(info.steam_id);
+	memdelete(info.identity);
+	uint32_t generation = (info.generation + 1) & PEER_GENERATION_MASK;
+	info = PeerInfo();
+	info.generation = generation;
+	free_slots.push_back(slot);
+	emit_signal("peer_released", p_peer);
+}
+
+void HBSteamNetworkingMessages::_release_idle_peers() {
+	// Every sender gets a handle, including ones we never talk back to, and Steam doesn't
+	// tell us when their sessions time out. Ask about them once the table fills up.
+	for (uint32_t i = 0; i < peers.size(); i++) {
+		const PeerInfo &info = peers[i];
+		if (info.identity == nullptr || info.group_refs > 0) {
+			continue;
+		}
+		ESteamNetworkingConnectionState state = SteamAPI_ISteamNetworkingMessages_GetSessionConnectionInfo(steam_networking_messages, *info.identity, nullptr, nullptr);
+		if (state == k_ESteamNetworkingConnectionState_None || state == k_ESteamNetworkingConnectionState_ClosedByPeer || state == k_ESteamNetworkingConnectionState_ProblemDetectedLocally) {
+			_release_peer(_make_peer_handle(i, info.generation));
+		}
+	}
+}
+
+void HBSteamNetworkingMessages::_receive_messages(int p_channel, void *p_userdata, MessageReceiver p_receiver) {
+	SteamNetworkingMessage_t *messages[MAX_MESSAGES_PER_POLL];
+	int message_count = 0;
+	do {
+		message_count = SteamAPI_ISteamNetworkingMessages_ReceiveMessagesOnChannel(steam_networking_messages, p_channel, messages, MAX_MESSAGES_PER_POLL);
+		for (int i = 0; i < message_count; i++) {
+			p_receiver(p_userdata, get_peer_handle_for_identity(messages[i]->m_identityPeer), (const uint8_t *)messages[i]->m_pData, messages[i]->m_cbSize);
+			SteamAPI_SteamNetworkingMessage_t_Release(messages[i]);
+		}
+	} while (message_count == MAX_MESSAGES_PER_POLL);
 }
 
 void HBSteamNetworkingMessages::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("poll_messages", "local_channel"), &HBSteamNetworkingMessages::poll_messages);
 	ClassDB::bind_method(D_METHOD("send_message_to_user", "data", "target_user", "send_flags", "channel"), &HBSteamNetworkingMessages::send_message_to_user);
 	ClassDB::bind_method(D_METHOD("accept_session_with_user", "user"), &HBSteamNetworkingMessages::accept_session_with_user);
+	ClassDB::bind_method(D_METHOD("get_peer_handle", "steam_id"), &HBSteamNetworkingMessages::get_peer_handle);
+	ClassDB::bind_method(D_METHOD("get_peer_handle_for_user", "user"), &HBSteamNetworkingMessages::get_peer_handle_for_user);
+	ClassDB::bind_method(D_METHOD("close_session_with_peer", "peer"), &HBSteamNetworkingMessages::close_session_with_peer);
+	ClassDB::bind_method(D_METHOD("is_peer_valid", "peer"), &HBSteamNetworkingMessages::is_peer_valid);
+	ClassDB::bind_method(D_METHOD("get_peer_count"), &HBSteamNetworkingMessages::get_peer_count);
+	ClassDB::bind_method(D_METHOD("get_peer_steam_id", "peer"), &HBSteamNetworkingMessages::get_peer_steam_id);
+	ClassDB::bind_method(D_METHOD("send_message_to_peer", "data", "peer", "send_flags", "channel"), &HBSteamNetworkingMessages::send_message_to_peer);
+	ClassDB::bind_method(D_METHOD("accept_session_with_peer", "peer"), &HBSteamNetworkingMessages::accept_session_with_peer);
+	ClassDB::bind_method(D_METHOD("create_peer_group"), &HBSteamNetworkingMessages::create_peer_group);
+	ClassDB::bind_method(D_METHOD("create_snapshot_replicator", "peer_group", "channel"), &HBSteamNetworkingMessages::create_snapshot_replicator);
+	ClassDB::bind_method(D_METHOD("create_input_transport", "peer_group", "channel", "redundancy"), &HBSteamNetworkingMessages::create_input_transport, DEFVAL(8));
+	ClassDB::bind_method(D_METHOD("create_clock_sync", "peer_group", "channel"), &HBSteamNetworkingMessages::create_clock_sync);
+	ClassDB::bind_method(D_METHOD("create_host_migration", "peer_group", "channel"), &HBSteamNetworkingMessages::create_host_migration);
 	ADD_SIGNAL(MethodInfo("session_requested", PropertyInfo(Variant::OBJECT, "sender", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend")));
 	ADD_SIGNAL(MethodInfo("session_failed", PropertyInfo(Variant::INT, "end_reason"), PropertyInfo(Variant::OBJECT, "user", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend")));
+	ADD_SIGNAL(MethodInfo("peer_released", PropertyInfo(Variant::INT, "peer")));
+	BIND_CONSTANT(INVALID_PEER);
 }
 
-void HBSteamNetworkingMessages::init_interface() {
-	steam_networking_messages = SteamAPI_SteamNetworkingMessages_SteamAPI();
+void HBSteamNetworkingMessages::init_interface(bool p_game_server) {
+	// Game servers have their own identity, so they get a separate messages interface.
+	steam_networking_messages = p_game_server ? SteamAPI_SteamGameServerNetworkingMessages_SteamAPI() : SteamAPI_SteamNetworkingMessages_SteamAPI();
 	SW_ERR_FAIL_COND_MSG(steam_networking_messages == nullptr, "Steamworks: Failed to initialize Steam networking messages, something catastrophic must have happened");
 	Steamworks::get_singleton()->add_callback(SteamNetworkingMessagesSessionRequest_t::k_iCallback, callable_mp(this, &HBSteamNetworkingMessages::_on_session_requested));
 	Steamworks::get_singleton()->add_callback(SteamNetworkingMessagesSessionFailed_t::k_iCallback, callable_mp(this, &HBSteamNetworkingMessages::_on_session_failed));
@@ -34,22 +115,13 @@ bool HBSteamNetworkingMessages::is_valid() const {
 }
 
 SWC::Result HBSteamNetworkingMessages::send_message_to_user(PackedByteArray p_data, Ref<HBSteamFriend> p_target_user, int p_send_flags, int p_channel) {
-	ISteamNetworkingMessages *nm = get_interface();
 	ERR_FAIL_COND_V(!p_target_user.is_valid(), SWC::RESULT_FAIL);
-	SteamNetworkingIdentity identity;
-	SteamAPI_SteamNetworkingIdentity_Clear(&identity);
-	SteamAPI_SteamNetworkingIdentity_SetSteamID64(&identity, p_target_user->get_steam_id());
-	return (SWC::Result)SteamAPI_ISteamNetworkingMessages_SendMessageToUser(nm, identity, p_data.ptr(), p_data.size(), p_send_flags, p_channel);
+	return send_raw_message_to_peer(p_data.ptr(), p_data.size(), get_peer_handle(p_target_user->get_steam_id()), p_send_flags, p_channel);
 }
 
 bool HBSteamNetworkingMessages::accept_session_with_user(Ref<HBSteamFriend> p_user) {
-	ISteamNetworkingMessages *nm = get_interface();
 	ERR_FAIL_COND_V(!p_user.is_valid(), false);
-	SteamNetworkingIdentity identity;
-	SteamAPI_SteamNetworkingIdentity_Clear(&identity);
-	SteamAPI_SteamNetworkingIdentity_SetSteamID64(&identity, p_user->get_steam_id());
-
-	return SteamAPI_ISteamNetworkingMessages_AcceptSessionWithUser(nm, identity);
+	return accept_session_with_peer(get_peer_handle(p_user->get_steam_id()));
 }
 
 TypedArray<HBSteamNetworkingMessage> HBSteamNetworkingMessages::poll_messages(int p_local_channel) {
@@ -64,7 +136,7 @@ TypedArray<HBSteamNetworkingMessage> HBSteamNetworkingMessages::poll_messages(in
 	TypedArray<HBSteamNetworkingMessage> out;
 	out.resize(message_count);
 	for (int i = 0; i < message_count; i++) {
-		Ref<HBSteamNetworkingMessage> message = HBSteamNetworkingMessage::create_from_message(messages[i]);
+		Ref<HBSteamNetworkingMessage> message = HBSteamNetworkingMessage::create_from_message(messages[i], get_peer_handle_for_identity(messages[i]->m_identityPeer));
 		SteamAPI_SteamNetworkingMessage_t_Release(messages[i]);
 		out[i] = message;
 	}
@@ -75,20 +147,311 @@ ISteamNetworkingMessages *HBSteamNetworkingMessages::get_interface() const {
 	return steam_networking_messages;
 }
 
+Ref<HBSteamPeerGroup> HBSteamNetworkingMessages::create_peer_group() {
+	Ref<HBSteamPeerGroup> peer_group;
+	peer_group.instantiate();
+	peer_group->set_networking_messages(this);
+	return peer_group;
+}
+
+Ref<HBSteamSnapshotReplicator> HBSteamNetworkingMessages::create_snapshot_replicator(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel) {
+	ERR_FAIL_COND_V_MSG(!p_peer_group.is_valid(), Ref<HBSteamSnapshotReplicator>(), "Snapshot replication needs a valid peer group to send snapshots to.");
+	return memnew(HBSteamSnapshotReplicator(p_peer_group, p_channel));
+}
+
+Ref<HBSteamInputTransport> HBSteamNetworkingMessages::create_input_transport(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel, int p_redundancy) {
+	ERR_FAIL_COND_V_MSG(!p_peer_group.is_valid(), Ref<HBSteamInputTransport>(), "Input transport needs a valid peer group to send input to.");
+	return memnew(HBSteamInputTransport(p_peer_group, p_channel, p_redundancy));
+}
+
+Ref<HBSteamClockSync> HBSteamNetworkingMessages::create_clock_sync(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel) {
+	ERR_FAIL_COND_V_MSG(!p_peer_group.is_valid(), Ref<HBSteamClockSync>(), "Clock sync needs a valid peer group to ping.");
+	return memnew(HBSteamClockSync(p_peer_group, p_channel));
+}
+
+Ref<HBSteamHostMigration> HBSteamNetworkingMessages::create_host_migration(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel) {
+	ERR_FAIL_COND_V_MSG(!p_peer_group.is_valid(), Ref<HBSteamHostMigration>(), "Host migration needs a valid peer group to announce hosts to.");
+	ERR_FAIL_COND_V_MSG(!p_peer_group->get_tracked_lobby().is_valid(), Ref<HBSteamHostMigration>(), "Host migration needs a peer group that tracks a lobby.");
+	return memnew(HBSteamHostMigration(p_peer_group, p_channel));
+}
+
+int HBSteamNetworkingMessages::get_peer_handle(uint64_t p_steam_id) {
+	ERR_FAIL_COND_V_MSG(p_steam_id == 0, INVALID_PEER, "An invalid steam user ID was given.");
+	if (const int *handle = peer_handles.getptr(p_steam_id)) {
+		// Talking to them again, keep the handle around.
+		peers[_get_peer_slot(*handle)].session_closed = false;
+		return *handle;
+	}
+
+	if (free_slots.is_empty() && peers.size() >= MAX_PEERS) {
+		_release_idle_peers();
+	}
+	ERR_FAIL_COND_V_MSG(free_slots.is_empty() && peers.size() >= MAX_PEERS, INVALID_PEER, vformat("Can't have more than %d peers with open sessions.", MAX_PEERS));
+
+	PeerInfo info;
+	info.steam_id = p_steam_id;
+	info.identity = memnew(SteamNetworkingIdentity);
+	SteamAPI_SteamNetworkingIdentity_Clear(info.identity);
+	SteamAPI_SteamNetworkingIdentity_SetSteamID64(info.identity, p_steam_id);
+
+	uint32_t slot;
+	if (!free_slots.is_empty()) {
+		slot = free_slots[free_slots.size() - 1];
+		free_slots.resize(free_slots.size() - 1);
+		info.generation = peers[slot].generation;
+		peers[slot] = info;
+	} else {
+		slot = peers.size();
+		peers.push_back(info);
+	}
+	int handle = _make_peer_handle(slot, info.generation);
+	peer_handles.insert(p_steam_id, handle);
+	return handle;
+}
+
+int HBSteamNetworkingMessages::get_peer_handle_for_identity(const SteamNetworkingIdentity &p_identity) {
+	// Identities that aren't Steam users (e.g. IP addresses) have no handle, that isn't an error.
+	uint64_t steam_id = SteamAPI_SteamNetworkingIdentity_GetSteamID64(const_cast<SteamNetworkingIdentity *>(&p_identity));
+	if (steam_id == 0) {
+		return INVALID_PEER;
+	}
+	return get_peer_handle(steam_id);
+}
+
+int HBSteamNetworkingMessages::get_peer_handle_for_user(const Ref<HBSteamFriend> &p_user) {
+	ERR_FAIL_COND_V(!p_user.is_valid(), INVALID_PEER);
+	return get_peer_handle(p_user->get_steam_id());
+}
+
+int HBSteamNetworkingMessages::find_peer_handle(uint64_t p_steam_id) const {
+	const int *handle = peer_handles.getptr(p_steam_id);
+	return handle ? *handle : INVALID_PEER;
+}
+
+bool HBSteamNetworkingMessages::is_peer_valid(int p_peer) const {
+	return _get_peer_slot(p_peer) != -1;
+}
+
+int HBSteamNetworkingMessages::get_peer_count() const {
+	return peer_handles.size();
+}
+
+void HBSteamNetworkingMessages::retain_peer(int p_peer) {
+	ERR_FAIL_COND_MSG(!is_peer_valid(p_peer), vformat("Invalid peer handle %d.", p_peer));
+	peers[_get_peer_slot(p_peer)].group_refs++;
+}
+
+void HBSteamNetworkingMessages::unretain_peer(int p_peer) {
+	ERR_FAIL_COND_MSG(!is_peer_valid(p_peer), vformat("Invalid peer handle %d.", p_peer));
+	PeerInfo &info = peers[_get_peer_slot(p_peer)];
+	ERR_FAIL_COND(info.group_refs == 0);
+	info.group_refs--;
+	if (info.group_refs == 0 && info.session_closed) {
+		_release_peer(p_peer);
+	}
+}
+
+uint64_t HBSteamNetworkingMessages::get_peer_steam_id(int p_peer) const {
+	ERR_FAIL_COND_V_MSG(!is_peer_valid(p_peer), 0, vformat("Invalid peer handle %d.", p_peer));
+	return peers[_get_peer_slot(p_peer)].steam_id;
+}
+
+const SteamNetworkingIdentity *HBSteamNetworkingMessages::get_peer_identity(int p_peer) const {
+	// Stale handles have no identity, callers decide whether that's an error.
+	int slot = _get_peer_slot(p_peer);
+	return slot == -1 ? nullptr : peers[slot].identity;
+}
+
+SWC::Result HBSteamNetworkingMessages::send_message_to_peer(const PackedByteArray &p_data, int p_peer, int p_send_flags, int p_channel) {
+	return send_raw_message_to_peer(p_data.ptr(), p_data.size(), p_peer, p_send_flags, p_channel);
+}
+
+SWC::Result HBSteamNetworkingMessages::send_raw_message_to_peer(const void *p_data, uint32_t p_size, int p_peer, int p_send_flags, int p_channel) {
+	ERR_FAIL_COND_V_MSG(!is_peer_valid(p_peer), SWC::RESULT_FAIL, vformat("Invalid peer handle %d.", p_peer));
+	return (SWC::Result)SteamAPI_ISteamNetworkingMessages_SendMessageToUser(steam_networking_messages, *peers[_get_peer_slot(p_peer)].identity, p_data, p_size, p_send_flags, p_channel);
+}
+
+bool HBSteamNetworkingMessages::accept_session_with_peer(int p_peer) {
+	ERR_FAIL_COND_V_MSG(!is_peer_valid(p_peer), false, vformat("Invalid peer handle %d.", p_peer));
+	return SteamAPI_ISteamNetworkingMessages_AcceptSessionWithUser(steam_networking_messages, *peers[_get_peer_slot(p_peer)].identity);
+}
+
+bool HBSteamNetworkingMessages::close_session_with_peer(int p_peer) {
+	ERR_FAIL_COND_V_MSG(!is_peer_valid(p_peer), false, vformat("Invalid peer handle %d.", p_peer));
+	bool closed = SteamAPI_ISteamNetworkingMessages_CloseSessionWithUser(steam_networking_messages, *peers[_get_peer_slot(p_peer)].identity);
+	_close_peer(p_peer);
+	return closed;
+}
+
+HBSteamNetworkingMessages::~HBSteamNetworkingMessages() {
+	for (PeerInfo &info : peers) {
+		if (info.identity) {
+			memdelete(info.identity);
+		}
+	}
+}
+
 void HBSteamNetworkingMessage::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_sender"), &HBSteamNetworkingMessage::get_sender);
+	ClassDB::bind_method(D_METHOD("get_sender_steam_id"), &HBSteamNetworkingMessage::get_sender_steam_id);
+	ClassDB::bind_method(D_METHOD("get_sender_peer"), &HBSteamNetworkingMessage::get_sender_peer);
 	ClassDB::bind_method(D_METHOD("get_data"), &HBSteamNetworkingMessage::get_data);
 
 	ADD_PROPERTY(PropertyInfo(Variant::PACKED_BYTE_ARRAY, "data"), "", "get_data");
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "sender", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriend"), "", "get_sender");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "sender_steam_id"), "", "get_sender_steam_id");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "sender_peer"), "", "get_sender_peer");
 }
 
-Ref<HBSteamNetworkingMessage> HBSteamNetworkingMessage::create_from_message(SteamNetworkingMessage_t *p_message) {
+Ref<HBSteamNetworkingMessage> HBSteamNetworkingMessage::create_from_message(SteamNetworkingMessage_t *p_message, int p_sender_peer) {
 	Ref<HBSteamNetworkingMessage> message;
 	message.instantiate();
 	message->data.resize(p_message->m_cbSize);
 	memcpy(message->data.ptrw(), p_message->m_pData, p_message->m_cbSize);
-	uint64_t steam_id = SteamAPI_SteamNetworkingIdentity_GetSteamID64(&p_message->m_identityPeer);
-	message->sender = HBSteamFriend::from_steam_id(steam_id);
+	message->sender_steam_id = SteamAPI_SteamNetworkingIdentity_GetSteamID64(&p_message->m_identityPeer);
+	message->sender_peer = p_sender_peer;
 	return message;
 }
+
+Ref<HBSteamFriend> HBSteamNetworkingMessage::get_sender() const {
+	// Built lazily, most receivers only care about the peer handle.
+	return HBSteamFriend::from_steam_id(sender_steam_id);
+}
+
+void HBSteamPeerGroup::_on_member_joined(Ref<HBSteamFriend> p_member) {
+	ERR_FAIL_COND(!p_member.is_valid());
+	if (p_member == Steamworks::get_singleton()->get_user()->get_local_user()) {
+		return;
+	}
+	add_peer(messages->get_peer_handle(p_member->get_steam_id()));
+}
+
+void HBSteamPeerGroup::_on_member_left(Ref<HBSteamFriend> p_member) {
+	ERR_FAIL_COND(!p_member.is_valid());
+	int peer = messages->find_peer_handle(p_member->get_steam_id());
+	if (peer != HBSteamNetworkingMessages::INVALID_PEER) {
+		remove_peer(peer);
+	}
+}
+
+void HBSteamPeerGroup::_untrack_lobby() {
+	if (!tracked_lobby.is_valid()) {
+		return;
+	}
+	tracked_lobby->disconnect("member_joined", callable_mp(this, &HBSteamPeerGroup::_on_member_joined));
+	tracked_lobby->disconnect("member_left", callable_mp(this, &HBSteamPeerGroup::_on_member_left));
+	tracked_lobby.unref();
+}
+
+void HBSteamPeerGroup::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("add_peer", "peer"), &HBSteamPeerGroup::add_peer);
+	ClassDB::bind_method(D_METHOD("remove_peer", "peer"), &HBSteamPeerGroup::remove_peer);
+	ClassDB::bind_method(D_METHOD("has_peer", "peer"), &HBSteamPeerGroup::has_peer);
+	ClassDB::bind_method(D_METHOD("clear"), &HBSteamPeerGroup::clear);
+	ClassDB::bind_method(D_METHOD("get_peers"), &HBSteamPeerGroup::get_peers);
+	ClassDB::bind_method(D_METHOD("get_peer_count"), &HBSteamPeerGroup::get_peer_count);
+	ClassDB::bind_method(D_METHOD("track_lobby", "lobby"), &HBSteamPeerGroup::track_lobby);
+	ClassDB::bind_method(D_METHOD("get_tracked_lobby"), &HBSteamPeerGroup::get_tracked_lobby);
+	ClassDB::bind_method(D_METHOD("send_to_group", "data", "send_flags", "channel", "exclude"), &HBSteamPeerGroup::send_to_group, DEFVAL(HBSteamNetworkingMessages::INVALID_PEER));
+
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "peers"), "", "get_peers");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "tracked_lobby", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamLobby"), "track_lobby", "get_tracked_lobby");
+}
+
+void HBSteamPeerGroup::add_peer(int p_peer) {
+	ERR_FAIL_COND_MSG(!messages->is_peer_valid(p_peer), vformat("Invalid peer handle %d.", p_peer));
+	if (!has_peer(p_peer)) {
+		peers.push_back(p_peer);
+		messages->retain_peer(p_peer);
+	}
+}
+
+void HBSteamPeerGroup::remove_peer(int p_peer) {
+	int64_t idx = peers.find(p_peer);
+	if (idx == -1) {
+		return;
+	}
+	peers.remove_at(idx);
+	messages->unretain_peer(p_peer);
+}
+
+bool HBSteamPeerGroup::has_peer(int p_peer) const {
+	return peers.has(p_peer);
+}
+
+void HBSteamPeerGroup::clear() {
+	// Release after emptying the list, so peer_released handlers don't see stale peers here.
+	LocalVector<int> old_peers = peers;
+	peers.clear();
+	for (int peer : old_peers) {
+		messages->unretain_peer(peer);
+	}
+}
+
+PackedInt32Array HBSteamPeerGroup::get_peers() const {
+	PackedInt32Array out;
+	out.resize(peers.size());
+	int *out_w = out.ptrw();
+	for (uint32_t i = 0; i < peers.size(); i++) {
+		out_w[i] = peers[i];
+	}
+	return out;
+}
+
+int HBSteamPeerGroup::get_peer_count() const {
+	return peers.size();
+}
+
+void HBSteamPeerGroup::track_lobby(const Ref<HBSteamLobby> &p_lobby) {
+	_untrack_lobby();
+	clear();
+	if (!p_lobby.is_valid()) {
+		return;
+	}
+	tracked_lobby = p_lobby;
+	tracked_lobby->connect("member_joined", callable_mp(this, &HBSteamPeerGroup::_on_member_joined));
+	tracked_lobby->connect("member_left", callable_mp(this, &HBSteamPeerGroup::_on_member_left));
+
+	TypedArray<HBSteamFriend> members = tracked_lobby->get_members();
+	for (int i = 0; i < members.size(); i++) {
+		_on_member_joined(members[i]);
+	}
+}
+
+Ref<HBSteamLobby> HBSteamPeerGroup::get_tracked_lobby() const {
+	return tracked_lobby;
+}
+
+SWC::Result HBSteamPeerGroup::send_to_group(const PackedByteArray &p_data, int p_send_flags, int p_channel, int p_exclude) {
+	return send_raw_to_group(p_data.ptr(), p_data.size(), p_send_flags, p_channel, p_exclude);
+}
+
+SWC::Result HBSteamPeerGroup::send_raw_to_group(const void *p_data, uint32_t p_size, int p_send_flags, int p_channel, int p_exclude) {
+	// ISteamNetworkingMessages has no multi-recipient send, so the best we can do is
+	// hand the same buffer to every recipient without going back through Variant.
+	ISteamNetworkingMessages *nm = messages->get_interface();
+	SWC::Result result = SWC::RESULT_OK;
+	for (int peer : peers) {
+		if (peer == p_exclude) {
+			continue;
+		}
+		const SteamNetworkingIdentity *identity = messages->get_peer_identity(peer);
+		if (!identity) {
+			ERR_PRINT(vformat("Peer handle %d in group is no longer valid, skipping it.", peer));
+			result = SWC::RESULT_FAIL;
+			continue;
+		}
+		EResult send_result = SteamAPI_ISteamNetworkingMessages_SendMessageToUser(nm, *identity, p_data, p_size, p_send_flags, p_channel);
+		if (send_result != k_EResultOK) {
+			result = (SWC::Result)send_result;
+		}
+	}
+	return result;
+}
+
+HBSteamPeerGroup::~HBSteamPeerGroup() {
+	_untrack_lobby();
+	if (messages.is_valid()) {
+		clear();
+	}
+}
@@ -2,31 +2,72 @@
 #define STEAM_NETWORKING_MESSAGES_H
 
 #include "core/object/ref_counted.h"
+#include "core/templates/local_vector.h"
 #include "steamworks_constants.gen.h"
 
 class ISteamNetworkingMessages;
 class HBSteamFriend;
+class HBSteamLobby;
+class HBSteamPeerGroup;
+class HBSteamSnapshotReplicator;
+class HBSteamInputTransport;
+class HBSteamClockSync;
+class HBSteamHostMigration;
 class SteamworksCallbackData;
 struct SteamNetworkingMessage_t;
+struct SteamNetworkingIdentity;
 
 class HBSteamNetworkingMessage : public RefCounted {
 	GDCLASS(HBSteamNetworkingMessage, RefCounted);
 	PackedByteArray data;
-	Ref<HBSteamFriend> sender;
+	uint64_t sender_steam_id = 0;
+	int sender_peer = -1;
 
 protected:
 	static void _bind_methods();
 
 public:
 	PackedByteArray get_data() const { return data; }
-	static Ref<HBSteamNetworkingMessage> create_from_message(SteamNetworkingMessage_t *p_message);
+	static Ref<HBSteamNetworkingMessage> create_from_message(SteamNetworkingMessage_t *p_message, int p_sender_peer);
 
-	Ref<HBSteamFriend> get_sender() const { return sender; }
+	Ref<HBSteamFriend> get_sender() const;
+	uint64_t get_sender_steam_id() const { return sender_steam_id; }
+	int get_sender_peer() const { return sender_peer; }
 };
 
 class HBSteamNetworkingMessages : public RefCounted {
 	GDCLASS(HBSteamNetworkingMessages, RefCounted);
 	ISteamNetworkingMessages *steam_networking_messages = nullptr;
+
+	// Identities are built once per peer so the send path doesn't have to rebuild them for every message.
+	struct PeerInfo {
+		uint64_t steam_id = 0;
+		SteamNetworkingIdentity *identity = nullptr;
+		// Peer groups holding this handle, it isn't released while any of them does.
+		int group_refs = 0;
+		bool session_closed = false;
+		// Bumped every time the slot is released.
+		uint32_t generation = 0;
+	};
+	// Peer handles pack a slot in this table together with the slot's generation. Released slots are
+	// reused for new peers, so anything keyed by a handle has to be dropped on peer_released, and
+	// handles kept past that are rejected instead of reaching whoever got the slot next.
+	static const int PEER_INDEX_BITS = 12;
+	static const uint32_t MAX_PEERS = 1 << PEER_INDEX_BITS;
+	static const uint32_t PEER_GENERATION_MASK = (1u << (31 - PEER_INDEX_BITS)) - 1;
+	LocalVector<PeerInfo> peers;
+	HashMap<uint64_t, int> peer_handles;
+	LocalVector<uint32_t> free_slots;
+
+	static int _make_peer_handle(uint32_t p_slot, uint32_t p_generation) { return (int)((p_generation << PEER_INDEX_BITS) | p_slot); }
+	int _get_peer_slot(int p_peer) const;
+	void _close_peer(int p_peer);
+	void _release_peer(int p_peer);
+	void _release_idle_peers();
+
+	static const int MAX_MESSAGES_PER_POLL = 32;
+	typedef void (*MessageReceiver)(void *p_userdata, int p_peer, const uint8_t *p_data, uint32_t p_size);
+	void _receive_messages(int p_channel, void *p_userdata, MessageReceiver p_receiver);
 	void _on_session_requested(Ref<SteamworksCallbackData> p_callback_data);
 	void _on_session_failed(Ref<SteamworksCallbackData> p_callback_data);
 
@@ -34,12 +75,86 @@ protected:
 	static void _bind_methods();
 
 public:
-	void init_interface();
+	static const int INVALID_PEER = -1;
+
+	void init_interface(bool p_game_server = false);
 	bool is_valid() const;
 	SWC::Result send_message_to_user(PackedByteArray p_data, Ref<HBSteamFriend> p_target_user, int p_send_flags, int p_channel);
 	bool accept_session_with_user(Ref<HBSteamFriend> p_user);
 	TypedArray<HBSteamNetworkingMessage> poll_messages(int p_local_channel);
 	ISteamNetworkingMessages *get_interface() const;
+	Ref<HBSteamPeerGroup> create_peer_group();
+	Ref<HBSteamSnapshotReplicator> create_snapshot_replicator(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel);
+	Ref<HBSteamInputTransport> create_input_transport(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel, int p_redundancy = 8);
+	Ref<HBSteamClockSync> create_clock_sync(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel);
+	Ref<HBSteamHostMigration> create_host_migration(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel);
+
+	int get_peer_handle(uint64_t p_steam_id);
+	int get_peer_handle_for_identity(const SteamNetworkingIdentity &p_identity);
+	int get_peer_handle_for_user(const Ref<HBSteamFriend> &p_user);
+	int find_peer_handle(uint64_t p_steam_id) const;
+	uint64_t get_peer_steam_id(int p_peer) const;
+	const SteamNetworkingIdentity *get_peer_identity(int p_peer) const;
+	SWC::Result send_message_to_peer(const PackedByteArray &p_data, int p_peer, int p_send_flags, int p_channel);
+	SWC::Result send_raw_message_to_peer(const void *p_data, uint32_t p_size, int p_peer, int p_send_flags, int p_channel);
+	bool accept_session_with_peer(int p_peer);
+	bool close_session_with_peer(int p_peer);
+	bool is_peer_valid(int p_peer) const;
+	int get_peer_count() const;
+
+	void retain_peer(int p_peer);
+	void unretain_peer(int p_peer);
+
+	// Drains p_channel, handing every message to p_instance's p_method along with the sender's peer
+	// handle. The data is only valid during the call.
+	template <typename C>
+	void receive_messages(int p_channel, C *p_instance, void (C::*p_method)(int, const uint8_t *, uint32_t)) {
+		struct Receiver {
+			C *instance;
+			void (C::*method)(int, const uint8_t *, uint32_t);
+		};
+		Receiver receiver = { p_instance, p_method };
+		_receive_messages(p_channel, &receiver, [](void *p_userdata, int p_peer, const uint8_t *p_data, uint32_t p_size) {
+			Receiver *r = (Receiver *)p_userdata;
+			(r->instance->*r->method)(p_peer, p_data, p_size);
+		});
+	}
+
+	~HBSteamNetworkingMessages();
+};
+
+class HBSteamPeerGroup : public RefCounted {
+	GDCLASS(HBSteamPeerGroup, RefCounted);
+	LocalVector<int> peers;
+	Ref<HBSteamLobby> tracked_lobby;
+	// Groups keep their handles retained so they aren't released from under them.
+	Ref<HBSteamNetworkingMessages> messages;
+
+	void _on_member_joined(Ref<HBSteamFriend> p_member);
+	void _on_member_left(Ref<HBSteamFriend> p_member);
+	void _untrack_lobby();
+
+protected:
+	static void _bind_methods();
+
+public:
+	void add_peer(int p_peer);
+	void remove_peer(int p_peer);
+	bool has_peer(int p_peer) const;
+	void clear();
+	PackedInt32Array get_peers() const;
+	const LocalVector<int> &get_peer_list() const { return peers; }
+	int get_peer_count() const;
+
+	void track_lobby(const Ref<HBSteamLobby> &p_lobby);
+	Ref<HBSteamLobby> get_tracked_lobby() const;
+
+	SWC::Result send_to_group(const PackedByteArray &p_data, int p_send_flags, int p_channel, int p_exclude = HBSteamNetworkingMessages::INVALID_PEER);
+	SWC::Result send_raw_to_group(const void *p_data, uint32_t p_size, int p_send_flags, int p_channel, int p_exclude = HBSteamNetworkingMessages::INVALID_PEER);
+
+	void set_networking_messages(const Ref<HBSteamNetworkingMessages> &p_messages) { messages = p_messages; }
+
+	~HBSteamPeerGroup();
 };
 
 #endif // STEAM_NETWORKING_MESSAGES_H
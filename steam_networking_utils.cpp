@@ -0,0 +1,111 @@
+/**************************************************************************/
+/*  steam_networking_utils.cpp                                            */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_networking_utils.h"
+#include "steam/steam_api_flat.h"
+#include "sw_error_macros.h"
+
+void HBSteamNetworkingUtils::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("init_relay_network_access"), &HBSteamNetworkingUtils::init_relay_network_access);
+	ClassDB::bind_method(D_METHOD("check_ping_data_up_to_date", "max_age_seconds"), &HBSteamNetworkingUtils::check_ping_data_up_to_date);
+	ClassDB::bind_method(D_METHOD("get_local_ping_location"), &HBSteamNetworkingUtils::get_local_ping_location);
+	ClassDB::bind_method(D_METHOD("is_ping_location_valid", "location"), &HBSteamNetworkingUtils::is_ping_location_valid);
+	ClassDB::bind_method(D_METHOD("estimate_ping_time_between_two_locations", "location_1", "location_2"), &HBSteamNetworkingUtils::estimate_ping_time_between_two_locations);
+	ClassDB::bind_method(D_METHOD("estimate_ping_time_from_local_host", "location"), &HBSteamNetworkingUtils::estimate_ping_time_from_local_host);
+	BIND_CONSTANT(PING_UNKNOWN);
+}
+
+void HBSteamNetworkingUtils::init_interface() {
+	steam_networking_utils = SteamAPI_SteamNetworkingUtils_SteamAPI();
+	SW_ERR_FAIL_COND_MSG(steam_networking_utils == nullptr, "Steamworks: Failed to initialize Steam networking utils, something catastrophic must have happened");
+}
+
+bool HBSteamNetworkingUtils::is_valid() const {
+	return steam_networking_utils != nullptr;
+}
+
+ISteamNetworkingUtils *HBSteamNetworkingUtils::get_interface() const {
+	return steam_networking_utils;
+}
+
+void HBSteamNetworkingUtils::init_relay_network_access() {
+	SteamAPI_ISteamNetworkingUtils_InitRelayNetworkAccess(steam_networking_utils);
+}
+
+bool HBSteamNetworkingUtils::check_ping_data_up_to_date(float p_max_age_seconds) const {
+	return SteamAPI_ISteamNetworkingUtils_CheckPingDataUpToDate(steam_networking_utils, p_max_age_seconds);
+}
+
+String HBSteamNetworkingUtils::get_local_ping_location() const {
+	SteamNetworkPingLocation_t location;
+	float age = SteamAPI_ISteamNetworkingUtils_GetLocalPingLocation(steam_networking_utils, location);
+	if (age < 0.0f) {
+		// Relay network access hasn't been initialized or hasn't measured anything yet.
+		return String();
+	}
+	char buffer[k_cchMaxSteamNetworkingPingLocationString];
+	SteamAPI_ISteamNetworkingUtils_ConvertPingLocationToString(steam_networking_utils, location, buffer, sizeof(buffer));
+	return String::utf8(buffer);
+}
+
+bool HBSteamNetworkingUtils::is_ping_location_valid(const String &p_location) const {
+	SteamNetworkPingLocation_t location;
+	return parse_ping_location(p_location, location);
+}
+
+int HBSteamNetworkingUtils::estimate_ping_time_between_two_locations(const String &p_location_1, const String &p_location_2) const {
+	SteamNetworkPingLocation_t location_1;
+	SteamNetworkPingLocation_t location_2;
+	if (!parse_ping_location(p_location_1, location_1) || !parse_ping_location(p_location_2, location_2)) {
+		return PING_UNKNOWN;
+	}
+	int ping = SteamAPI_ISteamNetworkingUtils_EstimatePingTimeBetweenTwoLocations(steam_networking_utils, location_1, location_2);
+	return ping < 0 ? PING_UNKNOWN : ping;
+}
+
+int HBSteamNetworkingUtils::estimate_ping_time_from_local_host(const String &p_location) const {
+	SteamNetworkPingLocation_t location;
+	if (!parse_ping_location(p_location, location)) {
+		return PING_UNKNOWN;
+	}
+	int ping = SteamAPI_ISteamNetworkingUtils_EstimatePingTimeFromLocalHost(steam_networking_utils, location);
+	return ping < 0 ? PING_UNKNOWN : ping;
+}
+
+bool HBSteamNetworkingUtils::parse_ping_location(const String &p_location, SteamNetworkPingLocation_t &r_location) const {
+	return parse_ping_location(p_location.utf8(), r_location);
+}
+
+bool HBSteamNetworkingUtils::parse_ping_location(const CharString &p_location, SteamNetworkPingLocation_t &r_location) const {
+	if (p_location.length() == 0) {
+		return false;
+	}
+	return SteamAPI_ISteamNetworkingUtils_ParsePingLocationString(steam_networking_utils, p_location.get_data(), r_location);
+}
@@ -0,0 +1,65 @@
+/**************************************************************************/
+/*  steam_networking_utils.h                                              */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_NETWORKING_UTILS_H
+#define STEAM_NETWORKING_UTILS_H
+
+#include "core/object/ref_counted.h"
+#include "steamworks_constants.gen.h"
+
+class ISteamNetworkingUtils;
+struct SteamNetworkPingLocation_t;
+
+class HBSteamNetworkingUtils : public RefCounted {
+	GDCLASS(HBSteamNetworkingUtils, RefCounted);
+	ISteamNetworkingUtils *steam_networking_utils = nullptr;
+
+protected:
+	static void _bind_methods();
+
+public:
+	static const int PING_UNKNOWN = -1;
+
+	void init_interface();
+	bool is_valid() const;
+	ISteamNetworkingUtils *get_interface() const;
+
+	void init_relay_network_access();
+	bool check_ping_data_up_to_date(float p_max_age_seconds) const;
+	String get_local_ping_location() const;
+	bool is_ping_location_valid(const String &p_location) const;
+	int estimate_ping_time_between_two_locations(const String &p_location_1, const String &p_location_2) const;
+	int estimate_ping_time_from_local_host(const String &p_location) const;
+
+	bool parse_ping_location(const String &p_location, SteamNetworkPingLocation_t &r_location) const;
+	bool parse_ping_location(const CharString &p_location, SteamNetworkPingLocation_t &r_location) const;
+};
+
+#endif // STEAM_NETWORKING_UTILS_H
@@ -0,0 +1,255 @@
+/**************************************************************************/
+/*  steam_persona_requests.cpp                                            */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_persona_requests.h"
+
+#include "core/os/os.h"
+#include "steam/steam_api_flat.h"
+#include "steamworks.h"
+
+bool HBSteamPersonaRequests::_pop_queue(LocalVector<uint64_t> &p_queue, uint32_t &p_head, bool p_visible, uint64_t &r_steam_id) {
+	while (p_head < p_queue.size()) {
+		uint64_t steam_id = p_queue[p_head++];
+		const Request *request = requests.getptr(steam_id);
+		if (request && request->issued_at_usec == 0 && request->visible == p_visible) {
+			r_steam_id = steam_id;
+			return true;
+		}
+	}
+	p_queue.clear();
+	p_head = 0;
+	return false;
+}
+
+void HBSteamPersonaRequests::_mark_ready(uint64_t p_steam_id) {
+	if (!ready_set.has(p_steam_id)) {
+		ready_set.insert(p_steam_id);
+		ready_ids.push_back(p_steam_id);
+	}
+	_queue_pump();
+}
+
+void HBSteamPersonaRequests::_queue_pump() {
+	if (!pump_queued) {
+		pump_queued = true;
+		Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamPersonaRequests::_pump));
+	}
+}
+
+void HBSteamPersonaRequests::_pump() {
+	pump_queued = false;
+	uint64_t now = OS::get_singleton()->get_ticks_usec();
+
+	if (in_flight_count > 0) {
+		// Steam never answers for some ids (e.g. deleted accounts), don't let them hold a slot forever.
+		uint64_t timeout_usec = request_timeout * 1000000.0;
+		LocalVector<uint64_t> expired;
+		for (const KeyValue<uint64_t, Request> &E : requests) {
+			if (E.value.issued_at_usec != 0 && now - E.value.issued_at_usec > timeout_usec) {
+				expired.push_back(E.key);
+			}
+		}
+		for (uint64_t steam_id : expired) {
+			requests.erase(steam_id);
+			in_flight_count--;
+			timeouts++;
+		}
+	}
+
+	ISteamFriends *friends = Steamworks::get_singleton()->get_friends()->get_interface();
+	while (in_flight_count < max_in_flight && queued_count > 0) {
+		uint64_t steam_id = 0;
+		if (!_pop_queue(visible_queue, visible_queue_head, true, steam_id) && !_pop_queue(background_queue, background_queue_head, false, steam_id)) {
+			break;
+		}
+		Request &request = requests[steam_id];
+		queued_count--;
+		if (!SteamAPI_ISteamFriends_RequestUserInformation(friends, steam_id, !request.include_avatars)) {
+			// Steam already has everything we asked for, no PersonaStateChange_t will follow.
+			requests.erase(steam_id);
+			already_available++;
+			_mark_ready(steam_id);
+			continue;
+		}
+		request.issued_at_usec = now;
+		in_flight_count++;
+		issued++;
+	}
+
+	if (!ready_ids.is_empty()) {
+		PackedInt64Array steam_ids = ready_ids;
+		ready_ids = PackedInt64Array();
+		ready_set.clear();
+		batches++;
+		emit_signal("persona_info_ready", steam_ids);
+	}
+
+	if (queued_count > 0 || in_flight_count > 0) {
+		_queue_pump();
+	}
+}
+
+void HBSteamPersonaRequests::_on_persona_state_change(Ref<SteamworksCallbackData> p_callback) {
+	const PersonaStateChange_t *state_change = p_callback->get_data<PersonaStateChange_t>();
+	const Request *request = requests.getptr(state_change->m_ulSteamID);
+	if (!request || request->issued_at_usec == 0) {
+		return;
+	}
+	requests.erase(state_change->m_ulSteamID);
+	in_flight_count--;
+	_mark_ready(state_change->m_ulSteamID);
+}
+
+void HBSteamPersonaRequests::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("request", "steam_id", "include_avatars", "visible"), &HBSteamPersonaRequests::request, DEFVAL(false), DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("request_many", "steam_ids", "include_avatars", "visible"), &HBSteamPersonaRequests::request_many, DEFVAL(false), DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("prioritize", "steam_ids"), &HBSteamPersonaRequests::prioritize);
+	ClassDB::bind_method(D_METHOD("is_pending", "steam_id"), &HBSteamPersonaRequests::is_pending);
+	ClassDB::bind_method(D_METHOD("get_pending_count"), &HBSteamPersonaRequests::get_pending_count);
+	ClassDB::bind_method(D_METHOD("get_in_flight_count"), &HBSteamPersonaRequests::get_in_flight_count);
+	ClassDB::bind_method(D_METHOD("clear"), &HBSteamPersonaRequests::clear);
+	ClassDB::bind_method(D_METHOD("get_stats"), &HBSteamPersonaRequests::get_stats);
+	ClassDB::bind_method(D_METHOD("set_max_in_flight", "max_in_flight"), &HBSteamPersonaRequests::set_max_in_flight);
+	ClassDB::bind_method(D_METHOD("get_max_in_flight"), &HBSteamPersonaRequests::get_max_in_flight);
+	ClassDB::bind_method(D_METHOD("set_request_timeout", "request_timeout"), &HBSteamPersonaRequests::set_request_timeout);
+	ClassDB::bind_method(D_METHOD("get_request_timeout"), &HBSteamPersonaRequests::get_request_timeout);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_in_flight", PROPERTY_HINT_RANGE, "1,64,1"), "set_max_in_flight", "get_max_in_flight");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "request_timeout", PROPERTY_HINT_RANGE, "0.1,60,0.1,suffix:s"), "set_request_timeout", "get_request_timeout");
+
+	ADD_SIGNAL(MethodInfo("persona_info_ready", PropertyInfo(Variant::PACKED_INT64_ARRAY, "steam_ids")));
+}
+
+void HBSteamPersonaRequests::request(uint64_t p_steam_id, bool p_include_avatars, bool p_visible) {
+	ERR_FAIL_COND_MSG(p_steam_id == 0, "An invalid steam user ID was given.");
+	total_requests++;
+	Request *existing = requests.getptr(p_steam_id);
+	if (existing) {
+		deduplicated++;
+		// Requests that already went out can't be changed anymore.
+		if (existing->issued_at_usec == 0) {
+			existing->include_avatars = existing->include_avatars || p_include_avatars;
+			if (p_visible && !existing->visible) {
+				existing->visible = true;
+				visible_queue.push_back(p_steam_id);
+			}
+		}
+		return;
+	}
+	Request new_request;
+	new_request.include_avatars = p_include_avatars;
+	new_request.visible = p_visible;
+	requests.insert(p_steam_id, new_request);
+	if (p_visible) {
+		visible_queue.push_back(p_steam_id);
+	} else {
+		background_queue.push_back(p_steam_id);
+	}
+	queued_count++;
+	_queue_pump();
+}
+
+void HBSteamPersonaRequests::request_many(const PackedInt64Array &p_steam_ids, bool p_include_avatars, bool p_visible) {
+	for (int64_t steam_id : p_steam_ids) {
+		request(steam_id, p_include_avatars, p_visible);
+	}
+}
+
+void HBSteamPersonaRequests::prioritize(const PackedInt64Array &p_steam_ids) {
+	for (int64_t steam_id : p_steam_ids) {
+		Request *existing = requests.getptr(steam_id);
+		if (existing && existing->issued_at_usec == 0 && !existing->visible) {
+			existing->visible = true;
+			visible_queue.push_back(steam_id);
+		}
+	}
+}
+
+bool HBSteamPersonaRequests::is_pending(uint64_t p_steam_id) const {
+	return requests.has(p_steam_id);
+}
+
+int HBSteamPersonaRequests::get_pending_count() const {
+	return requests.size();
+}
+
+int HBSteamPersonaRequests::get_in_flight_count() const {
+	return in_flight_count;
+}
+
+void HBSteamPersonaRequests::clear() {
+	requests.clear();
+	visible_queue.clear();
+	background_queue.clear();
+	visible_queue_head = 0;
+	background_queue_head = 0;
+	queued_count = 0;
+	in_flight_count = 0;
+	ready_ids.clear();
+	ready_set.clear();
+}
+
+Dictionary HBSteamPersonaRequests::get_stats() const {
+	Dictionary stats;
+	stats["requests"] = total_requests;
+	stats["deduplicated"] = deduplicated;
+	stats["issued"] = issued;
+	stats["already_available"] = already_available;
+	stats["timeouts"] = timeouts;
+	stats["batches"] = batches;
+	stats["queued"] = queued_count;
+	stats["in_flight"] = in_flight_count;
+	return stats;
+}
+
+void HBSteamPersonaRequests::set_max_in_flight(int p_max_in_flight) {
+	ERR_FAIL_COND_MSG(p_max_in_flight < 1, "At least one request must be allowed in flight.");
+	max_in_flight = p_max_in_flight;
+	if (queued_count > 0) {
+		_queue_pump();
+	}
+}
+
+int HBSteamPersonaRequests::get_max_in_flight() const {
+	return max_in_flight;
+}
+
+void HBSteamPersonaRequests::set_request_timeout(float p_request_timeout) {
+	ERR_FAIL_COND_MSG(p_request_timeout <= 0.0f, "The request timeout must be positive.");
+	request_timeout = p_request_timeout;
+}
+
+float HBSteamPersonaRequests::get_request_timeout() const {
+	return request_timeout;
+}
+
+HBSteamPersonaRequests::HBSteamPersonaRequests() {
+	Steamworks::get_singleton()->add_callback(PersonaStateChange_t::k_iCallback, callable_mp(this, &HBSteamPersonaRequests::_on_persona_state_change));
+}
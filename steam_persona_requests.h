@@ -0,0 +1,101 @@
+/**************************************************************************/
+/*  steam_persona_requests.h                                              */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_PERSONA_REQUESTS_H
+#define STEAM_PERSONA_REQUESTS_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/hash_set.h"
+#include "core/templates/local_vector.h"
+#include "steamworks_callback_data.h"
+
+// Spreads RequestUserInformation calls over several frames so opening a big scoreboard doesn't
+// ask Steam for every user at once, and reports the results in a single signal per frame.
+class HBSteamPersonaRequests : public RefCounted {
+	GDCLASS(HBSteamPersonaRequests, RefCounted);
+
+	struct Request {
+		bool include_avatars = false;
+		bool visible = false;
+		// 0 while the request is still queued.
+		uint64_t issued_at_usec = 0;
+	};
+	HashMap<uint64_t, Request> requests;
+	// Queues may hold ids that were promoted, issued or cleared since, those are skipped when popped.
+	LocalVector<uint64_t> visible_queue;
+	LocalVector<uint64_t> background_queue;
+	uint32_t visible_queue_head = 0;
+	uint32_t background_queue_head = 0;
+	int queued_count = 0;
+	int in_flight_count = 0;
+
+	PackedInt64Array ready_ids;
+	HashSet<uint64_t> ready_set;
+	bool pump_queued = false;
+
+	int max_in_flight = 8;
+	float request_timeout = 10.0f;
+
+	uint64_t total_requests = 0;
+	uint64_t deduplicated = 0;
+	uint64_t issued = 0;
+	uint64_t already_available = 0;
+	uint64_t timeouts = 0;
+	uint64_t batches = 0;
+
+	bool _pop_queue(LocalVector<uint64_t> &p_queue, uint32_t &p_head, bool p_visible, uint64_t &r_steam_id);
+	void _mark_ready(uint64_t p_steam_id);
+	void _queue_pump();
+	void _pump();
+	void _on_persona_state_change(Ref<SteamworksCallbackData> p_callback);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void request(uint64_t p_steam_id, bool p_include_avatars = false, bool p_visible = false);
+	void request_many(const PackedInt64Array &p_steam_ids, bool p_include_avatars = false, bool p_visible = false);
+	void prioritize(const PackedInt64Array &p_steam_ids);
+	bool is_pending(uint64_t p_steam_id) const;
+	int get_pending_count() const;
+	int get_in_flight_count() const;
+	void clear();
+	Dictionary get_stats() const;
+
+	void set_max_in_flight(int p_max_in_flight);
+	int get_max_in_flight() const;
+	void set_request_timeout(float p_request_timeout);
+	float get_request_timeout() const;
+
+	HBSteamPersonaRequests();
+};
+
+#endif // STEAM_PERSONA_REQUESTS_H
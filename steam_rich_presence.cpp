@@ -0,0 +1,220 @@
+/**************************************************************************/
+/*  steam_rich_presence.cpp                                               */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_rich_presence.h"
+
+#include "core/os/os.h"
+#include "steam/steam_api_flat.h"
+#include "steamworks.h"
+
+static const char *DISPLAY_KEY = "steam_display";
+static const char *STATUS_KEY = "status";
+static const char *CONNECT_KEY = "connect";
+static const char *PLAYER_GROUP_KEY = "steam_player_group";
+static const char *PLAYER_GROUP_SIZE_KEY = "steam_player_group_size";
+
+int HBSteamRichPresence::_get_key_count() const {
+	int key_count = current_values.size();
+	for (const KeyValue<String, String> &E : pending_values) {
+		bool is_current = current_values.has(E.key);
+		if (!is_current && !E.value.is_empty()) {
+			key_count++;
+		} else if (is_current && E.value.is_empty()) {
+			key_count--;
+		}
+	}
+	return key_count;
+}
+
+void HBSteamRichPresence::_queue_flush() {
+	if (!flush_queued) {
+		flush_queued = true;
+		Steamworks::get_singleton()->add_frame_callback(callable_mp(this, &HBSteamRichPresence::_on_flush_timer));
+	}
+}
+
+void HBSteamRichPresence::_on_flush_timer() {
+	flush_queued = false;
+	if (pending_values.is_empty()) {
+		return;
+	}
+	uint64_t since_last_flush = OS::get_singleton()->get_ticks_usec() - last_flush_usec;
+	if (last_flush_usec != 0 && since_last_flush < min_update_interval * 1000000.0) {
+		// Keep collecting changes until the interval is up.
+		_queue_flush();
+		return;
+	}
+	flush();
+}
+
+void HBSteamRichPresence::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_value", "key", "value"), &HBSteamRichPresence::set_value);
+	ClassDB::bind_method(D_METHOD("set_values", "values"), &HBSteamRichPresence::set_values);
+	ClassDB::bind_method(D_METHOD("get_value", "key"), &HBSteamRichPresence::get_value);
+	ClassDB::bind_method(D_METHOD("get_values"), &HBSteamRichPresence::get_values);
+	ClassDB::bind_method(D_METHOD("has_pending_changes"), &HBSteamRichPresence::has_pending_changes);
+	ClassDB::bind_method(D_METHOD("flush"), &HBSteamRichPresence::flush);
+	ClassDB::bind_method(D_METHOD("clear"), &HBSteamRichPresence::clear);
+	ClassDB::bind_method(D_METHOD("set_display", "token", "substitutions"), &HBSteamRichPresence::set_display, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("set_status", "status"), &HBSteamRichPresence::set_status);
+	ClassDB::bind_method(D_METHOD("set_connect", "connect"), &HBSteamRichPresence::set_connect);
+	ClassDB::bind_method(D_METHOD("set_player_group", "group_id", "group_size"), &HBSteamRichPresence::set_player_group, DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("get_stats"), &HBSteamRichPresence::get_stats);
+	ClassDB::bind_method(D_METHOD("set_min_update_interval", "min_update_interval"), &HBSteamRichPresence::set_min_update_interval);
+	ClassDB::bind_method(D_METHOD("get_min_update_interval"), &HBSteamRichPresence::get_min_update_interval);
+
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "min_update_interval", PROPERTY_HINT_RANGE, "0,60,0.01,suffix:s"), "set_min_update_interval", "get_min_update_interval");
+}
+
+bool HBSteamRichPresence::set_value(const String &p_key, const String &p_value) {
+	ERR_FAIL_COND_V_MSG(p_key.is_empty(), false, "Rich presence keys can't be empty.");
+	ERR_FAIL_COND_V_MSG(p_key.utf8().length() >= k_cchMaxRichPresenceKeyLength, false, vformat("Rich presence key \"%s\" is too long.", p_key));
+	ERR_FAIL_COND_V_MSG(p_value.utf8().length() >= k_cchMaxRichPresenceValueLength, false, vformat("Rich presence value for \"%s\" is too long.", p_key));
+
+	const String *current_value = current_values.getptr(p_key);
+	if (p_value == (current_value ? *current_value : String())) {
+		// Steam already has this value, drop any change that was waiting to overwrite it.
+		pending_values.erase(p_key);
+		skipped_writes++;
+		return true;
+	}
+	const String *pending_value = pending_values.getptr(p_key);
+	if (pending_value && *pending_value == p_value) {
+		skipped_writes++;
+		return true;
+	}
+	ERR_FAIL_COND_V_MSG(!p_value.is_empty() && !current_value && !pending_value && _get_key_count() >= k_cchMaxRichPresenceKeys, false, vformat("Can't set rich presence key \"%s\", there can't be more than %d keys.", p_key, (int)k_cchMaxRichPresenceKeys));
+	pending_values[p_key] = p_value;
+	_queue_flush();
+	return true;
+}
+
+bool HBSteamRichPresence::set_values(const Dictionary &p_values) {
+	bool ok = true;
+	for (const Variant &key : p_values.keys()) {
+		ok = set_value(key, p_values[key]) && ok;
+	}
+	return ok;
+}
+
+String HBSteamRichPresence::get_value(const String &p_key) const {
+	const String *pending_value = pending_values.getptr(p_key);
+	if (pending_value) {
+		return *pending_value;
+	}
+	const String *current_value = current_values.getptr(p_key);
+	return current_value ? *current_value : String();
+}
+
+Dictionary HBSteamRichPresence::get_values() const {
+	Dictionary values;
+	for (const KeyValue<String, String> &E : current_values) {
+		values[E.key] = E.value;
+	}
+	for (const KeyValue<String, String> &E : pending_values) {
+		if (E.value.is_empty()) {
+			values.erase(E.key);
+		} else {
+			values[E.key] = E.value;
+		}
+	}
+	return values;
+}
+
+bool HBSteamRichPresence::has_pending_changes() const {
+	return !pending_values.is_empty();
+}
+
+void HBSteamRichPresence::flush() {
+	if (pending_values.is_empty()) {
+		return;
+	}
+	// Everything goes out in the same frame, so friends never see a display token without its substitutions.
+	ISteamFriends *friends = Steamworks::get_singleton()->get_friends()->get_interface();
+	for (const KeyValue<String, String> &E : pending_values) {
+		SteamAPI_ISteamFriends_SetRichPresence(friends, E.key.utf8().get_data(), E.value.utf8().get_data());
+		if (E.value.is_empty()) {
+			current_values.erase(E.key);
+		} else {
+			current_values[E.key] = E.value;
+		}
+		writes++;
+	}
+	pending_values.clear();
+	last_flush_usec = OS::get_singleton()->get_ticks_usec();
+	flushes++;
+}
+
+void HBSteamRichPresence::clear() {
+	SteamAPI_ISteamFriends_ClearRichPresence(Steamworks::get_singleton()->get_friends()->get_interface());
+	current_values.clear();
+	pending_values.clear();
+}
+
+bool HBSteamRichPresence::set_display(const String &p_token, const Dictionary &p_substitutions) {
+	// Localization tokens are looked up with a leading #, see the rich presence localization file.
+	String token = p_token;
+	if (!token.is_empty() && !token.begins_with("#")) {
+		token = "#" + token;
+	}
+	return set_values(p_substitutions) && set_value(DISPLAY_KEY, token);
+}
+
+bool HBSteamRichPresence::set_status(const String &p_status) {
+	return set_value(STATUS_KEY, p_status);
+}
+
+bool HBSteamRichPresence::set_connect(const String &p_connect) {
+	return set_value(CONNECT_KEY, p_connect);
+}
+
+bool HBSteamRichPresence::set_player_group(const String &p_group_id, int p_group_size) {
+	String group_size = p_group_id.is_empty() || p_group_size <= 0 ? String() : itos(p_group_size);
+	return set_value(PLAYER_GROUP_KEY, p_group_id) && set_value(PLAYER_GROUP_SIZE_KEY, group_size);
+}
+
+Dictionary HBSteamRichPresence::get_stats() const {
+	Dictionary stats;
+	stats["keys"] = current_values.size();
+	stats["pending"] = pending_values.size();
+	stats["writes"] = writes;
+	stats["skipped_writes"] = skipped_writes;
+	stats["flushes"] = flushes;
+	return stats;
+}
+
+void HBSteamRichPresence::set_min_update_interval(float p_min_update_interval) {
+	ERR_FAIL_COND_MSG(p_min_update_interval < 0.0f, "The minimum update interval can't be negative.");
+	min_update_interval = p_min_update_interval;
+}
+
+float HBSteamRichPresence::get_min_update_interval() const {
+	return min_update_interval;
+}
@@ -0,0 +1,83 @@
+/**************************************************************************/
+/*  steam_rich_presence.h                                                 */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_RICH_PRESENCE_H
+#define STEAM_RICH_PRESENCE_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+
+// Keeps track of the rich presence Steam already has, so gameplay code can set it as often as it
+// likes: unchanged values are dropped and whatever did change is written together at most once
+// every min_update_interval.
+class HBSteamRichPresence : public RefCounted {
+	GDCLASS(HBSteamRichPresence, RefCounted);
+
+	// What we last told Steam, keys with empty values are removed.
+	HashMap<String, String> current_values;
+	// Changes since the last flush, an empty value removes the key.
+	HashMap<String, String> pending_values;
+	bool flush_queued = false;
+	uint64_t last_flush_usec = 0;
+
+	float min_update_interval = 1.0f;
+
+	uint64_t writes = 0;
+	uint64_t skipped_writes = 0;
+	uint64_t flushes = 0;
+
+	int _get_key_count() const;
+	void _queue_flush();
+	void _on_flush_timer();
+
+protected:
+	static void _bind_methods();
+
+public:
+	bool set_value(const String &p_key, const String &p_value);
+	bool set_values(const Dictionary &p_values);
+	String get_value(const String &p_key) const;
+	Dictionary get_values() const;
+	bool has_pending_changes() const;
+	void flush();
+	void clear();
+
+	bool set_display(const String &p_token, const Dictionary &p_substitutions = Dictionary());
+	bool set_status(const String &p_status);
+	bool set_connect(const String &p_connect);
+	bool set_player_group(const String &p_group_id, int p_group_size = 0);
+
+	Dictionary get_stats() const;
+
+	void set_min_update_interval(float p_min_update_interval);
+	float get_min_update_interval() const;
+};
+
+#endif // STEAM_RICH_PRESENCE_H
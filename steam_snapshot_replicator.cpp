@@ -0,0 +1,319 @@
+/**************************************************************************/
+/*  steam_snapshot_replicator.cpp                                         */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_snapshot_replicator.h"
+
+#include "core/io/marshalls.h"
+#include "steam/steam_api_flat.h"
+#include "steam_delta_codec.h"
+#include "steamworks.h"
+
+// Wire format, all integers little endian:
+//   uint8 flags
+//   [uint16 ack]                                  if PACKET_HAS_ACK
+//   [uint16 sequence, uint32 snapshot size]       if PACKET_HAS_SNAPSHOT
+//   [uint16 baseline sequence]                    if PACKET_IS_DELTA
+//   payload, the snapshot or its delta against the baseline
+
+const uint32_t HBSteamSnapshotReplicator::MAX_SNAPSHOT_SIZE = k_cbMaxSteamNetworkingSocketsMessageSizeSend - MAX_HEADER_SIZE;
+
+static inline bool sequence_newer(uint16_t p_a, uint16_t p_b) {
+	return (int16_t)(p_a - p_b) > 0;
+}
+
+HBSteamSnapshotReplicator::Peer &HBSteamSnapshotReplicator::_get_or_create_peer(int p_peer) {
+	if (Peer *peer = peers.getptr(p_peer)) {
+		return *peer;
+	}
+	return peers.insert(p_peer, Peer())->value;
+}
+
+SWC::Result HBSteamSnapshotReplicator::_send_packet(int p_peer, Peer &p_state, const uint8_t *p_snapshot, uint32_t p_size) {
+	const bool has_snapshot = p_snapshot != nullptr;
+	const bool has_ack = p_state.received_sequence != INVALID_SEQUENCE;
+	uint16_t sequence = p_state.next_sequence;
+
+	// Delta against the newest snapshot the peer acknowledged, as long as it's still in the ring.
+	const Snapshot *baseline = nullptr;
+	if (has_snapshot && p_state.acked_sequence != INVALID_SEQUENCE) {
+		const Snapshot &candidate = p_state.sent[p_state.acked_sequence % SNAPSHOT_RING_SIZE];
+		if (candidate.sequence == p_state.acked_sequence && (uint16_t)(sequence - candidate.sequence) < SNAPSHOT_RING_SIZE) {
+			baseline = &candidate;
+		}
+	}
+	const bool is_delta = baseline != nullptr && HBDeltaCodec::encode(p_snapshot, p_size, baseline->data.ptr(), baseline->data.size(), p_size, delta_buffer);
+	const uint32_t payload_size = is_delta ? delta_buffer.size() : p_size;
+
+	if (packet_buffer.size() < MAX_HEADER_SIZE + payload_size) {
+		packet_buffer.resize(MAX_HEADER_SIZE + payload_size);
+	}
+	uint8_t *w = packet_buffer.ptr();
+	uint8_t flags = 0;
+	uint32_t pos = 1;
+	if (has_ack) {
+		flags |= PACKET_HAS_ACK;
+		pos += encode_uint16(p_state.received_sequence, w + pos);
+	}
+	if (has_snapshot) {
+		flags |= PACKET_HAS_SNAPSHOT;
+		pos += encode_uint16(sequence, w + pos);
+		pos += encode_uint32(p_size, w + pos);
+		if (is_delta) {
+			flags |= PACKET_IS_DELTA;
+			pos += encode_uint16(baseline->sequence, w + pos);
+			memcpy(w + pos, delta_buffer.ptr(), payload_size);
+		} else {
+			memcpy(w + pos, p_snapshot, payload_size);
+		}
+		pos += payload_size;
+	}
+	w[0] = flags;
+
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	SWC::Result result = networking_messages->send_raw_message_to_peer(w, pos, p_peer, k_nSteamNetworkingSend_UnreliableNoNagle, channel);
+	p_state.ack_pending = false;
+	p_state.bytes_sent += pos;
+
+	if (has_snapshot) {
+		Snapshot &slot = p_state.sent[sequence % SNAPSHOT_RING_SIZE];
+		slot.sequence = sequence;
+		slot.data.resize(p_size);
+		memcpy(slot.data.ptr(), p_snapshot, p_size);
+		p_state.next_sequence++;
+		p_state.snapshot_bytes += p_size;
+		if (is_delta) {
+			p_state.delta_snapshots_sent++;
+		} else {
+			p_state.full_snapshots_sent++;
+		}
+	}
+	return result;
+}
+
+void HBSteamSnapshotReplicator::_receive_packets() {
+	Steamworks::get_singleton()->get_networking_messages()->receive_messages(channel, this, &HBSteamSnapshotReplicator::_receive_packet);
+}
+
+void HBSteamSnapshotReplicator::_receive_packet(int p_peer, const uint8_t *p_data, uint32_t p_size) {
+	if (p_peer == HBSteamNetworkingMessages::INVALID_PEER || p_size == 0) {
+		return;
+	}
+	Peer &state = _get_or_create_peer(p_peer);
+
+	const uint8_t flags = p_data[0];
+	uint32_t header_size = 1;
+	if (flags & PACKET_HAS_ACK) {
+		header_size += sizeof(uint16_t);
+	}
+	if (flags & PACKET_HAS_SNAPSHOT) {
+		header_size += sizeof(uint16_t) + sizeof(uint32_t);
+		if (flags & PACKET_IS_DELTA) {
+			header_size += sizeof(uint16_t);
+		}
+	}
+	ERR_FAIL_COND_MSG(p_size < header_size, "Steamworks: Received a truncated snapshot packet.");
+
+	uint32_t pos = 1;
+	if (flags & PACKET_HAS_ACK) {
+		uint16_t ack = decode_uint16(p_data + pos);
+		pos += sizeof(uint16_t);
+		// Acks for snapshots we never sent or that already left the ring are useless as baselines.
+		const Snapshot &acked = state.sent[ack % SNAPSHOT_RING_SIZE];
+		bool newer = state.acked_sequence == INVALID_SEQUENCE || sequence_newer(ack, state.acked_sequence);
+		if (newer && acked.sequence == ack) {
+			state.acked_sequence = ack;
+		}
+	}
+
+	if (!(flags & PACKET_HAS_SNAPSHOT)) {
+		return;
+	}
+
+	uint16_t sequence = decode_uint16(p_data + pos);
+	pos += sizeof(uint16_t);
+	uint32_t snapshot_size = decode_uint32(p_data + pos);
+	pos += sizeof(uint32_t);
+
+	if (state.received_sequence != INVALID_SEQUENCE && !sequence_newer(sequence, state.received_sequence)) {
+		// Unreliable packets can arrive out of order, only the newest state is interesting.
+		state.stale_snapshots++;
+		return;
+	}
+
+	ERR_FAIL_COND_MSG(snapshot_size == 0 || snapshot_size > MAX_SNAPSHOT_SIZE, "Steamworks: Received a snapshot with an invalid size.");
+	if (!(flags & PACKET_IS_DELTA)) {
+		ERR_FAIL_COND_MSG(p_size - pos != snapshot_size, "Steamworks: Received a truncated snapshot.");
+	}
+
+	if (decode_buffer.size() < snapshot_size) {
+		decode_buffer.resize(snapshot_size);
+	}
+	if (flags & PACKET_IS_DELTA) {
+		uint16_t baseline_sequence = decode_uint16(p_data + pos);
+		pos += sizeof(uint16_t);
+		const Snapshot &baseline = state.received[baseline_sequence % SNAPSHOT_RING_SIZE];
+		if (baseline.sequence != baseline_sequence) {
+			state.missing_baselines++;
+			return;
+		}
+		bool ok = HBDeltaCodec::decode(p_data + pos, p_size - pos, baseline.data.ptr(), baseline.data.size(), decode_buffer.ptr(), snapshot_size);
+		ERR_FAIL_COND_MSG(!ok, "Steamworks: Received a malformed snapshot delta.");
+	} else {
+		memcpy(decode_buffer.ptr(), p_data + pos, snapshot_size);
+	}
+
+	Snapshot &slot = state.received[sequence % SNAPSHOT_RING_SIZE];
+	slot.sequence = sequence;
+	slot.data.resize(snapshot_size);
+	memcpy(slot.data.ptr(), decode_buffer.ptr(), snapshot_size);
+
+	state.received_sequence = sequence;
+	state.ack_pending = true;
+	state.snapshots_received++;
+
+	PackedByteArray snapshot;
+	snapshot.resize(snapshot_size);
+	memcpy(snapshot.ptrw(), slot.data.ptr(), snapshot_size);
+	emit_signal("snapshot_received", p_peer, sequence, snapshot);
+}
+
+void HBSteamSnapshotReplicator::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("send_snapshot", "snapshot"), &HBSteamSnapshotReplicator::send_snapshot);
+	ClassDB::bind_method(D_METHOD("send_snapshot_to_peer", "peer", "snapshot"), &HBSteamSnapshotReplicator::send_snapshot_to_peer);
+	ClassDB::bind_method(D_METHOD("poll"), &HBSteamSnapshotReplicator::poll);
+	ClassDB::bind_method(D_METHOD("reset_peer", "peer"), &HBSteamSnapshotReplicator::reset_peer);
+	ClassDB::bind_method(D_METHOD("get_peers"), &HBSteamSnapshotReplicator::get_peers);
+	ClassDB::bind_method(D_METHOD("get_peer_acked_sequence", "peer"), &HBSteamSnapshotReplicator::get_peer_acked_sequence);
+	ClassDB::bind_method(D_METHOD("get_latest_snapshot", "peer"), &HBSteamSnapshotReplicator::get_latest_snapshot);
+	ClassDB::bind_method(D_METHOD("get_peer_stats", "peer"), &HBSteamSnapshotReplicator::get_peer_stats);
+	ClassDB::bind_method(D_METHOD("get_peer_group"), &HBSteamSnapshotReplicator::get_peer_group);
+	ClassDB::bind_method(D_METHOD("get_channel"), &HBSteamSnapshotReplicator::get_channel);
+
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "peer_group", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamPeerGroup"), "", "get_peer_group");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "channel"), "", "get_channel");
+
+	ADD_SIGNAL(MethodInfo("snapshot_received", PropertyInfo(Variant::INT, "peer"), PropertyInfo(Variant::INT, "sequence"), PropertyInfo(Variant::PACKED_BYTE_ARRAY, "snapshot")));
+}
+
+SWC::Result HBSteamSnapshotReplicator::send_snapshot(const PackedByteArray &p_snapshot) {
+	ERR_FAIL_COND_V(!peer_group.is_valid(), SWC::RESULT_FAIL);
+	SWC::Result result = SWC::RESULT_OK;
+	for (int peer : peer_group->get_peer_list()) {
+		SWC::Result peer_result = send_raw_snapshot_to_peer(peer, p_snapshot.ptr(), p_snapshot.size());
+		if (peer_result != SWC::RESULT_OK) {
+			result = peer_result;
+		}
+	}
+	return result;
+}
+
+SWC::Result HBSteamSnapshotReplicator::send_snapshot_to_peer(int p_peer, const PackedByteArray &p_snapshot) {
+	return send_raw_snapshot_to_peer(p_peer, p_snapshot.ptr(), p_snapshot.size());
+}
+
+SWC::Result HBSteamSnapshotReplicator::send_raw_snapshot_to_peer(int p_peer, const uint8_t *p_snapshot, uint32_t p_size) {
+	ERR_FAIL_COND_V(p_peer == HBSteamNetworkingMessages::INVALID_PEER, SWC::RESULT_FAIL);
+	ERR_FAIL_COND_V(p_size == 0, SWC::RESULT_FAIL);
+	ERR_FAIL_COND_V_MSG(p_size > MAX_SNAPSHOT_SIZE, SWC::RESULT_FAIL, vformat("Steamworks: Snapshot is %d bytes, which is more than a message can hold (%d bytes).", p_size, MAX_SNAPSHOT_SIZE));
+	return _send_packet(p_peer, _get_or_create_peer(p_peer), p_snapshot, p_size);
+}
+
+void HBSteamSnapshotReplicator::poll() {
+	// Acks normally ride along with our own snapshots, peers we didn't send anything
+	// to since the last poll get a standalone ack instead.
+	for (KeyValue<int, Peer> &kv : peers) {
+		if (kv.value.ack_pending) {
+			_send_packet(kv.key, kv.value, nullptr, 0);
+		}
+	}
+	_receive_packets();
+}
+
+void HBSteamSnapshotReplicator::reset_peer(int p_peer) {
+	peers.erase(p_peer);
+}
+
+PackedInt32Array HBSteamSnapshotReplicator::get_peers() const {
+	PackedInt32Array out;
+	for (const KeyValue<int, Peer> &kv : peers) {
+		out.push_back(kv.key);
+	}
+	return out;
+}
+
+int HBSteamSnapshotReplicator::get_peer_acked_sequence(int p_peer) const {
+	const Peer *peer = peers.getptr(p_peer);
+	if (!peer || peer->acked_sequence == INVALID_SEQUENCE) {
+		return -1;
+	}
+	return peer->acked_sequence;
+}
+
+PackedByteArray HBSteamSnapshotReplicator::get_latest_snapshot(int p_peer) const {
+	PackedByteArray out;
+	const Peer *peer = peers.getptr(p_peer);
+	if (!peer || peer->received_sequence == INVALID_SEQUENCE) {
+		return out;
+	}
+	const Snapshot &snapshot = peer->received[peer->received_sequence % SNAPSHOT_RING_SIZE];
+	out.resize(snapshot.data.size());
+	memcpy(out.ptrw(), snapshot.data.ptr(), snapshot.data.size());
+	return out;
+}
+
+Dictionary HBSteamSnapshotReplicator::get_peer_stats(int p_peer) const {
+	const Peer *peer = peers.getptr(p_peer);
+	ERR_FAIL_NULL_V_MSG(peer, Dictionary(), vformat("Peer %d has no replication state.", p_peer));
+	Dictionary stats;
+	stats["full_snapshots_sent"] = peer->full_snapshots_sent;
+	stats["delta_snapshots_sent"] = peer->delta_snapshots_sent;
+	stats["snapshot_bytes"] = peer->snapshot_bytes;
+	stats["bytes_sent"] = peer->bytes_sent;
+	stats["snapshots_received"] = peer->snapshots_received;
+	stats["stale_snapshots"] = peer->stale_snapshots;
+	stats["missing_baselines"] = peer->missing_baselines;
+	stats["acked_sequence"] = get_peer_acked_sequence(p_peer);
+	stats["received_sequence"] = peer->received_sequence == INVALID_SEQUENCE ? -1 : (int)peer->received_sequence;
+	return stats;
+}
+
+Ref<HBSteamPeerGroup> HBSteamSnapshotReplicator::get_peer_group() const {
+	return peer_group;
+}
+
+int HBSteamSnapshotReplicator::get_channel() const {
+	return channel;
+}
+
+HBSteamSnapshotReplicator::HBSteamSnapshotReplicator(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel) {
+	peer_group = p_peer_group;
+	channel = p_channel;
+	Steamworks::get_singleton()->get_networking_messages()->connect("peer_released", callable_mp(this, &HBSteamSnapshotReplicator::reset_peer));
+}
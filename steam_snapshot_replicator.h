@@ -0,0 +1,118 @@
+/**************************************************************************/
+/*  steam_snapshot_replicator.h                                           */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_SNAPSHOT_REPLICATOR_H
+#define STEAM_SNAPSHOT_REPLICATOR_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/local_vector.h"
+#include "steamworks_constants.gen.h"
+
+class HBSteamPeerGroup;
+
+class HBSteamSnapshotReplicator : public RefCounted {
+	GDCLASS(HBSteamSnapshotReplicator, RefCounted);
+
+	static const int SNAPSHOT_RING_SIZE = 32;
+	static const int MAX_HEADER_SIZE = 11;
+	// Largest snapshot that fits in a single Steam message along with the header, also bounds
+	// decoded snapshots so a bogus size in a packet can't make us allocate whatever it says.
+	static const uint32_t MAX_SNAPSHOT_SIZE;
+	static const uint32_t INVALID_SEQUENCE = UINT32_MAX;
+
+	enum PacketFlags {
+		PACKET_HAS_ACK = 1 << 0,
+		PACKET_HAS_SNAPSHOT = 1 << 1,
+		PACKET_IS_DELTA = 1 << 2,
+	};
+
+	struct Snapshot {
+		uint32_t sequence = INVALID_SEQUENCE;
+		LocalVector<uint8_t> data;
+	};
+
+	struct Peer {
+		// Indexed by sequence, slots keep their capacity so the rings stop allocating
+		// once every slot has held a snapshot.
+		Snapshot sent[SNAPSHOT_RING_SIZE];
+		Snapshot received[SNAPSHOT_RING_SIZE];
+
+		uint16_t next_sequence = 0;
+		// Newest of our snapshots the peer has acknowledged, this is the delta baseline.
+		uint32_t acked_sequence = INVALID_SEQUENCE;
+		// Newest snapshot received from the peer, sent back as the ack.
+		uint32_t received_sequence = INVALID_SEQUENCE;
+		bool ack_pending = false;
+
+		uint64_t full_snapshots_sent = 0;
+		uint64_t delta_snapshots_sent = 0;
+		uint64_t snapshot_bytes = 0;
+		uint64_t bytes_sent = 0;
+		uint64_t snapshots_received = 0;
+		uint64_t stale_snapshots = 0;
+		uint64_t missing_baselines = 0;
+	};
+	HashMap<int, Peer> peers;
+
+	Ref<HBSteamPeerGroup> peer_group;
+	int channel = 0;
+
+	LocalVector<uint8_t> packet_buffer;
+	LocalVector<uint8_t> delta_buffer;
+	LocalVector<uint8_t> decode_buffer;
+
+	Peer &_get_or_create_peer(int p_peer);
+	SWC::Result _send_packet(int p_peer, Peer &p_state, const uint8_t *p_snapshot, uint32_t p_size);
+	void _receive_packets();
+	void _receive_packet(int p_peer, const uint8_t *p_data, uint32_t p_size);
+
+protected:
+	static void _bind_methods();
+
+public:
+	SWC::Result send_snapshot(const PackedByteArray &p_snapshot);
+	SWC::Result send_snapshot_to_peer(int p_peer, const PackedByteArray &p_snapshot);
+	SWC::Result send_raw_snapshot_to_peer(int p_peer, const uint8_t *p_snapshot, uint32_t p_size);
+
+	void poll();
+
+	void reset_peer(int p_peer);
+	PackedInt32Array get_peers() const;
+	int get_peer_acked_sequence(int p_peer) const;
+	PackedByteArray get_latest_snapshot(int p_peer) const;
+	Dictionary get_peer_stats(int p_peer) const;
+
+	Ref<HBSteamPeerGroup> get_peer_group() const;
+	int get_channel() const;
+
+	HBSteamSnapshotReplicator(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel);
+};
+
+#endif // STEAM_SNAPSHOT_REPLICATOR_H
@@ -30,6 +30,7 @@
 
 #include "steam_user.h"
 #include "steam/steam_api_flat.h"
+#include "steam_voice.h"
 #include "steamworks.h"
 
 void HBAuthTicketForWebAPI::_on_get_ticket(Ref<SteamworksCallbackData> p_callback) {
@@ -59,6 +60,7 @@ HBAuthTicketForWebAPI::HBAuthTicketForWebAPI(SWC::HAuthTicket p_ticket) {
 void HBSteamUser::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_auth_ticket_for_web_api", "identity"), &HBSteamUser::get_auth_ticket_for_web_api);
 	ClassDB::bind_method(D_METHOD("get_local_user"), &HBSteamUser::get_local_user);
+	ClassDB::bind_method(D_METHOD("create_voice_chat", "peer_group", "channel"), &HBSteamUser::create_voice_chat);
 }
 
 Ref<HBAuthTicketForWebAPI> HBSteamUser::get_auth_ticket_for_web_api(const String &p_identity) const {
@@ -79,4 +81,8 @@ bool HBSteamUser::is_valid() const {
 
 Ref<HBSteamFriend> HBSteamUser::get_local_user() const {
 	return HBSteamFriend::from_steam_id(SteamAPI_ISteamUser_GetSteamID(steam_user));
-}
\ No newline at end of file
+}
+Ref<HBSteamVoiceChat> HBSteamUser::create_voice_chat(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel) {
+	ERR_FAIL_COND_V_MSG(!p_peer_group.is_valid(), Ref<HBSteamVoiceChat>(), "Voice chat needs a valid peer group to send voice to.");
+	return memnew(HBSteamVoiceChat(p_peer_group, p_channel));
+}
@@ -38,6 +38,8 @@
 
 class ISteamUser;
 class HBSteamUser;
+class HBSteamPeerGroup;
+class HBSteamVoiceChat;
 
 class HBAuthTicketForWebAPI : public RefCounted {
 	GDCLASS(HBAuthTicketForWebAPI, RefCounted);
@@ -66,6 +68,7 @@ public:
 	void init_interface();
 	bool is_valid() const;
 	Ref<HBSteamFriend> get_local_user() const;
+	Ref<HBSteamVoiceChat> create_voice_chat(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel);
 };
 
 #endif // STEAM_USER_H
@@ -51,6 +51,8 @@ void HBSteamUtils::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("is_on_steam_deck"), &HBSteamUtils::is_on_steam_deck);
 	ClassDB::bind_method(D_METHOD("show_gamepad_text_input", "input_mode", "line_input_mode", "description", "existing_text", "max_text"), &HBSteamUtils::show_gamepad_text_input);
 	ClassDB::bind_method(D_METHOD("show_floating_gamepad_text_input", "input_mode", "text_field_rect"), &HBSteamUtils::show_floating_gamepad_text_input);
+	ClassDB::bind_method(D_METHOD("get_image_cache"), &HBSteamUtils::get_image_cache);
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "image_cache", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamImageCache"), "", "get_image_cache");
 	ADD_SIGNAL(MethodInfo("gamepad_text_input_dismissed", PropertyInfo(Variant::BOOL, "submitted"), PropertyInfo(Variant::STRING, "text")));
 	ADD_SIGNAL(MethodInfo("floating_gamepad_text_input_dismissed"));
 }
@@ -83,9 +85,17 @@ bool HBSteamUtils::show_floating_gamepad_text_input(SWC::FloatingGamepadTextInpu
 			p_text_field_rect.size.y);
 }
 
-void HBSteamUtils::init_interface() {
-	steam_utils = SteamAPI_SteamUtils();
+void HBSteamUtils::init_interface(bool p_game_server) {
+	steam_utils = p_game_server ? SteamAPI_SteamGameServerUtils() : SteamAPI_SteamUtils();
 	SW_ERR_FAIL_COND_MSG(steam_utils == nullptr, "Steamworks: Failed to initialize Steam Utils, something catastrophic must have happened");
+	if (!p_game_server) {
+		// Game servers have no friends or achievements to show images of.
+		image_cache.instantiate();
+	}
+}
+
+Ref<HBSteamImageCache> HBSteamUtils::get_image_cache() const {
+	return image_cache;
 }
 
 ISteamUtils *HBSteamUtils::get_interface() {
@@ -32,6 +32,7 @@
 #define STEAM_UTILS_H
 
 #include "core/object/ref_counted.h"
+#include "steam_image_cache.h"
 #include "steamworks_callback_data.h"
 #include "steamworks_constants.gen.h"
 
@@ -42,6 +43,7 @@ class HBSteamUtils : public RefCounted {
 
 private:
 	ISteamUtils *steam_utils = nullptr;
+	Ref<HBSteamImageCache> image_cache;
 	void _on_gamepad_text_input_dismissed(Ref<SteamworksCallbackData> p_callback);
 	void _on_floating_gamepad_text_input_dismissed(Ref<SteamworksCallbackData> p_callback);
 
@@ -53,7 +55,8 @@ public:
 	bool is_on_steam_deck() const;
 	bool show_gamepad_text_input(SWC::GamepadTextInputMode p_input_mode, SWC::GamepadTextInputLineMode p_line_input_mode, String p_description, String p_existing_text, uint32_t p_max_text) const;
 	bool show_floating_gamepad_text_input(SWC::FloatingGamepadTextInputMode p_input_mode, Rect2i p_text_field_rect) const;
-	void init_interface();
+	Ref<HBSteamImageCache> get_image_cache() const;
+	void init_interface(bool p_game_server = false);
 	ISteamUtils *get_interface();
 	bool is_valid() const;
 	HBSteamUtils();
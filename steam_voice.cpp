@@ -0,0 +1,380 @@
+/**************************************************************************/
+/*  steam_voice.cpp                                                       */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "steam_voice.h"
+
+#include "core/io/marshalls.h"
+#include "core/os/os.h"
+#include "steam/steam_api_flat.h"
+#include "steamworks.h"
+
+void HBSteamVoiceChat::_capture_thread_func(void *p_userdata) {
+	HBSteamVoiceChat *voice_chat = (HBSteamVoiceChat *)p_userdata;
+	while (!voice_chat->capture_exit.is_set()) {
+		voice_chat->_capture();
+		OS::get_singleton()->delay_usec(CAPTURE_POLL_INTERVAL_USEC);
+	}
+}
+
+void HBSteamVoiceChat::_capture() {
+	ISteamUser *steam_user = SteamAPI_SteamUser();
+	uint32_t compressed_size = 0;
+	EVoiceResult result = SteamAPI_ISteamUser_GetAvailableVoice(steam_user, &compressed_size, nullptr, 0);
+	if (result != k_EVoiceResultOK || compressed_size == 0) {
+		return;
+	}
+
+	uint8_t buffer[MAX_COMPRESSED_FRAME_SIZE];
+	uint32_t bytes_written = 0;
+	result = SteamAPI_ISteamUser_GetVoice(steam_user, true, buffer, sizeof(buffer), &bytes_written, false, nullptr, 0, nullptr, 0);
+	if (result != k_EVoiceResultOK || bytes_written == 0) {
+		return;
+	}
+
+	MutexLock lock(capture_mutex);
+	if (capture_queue_count == CAPTURE_QUEUE_SIZE) {
+		// The main thread isn't keeping up, old voice is useless so drop it.
+		capture_queue_read = (capture_queue_read + 1) % CAPTURE_QUEUE_SIZE;
+		capture_queue_count--;
+		capture_overflows++;
+	}
+	CapturedFrame &frame = capture_queue[(capture_queue_read + capture_queue_count) % CAPTURE_QUEUE_SIZE];
+	encode_uint16(capture_sequence++, frame.data);
+	memcpy(frame.data + sizeof(uint16_t), buffer, bytes_written);
+	frame.size = bytes_written + sizeof(uint16_t);
+	capture_queue_count++;
+}
+
+void HBSteamVoiceChat::_send_captured_frames() {
+	MutexLock lock(capture_mutex);
+	while (capture_queue_count > 0) {
+		const CapturedFrame &frame = capture_queue[capture_queue_read];
+		if (peer_group.is_valid()) {
+			peer_group->send_raw_to_group(frame.data, frame.size, k_nSteamNetworkingSend_UnreliableNoDelay, channel);
+		}
+		capture_queue_read = (capture_queue_read + 1) % CAPTURE_QUEUE_SIZE;
+		capture_queue_count--;
+	}
+}
+
+void HBSteamVoiceChat::_receive_frames() {
+	Steamworks::get_singleton()->get_networking_messages()->receive_messages(channel, this, &HBSteamVoiceChat::_receive_frame);
+}
+
+void HBSteamVoiceChat::_receive_frame(int p_peer, const uint8_t *p_data, uint32_t p_size) {
+	if (p_peer == HBSteamNetworkingMessages::INVALID_PEER || p_size <= sizeof(uint16_t)) {
+		return;
+	}
+	Speaker &speaker = _get_or_create_speaker(p_peer);
+
+	uint16_t sequence = decode_uint16(p_data);
+	if (speaker.has_sequence && (int16_t)(sequence - speaker.last_sequence) <= 0) {
+		// Duplicated or reordered behind a frame we already played.
+		speaker.late_frames++;
+		return;
+	}
+	speaker.has_sequence = true;
+	speaker.last_sequence = sequence;
+
+	uint32_t bytes_written = 0;
+	EVoiceResult result = SteamAPI_ISteamUser_DecompressVoice(SteamAPI_SteamUser(), p_data + sizeof(uint16_t), p_size - sizeof(uint16_t), decompress_buffer.ptr(), decompress_buffer.size(), &bytes_written, sample_rate);
+	ERR_FAIL_COND_MSG(result != k_EVoiceResultOK, vformat("Steamworks: Failed to decompress voice data, error %d.", result));
+
+	push_speaker_samples(p_peer, (const int16_t *)decompress_buffer.ptr(), bytes_written / sizeof(int16_t));
+}
+
+void HBSteamVoiceChat::push_speaker_samples(int p_peer, const int16_t *p_samples, uint32_t p_count) {
+	ERR_FAIL_COND(p_peer == HBSteamNetworkingMessages::INVALID_PEER);
+	Speaker &speaker = _get_or_create_speaker(p_peer);
+
+	// Interarrival jitter, the same estimator RTP uses (RFC 3550, section 6.4.1).
+	uint64_t now = OS::get_singleton()->get_ticks_usec();
+	if (speaker.last_arrival_usec != 0) {
+		double expected_usec = speaker.last_frame_samples * 1000000.0 / sample_rate;
+		double deviation = Math::abs((double)(now - speaker.last_arrival_usec) - expected_usec);
+		speaker.jitter_usec += (deviation - speaker.jitter_usec) / 16.0;
+	}
+	speaker.last_arrival_usec = now;
+	speaker.last_frame_samples = p_count;
+	_update_target(speaker);
+
+	const uint32_t capacity = speaker.samples.size();
+	for (uint32_t i = 0; i < p_count; i++) {
+		if (speaker.buffered == capacity) {
+			speaker.read_pos = (speaker.read_pos + 1) % capacity;
+			speaker.buffered--;
+			speaker.dropped_samples++;
+		}
+		speaker.samples[(speaker.read_pos + speaker.buffered) % capacity] = p_samples[i];
+		speaker.buffered++;
+	}
+
+	// Don't let latency pile up after a stall, skip ahead to the target delay.
+	const uint32_t max_samples = max_jitter_buffer_ms * sample_rate / 1000;
+	if (speaker.buffered > max_samples) {
+		uint32_t skip = speaker.buffered - speaker.target_samples;
+		speaker.read_pos = (speaker.read_pos + skip) % capacity;
+		speaker.buffered -= skip;
+		speaker.dropped_samples += skip;
+	}
+}
+
+void HBSteamVoiceChat::_play_speaker(Speaker &p_speaker) {
+	const uint32_t capacity = p_speaker.samples.size();
+	if (!p_speaker.playback.is_valid()) {
+		// Nowhere to play it, discard so it doesn't come out late once a playback is set.
+		p_speaker.read_pos = (p_speaker.read_pos + p_speaker.buffered) % capacity;
+		p_speaker.buffered = 0;
+		p_speaker.buffering = true;
+		return;
+	}
+
+	int64_t skips = p_speaker.playback->get_skips();
+	if (skips > p_speaker.last_skips) {
+		// The generator also skips while nobody is talking, only count it as an
+		// underrun if we were playing and the speaker is still sending us voice.
+		const uint64_t recent_usec = (uint64_t)max_jitter_buffer_ms * 1000;
+		if (!p_speaker.buffering && OS::get_singleton()->get_ticks_usec() - p_speaker.last_arrival_usec < recent_usec) {
+			p_speaker.underruns++;
+		}
+		p_speaker.buffering = true;
+		p_speaker.last_skips = skips;
+	}
+
+	if (p_speaker.buffering) {
+		if (p_speaker.buffered < p_speaker.target_samples) {
+			return;
+		}
+		p_speaker.buffering = false;
+	}
+
+	// Only keep the generator fed up to the target delay, the rest waits in our ring buffer
+	// so we can skip ahead if latency builds up.
+	int frames_available = p_speaker.playback->get_frames_available();
+	p_speaker.playback_capacity = MAX(p_speaker.playback_capacity, (uint32_t)frames_available);
+	uint32_t queued = p_speaker.playback_capacity - frames_available;
+	if (queued >= p_speaker.target_samples) {
+		return;
+	}
+	uint32_t to_push = MIN(p_speaker.buffered, MIN(p_speaker.target_samples - queued, (uint32_t)frames_available));
+	if (to_push == 0) {
+		return;
+	}
+	// One push per block, push_frame goes through the generator's ring buffer checks for every sample.
+	playback_frames.resize(to_push);
+	Vector2 *frames_w = playback_frames.ptrw();
+	for (uint32_t i = 0; i < to_push; i++) {
+		float sample = p_speaker.samples[p_speaker.read_pos] / 32768.0f;
+		frames_w[i] = Vector2(sample, sample);
+		p_speaker.read_pos = (p_speaker.read_pos + 1) % capacity;
+	}
+	p_speaker.playback->push_buffer(playback_frames);
+	p_speaker.buffered -= to_push;
+}
+
+HBSteamVoiceChat::Speaker &HBSteamVoiceChat::_get_or_create_speaker(int p_peer) {
+	if (Speaker *speaker = speakers.getptr(p_peer)) {
+		return *speaker;
+	}
+	Speaker &speaker = speakers.insert(p_peer, Speaker())->value;
+	speaker.samples.resize(sample_rate * JITTER_BUFFER_SECONDS);
+	_update_target(speaker);
+	emit_signal("speaker_added", p_peer);
+	return speaker;
+}
+
+void HBSteamVoiceChat::_update_target(Speaker &p_speaker) const {
+	// Cover about three times the measured jitter plus one frame of audio.
+	double frame_ms = p_speaker.last_frame_samples * 1000.0 / sample_rate;
+	double target_ms = CLAMP(p_speaker.jitter_usec * 3.0 / 1000.0 + frame_ms, min_jitter_buffer_ms, max_jitter_buffer_ms);
+	p_speaker.target_samples = target_ms * sample_rate / 1000.0;
+}
+
+void HBSteamVoiceChat::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("start_recording"), &HBSteamVoiceChat::start_recording);
+	ClassDB::bind_method(D_METHOD("stop_recording"), &HBSteamVoiceChat::stop_recording);
+	ClassDB::bind_method(D_METHOD("is_recording"), &HBSteamVoiceChat::is_recording);
+	ClassDB::bind_method(D_METHOD("poll"), &HBSteamVoiceChat::poll);
+	ClassDB::bind_method(D_METHOD("set_speaker_playback", "peer", "playback"), &HBSteamVoiceChat::set_speaker_playback);
+	ClassDB::bind_method(D_METHOD("remove_speaker", "peer"), &HBSteamVoiceChat::remove_speaker);
+	ClassDB::bind_method(D_METHOD("get_speakers"), &HBSteamVoiceChat::get_speakers);
+	ClassDB::bind_method(D_METHOD("get_speaker_latency_ms", "peer"), &HBSteamVoiceChat::get_speaker_latency_ms);
+	ClassDB::bind_method(D_METHOD("get_speaker_underrun_count", "peer"), &HBSteamVoiceChat::get_speaker_underrun_count);
+	ClassDB::bind_method(D_METHOD("get_speaker_stats", "peer"), &HBSteamVoiceChat::get_speaker_stats);
+	ClassDB::bind_method(D_METHOD("set_sample_rate", "sample_rate"), &HBSteamVoiceChat::set_sample_rate);
+	ClassDB::bind_method(D_METHOD("get_sample_rate"), &HBSteamVoiceChat::get_sample_rate);
+	ClassDB::bind_method(D_METHOD("set_min_jitter_buffer_ms", "min_jitter_buffer_ms"), &HBSteamVoiceChat::set_min_jitter_buffer_ms);
+	ClassDB::bind_method(D_METHOD("get_min_jitter_buffer_ms"), &HBSteamVoiceChat::get_min_jitter_buffer_ms);
+	ClassDB::bind_method(D_METHOD("set_max_jitter_buffer_ms", "max_jitter_buffer_ms"), &HBSteamVoiceChat::set_max_jitter_buffer_ms);
+	ClassDB::bind_method(D_METHOD("get_max_jitter_buffer_ms"), &HBSteamVoiceChat::get_max_jitter_buffer_ms);
+	ClassDB::bind_method(D_METHOD("get_peer_group"), &HBSteamVoiceChat::get_peer_group);
+	ClassDB::bind_method(D_METHOD("get_channel"), &HBSteamVoiceChat::get_channel);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "sample_rate"), "set_sample_rate", "get_sample_rate");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "min_jitter_buffer_ms"), "set_min_jitter_buffer_ms", "get_min_jitter_buffer_ms");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_jitter_buffer_ms"), "set_max_jitter_buffer_ms", "get_max_jitter_buffer_ms");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "peer_group", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamPeerGroup"), "", "get_peer_group");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "channel"), "", "get_channel");
+
+	ADD_SIGNAL(MethodInfo("speaker_added", PropertyInfo(Variant::INT, "peer")));
+}
+
+void HBSteamVoiceChat::start_recording() {
+	ERR_FAIL_COND_MSG(capture_thread.is_started(), "Voice recording has already been started.");
+	SteamAPI_ISteamUser_StartVoiceRecording(SteamAPI_SteamUser());
+	capture_exit.clear();
+	capture_thread.start(&HBSteamVoiceChat::_capture_thread_func, this);
+}
+
+void HBSteamVoiceChat::stop_recording() {
+	if (!capture_thread.is_started()) {
+		return;
+	}
+	SteamAPI_ISteamUser_StopVoiceRecording(SteamAPI_SteamUser());
+	capture_exit.set();
+	capture_thread.wait_to_finish();
+}
+
+bool HBSteamVoiceChat::is_recording() const {
+	return capture_thread.is_started();
+}
+
+void HBSteamVoiceChat::poll() {
+	_send_captured_frames();
+	_receive_frames();
+	for (KeyValue<int, Speaker> &kv : speakers) {
+		_play_speaker(kv.value);
+	}
+}
+
+void HBSteamVoiceChat::set_speaker_playback(int p_peer, const Ref<AudioStreamGeneratorPlayback> &p_playback) {
+	ERR_FAIL_COND(p_peer == HBSteamNetworkingMessages::INVALID_PEER);
+	Speaker &speaker = _get_or_create_speaker(p_peer);
+	speaker.playback = p_playback;
+	speaker.playback_capacity = 0;
+	speaker.last_skips = p_playback.is_valid() ? p_playback->get_skips() : 0;
+	speaker.buffering = true;
+}
+
+void HBSteamVoiceChat::remove_speaker(int p_peer) {
+	speakers.erase(p_peer);
+}
+
+PackedInt32Array HBSteamVoiceChat::get_speakers() const {
+	PackedInt32Array out;
+	for (const KeyValue<int, Speaker> &kv : speakers) {
+		out.push_back(kv.key);
+	}
+	return out;
+}
+
+float HBSteamVoiceChat::get_speaker_latency_ms(int p_peer) const {
+	const Speaker *speaker = speakers.getptr(p_peer);
+	ERR_FAIL_NULL_V_MSG(speaker, 0.0f, vformat("Peer %d is not a speaker in this voice chat.", p_peer));
+	uint32_t queued = 0;
+	if (speaker->playback.is_valid()) {
+		queued = speaker->playback_capacity - MIN(speaker->playback_capacity, (uint32_t)speaker->playback->get_frames_available());
+	}
+	return (queued + speaker->buffered) * 1000.0f / sample_rate;
+}
+
+int HBSteamVoiceChat::get_speaker_underrun_count(int p_peer) const {
+	const Speaker *speaker = speakers.getptr(p_peer);
+	ERR_FAIL_NULL_V_MSG(speaker, 0, vformat("Peer %d is not a speaker in this voice chat.", p_peer));
+	return speaker->underruns;
+}
+
+Dictionary HBSteamVoiceChat::get_speaker_stats(int p_peer) const {
+	const Speaker *speaker = speakers.getptr(p_peer);
+	ERR_FAIL_NULL_V_MSG(speaker, Dictionary(), vformat("Peer %d is not a speaker in this voice chat.", p_peer));
+	Dictionary stats;
+	stats["latency_ms"] = get_speaker_latency_ms(p_peer);
+	stats["target_ms"] = speaker->target_samples * 1000.0f / sample_rate;
+	stats["jitter_ms"] = speaker->jitter_usec / 1000.0;
+	stats["underruns"] = speaker->underruns;
+	stats["late_frames"] = speaker->late_frames;
+	stats["dropped_samples"] = speaker->dropped_samples;
+	return stats;
+}
+
+void HBSteamVoiceChat::set_sample_rate(int p_sample_rate) {
+	// Valid range for DecompressVoice.
+	ERR_FAIL_COND_MSG(p_sample_rate < 11025 || p_sample_rate > 48000, "Voice sample rate must be between 11025 and 48000 Hz.");
+	sample_rate = p_sample_rate;
+	for (KeyValue<int, Speaker> &kv : speakers) {
+		kv.value.samples.resize(sample_rate * JITTER_BUFFER_SECONDS);
+		kv.value.read_pos = 0;
+		kv.value.buffered = 0;
+		kv.value.buffering = true;
+		_update_target(kv.value);
+	}
+}
+
+int HBSteamVoiceChat::get_sample_rate() const {
+	return sample_rate;
+}
+
+void HBSteamVoiceChat::set_min_jitter_buffer_ms(int p_min_jitter_buffer_ms) {
+	ERR_FAIL_COND(p_min_jitter_buffer_ms < 0 || p_min_jitter_buffer_ms > max_jitter_buffer_ms);
+	min_jitter_buffer_ms = p_min_jitter_buffer_ms;
+}
+
+int HBSteamVoiceChat::get_min_jitter_buffer_ms() const {
+	return min_jitter_buffer_ms;
+}
+
+void HBSteamVoiceChat::set_max_jitter_buffer_ms(int p_max_jitter_buffer_ms) {
+	ERR_FAIL_COND(p_max_jitter_buffer_ms < min_jitter_buffer_ms || p_max_jitter_buffer_ms > JITTER_BUFFER_SECONDS * 1000);
+	max_jitter_buffer_ms = p_max_jitter_buffer_ms;
+}
+
+int HBSteamVoiceChat::get_max_jitter_buffer_ms() const {
+	return max_jitter_buffer_ms;
+}
+
+Ref<HBSteamPeerGroup> HBSteamVoiceChat::get_peer_group() const {
+	return peer_group;
+}
+
+int HBSteamVoiceChat::get_channel() const {
+	return channel;
+}
+
+HBSteamVoiceChat::HBSteamVoiceChat(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel) {
+	peer_group = p_peer_group;
+	channel = p_channel;
+	capture_queue.resize(CAPTURE_QUEUE_SIZE);
+	decompress_buffer.resize(DECOMPRESS_BUFFER_SIZE);
+	Steamworks::get_singleton()->get_networking_messages()->connect("peer_released", callable_mp(this, &HBSteamVoiceChat::remove_speaker));
+}
+
+HBSteamVoiceChat::~HBSteamVoiceChat() {
+	stop_recording();
+}
@@ -0,0 +1,139 @@
+/**************************************************************************/
+/*  steam_voice.h                                                         */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef STEAM_VOICE_H
+#define STEAM_VOICE_H
+
+#include "core/object/ref_counted.h"
+#include "core/os/mutex.h"
+#include "core/os/thread.h"
+#include "core/templates/local_vector.h"
+#include "core/templates/safe_refcount.h"
+#include "servers/audio/effects/audio_stream_generator.h"
+
+class HBSteamPeerGroup;
+
+class HBSteamVoiceChat : public RefCounted {
+	GDCLASS(HBSteamVoiceChat, RefCounted);
+
+	static const int MAX_COMPRESSED_FRAME_SIZE = 8192;
+	static const int CAPTURE_QUEUE_SIZE = 16;
+	static const int DECOMPRESS_BUFFER_SIZE = 65536;
+	static const int JITTER_BUFFER_SECONDS = 1;
+	static const int CAPTURE_POLL_INTERVAL_USEC = 10000;
+
+	// Compressed frames written by the capture thread and sent from poll().
+	struct CapturedFrame {
+		uint8_t data[MAX_COMPRESSED_FRAME_SIZE + sizeof(uint16_t)];
+		uint32_t size = 0;
+	};
+	LocalVector<CapturedFrame> capture_queue;
+	uint32_t capture_queue_read = 0;
+	uint32_t capture_queue_count = 0;
+	uint64_t capture_overflows = 0;
+	uint16_t capture_sequence = 0;
+	Mutex capture_mutex;
+	Thread capture_thread;
+	SafeFlag capture_exit;
+
+	struct Speaker {
+		Ref<AudioStreamGeneratorPlayback> playback;
+		// Ring buffer of decompressed mono samples.
+		LocalVector<int16_t> samples;
+		uint32_t read_pos = 0;
+		uint32_t buffered = 0;
+
+		bool has_sequence = false;
+		uint16_t last_sequence = 0;
+		bool buffering = true;
+		uint32_t playback_capacity = 0;
+		int64_t last_skips = 0;
+		uint64_t last_arrival_usec = 0;
+		uint32_t last_frame_samples = 0;
+		double jitter_usec = 0.0;
+		uint32_t target_samples = 0;
+
+		uint64_t underruns = 0;
+		uint64_t late_frames = 0;
+		uint64_t dropped_samples = 0;
+	};
+	HashMap<int, Speaker> speakers;
+
+	Ref<HBSteamPeerGroup> peer_group;
+	int channel = 0;
+	int sample_rate = 44100;
+	int min_jitter_buffer_ms = 40;
+	int max_jitter_buffer_ms = 300;
+
+	LocalVector<uint8_t> decompress_buffer;
+	// Reused for every push to a generator, so playback doesn't allocate once it's warmed up.
+	PackedVector2Array playback_frames;
+
+	static void _capture_thread_func(void *p_userdata);
+	void _capture();
+	void _send_captured_frames();
+	void _receive_frames();
+	void _receive_frame(int p_peer, const uint8_t *p_data, uint32_t p_size);
+	void _play_speaker(Speaker &p_speaker);
+	Speaker &_get_or_create_speaker(int p_peer);
+	void _update_target(Speaker &p_speaker) const;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void start_recording();
+	void stop_recording();
+	bool is_recording() const;
+
+	void poll();
+
+	void set_speaker_playback(int p_peer, const Ref<AudioStreamGeneratorPlayback> &p_playback);
+	void push_speaker_samples(int p_peer, const int16_t *p_samples, uint32_t p_count);
+	void remove_speaker(int p_peer);
+	PackedInt32Array get_speakers() const;
+	float get_speaker_latency_ms(int p_peer) const;
+	int get_speaker_underrun_count(int p_peer) const;
+	Dictionary get_speaker_stats(int p_peer) const;
+
+	void set_sample_rate(int p_sample_rate);
+	int get_sample_rate() const;
+	void set_min_jitter_buffer_ms(int p_min_jitter_buffer_ms);
+	int get_min_jitter_buffer_ms() const;
+	void set_max_jitter_buffer_ms(int p_max_jitter_buffer_ms);
+	int get_max_jitter_buffer_ms() const;
+	Ref<HBSteamPeerGroup> get_peer_group() const;
+	int get_channel() const;
+
+	HBSteamVoiceChat(const Ref<HBSteamPeerGroup> &p_peer_group, int p_channel);
+	~HBSteamVoiceChat();
+};
+
+#endif // STEAM_VOICE_H
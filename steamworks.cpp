@@ -29,8 +29,10 @@
 /**************************************************************************/
 
 #include "steamworks.h"
+#include "core/io/ip_address.h"
 #include "scene/main/window.h"
 #include "steam/steam_api_flat.h"
+#include "steam/steam_gameserver.h"
 #include "steamworks_constants.gen.h"
 #include "sw_error_macros.h"
 #include <iostream>
@@ -46,7 +48,36 @@ extern "C" void __cdecl SteamAPIDebugTextHook(int nSeverity, const char *pchDebu
 	}
 }
 
+void Steamworks::_run_worker_group_task_callbacks() {
+	for (uint32_t i = 0; i < worker_group_task_callbacks.size();) {
+		WorkerGroupTaskCallback &task_callback = worker_group_task_callbacks[i];
+		if (!WorkerThreadPool::get_singleton()->is_group_task_completed(task_callback.group_id)) {
+			i++;
+			continue;
+		}
+		// Doesn't block, the task is done, but the pool needs it to release the group.
+		WorkerThreadPool::get_singleton()->wait_for_group_task_completion(task_callback.group_id);
+		Callable callable = task_callback.callback;
+		worker_group_task_callbacks.remove_at_unordered(i);
+		if (callable.is_valid()) {
+			callable.call();
+		}
+	}
+}
+
+void Steamworks::_run_frame_callbacks() {
+	// Callbacks are allowed to queue themselves again for the next frame.
+	LocalVector<Callable> callbacks;
+	SWAP(callbacks, frame_callbacks);
+	for (const Callable &callable : callbacks) {
+		if (callable.is_valid()) {
+			callable.call();
+		}
+	}
+}
+
 void Steamworks::_run_callbacks() {
+	_run_frame_callbacks();
 	SteamAPI_ManualDispatch_RunFrame(steam_pipe);
 	CallbackMsg_t msg;
 	while (SteamAPI_ManualDispatch_GetNextCallback(steam_pipe, &msg)) {
@@ -72,10 +103,11 @@ void Steamworks::_run_callbacks() {
 			}
 
 			if (call_result_callbacks.has(api_call->m_hAsyncCall)) {
-				SteamworksCallbackInfo &info = call_result_callbacks[api_call->m_hAsyncCall];
+				// API result callbacks are one-time only.
+				SteamworksCallbackInfo info = call_result_callbacks[api_call->m_hAsyncCall];
+				call_result_callbacks.erase(api_call->m_hAsyncCall);
 				for (Callable callable : info.callbacks) {
 					if (!callable.is_valid()) {
-						// API result callbacks are one-time only.
 						continue;
 					}
 					Array args;
@@ -83,7 +115,6 @@ void Steamworks::_run_callbacks() {
 					args.push_back(failed);
 					callable.callv(args);
 				}
-				info.callbacks.clear();
 			}
 		} else {
 			if (callback_infos.has(msg.m_iCallback)) {
@@ -102,6 +133,7 @@ void Steamworks::_run_callbacks() {
 		}
 		SteamAPI_ManualDispatch_FreeLastCallback(steam_pipe);
 	}
+	_run_worker_group_task_callbacks();
 }
 
 bool Steamworks::get_ticket_for_web_api(const String &p_identity) const {
@@ -110,7 +142,9 @@ bool Steamworks::get_ticket_for_web_api(const String &p_identity) const {
 
 void Steamworks::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("init", "app_id", "run_callbacks_automatically"), &Steamworks::init, DEFVAL(true));
+	ClassDB::bind_method(D_METHOD("init_game_server", "app_id", "game_port", "query_port", "server_mode", "version", "bind_address", "run_callbacks_automatically"), &Steamworks::init_game_server, DEFVAL(""), DEFVAL(true));
 	ClassDB::bind_method(D_METHOD("is_valid"), &Steamworks::is_valid);
+	ClassDB::bind_method(D_METHOD("is_game_server"), &Steamworks::is_game_server);
 
 	ClassDB::bind_method(D_METHOD("run_callbacks"), &Steamworks::run_callbacks);
 
@@ -120,6 +154,8 @@ void Steamworks::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "input", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamInput"), "", "get_input");
 	ClassDB::bind_method(D_METHOD("get_matchmaking"), &Steamworks::get_matchmaking);
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "matchmaking", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamMatchmaking"), "", "get_matchmaking");
+	ClassDB::bind_method(D_METHOD("get_matchmaking_servers"), &Steamworks::get_matchmaking_servers);
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "matchmaking_servers", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamMatchmakingServers"), "", "get_matchmaking_servers");
 	ClassDB::bind_method(D_METHOD("get_friends"), &Steamworks::get_friends);
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "friends", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamFriends"), "", "get_friends");
 	ClassDB::bind_method(D_METHOD("get_utils"), &Steamworks::get_utils);
@@ -138,6 +174,10 @@ void Steamworks::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "user_stats", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamUserStats"), "", "get_user_stats");
 	ClassDB::bind_method(D_METHOD("get_networking_messages"), &Steamworks::get_networking_messages);
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "networking_messages", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamNetworkingMessages"), "", "get_networking_messages");
+	ClassDB::bind_method(D_METHOD("get_networking_utils"), &Steamworks::get_networking_utils);
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "networking_utils", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamNetworkingUtils"), "", "get_networking_utils");
+	ClassDB::bind_method(D_METHOD("get_game_server"), &Steamworks::get_game_server);
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "game_server", PROPERTY_HINT_RESOURCE_TYPE, "HBSteamGameServer"), "", "get_game_server");
 	ClassDB::bind_method(D_METHOD("get_app_id"), &Steamworks::get_app_id);
 
 	ClassDB::bind_method(D_METHOD("set_run_callbacks_automatically", "run_callbacks_automatically"), &Steamworks::set_run_callbacks_automatically);
@@ -152,9 +192,22 @@ void Steamworks::add_callback(int p_callback_type, Callable p_callable) {
 }
 
 void Steamworks::add_call_result_callback(ResultCallbackType p_callback_id, Callable p_callable) {
-	SteamworksCallbackInfo callback_info;
-	callback_info.callbacks.push_back(p_callable);
-	call_result_callbacks.insert(p_callback_id, callback_info);
+	// Several listeners can wait on the same call, e.g. lobby list queries sharing a request.
+	if (!call_result_callbacks.has(p_callback_id)) {
+		call_result_callbacks.insert(p_callback_id, SteamworksCallbackInfo());
+	}
+	call_result_callbacks[p_callback_id].callbacks.push_back(p_callable);
+}
+
+void Steamworks::add_worker_group_task_callback(WorkerThreadPool::GroupID p_group_id, Callable p_callable) {
+	WorkerGroupTaskCallback task_callback;
+	task_callback.group_id = p_group_id;
+	task_callback.callback = p_callable;
+	worker_group_task_callbacks.push_back(task_callback);
+}
+
+void Steamworks::add_frame_callback(Callable p_callable) {
+	frame_callbacks.push_back(p_callable);
 }
 
 bool Steamworks::init(int p_app_id, bool p_run_callbacks_automatically) {
@@ -178,6 +231,9 @@ bool Steamworks::init(int p_app_id, bool p_run_callbacks_automatically) {
 	matchmaking.instantiate();
 	matchmaking->init_interface();
 
+	matchmaking_servers.instantiate();
+	matchmaking_servers->init_interface();
+
 	friends.instantiate();
 	friends->init_interface();
 
@@ -205,6 +261,52 @@ bool Steamworks::init(int p_app_id, bool p_run_callbacks_automatically) {
 	networking_messages.instantiate();
 	networking_messages->init_interface();
 
+	networking_utils.instantiate();
+	networking_utils->init_interface();
+
+	return true;
+}
+
+bool Steamworks::init_game_server(int p_app_id, int p_game_port, int p_query_port, SWC::ServerMode p_server_mode, const String &p_version, const String &p_bind_address, bool p_run_callbacks_automatically) {
+	SW_ERR_FAIL_COND_V_MSG(initialized, false, "Steamworks: Calling Steamworks.init_game_server but it's already initialized.");
+	SW_ERR_FAIL_COND_V_MSG(p_game_port <= 0 || p_game_port > UINT16_MAX, false, "Steamworks: Invalid game port passed to init_game_server.");
+	SW_ERR_FAIL_COND_V_MSG(p_query_port != STEAMGAMESERVER_QUERY_PORT_SHARED && (p_query_port <= 0 || p_query_port > UINT16_MAX), false, "Steamworks: Invalid query port passed to init_game_server.");
+
+	// Steam wants the address in host order, 0 binds to every interface.
+	uint32_t bind_ip = 0;
+	if (!p_bind_address.is_empty()) {
+		IPAddress address(p_bind_address);
+		SW_ERR_FAIL_COND_V_MSG(!address.is_valid() || !address.is_ipv4(), false, "Steamworks: init_game_server bind address must be an IPv4 address.");
+		const uint8_t *bytes = address.get_ipv4();
+		bind_ip = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+	}
+
+	// Game servers don't talk to a running Steam client, they load steamclient from the SDK redistributables
+	// and log on by themselves, so this works on headless boxes and with several instances per machine.
+	OS::get_singleton()->set_environment("SteamAppId", Variant(p_app_id));
+	OS::get_singleton()->set_environment("SteamGameId", Variant(p_app_id));
+	SW_ERR_FAIL_COND_V_MSG(!SteamGameServer_Init(bind_ip, p_game_port, p_query_port, (EServerMode)p_server_mode, p_version.utf8().get_data()), false, "Steamworks: SteamGameServer_Init returned false. Ports are already in use, steamclient couldn't be loaded or App ID is invalid.");
+	SteamAPI_ManualDispatch_Init();
+	steam_pipe = SteamGameServer_GetHSteamPipe();
+	initialized = true;
+	game_server_mode = true;
+	app_id = p_app_id;
+
+	SteamAPI_ISteamClient_SetWarningMessageHook(SteamGameServerClient(), SteamAPIDebugTextHook);
+
+	// Client only interfaces (friends, matchmaking, input...) are left null in game server mode.
+	utils.instantiate();
+	utils->init_interface(true);
+
+	networking_messages.instantiate();
+	networking_messages->init_interface(true);
+
+	networking_utils.instantiate();
+	networking_utils->init_interface();
+
+	game_server.instantiate();
+	game_server->init_interface();
+
 	return true;
 }
 
@@ -224,9 +326,16 @@ Steamworks::~Steamworks() {
 			memdelete(input);
 		}
 		matchmaking = Ref<HBSteamMatchmaking>();
+		HBSteamFriend::clear_cache();
 		friends = Ref<HBSteamFriends>();
 		utils = Ref<HBSteamUtils>();
-		SteamAPI_Shutdown();
+		if (game_server_mode) {
+			// Ends any outstanding auth sessions while the interface is still alive.
+			game_server = Ref<HBSteamGameServer>();
+			SteamGameServer_Shutdown();
+		} else {
+			SteamAPI_Shutdown();
+		}
 	}
 	singleton = nullptr;
 }
@@ -264,6 +373,10 @@ Ref<HBSteamMatchmaking> Steamworks::get_matchmaking() const {
 	return matchmaking;
 }
 
+Ref<HBSteamMatchmakingServers> Steamworks::get_matchmaking_servers() const {
+	return matchmaking_servers;
+}
+
 Ref<HBSteamFriends> Steamworks::get_friends() const {
 	return friends;
 }
@@ -300,6 +413,14 @@ Ref<HBSteamNetworkingMessages> Steamworks::get_networking_messages() const {
 	return networking_messages;
 }
 
+Ref<HBSteamNetworkingUtils> Steamworks::get_networking_utils() const {
+	return networking_utils;
+}
+
+Ref<HBSteamGameServer> Steamworks::get_game_server() const {
+	return game_server;
+}
+
 int Steamworks::get_app_id() const {
 	return app_id;
 }
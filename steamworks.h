@@ -31,17 +31,32 @@
 #ifndef STEAMWORKS_H
 #define STEAMWORKS_H
 
+#include "core/object/worker_thread_pool.h"
 #include "steam_apps.h"
+#include "steam_avatar_atlas.h"
+#include "steam_avatar_cache.h"
+#include "steam_clock_sync.h"
 #include "steam_friends.h"
+#include "steam_game_server.h"
+#include "steam_host_migration.h"
+#include "steam_image_cache.h"
 #include "steam_input.h"
+#include "steam_input_transport.h"
+#include "steam_lobby_state_store.h"
 #include "steam_matchmaking.h"
+#include "steam_matchmaking_servers.h"
 #include "steam_networking.h"
 #include "steam_networking_messages.h"
+#include "steam_networking_utils.h"
+#include "steam_persona_requests.h"
 #include "steam_remote_storage.h"
+#include "steam_rich_presence.h"
+#include "steam_snapshot_replicator.h"
 #include "steam_ugc.h"
 #include "steam_user.h"
 #include "steam_user_stats.h"
 #include "steam_utils.h"
+#include "steam_voice.h"
 
 class ISteamClient;
 class Steamworks : public Object {
@@ -52,10 +67,12 @@ class Steamworks : public Object {
 	static Steamworks *singleton;
 	bool initialized = false;
 	bool run_callbacks_automatically = false;
+	bool game_server_mode = false;
 	int app_id;
 
 	HBSteamInput *input = nullptr;
 	Ref<HBSteamMatchmaking> matchmaking;
+	Ref<HBSteamMatchmakingServers> matchmaking_servers;
 	Ref<HBSteamFriends> friends;
 	Ref<HBSteamUtils> utils;
 	Ref<HBSteamNetworking> networking;
@@ -65,6 +82,8 @@ class Steamworks : public Object {
 	Ref<HBSteamRemoteStorage> remote_storage;
 	Ref<HBSteamUserStats> user_stats;
 	Ref<HBSteamNetworkingMessages> networking_messages;
+	Ref<HBSteamNetworkingUtils> networking_utils;
+	Ref<HBSteamGameServer> game_server;
 	typedef int CallbackType;
 
 	struct SteamworksCallbackInfo {
@@ -75,6 +94,16 @@ class Steamworks : public Object {
 
 	HashMap<CallbackType, SteamworksCallbackInfo> callback_infos;
 	HashMap<ResultCallbackType, SteamworksCallbackInfo> call_result_callbacks;
+
+	struct WorkerGroupTaskCallback {
+		WorkerThreadPool::GroupID group_id;
+		Callable callback;
+	};
+	LocalVector<WorkerGroupTaskCallback> worker_group_task_callbacks;
+	// One-shot callbacks run at the start of the next callback run.
+	LocalVector<Callable> frame_callbacks;
+	void _run_worker_group_task_callbacks();
+	void _run_frame_callbacks();
 	void _run_callbacks();
 	bool get_ticket_for_web_api(const String &p_identifier) const;
 
@@ -84,12 +113,16 @@ protected:
 public:
 	void add_callback(int p_callback_type, Callable p_callable);
 	void add_call_result_callback(uint64_t p_callback_id, Callable p_callable);
+	void add_worker_group_task_callback(WorkerThreadPool::GroupID p_group_id, Callable p_callable);
+	void add_frame_callback(Callable p_callable);
 	static String last_error;
 	static String get_last_error() { return last_error; };
 	static Steamworks *get_singleton() { return singleton; }
 
 	bool init(int p_app_id, bool p_run_callbacks_automatically = true);
+	bool init_game_server(int p_app_id, int p_game_port, int p_query_port, SWC::ServerMode p_server_mode, const String &p_version, const String &p_bind_address = "", bool p_run_callbacks_automatically = true);
 	bool is_valid() const { return initialized; };
+	bool is_game_server() const { return game_server_mode; };
 
 	void run_callbacks();
 
@@ -98,6 +131,7 @@ public:
 
 	HBSteamInput *get_input() const;
 	Ref<HBSteamMatchmaking> get_matchmaking() const;
+	Ref<HBSteamMatchmakingServers> get_matchmaking_servers() const;
 	Ref<HBSteamFriends> get_friends() const;
 	Ref<HBSteamUtils> get_utils() const;
 	Ref<HBSteamNetworking> get_networking() const;
@@ -107,6 +141,8 @@ public:
 	Ref<HBSteamRemoteStorage> get_remote_storage() const;
 	Ref<HBSteamUserStats> get_user_stats() const;
 	Ref<HBSteamNetworkingMessages> get_networking_messages() const;
+	Ref<HBSteamNetworkingUtils> get_networking_utils() const;
+	Ref<HBSteamGameServer> get_game_server() const;
 	int get_app_id() const;
 
 	Steamworks();
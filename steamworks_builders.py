@@ -29,6 +29,14 @@ whitelisted_enum_names = [
     "EChatRoomEnterResponse",
     "EChatEntryType",
     "EChatMemberStateChange",
+    "EMatchMakingServerResponse",
+    "EServerMode",
+    "EBeginAuthSessionResult",
+    "EAuthSessionResponse",
+    "EUserHasLicenseForAppResult",
+    "EFriendRelationship",
+    "EPersonaState",
+    "EFriendFlags",
 ]
 
 # Needed because godot can't convert unsigned long long
@@ -50,7 +58,7 @@ whitelisted_types = [
     "HAuthTicket",
 ]
 
-bitfields = ["ItemState"]
+bitfields = ["ItemState", "FriendFlags"]
 
 whitelisted_constants = ["k_UGCQueryHandleInvalid", "k_UGCUpdateHandleInvalid"]
 
@@ -84,6 +92,9 @@ def process_enum_data(enums_data) -> List[EnumInfo]:
             value_name = value["name"]
             if value_name.lower().startswith("k_e"):
                 value_name = value_name[3:]
+            elif value_name.startswith("e") and value_name[1:2].isupper():
+                # Older enums like EMatchMakingServerResponse use eValueName
+                value_name = value_name[1:]
             value_name = value_name.replace("_", "")
             value_name = snake_case(value_name)
             if value_name.startswith("P2_P_"):
@@ -208,3 +219,381 @@ def generate_constants_file(target, source, env):
 
         f.write("using SWC = SteamworksConstants;\n\n")
         f.write("#endif // STEAMWORKS_CONSTANTS_GEN_H\n")
+
+
+# Message schemas
+#
+# Each schema file is a JSON document with a list of messages, every message gets a C++ class
+# deriving from HBSteamSchemaMessage that is also exposed to scripting:
+#
+# {
+#     "messages": [
+#         {
+#             "name": "PlayerStateMessage",
+#             "id": 1,
+#             "fields": [
+#                 { "name": "entity_id", "type": "uint", "bits": 12 },
+#                 { "name": "position", "type": "vector3", "bits": 16, "min": -512.0, "max": 512.0 },
+#                 { "name": "health", "type": "int", "bits": 8, "optional": true },
+#                 { "name": "nickname", "type": "string", "max_length": 32, "optional": true }
+#             ]
+#         }
+#     ]
+# }
+#
+# "int" values are zigzag encoded, "float", "vector2" and "vector3" are quantized to "bits" bits in
+# the [min, max] range if "bits" is given, otherwise they are sent as full precision floats.
+# "string" and "bytes" fields are length prefixed and limited to "max_length" bytes.
+# Optional fields cost a single presence bit when they aren't set.
+# Message IDs from RESERVED_MESSAGE_ID_START upwards are reserved for future use by this module.
+
+message_field_types = {
+    # type: (C++ type for 32 bit or smaller values, C++ type for bigger values, variant type)
+    "bool": ("bool", "bool", "BOOL"),
+    "int": ("int32_t", "int64_t", "INT"),
+    "uint": ("uint32_t", "uint64_t", "INT"),
+    "float": ("float", "float", "FLOAT"),
+    "vector2": ("Vector2", "Vector2", "VECTOR2"),
+    "vector3": ("Vector3", "Vector3", "VECTOR3"),
+    "string": ("CharString", "CharString", "STRING"),
+    "bytes": ("PackedByteArray", "PackedByteArray", "PACKED_BYTE_ARRAY"),
+}
+
+message_field_defaults = {
+    "bool": "false",
+    "int": "0",
+    "uint": "0",
+    "float": "0.0f",
+}
+
+vector_components = {
+    "vector2": ["x", "y"],
+    "vector3": ["x", "y", "z"],
+}
+
+MAX_QUANTIZED_BITS = 24
+MAX_MESSAGE_ID = 255
+RESERVED_MESSAGE_ID_START = 240
+
+
+class MessageField:
+    name: str
+    field_type: str
+    bits: int
+    quantized: bool
+    min_value: float
+    max_value: float
+    max_length: int
+    optional: bool
+
+    def __init__(self, message_name: str, field: Dict):
+        self.name = field["name"]
+        self.field_type = field["type"]
+        self.optional = field.get("optional", False)
+        self.quantized = False
+        self.bits = 0
+        self.min_value = 0.0
+        self.max_value = 0.0
+        self.max_length = 0
+
+        where = f"{message_name}.{self.name}"
+        if not self.name.isidentifier():
+            raise ValueError(f"Invalid message field name {where}")
+        if self.field_type not in message_field_types:
+            raise ValueError(f"Unknown type {self.field_type} for message field {where}")
+
+        if self.field_type in ["int", "uint"]:
+            self.bits = field.get("bits", 32)
+            if self.bits < 1 or self.bits > 64:
+                raise ValueError(f"Message field {where} must use between 1 and 64 bits")
+        elif self.field_type in ["float", "vector2", "vector3"]:
+            self.quantized = "bits" in field
+            if self.quantized:
+                self.bits = field["bits"]
+                if self.bits < 1 or self.bits > MAX_QUANTIZED_BITS:
+                    raise ValueError(f"Quantized message field {where} must use between 1 and {MAX_QUANTIZED_BITS} bits")
+                if "min" not in field or "max" not in field:
+                    raise ValueError(f"Quantized message field {where} needs a min and a max value")
+                self.min_value = float(field["min"])
+                self.max_value = float(field["max"])
+                if self.min_value >= self.max_value:
+                    raise ValueError(f"Message field {where} has an empty range")
+            else:
+                self.bits = 32
+        elif self.field_type in ["string", "bytes"]:
+            if "max_length" not in field:
+                raise ValueError(f"Message field {where} needs a max_length")
+            self.max_length = field["max_length"]
+            if self.max_length < 1 or self.max_length > 65535:
+                raise ValueError(f"Message field {where} must have a max_length between 1 and 65535")
+        elif self.field_type == "bool":
+            self.bits = 1
+
+    def get_cpp_type(self) -> str:
+        types = message_field_types[self.field_type]
+        return types[0] if self.bits <= 32 else types[1]
+
+    def get_variant_type(self) -> str:
+        return message_field_types[self.field_type][2]
+
+    def get_max_bits(self) -> int:
+        bits = 1 if self.optional else 0
+        if self.field_type in vector_components:
+            bits += self.bits * len(vector_components[self.field_type])
+        elif self.field_type in ["string", "bytes"]:
+            bits += self.max_length.bit_length() + self.max_length * 8
+        else:
+            bits += self.bits
+        return bits
+
+    def get_argument_type(self) -> str:
+        if self.field_type == "string":
+            return "const String &"
+        if self.field_type in ["vector2", "vector3", "bytes"]:
+            return f"const {self.get_cpp_type()} &"
+        return self.get_cpp_type() + " "
+
+    def get_return_type(self) -> str:
+        if self.field_type == "string":
+            return "String"
+        return self.get_cpp_type()
+
+    def float_literal(self, value: float) -> str:
+        return repr(float(value)) + "f"
+
+    def write_value(self, f: StringIO, value: str, indent: str):
+        if self.field_type == "bool":
+            f.write(f"{indent}p_writer.write_bool({value});\n")
+        elif self.field_type == "int":
+            f.write(f"{indent}p_writer.write_int({value}, {self.bits});\n")
+        elif self.field_type == "uint":
+            f.write(f"{indent}p_writer.write_uint({value}, {self.bits});\n")
+        elif self.field_type == "float":
+            if self.quantized:
+                f.write(
+                    f"{indent}p_writer.write_quantized_float({value}, {self.float_literal(self.min_value)}, {self.float_literal(self.max_value)}, {self.bits});\n"
+                )
+            else:
+                f.write(f"{indent}p_writer.write_float({value});\n")
+        elif self.field_type in vector_components:
+            for component in vector_components[self.field_type]:
+                if self.quantized:
+                    f.write(
+                        f"{indent}p_writer.write_quantized_float({value}.{component}, {self.float_literal(self.min_value)}, {self.float_literal(self.max_value)}, {self.bits});\n"
+                    )
+                else:
+                    f.write(f"{indent}p_writer.write_float({value}.{component});\n")
+        elif self.field_type == "string":
+            f.write(f"{indent}p_writer.write_length({value}.length(), {self.max_length});\n")
+            f.write(f"{indent}p_writer.write_bytes((const uint8_t *){value}.get_data(), {value}.length());\n")
+        elif self.field_type == "bytes":
+            f.write(f"{indent}p_writer.write_length({value}.size(), {self.max_length});\n")
+            f.write(f"{indent}p_writer.write_bytes({value}.ptr(), {value}.size());\n")
+
+    def read_value(self, f: StringIO, value: str, indent: str):
+        if self.field_type == "bool":
+            f.write(f"{indent}{value} = p_reader.read_bool();\n")
+        elif self.field_type == "int":
+            f.write(f"{indent}{value} = p_reader.read_int({self.bits});\n")
+        elif self.field_type == "uint":
+            f.write(f"{indent}{value} = p_reader.read_uint({self.bits});\n")
+        elif self.field_type == "float":
+            if self.quantized:
+                f.write(
+                    f"{indent}{value} = p_reader.read_quantized_float({self.float_literal(self.min_value)}, {self.float_literal(self.max_value)}, {self.bits});\n"
+                )
+            else:
+                f.write(f"{indent}{value} = p_reader.read_float();\n")
+        elif self.field_type in vector_components:
+            for component in vector_components[self.field_type]:
+                if self.quantized:
+                    f.write(
+                        f"{indent}{value}.{component} = p_reader.read_quantized_float({self.float_literal(self.min_value)}, {self.float_literal(self.max_value)}, {self.bits});\n"
+                    )
+                else:
+                    f.write(f"{indent}{value}.{component} = p_reader.read_float();\n")
+        elif self.field_type == "string":
+            f.write(f"{indent}uint32_t {value}_length = p_reader.read_length({self.max_length});\n")
+            f.write(f"{indent}{value}.resize({value}_length + 1);\n")
+            f.write(f"{indent}p_reader.read_bytes((uint8_t *){value}.ptrw(), {value}_length);\n")
+            f.write(f"{indent}{value}.ptrw()[{value}_length] = 0;\n")
+        elif self.field_type == "bytes":
+            f.write(f"{indent}uint32_t {value}_length = p_reader.read_length({self.max_length});\n")
+            f.write(f"{indent}{value}.resize({value}_length);\n")
+            f.write(f"{indent}p_reader.read_bytes({value}.ptrw(), {value}_length);\n")
+
+
+class MessageSchema:
+    name: str
+    message_id: int
+    fields: List[MessageField]
+
+    def __init__(self, message: Dict):
+        self.name = message["name"]
+        self.message_id = message["id"]
+        if not self.name.isidentifier():
+            raise ValueError(f"Invalid message name {self.name}")
+        if self.message_id < 0 or self.message_id > MAX_MESSAGE_ID:
+            raise ValueError(f"Message {self.name} must have an id between 0 and {MAX_MESSAGE_ID}")
+        if self.message_id >= RESERVED_MESSAGE_ID_START:
+            raise ValueError(f"Message {self.name} uses the id {self.message_id}, ids from {RESERVED_MESSAGE_ID_START} upwards are reserved")
+        self.fields = [MessageField(self.name, field) for field in message.get("fields", [])]
+        field_names = [field.name for field in self.fields]
+        for field_name in field_names:
+            if field_names.count(field_name) > 1:
+                raise ValueError(f"Message {self.name} has more than one field named {field_name}")
+
+    def get_max_encoded_size(self) -> int:
+        bits = 8 + sum([field.get_max_bits() for field in self.fields])
+        return (bits + 7) // 8
+
+
+def load_message_schemas(paths: List[str]) -> List[MessageSchema]:
+    schemas: List[MessageSchema] = []
+    for path in paths:
+        with open(path, "r") as schema_file:
+            schema_json = json.load(schema_file)
+        for message in schema_json["messages"]:
+            schemas.append(MessageSchema(message))
+
+    for schema in schemas:
+        for other in schemas:
+            if schema is other:
+                continue
+            if schema.name == other.name:
+                raise ValueError(f"Message {schema.name} is defined more than once")
+            if schema.message_id == other.message_id:
+                raise ValueError(f"Messages {schema.name} and {other.name} share the id {schema.message_id}")
+    return schemas
+
+
+def generate_message_class(schema: MessageSchema) -> StringIO:
+    f = StringIO()
+    name = schema.name
+    f.write(f"class {name} : public HBSteamSchemaMessage {{\n")
+    f.write(f"\tGDCLASS({name}, HBSteamSchemaMessage);\n\n")
+
+    for field in schema.fields:
+        default_value = message_field_defaults.get(field.field_type)
+        if default_value is None:
+            f.write(f"\t{field.get_cpp_type()} {field.name};\n")
+        else:
+            f.write(f"\t{field.get_cpp_type()} {field.name} = {default_value};\n")
+        if field.optional:
+            f.write(f"\tbool {field.name}_set = false;\n")
+
+    f.write("\nprotected:\n")
+    f.write("\tstatic void _bind_methods() {\n")
+    for field in schema.fields:
+        f.write(f'\t\tClassDB::bind_method(D_METHOD("set_{field.name}", "{field.name}"), &{name}::set_{field.name});\n')
+        f.write(f'\t\tClassDB::bind_method(D_METHOD("get_{field.name}"), &{name}::get_{field.name});\n')
+        if field.optional:
+            f.write(f'\t\tClassDB::bind_method(D_METHOD("has_{field.name}"), &{name}::has_{field.name});\n')
+            f.write(f'\t\tClassDB::bind_method(D_METHOD("clear_{field.name}"), &{name}::clear_{field.name});\n')
+    for field in schema.fields:
+        f.write(
+            f'\t\tADD_PROPERTY(PropertyInfo(Variant::{field.get_variant_type()}, "{field.name}"), "set_{field.name}", "get_{field.name}");\n'
+        )
+    f.write(f"\t\tBIND_CONSTANT(MESSAGE_ID);\n")
+    f.write(f"\t\tBIND_CONSTANT(MAX_ENCODED_SIZE);\n")
+    f.write("\t}\n\n")
+
+    f.write("public:\n")
+    f.write(f"\tstatic const int MESSAGE_ID = {schema.message_id};\n")
+    f.write(f"\tstatic const uint32_t MAX_ENCODED_SIZE = {schema.get_max_encoded_size()};\n\n")
+
+    f.write("\tstatic Ref<HBSteamSchemaMessage> create() {\n")
+    f.write(f"\t\tRef<{name}> message;\n")
+    f.write("\t\tmessage.instantiate();\n")
+    f.write("\t\treturn message;\n")
+    f.write("\t}\n\n")
+
+    f.write("\tvirtual int get_message_id() const override { return MESSAGE_ID; }\n")
+    f.write("\tvirtual uint32_t get_max_encoded_size() const override { return MAX_ENCODED_SIZE; }\n\n")
+
+    f.write("\tvirtual void encode_fields(HBBitWriter &p_writer) const override {\n")
+    for field in schema.fields:
+        if field.optional:
+            f.write(f"\t\tp_writer.write_bool({field.name}_set);\n")
+            f.write(f"\t\tif ({field.name}_set) {{\n")
+            field.write_value(f, field.name, "\t\t\t")
+            f.write("\t\t}\n")
+        else:
+            field.write_value(f, field.name, "\t\t")
+    if len(schema.fields) == 0:
+        f.write("\t\t(void)p_writer;\n")
+    f.write("\t}\n\n")
+
+    f.write("\tvirtual void decode_fields(HBBitReader &p_reader) override {\n")
+    for field in schema.fields:
+        if field.optional:
+            f.write(f"\t\t{field.name}_set = p_reader.read_bool();\n")
+            f.write(f"\t\tif ({field.name}_set) {{\n")
+            field.read_value(f, field.name, "\t\t\t")
+            f.write("\t\t} else {\n")
+            f.write(f"\t\t\t{field.name} = {field.get_cpp_type()}();\n")
+            f.write("\t\t}\n")
+        else:
+            field.read_value(f, field.name, "\t\t")
+    if len(schema.fields) == 0:
+        f.write("\t\t(void)p_reader;\n")
+    f.write("\t}\n")
+
+    for field in schema.fields:
+        f.write("\n")
+        argument = f"p_{field.name}"
+        f.write(f"\tvoid set_{field.name}({field.get_argument_type()}{argument}) {{\n")
+        if field.field_type == "string":
+            f.write(f"\t\tCharString {field.name}_utf8 = {argument}.utf8();\n")
+            f.write(
+                f'\t\tERR_FAIL_COND_MSG({field.name}_utf8.length() > {field.max_length}, "{name}.{field.name} can\'t be longer than {field.max_length} bytes.");\n'
+            )
+            f.write(f"\t\t{field.name} = {field.name}_utf8;\n")
+        elif field.field_type == "bytes":
+            f.write(
+                f'\t\tERR_FAIL_COND_MSG({argument}.size() > {field.max_length}, "{name}.{field.name} can\'t be longer than {field.max_length} bytes.");\n'
+            )
+            f.write(f"\t\t{field.name} = {argument};\n")
+        else:
+            f.write(f"\t\t{field.name} = {argument};\n")
+        if field.optional:
+            f.write(f"\t\t{field.name}_set = true;\n")
+        f.write("\t}\n")
+
+        if field.field_type == "string":
+            f.write(f"\tString get_{field.name}() const {{ return String::utf8({field.name}.get_data(), {field.name}.length()); }}\n")
+        else:
+            f.write(f"\t{field.get_return_type()} get_{field.name}() const {{ return {field.name}; }}\n")
+
+        if field.optional:
+            f.write(f"\tbool has_{field.name}() const {{ return {field.name}_set; }}\n")
+            f.write(f"\tvoid clear_{field.name}() {{\n")
+            f.write(f"\t\t{field.name} = {field.get_cpp_type()}();\n")
+            f.write(f"\t\t{field.name}_set = false;\n")
+            f.write("\t}\n")
+
+    f.write("};\n\n")
+    return f
+
+
+def generate_messages_file(target, source, env):
+    schema_paths = [str(s) for s in source if str(s).endswith(".json")]
+    schemas = load_message_schemas(schema_paths)
+    schemas.sort(key=lambda schema: schema.message_id)
+
+    with open(target[0].path, "w") as f:
+        f.write("#ifndef STEAMWORKS_MESSAGES_GEN_H\n")
+        f.write("#define STEAMWORKS_MESSAGES_GEN_H\n\n")
+
+        f.write('#include "steam_message_schema.h"\n\n')
+
+        for schema in schemas:
+            f.write(generate_message_class(schema).getvalue())
+
+        f.write("inline void register_steam_schema_messages() {\n")
+        for schema in schemas:
+            f.write(f"\tGDREGISTER_CLASS({schema.name});\n")
+            f.write(f"\tHBSteamSchemaMessage::register_message_type({schema.name}::MESSAGE_ID, &{schema.name}::create);\n")
+        f.write("}\n\n")
+
+        f.write("#endif // STEAMWORKS_MESSAGES_GEN_H\n")
@@ -0,0 +1,322 @@
+/**************************************************************************/
+/*  test_steam_friends.h                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef TEST_STEAM_FRIENDS_H
+#define TEST_STEAM_FRIENDS_H
+
+#include "test_steamworks.h"
+#include "tests/test_macros.h"
+
+namespace TestSteamFriends {
+class SteamFriendsSignalTester : public RefCounted {
+	GDCLASS(SteamFriendsSignalTester, RefCounted);
+
+public:
+	int avatar_loaded_count = 0;
+	Ref<Texture2D> loaded_avatar;
+	void _on_avatar_loaded(int p_size, Ref<Texture2D> p_texture) {
+		avatar_loaded_count++;
+		loaded_avatar = p_texture;
+	}
+
+	LocalVector<PackedInt64Array> persona_batches;
+	void _on_persona_info_ready(PackedInt64Array p_steam_ids) {
+		persona_batches.push_back(p_steam_ids);
+	}
+};
+
+TEST_CASE("[SteamFriends] Test asynchronous avatar loading") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<HBSteamAvatarCache> avatar_cache = singleton->get_friends()->get_avatar_cache();
+	REQUIRE(avatar_cache.is_valid());
+	avatar_cache->clear();
+	avatar_cache->set_disk_cache_path(OS::get_singleton()->get_cache_path().path_join("steam_avatar_cache_test"));
+
+	Ref<SteamFriendsSignalTester> signal_tester;
+	signal_tester.instantiate();
+	Ref<HBSteamFriend> local_user = singleton->get_user()->get_local_user();
+	local_user->connect("avatar_loaded", callable_mp(signal_tester.ptr(), &SteamFriendsSignalTester::_on_avatar_loaded));
+
+	Ref<Texture2D> avatar = local_user->get_avatar();
+	for (int i = 0; i < 40 && !avatar_cache->is_avatar_loaded(local_user->get_steam_id()); i++) {
+		singleton->run_callbacks();
+		OS::get_singleton()->delay_usec(50000);
+	}
+	REQUIRE_MESSAGE(avatar_cache->is_avatar_loaded(local_user->get_steam_id()), "The local user's avatar should load.");
+	avatar = local_user->get_avatar();
+	if (avatar.is_valid()) {
+		CHECK_MESSAGE(signal_tester->avatar_loaded_count == 1, "The friend should be told once when its avatar loads.");
+		CHECK_MESSAGE(signal_tester->loaded_avatar == avatar, "The signal should carry the cached texture.");
+		CHECK_MESSAGE(avatar->get_width() == 64, "Medium avatars should be 64 pixels wide.");
+	}
+	CHECK_MESSAGE(avatar_cache->get_avatar(local_user->get_steam_id(), HBSteamAvatarCache::AVATAR_SIZE_MEDIUM) == avatar, "Avatars should be shared through the cache.");
+	CHECK_MESSAGE((uint64_t)avatar_cache->get_stats()["hits"] >= 2, "Loaded avatars should be served from the cache.");
+
+	SUBCASE("Test avatar atlas") {
+		REQUIRE_MESSAGE(avatar.is_valid(), "The local user needs an avatar to test atlases with.");
+		Ref<HBSteamAvatarAtlas> atlas = avatar_cache->create_atlas(256, 1);
+		REQUIRE(atlas.is_valid());
+		Ref<AtlasTexture> region = atlas->get_avatar(local_user->get_steam_id());
+		REQUIRE_MESSAGE(region.is_valid(), "Loaded avatars should be packed into an atlas region.");
+		CHECK_MESSAGE(atlas->get_page_count() == 1, "A single avatar should fit in one page.");
+		CHECK_MESSAGE(region->get_atlas() == atlas->get_page_texture(0), "The region should point at the atlas page.");
+		CHECK_MESSAGE(region->get_region().size == Size2(64, 64), "The region should be the size of the avatar.");
+		CHECK_MESSAGE(atlas->get_avatar(local_user->get_steam_id()) == region, "Packed avatars should be reused.");
+
+		Ref<AtlasTexture> small_region = atlas->get_avatar(local_user->get_steam_id(), HBSteamAvatarCache::AVATAR_SIZE_SMALL);
+		for (int i = 0; i < 40 && small_region.is_null(); i++) {
+			singleton->run_callbacks();
+			small_region = atlas->get_avatar(local_user->get_steam_id(), HBSteamAvatarCache::AVATAR_SIZE_SMALL);
+			OS::get_singleton()->delay_usec(50000);
+		}
+		REQUIRE(small_region.is_valid());
+		CHECK_MESSAGE(small_region->get_atlas() == region->get_atlas(), "Different sizes should share the page.");
+		CHECK_MESSAGE(!small_region->get_region().intersects(region->get_region()), "Regions shouldn't overlap.");
+
+		atlas->flush();
+		Dictionary stats = atlas->get_stats();
+		CHECK_MESSAGE((int)stats["slots"] == 2, "Each avatar should get a single slot.");
+		CHECK_MESSAGE((int)stats["uploads"] >= 1, "Packed avatars should be uploaded.");
+		atlas->flush();
+		CHECK_MESSAGE((int)atlas->get_stats()["uploads"] == (int)stats["uploads"], "Pages without changes shouldn't be uploaded again.");
+	}
+}
+
+TEST_CASE("[SteamFriends] Test friends snapshot") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<HBSteamFriendsSnapshot> snapshot = singleton->get_friends()->get_friends_snapshot(SWC::FRIEND_FLAG_ALL);
+	REQUIRE(snapshot.is_valid());
+	int friend_count = snapshot->get_friend_count();
+	CHECK_MESSAGE(snapshot->get_version() == 1, "A freshly built snapshot should be at its first version.");
+	CHECK((int64_t)snapshot->get_friend_flags() == SWC::FRIEND_FLAG_ALL);
+	CHECK_MESSAGE(snapshot->get_persona_states().size() == friend_count, "Every column should have an entry per friend.");
+	CHECK_MESSAGE(snapshot->get_persona_names().size() == friend_count, "Every column should have an entry per friend.");
+	CHECK_MESSAGE(snapshot->get_game_ids().size() == friend_count, "Every column should have an entry per friend.");
+	CHECK_MESSAGE(snapshot->get_relationships().size() == friend_count, "Every column should have an entry per friend.");
+
+	PackedInt64Array steam_ids = snapshot->get_steam_ids();
+	for (int i = 0; i < friend_count; i++) {
+		CHECK_MESSAGE(snapshot->find_friend(steam_ids[i]) == i, "Friends should be found at their index.");
+		CHECK(snapshot->get_friend(i)->get_persona_name() == snapshot->get_persona_names()[i]);
+	}
+	CHECK_MESSAGE(snapshot->find_friend(singleton->get_user()->get_local_user()->get_steam_id()) == -1, "The local user isn't in their own friends list.");
+}
+
+TEST_CASE("[SteamFriends] Test persona request queue") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<HBSteamPersonaRequests> persona_requests = singleton->get_friends()->get_persona_requests();
+	REQUIRE(persona_requests.is_valid());
+	persona_requests->clear();
+	persona_requests->set_max_in_flight(1);
+
+	Ref<SteamFriendsSignalTester> signal_tester;
+	signal_tester.instantiate();
+	persona_requests->connect("persona_info_ready", callable_mp(signal_tester.ptr(), &SteamFriendsSignalTester::_on_persona_info_ready));
+
+	// Steam always knows about the local user, so their request is answered right away
+	const uint64_t other_user_id = 76561197960287930;
+	uint64_t local_user_id = singleton->get_user()->get_local_user()->get_steam_id();
+	Dictionary stats_before = persona_requests->get_stats();
+	persona_requests->request(other_user_id);
+	persona_requests->request(local_user_id, false, true);
+	persona_requests->request(local_user_id, false, true);
+	CHECK_MESSAGE(persona_requests->get_pending_count() == 2, "Requests for the same user should be deduplicated.");
+	CHECK((uint64_t)persona_requests->get_stats()["deduplicated"] == (uint64_t)stats_before["deduplicated"] + 1);
+	CHECK_MESSAGE(persona_requests->get_in_flight_count() == 0, "Requests shouldn't be sent until the next frame.");
+
+	singleton->run_callbacks();
+	REQUIRE_MESSAGE(signal_tester->persona_batches.size() == 1, "Ready users should be reported in a single batch.");
+	CHECK_MESSAGE(signal_tester->persona_batches[0][0] == (int64_t)local_user_id, "Visible users should be requested first.");
+	CHECK_MESSAGE(!persona_requests->is_pending(local_user_id), "Answered users should stop being pending.");
+	CHECK_MESSAGE(persona_requests->get_in_flight_count() <= 1, "No more than max_in_flight requests should be sent.");
+
+	persona_requests->clear();
+	persona_requests->set_max_in_flight(8);
+	persona_requests->disconnect("persona_info_ready", callable_mp(signal_tester.ptr(), &SteamFriendsSignalTester::_on_persona_info_ready));
+}
+
+TEST_CASE("[SteamFriends] Test friend object retention") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamFriends> friends = Steamworks::get_singleton()->get_friends();
+	friends->clear_friend_cache();
+	friends->set_friend_cache_capacity(2);
+
+	const uint64_t first_user_id = 76561197960287930;
+	HBSteamFriend *first_user = HBSteamFriend::from_steam_id(first_user_id).ptr();
+	Dictionary stats = friends->get_friend_cache_stats();
+	CHECK_MESSAGE((int)stats["retained"] == 1, "Friends should be retained after their last Ref is dropped.");
+	CHECK_MESSAGE(HBSteamFriend::from_steam_id(first_user_id).ptr() == first_user, "Retained friends should be handed out again.");
+	CHECK((uint64_t)friends->get_friend_cache_stats()["hits"] == (uint64_t)stats["hits"] + 1);
+
+	// Push the first user out with two more recent ones
+	HBSteamFriend::from_steam_id(first_user_id + 1);
+	HBSteamFriend::from_steam_id(first_user_id + 2);
+	stats = friends->get_friend_cache_stats();
+	CHECK_MESSAGE((int)stats["retained"] == 2, "The cache shouldn't retain more friends than its capacity.");
+	CHECK_MESSAGE((uint64_t)stats["evictions"] >= 1, "The least recently used friend should be evicted.");
+	CHECK((int64_t)stats["retained_bytes"] <= friends->get_friend_cache_memory_budget());
+
+	friends->set_friend_cache_memory_budget(0);
+	CHECK_MESSAGE((int)friends->get_friend_cache_stats()["retained"] == 0, "Nothing should be retained without a memory budget.");
+
+	friends->set_friend_cache_memory_budget(1024 * 1024);
+	friends->set_friend_cache_capacity(256);
+}
+
+TEST_CASE("[SteamFriends] Test rich presence writer") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<HBSteamRichPresence> rich_presence = singleton->get_friends()->get_rich_presence();
+	REQUIRE(rich_presence.is_valid());
+	rich_presence->clear();
+	rich_presence->set_min_update_interval(10.0f);
+
+	CHECK(rich_presence->set_status("Testing"));
+	rich_presence->flush();
+	Dictionary stats = rich_presence->get_stats();
+	CHECK(rich_presence->get_value("status") == "Testing");
+	CHECK_MESSAGE(!rich_presence->has_pending_changes(), "Flushing should write every pending change.");
+
+	rich_presence->set_status("Testing");
+	CHECK_MESSAGE(!rich_presence->has_pending_changes(), "Values Steam already has shouldn't be written again.");
+	rich_presence->set_status("Still testing");
+	rich_presence->set_status("Testing");
+	CHECK_MESSAGE(!rich_presence->has_pending_changes(), "Changes reverted before a flush should be dropped.");
+	CHECK((uint64_t)rich_presence->get_stats()["writes"] == (uint64_t)stats["writes"]);
+
+	Dictionary substitutions;
+	substitutions["map"] = "Test map";
+	CHECK(rich_presence->set_display("InMatch", substitutions));
+	CHECK_MESSAGE(rich_presence->get_value("steam_display") == "#InMatch", "Display tokens should get their leading #.");
+	singleton->run_callbacks();
+	CHECK_MESSAGE(rich_presence->has_pending_changes(), "Changes should wait for the minimum update interval.");
+	rich_presence->flush();
+	CHECK((uint64_t)rich_presence->get_stats()["writes"] == (uint64_t)stats["writes"] + 2);
+	CHECK(rich_presence->get_values().size() == 3);
+
+	CHECK_MESSAGE(!rich_presence->set_value(String("k").repeat(64), "value"), "Keys that are too long should be rejected.");
+
+	rich_presence->clear();
+	CHECK(rich_presence->get_values().is_empty());
+	rich_presence->set_min_update_interval(1.0f);
+}
+
+TEST_CASE("[SteamFriends] Test image cache with an invalid handle") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<HBSteamImageCache> image_cache = singleton->get_utils()->get_image_cache();
+	REQUIRE(image_cache.is_valid());
+	image_cache->clear();
+
+	const int invalid_handle = 0x7FFFFFF0;
+	Dictionary stats = image_cache->get_stats();
+	CHECK_MESSAGE(image_cache->get_texture(invalid_handle).is_null(), "Images should be converted in the background.");
+	CHECK_MESSAGE(image_cache->get_texture(invalid_handle).is_null(), "Images should only be queued once.");
+	CHECK((uint64_t)image_cache->get_stats()["misses"] == (uint64_t)stats["misses"] + 1);
+	CHECK((int)image_cache->get_stats()["pending"] == 1);
+
+	for (int i = 0; i < 40 && (int)image_cache->get_stats()["pending"] > 0; i++) {
+		singleton->run_callbacks();
+		OS::get_singleton()->delay_usec(10000);
+	}
+	CHECK_MESSAGE((uint64_t)image_cache->get_stats()["failures"] == (uint64_t)stats["failures"] + 1, "Handles without an image should fail to convert.");
+	CHECK_MESSAGE(!image_cache->is_loaded(invalid_handle), "Failed handles shouldn't be cached.");
+	CHECK((int)image_cache->get_stats()["images"] == 0);
+	CHECK((int64_t)image_cache->get_stats()["bytes"] == 0);
+}
+
+TEST_CASE("[SteamFriends] Test image cache conversion and eviction") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<HBSteamImageCache> image_cache = singleton->get_utils()->get_image_cache();
+	REQUIRE(image_cache.is_valid());
+	image_cache->clear();
+
+	const uint64_t local_steam_id = singleton->get_user()->get_local_user()->get_steam_id();
+	const int small_handle = HBSteamAvatarCache::get_avatar_image_handle(local_steam_id, HBSteamAvatarCache::AVATAR_SIZE_SMALL);
+	const int medium_handle = HBSteamAvatarCache::get_avatar_image_handle(local_steam_id, HBSteamAvatarCache::AVATAR_SIZE_MEDIUM);
+	if (small_handle <= 0 || medium_handle <= 0) {
+		MESSAGE("The local user has no avatar to convert, skipping.");
+		return;
+	}
+
+	const int64_t memory_budget = image_cache->get_memory_budget();
+	Dictionary stats = image_cache->get_stats();
+	CHECK(image_cache->get_texture(small_handle).is_null());
+	CHECK(image_cache->get_texture(medium_handle).is_null());
+	for (int i = 0; i < 40 && (int)image_cache->get_stats()["pending"] > 0; i++) {
+		singleton->run_callbacks();
+		OS::get_singleton()->delay_usec(10000);
+	}
+	CHECK_MESSAGE((uint64_t)image_cache->get_stats()["conversions"] == (uint64_t)stats["conversions"] + 2, "Both avatars should be converted.");
+	REQUIRE(image_cache->is_loaded(small_handle));
+	REQUIRE(image_cache->is_loaded(medium_handle));
+
+	// Small avatars are 32x32 and medium ones 64x64, stored as uncompressed RGBA8 without mipmaps.
+	Ref<Texture2D> medium_texture = image_cache->get_texture(medium_handle);
+	Ref<Texture2D> small_texture = image_cache->get_texture(small_handle);
+	REQUIRE(medium_texture.is_valid());
+	REQUIRE(small_texture.is_valid());
+	CHECK(medium_texture->get_width() == 64);
+	CHECK(small_texture->get_width() == 32);
+	CHECK_MESSAGE(image_cache->get_texture(small_handle) == small_texture, "Loaded handles should keep returning the same texture.");
+	CHECK((uint64_t)image_cache->get_stats()["hits"] == (uint64_t)stats["hits"] + 3);
+	CHECK((uint64_t)image_cache->get_stats()["misses"] == (uint64_t)stats["misses"] + 2);
+	CHECK((int64_t)image_cache->get_stats()["bytes"] == 32 * 32 * 4 + 64 * 64 * 4);
+
+	// Only the small avatar fits, the medium one was used least recently.
+	image_cache->set_memory_budget(32 * 32 * 4);
+	CHECK((uint64_t)image_cache->get_stats()["evictions"] == (uint64_t)stats["evictions"] + 1);
+	CHECK_MESSAGE(!image_cache->is_loaded(medium_handle), "The least recently used image should be evicted.");
+	CHECK_MESSAGE(image_cache->is_loaded(small_handle), "Images within the budget should be kept.");
+	CHECK((int64_t)image_cache->get_stats()["bytes"] == 32 * 32 * 4);
+	CHECK_MESSAGE(medium_texture->get_width() == 64, "Evicted textures should stay valid for whoever holds them.");
+
+	image_cache->set_memory_budget(memory_budget);
+	image_cache->clear();
+}
+} //namespace TestSteamFriends
+
+#endif // TEST_STEAM_FRIENDS_H
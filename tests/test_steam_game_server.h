@@ -0,0 +1,122 @@
+/**************************************************************************/
+/*  test_steam_game_server.h                                              */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef TEST_STEAM_GAME_SERVER_H
+#define TEST_STEAM_GAME_SERVER_H
+
+#include "test_steamworks.h"
+#include "tests/test_macros.h"
+
+namespace TestSteamGameServer {
+class GameServerSignalTester : public RefCounted {
+	GDCLASS(GameServerSignalTester, RefCounted);
+
+public:
+	bool got_servers_connected_signal = false;
+	bool got_connect_failure_signal = false;
+	void _on_servers_connected() {
+		got_servers_connected_signal = true;
+	}
+	void _on_server_connect_failure(int p_result, bool p_still_retrying) {
+		got_connect_failure_signal = !p_still_retrying;
+	}
+};
+
+TEST_CASE("[SteamGameServer] Test game server mode") {
+	// Game server mode replaces the client API, so start from a fresh singleton and leave one behind
+	// for the other tests to reinitialize.
+	Steamworks *singleton = Steamworks::get_singleton();
+	if (singleton != nullptr) {
+		memdelete(singleton);
+	}
+	singleton = memnew(Steamworks);
+
+	REQUIRE_MESSAGE(singleton->init_game_server(TestSteamworks::TEST_APPID, 27015, 27016, SWC::SERVER_MODE_AUTHENTICATION_AND_SECURE, "1.0.0.0", "", false), "Game server should initialize without a Steam client.");
+	CHECK_MESSAGE(singleton->is_valid(), "is_valid() should return true in game server mode.");
+	CHECK_MESSAGE(singleton->is_game_server(), "is_game_server() should return true after init_game_server.");
+	CHECK_MESSAGE(singleton->get_game_server().is_valid(), "SteamGameServer interface should be valid.");
+	CHECK_MESSAGE(singleton->get_utils().is_valid(), "SteamUtils interface should be valid in game server mode.");
+	CHECK_MESSAGE(singleton->get_networking_messages().is_valid(), "SteamNetworkingMessages interface should be valid in game server mode.");
+	CHECK_MESSAGE(singleton->get_networking_utils().is_valid(), "SteamNetworkingUtils interface should be valid in game server mode.");
+	CHECK_MESSAGE(!singleton->get_friends().is_valid(), "Client only interfaces shouldn't exist in game server mode.");
+
+	ERR_PRINT_OFF;
+	CHECK_FALSE_MESSAGE(singleton->init(TestSteamworks::TEST_APPID, false), "Client init should fail when already running as a game server.");
+	ERR_PRINT_ON;
+
+	Ref<HBSteamGameServer> game_server = singleton->get_game_server();
+	game_server->set_product("eirteam_steamworks_test");
+	game_server->set_game_description("EIRTeam.Steamworks test server");
+	game_server->set_dedicated_server(true);
+	game_server->set_max_player_count(8);
+	game_server->set_server_name("Test server");
+	game_server->set_map_name("test_map");
+	PackedStringArray tags;
+	tags.push_back("test");
+	tags.push_back("headless");
+	game_server->set_game_tags(tags);
+
+	Ref<GameServerSignalTester> signal_tester;
+	signal_tester.instantiate();
+	game_server->connect("servers_connected", callable_mp(signal_tester.ptr(), &GameServerSignalTester::_on_servers_connected));
+	game_server->connect("server_connect_failure", callable_mp(signal_tester.ptr(), &GameServerSignalTester::_on_server_connect_failure));
+	game_server->log_on_anonymous();
+
+	for (int i = 0; i < 40; i++) {
+		singleton->run_callbacks();
+		if (signal_tester->got_servers_connected_signal || signal_tester->got_connect_failure_signal) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(250000);
+	}
+	CHECK_MESSAGE(signal_tester->got_servers_connected_signal, "Game server should log on anonymously.");
+	CHECK_MESSAGE(game_server->is_logged_on(), "Game server should be logged on after servers_connected.");
+	CHECK_MESSAGE(game_server->get_steam_id() != 0, "Logged on game server should have a Steam ID.");
+	game_server->set_advertise_server_active(true);
+
+	SUBCASE("[SteamGameServer] Test rejecting a bogus auth ticket") {
+		PackedByteArray ticket;
+		ticket.resize(16);
+		ticket.fill(0xAB);
+		uint64_t steam_id = 76561197960287930;
+		CHECK_MESSAGE(game_server->begin_auth_session(ticket, steam_id) != SWC::BEGIN_AUTH_SESSION_RESULT_OK, "A bogus ticket shouldn't start an auth session.");
+		CHECK_MESSAGE(!game_server->has_auth_session(steam_id), "A rejected ticket shouldn't be tracked as an auth session.");
+		CHECK_MESSAGE(!game_server->is_auth_session_validated(steam_id), "A rejected ticket shouldn't be validated.");
+	}
+
+	game_server->set_advertise_server_active(false);
+	game_server->log_off();
+	game_server = Ref<HBSteamGameServer>();
+	memdelete(singleton);
+	memnew(Steamworks);
+}
+} //namespace TestSteamGameServer
+
+#endif // TEST_STEAM_GAME_SERVER_H
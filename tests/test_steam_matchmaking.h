@@ -58,6 +58,11 @@ public:
 		got_lobby_data_updated_signal = true;
 	}
 
+	PackedStringArray lobby_data_changed_keys;
+	void _on_lobby_data_changed(PackedStringArray p_changed_keys, PackedStringArray p_removed_keys) {
+		lobby_data_changed_keys.append_array(p_changed_keys);
+	}
+
 	bool got_lobby_member_data_updated_signal = false;
 	Ref<HBSteamFriend> member_data_updated_signal_member;
 	void _on_lobby_member_data_updated(Ref<HBSteamFriend> p_lobby_user) {
@@ -74,11 +79,31 @@ public:
 		chat_msg_user = p_user;
 	}
 
+	PackedInt64Array chat_batch_sender_ids;
+	PackedInt32Array chat_batch_offsets;
+	PackedByteArray chat_batch_data;
+	int chat_batch_signal_count = 0;
+	void _on_chat_messages_received(PackedInt64Array p_sender_ids, PackedInt32Array p_types, PackedInt32Array p_offsets, PackedByteArray p_data) {
+		chat_batch_signal_count++;
+		chat_batch_sender_ids = p_sender_ids;
+		chat_batch_offsets = p_offsets;
+		chat_batch_data = p_data;
+	}
+
+	PackedStringArray state_store_changed_keys;
+	PackedStringArray state_store_removed_keys;
+	void _on_state_store_values_changed(PackedStringArray p_changed_keys, PackedStringArray p_removed_keys) {
+		state_store_changed_keys.append_array(p_changed_keys);
+		state_store_removed_keys.append_array(p_removed_keys);
+	}
+
 	void connect_signals_to_lobby(Ref<HBSteamLobby> p_lobby) {
 		p_lobby->connect("lobby_created", callable_mp(this, &MatchmakingSignalTester::_on_test_lobby_creation));
 		p_lobby->connect("lobby_entered", callable_mp(this, &MatchmakingSignalTester::_on_test_lobby_entered));
 		p_lobby->connect("chat_message_received", callable_mp(this, &MatchmakingSignalTester::_on_chat_message_received));
+		p_lobby->connect("chat_messages_received", callable_mp(this, &MatchmakingSignalTester::_on_chat_messages_received));
 		p_lobby->connect("lobby_data_updated", callable_mp(this, &MatchmakingSignalTester::_on_lobby_data_updated));
+		p_lobby->connect("lobby_data_changed", callable_mp(this, &MatchmakingSignalTester::_on_lobby_data_changed));
 		p_lobby->connect("lobby_member_data_updated", callable_mp(this, &MatchmakingSignalTester::_on_lobby_member_data_updated));
 	}
 };
@@ -124,11 +149,19 @@ TEST_CASE("[SteamMatchmaking] Test lobby creation and interaction") {
 		}
 		CHECK_MESSAGE(lobby->get_data("test data") == "test value", "Lobby data should be the same as the set data.");
 		CHECK_MESSAGE(signal_tester->got_lobby_data_updated_signal, "Setting lobby data should trigger a lobby data updated signal.");
+		CHECK_MESSAGE(signal_tester->lobby_data_changed_keys.has("test data"), "Setting lobby data should report the changed key.");
+		Dictionary lobby_data = lobby->get_all_lobby_data();
+		CHECK_MESSAGE(lobby_data.get("test data", "") == "test value", "Cached lobby data should contain the set data.");
+		CHECK_MESSAGE(lobby->get_all_lobby_data().id() == lobby_data.id(), "Cached lobby data should be reused while nothing changes.");
 	}
 
 	SUBCASE("Test setting lobby member data") {
 		// Creating the lobby might have triggered this already, so let's reset it
 		signal_tester->got_lobby_member_data_updated_signal = false;
+		PackedStringArray tracked_keys;
+		tracked_keys.push_back("test member data");
+		lobby->set_tracked_member_data_keys(tracked_keys);
+		uint64_t roster_version = lobby->get_roster_version();
 		lobby->set_member_data("test member data", "test member value");
 		for (int i = 0; i < 4; i++) {
 			singleton->run_callbacks();
@@ -140,6 +173,104 @@ TEST_CASE("[SteamMatchmaking] Test lobby creation and interaction") {
 		CHECK_MESSAGE(lobby->get_member_data(local_user, "test member data") == "test member value", "Lobby data should be the same as the set data.");
 		CHECK_MESSAGE(signal_tester->got_lobby_member_data_updated_signal, "Setting lobby member data should trigger a lobby member data updated signal.");
 		CHECK_MESSAGE(local_user == signal_tester->member_data_updated_signal_member, "Lobby member data updated signal should return the lobby member that triggered it.");
+		Dictionary snapshot = lobby->get_member_data_snapshot(local_user);
+		CHECK_MESSAGE(snapshot.get("test member data", "") == "test member value", "Member data snapshot should contain the set data.");
+		CHECK_MESSAGE(lobby->get_roster_version() > roster_version, "Changing tracked member data should bump the roster version.");
+	}
+
+	SUBCASE("Test lobby member roster") {
+		PackedInt64Array member_ids = lobby->get_member_ids();
+		CHECK_MESSAGE(member_ids.size() == 1, "Lobby should only contain the local user.");
+		CHECK_MESSAGE(member_ids.has(local_user->get_steam_id()), "Lobby roster should contain the local user.");
+		CHECK_MESSAGE(lobby->get_members_count() == member_ids.size(), "Member count should match the roster.");
+		uint64_t roster_version = lobby->get_roster_version();
+		CHECK_MESSAGE(lobby->get_members().size() == member_ids.size(), "Member list should match the roster.");
+		CHECK_MESSAGE(lobby->get_roster_version() == roster_version, "Roster version shouldn't change while nothing changes.");
+	}
+
+	SUBCASE("Test coalescing lobby data writes") {
+		lobby->set_coalesce_writes(true);
+		signal_tester->lobby_data_changed_keys.clear();
+		lobby->set_data("coalesced data", "first value");
+		lobby->set_data("coalesced data", "second value");
+		lobby->set_data("coalesced data", "final value");
+		CHECK_MESSAGE(lobby->has_pending_writes(), "Coalesced writes should be buffered.");
+		CHECK_MESSAGE(lobby->get_data("coalesced data") == "final value", "Buffered writes should be visible right away.");
+		for (int i = 0; i < 4; i++) {
+			singleton->run_callbacks();
+			if (signal_tester->lobby_data_changed_keys.has("coalesced data")) {
+				break;
+			}
+			OS::get_singleton()->delay_usec(500000);
+		}
+		CHECK_MESSAGE(!lobby->has_pending_writes(), "Running callbacks should flush buffered writes.");
+		CHECK_MESSAGE(lobby->get_data("coalesced data") == "final value", "Flushed lobby data should be the last written value.");
+		lobby->set_data("coalesced data", "final value");
+		CHECK_MESSAGE(!lobby->has_pending_writes(), "Writing the current value should be skipped.");
+		Dictionary write_stats = lobby->get_write_stats();
+		CHECK_MESSAGE(int(write_stats["writes_coalesced"]) == 2, "Repeated writes to the same key should be coalesced.");
+		CHECK_MESSAGE(int(write_stats["writes_skipped"]) == 1, "No-op writes should be skipped.");
+		CHECK_MESSAGE(lobby->get_saved_write_count() == 3, "Saved writes should include coalesced and skipped writes.");
+	}
+
+	SUBCASE("Test lobby state store") {
+		Ref<HBLobbyStateStore> store = lobby->create_state_store("test_store");
+		REQUIRE(store.is_valid());
+		store->connect("values_changed", callable_mp(signal_tester.ptr(), &MatchmakingSignalTester::_on_state_store_values_changed));
+
+		store->set_value("ready", "1");
+		store->set_value("loadout", "sword");
+		store->set_value("loadout", "bow");
+		CHECK_MESSAGE(store->get_value("loadout") == "bow", "Local writes should be visible right away.");
+		CHECK_MESSAGE(store->get_writer("loadout") == HBLobbyStateStore::OWNER_WRITER, "The lobby owner's writes should be published as the owner's.");
+		uint64_t loadout_version = store->get_version("loadout");
+		CHECK_MESSAGE(loadout_version > store->get_version("ready"), "Later writes should get higher versions.");
+		store->set_value("loadout", "bow");
+		CHECK_MESSAGE(store->get_version("loadout") == loadout_version, "Writing the current value again shouldn't create a new version.");
+
+		singleton->run_callbacks();
+		CHECK_MESSAGE(signal_tester->state_store_changed_keys.size() == 2, "Each changed key should be reported once per frame.");
+		CHECK_MESSAGE(lobby->get_data("test_store:n") == "1", "Small stores should be packed into a single lobby data value.");
+
+		store->erase_value("ready");
+		store->flush();
+		CHECK_MESSAGE(!store->has_value("ready"), "Erased keys shouldn't have a value.");
+		CHECK_MESSAGE(signal_tester->state_store_removed_keys.has("ready"), "Erased keys should be reported as removed.");
+		Dictionary version_vector = store->get_version_vector("ready");
+		CHECK_MESSAGE((uint64_t)version_vector[HBLobbyStateStore::OWNER_WRITER] > loadout_version, "The erase should be versioned like any other write.");
+
+		Ref<HBLobbyStateStore> other_store = lobby->create_state_store("test_store");
+		CHECK_MESSAGE(other_store->get_value("loadout") == "bow", "A new store should read back what was published.");
+		CHECK_MESSAGE(!other_store->has_value("ready"), "A new store should read back published erases.");
+	}
+
+	SUBCASE("Test host migration") {
+		Ref<HBSteamNetworkingMessages> networking_messages = singleton->get_networking_messages();
+		Ref<HBSteamPeerGroup> peer_group = networking_messages->create_peer_group();
+		ERR_PRINT_OFF;
+		CHECK_MESSAGE(networking_messages->create_host_migration(peer_group, 3).is_null(), "Host migration should need a peer group that tracks a lobby.");
+		ERR_PRINT_ON;
+
+		peer_group->track_lobby(lobby);
+		Ref<HBSteamHostMigration> host_migration = networking_messages->create_host_migration(peer_group, 3);
+		REQUIRE(host_migration.is_valid());
+		CHECK_MESSAGE(host_migration->is_host(), "The lobby owner should start out as the host.");
+		CHECK_MESSAGE(host_migration->get_host_peer() == HBSteamNetworkingMessages::INVALID_PEER, "The local host shouldn't have a host peer.");
+
+		PackedByteArray state;
+		state.resize(1024);
+		state.fill(7);
+		host_migration->set_authoritative_state(state);
+		host_migration->poll();
+		CHECK_MESSAGE(host_migration->get_successors().is_empty(), "A lobby with a single member has no successors.");
+		CHECK_MESSAGE((uint64_t)host_migration->get_stats()["states_sent"] == 0, "The state shouldn't be sent when there is nobody to take over.");
+
+		host_migration->set_eligible(false);
+		CHECK_MESSAGE(lobby->get_member_data(local_user, "hm_eligible") == "0", "Eligibility should be published in the member data.");
+		ERR_PRINT_OFF;
+		CHECK_MESSAGE(!host_migration->hand_off(), "Hosting can't be handed off without a successor.");
+		ERR_PRINT_ON;
+		CHECK_MESSAGE(host_migration->is_host(), "A failed hand off should keep the host.");
 	}
 
 	SUBCASE("Test getting and setting lobby max members") {
@@ -163,6 +294,60 @@ TEST_CASE("[SteamMatchmaking] Test lobby creation and interaction") {
 		s.parse_utf8((const char *)signal_tester->chat_msg_data.ptr(), signal_tester->chat_msg_data.size());
 		CHECK_MESSAGE(s == test_chat_msg_string, "Send chat string should trigger a chat message received signal.");
 	}
+
+	SUBCASE("Test binary lobby chat starting with the frame marker") {
+		// Would look like a frame holding a single one byte message if it was sent as is.
+		PackedByteArray message;
+		message.push_back(HBSteamLobby::CHAT_FRAME_MARKER);
+		message.push_back(1);
+		message.push_back(0);
+		message.push_back(42);
+		CHECK(lobby->send_chat_binary(message));
+		for (int i = 0; i < 4; i++) {
+			singleton->run_callbacks();
+			if (signal_tester->got_chat_message_received_signal) {
+				break;
+			}
+			OS::get_singleton()->delay_usec(500000);
+		}
+		CHECK_MESSAGE(signal_tester->got_chat_message_received_signal, "Binary chat starting with the frame marker should be received.");
+		CHECK_MESSAGE(signal_tester->chat_msg_data == message, "Binary chat starting with the frame marker should arrive unchanged.");
+	}
+
+	SUBCASE("Test batched framed lobby chat") {
+		lobby->set_batch_chat_messages(true);
+		PackedByteArray first_message = String("first").to_utf8_buffer();
+		PackedByteArray second_message;
+		second_message.push_back(HBSteamLobby::CHAT_FRAME_MARKER);
+		second_message.push_back(0);
+		CHECK(lobby->queue_chat_message(first_message));
+		CHECK(lobby->queue_chat_message(second_message));
+		CHECK(lobby->queue_chat_message(PackedByteArray()));
+		CHECK_MESSAGE(lobby->has_queued_chat_messages(), "Queued chat messages should wait for the next frame.");
+
+		ERR_PRINT_OFF;
+		PackedByteArray too_big;
+		too_big.resize(HBSteamLobby::MAX_FRAMED_CHAT_MESSAGE_SIZE + 1);
+		CHECK_FALSE_MESSAGE(lobby->queue_chat_message(too_big), "Messages that don't fit in a chat entry should be rejected.");
+		ERR_PRINT_ON;
+
+		for (int i = 0; i < 8; i++) {
+			singleton->run_callbacks();
+			if (signal_tester->chat_batch_signal_count > 0) {
+				break;
+			}
+			OS::get_singleton()->delay_usec(500000);
+		}
+		CHECK_MESSAGE(!lobby->has_queued_chat_messages(), "Queued chat messages should be sent on the next frame.");
+		CHECK_MESSAGE(!signal_tester->got_chat_message_received_signal, "Batched chat messages shouldn't be reported one by one.");
+		CHECK_MESSAGE(signal_tester->chat_batch_signal_count == 1, "Messages sharing a chat entry should arrive in a single batch.");
+		REQUIRE_MESSAGE(signal_tester->chat_batch_sender_ids.size() == 3, "Every framed message should be split out of the chat entry.");
+		REQUIRE(signal_tester->chat_batch_offsets.size() == 4);
+		const PackedInt32Array &offsets = signal_tester->chat_batch_offsets;
+		CHECK_MESSAGE(signal_tester->chat_batch_data.slice(offsets[0], offsets[1]) == first_message, "Framed messages should arrive unchanged.");
+		CHECK_MESSAGE(signal_tester->chat_batch_data.slice(offsets[1], offsets[2]) == second_message, "Framed messages starting with the frame marker should arrive unchanged.");
+		CHECK_MESSAGE(offsets[3] == offsets[2], "Empty framed messages should be kept.");
+	}
 }
 
 TEST_CASE("[SteamMatchmaking] Test lobby listing") {
@@ -197,6 +382,133 @@ TEST_CASE("[SteamMatchmaking] Test lobby listing") {
 	}
 	CHECK_MESSAGE(signal_tester->got_lobby_list_signal, "Lobby query should trigger lobby list received signal.");
 }
+
+TEST_CASE("[SteamMatchmaking] Test lobby listing with prefetched data") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<MatchmakingSignalTester> signal_tester;
+	signal_tester.instantiate();
+
+	PackedStringArray keys;
+	keys.push_back("ping_location");
+	keys.push_back("test");
+	Ref<HBLobbyListQuery> query = singleton->get_matchmaking()->create_lobby_list_query()
+										  ->filter_distance_worldwide()
+										  ->with_prefetched_keys(keys)
+										  ->request_lobby_list();
+	query->connect("received_lobby_list", callable_mp(signal_tester.ptr(), &MatchmakingSignalTester::_on_test_lobby_list));
+
+	for (int i = 0; i < 4; i++) {
+		singleton->run_callbacks();
+		if (signal_tester->got_lobby_list_signal) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(500000);
+	}
+	CHECK_MESSAGE(signal_tester->got_lobby_list_signal, "Lobby query should trigger lobby list received signal.");
+	Ref<HBLobbyListSnapshot> snapshot = query->get_snapshot();
+	REQUIRE_MESSAGE(snapshot.is_valid(), "Lobby query with prefetched keys should build a snapshot.");
+	CHECK_MESSAGE(snapshot->get_keys() == keys, "Snapshot should contain the prefetched keys.");
+	int lobby_count = snapshot->get_lobby_count();
+	CHECK_MESSAGE(snapshot->get_lobby_ids().size() == lobby_count, "Snapshot columns should have an entry per lobby.");
+	CHECK_MESSAGE(snapshot->get_member_counts().size() == lobby_count, "Snapshot columns should have an entry per lobby.");
+	CHECK_MESSAGE(snapshot->get_member_limits().size() == lobby_count, "Snapshot columns should have an entry per lobby.");
+	CHECK_MESSAGE(snapshot->get_column("test").size() == lobby_count, "Snapshot columns should have an entry per lobby.");
+	for (int i = 0; i < lobby_count; i++) {
+		if (snapshot->is_lobby_pending(i)) {
+			continue;
+		}
+		Ref<HBSteamLobby> lobby = snapshot->get_lobby(i);
+		CHECK_MESSAGE(snapshot->get_value(i, "ping_location") == lobby->get_ping_location(), "Snapshot data should match the lobby data.");
+	}
+}
+
+TEST_CASE("[SteamMatchmaking] Test lobby listing sorted by estimated ping") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<MatchmakingSignalTester> signal_tester;
+	signal_tester.instantiate();
+
+	Ref<HBLobbyListQuery> query = singleton->get_matchmaking()->create_lobby_list_query()
+										  ->filter_distance_worldwide()
+										  ->sort_by_estimated_ping()
+										  ->request_lobby_list();
+	query->connect("received_lobby_list", callable_mp(signal_tester.ptr(), &MatchmakingSignalTester::_on_test_lobby_list));
+
+	for (int i = 0; i < 8; i++) {
+		singleton->run_callbacks();
+		if (signal_tester->got_lobby_list_signal) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(500000);
+	}
+	CHECK_MESSAGE(signal_tester->got_lobby_list_signal, "Lobby query sorted by ping should trigger lobby list received signal.");
+	PackedInt32Array pings = query->get_estimated_pings();
+	for (int i = 1; i < pings.size(); i++) {
+		if (pings[i] == HBSteamNetworkingUtils::PING_UNKNOWN) {
+			continue;
+		}
+		CHECK_MESSAGE(pings[i - 1] != HBSteamNetworkingUtils::PING_UNKNOWN, "Lobbies with unknown ping should be sorted last.");
+		CHECK_MESSAGE(pings[i - 1] <= pings[i], "Lobbies should be sorted by estimated ping.");
+	}
+}
+
+TEST_CASE("[SteamMatchmaking] Test lobby list cache") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<HBSteamMatchmaking> matchmaking = singleton->get_matchmaking();
+	REQUIRE(matchmaking->is_valid());
+	matchmaking->clear_lobby_list_cache();
+	Dictionary initial_stats = matchmaking->get_lobby_list_cache_stats();
+
+	Ref<HBLobbyListQuery> first_query = matchmaking->create_lobby_list_query()
+												->with_equal("cache_test", 1)
+												->with_key_value("cache_mode", "test");
+	Ref<HBLobbyListQuery> second_query = matchmaking->create_lobby_list_query()
+												 ->with_key_value("cache_mode", "test")
+												 ->with_equal("cache_test", 1);
+	CHECK_MESSAGE(first_query->get_fingerprint() == second_query->get_fingerprint(), "Filter order shouldn't change the query fingerprint.");
+	Ref<HBLobbyListQuery> other_query = matchmaking->create_lobby_list_query()->with_equal("cache_test", 2);
+	CHECK_MESSAGE(first_query->get_fingerprint() != other_query->get_fingerprint(), "Different filters should have different fingerprints.");
+
+	Ref<MatchmakingSignalTester> first_tester;
+	first_tester.instantiate();
+	Ref<MatchmakingSignalTester> second_tester;
+	second_tester.instantiate();
+
+	first_query->with_cache_ttl(60.0)->request_lobby_list();
+	first_query->connect("received_lobby_list", callable_mp(first_tester.ptr(), &MatchmakingSignalTester::_on_test_lobby_list));
+	second_query->with_cache_ttl(60.0)->request_lobby_list();
+	second_query->connect("received_lobby_list", callable_mp(second_tester.ptr(), &MatchmakingSignalTester::_on_test_lobby_list));
+
+	for (int i = 0; i < 4; i++) {
+		singleton->run_callbacks();
+		if (first_tester->got_lobby_list_signal && second_tester->got_lobby_list_signal) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(500000);
+	}
+	CHECK_MESSAGE(first_tester->got_lobby_list_signal, "First lobby query should trigger lobby list received signal.");
+	CHECK_MESSAGE(second_tester->got_lobby_list_signal, "Identical lobby query should share the in-flight request.");
+	Dictionary stats = matchmaking->get_lobby_list_cache_stats();
+	CHECK_MESSAGE(int(stats["requests_sent"]) - int(initial_stats["requests_sent"]) == 1, "Identical in-flight queries should only send one request.");
+	CHECK_MESSAGE(int(stats["requests_shared"]) - int(initial_stats["requests_shared"]) == 1, "Identical in-flight queries should share the request.");
+
+	second_tester->got_lobby_list_signal = false;
+	second_query->request_lobby_list();
+	CHECK_MESSAGE(!second_tester->got_lobby_list_signal, "Cached results should be emitted on the next frame.");
+	singleton->run_callbacks();
+	CHECK_MESSAGE(second_tester->got_lobby_list_signal, "Cached results should be emitted on the next frame.");
+	stats = matchmaking->get_lobby_list_cache_stats();
+	CHECK_MESSAGE(int(stats["requests_sent"]) - int(initial_stats["requests_sent"]) == 1, "Cached query shouldn't send another request.");
+	CHECK_MESSAGE(int(stats["cache_hits"]) - int(initial_stats["cache_hits"]) == 1, "Cached query should count as a cache hit.");
+}
 } //namespace TestSteamMatchmaking
 
 #endif // TEST_STEAM_MATCHMAKING_H
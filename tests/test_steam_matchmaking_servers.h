@@ -0,0 +1,96 @@
+/**************************************************************************/
+/*  test_steam_matchmaking_servers.h                                      */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                           EIRTeam.Steamworks                           */
+/*                         https://ph.eirteam.moe                         */
+/**************************************************************************/
+/* Copyright (c) 2023-present Álex Román (EIRTeam) & contributors.        */
+/*                                                                        */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef TEST_STEAM_MATCHMAKING_SERVERS_H
+#define TEST_STEAM_MATCHMAKING_SERVERS_H
+
+#include "test_steamworks.h"
+#include "tests/test_macros.h"
+
+namespace TestSteamMatchmakingServers {
+class ServerListSignalTester : public RefCounted {
+	GDCLASS(ServerListSignalTester, RefCounted);
+
+public:
+	bool got_refresh_completed_signal = false;
+	int responded_rows = 0;
+	void _on_server_responded(PackedInt32Array p_rows) {
+		responded_rows += p_rows.size();
+	}
+	void _on_refresh_completed(int p_response) {
+		got_refresh_completed_signal = true;
+	}
+};
+
+TEST_CASE("[SteamMatchmakingServers] Test LAN server list") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Steamworks *singleton = Steamworks::get_singleton();
+	singleton->set_run_callbacks_automatically(false);
+
+	Ref<HBSteamMatchmakingServers> matchmaking_servers = singleton->get_matchmaking_servers();
+	REQUIRE(matchmaking_servers->is_valid());
+
+	Ref<ServerListSignalTester> signal_tester;
+	signal_tester.instantiate();
+
+	Ref<HBSteamServerList> server_list = matchmaking_servers->request_lan_server_list();
+	REQUIRE(server_list.is_valid());
+	CHECK_MESSAGE(server_list->is_refreshing(), "Server list should be refreshing after being requested.");
+	server_list->connect("server_responded", callable_mp(signal_tester.ptr(), &ServerListSignalTester::_on_server_responded));
+	server_list->connect("refresh_completed", callable_mp(signal_tester.ptr(), &ServerListSignalTester::_on_refresh_completed));
+
+	for (int i = 0; i < 20; i++) {
+		singleton->run_callbacks();
+		if (signal_tester->got_refresh_completed_signal) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(500000);
+	}
+	CHECK_MESSAGE(signal_tester->got_refresh_completed_signal, "LAN server list should complete.");
+	CHECK_MESSAGE(!server_list->is_refreshing(), "Server list shouldn't be refreshing once completed.");
+
+	int row_count = server_list->get_row_count();
+	CHECK_MESSAGE(signal_tester->responded_rows == row_count, "Every row should have been reported as it responded.");
+	CHECK_MESSAGE(server_list->get_names().size() == row_count, "Server list columns should have an entry per row.");
+	CHECK_MESSAGE(server_list->get_pings().size() == row_count, "Server list columns should have an entry per row.");
+	CHECK_MESSAGE(server_list->get_addresses().size() == row_count, "Server list columns should have an entry per row.");
+
+	PackedInt32Array rows_by_ping = server_list->get_sorted_rows(HBSteamServerList::COLUMN_PING);
+	CHECK_MESSAGE(rows_by_ping.size() == row_count, "Sorting should return every row.");
+	PackedInt32Array pings = server_list->get_pings();
+	for (int i = 1; i < rows_by_ping.size(); i++) {
+		CHECK_MESSAGE(pings[rows_by_ping[i - 1]] <= pings[rows_by_ping[i]], "Rows should be sorted by ping.");
+	}
+	PackedInt32Array empty_servers = server_list->filter_rows_by_range(HBSteamServerList::COLUMN_PLAYERS, 0, 0);
+	CHECK_MESSAGE(empty_servers.size() <= row_count, "Filtering shouldn't return more rows than there are.");
+}
+} //namespace TestSteamMatchmakingServers
+
+#endif // TEST_STEAM_MATCHMAKING_SERVERS_H
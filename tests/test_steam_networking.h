@@ -31,6 +31,7 @@
 #ifndef TEST_STEAM_NETWORKING_H
 #define TEST_STEAM_NETWORKING_H
 
+#include "../steamworks_messages.gen.h"
 #include "test_steamworks.h"
 #include "tests/test_macros.h"
 
@@ -59,6 +60,287 @@ TEST_CASE("[SteamNetworking] Test sending an receiving Steam P2P packets") {
 	CHECK_MESSAGE(packet->get_data().size() == 3, "The received P2P packet should be the same length as the sent one.");
 	CHECK_MESSAGE(packet->get_data()[1] == 2, "The received P2P packet should match the sent data.");
 }
+
+TEST_CASE("[SteamNetworking] Test peer handles for Steam networking messages") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamFriend> local_user = Steamworks::get_singleton()->get_user()->get_local_user();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+
+	int peer = networking_messages->get_peer_handle(local_user->get_steam_id());
+	CHECK_MESSAGE(peer != HBSteamNetworkingMessages::INVALID_PEER, "The local user should get a valid peer handle.");
+	CHECK_MESSAGE(networking_messages->get_peer_handle_for_user(local_user) == peer, "Peer handles should be stable for the same user.");
+	CHECK_MESSAGE(networking_messages->get_peer_steam_id(peer) == local_user->get_steam_id(), "Peer handles should map back to the user's Steam ID.");
+
+	PackedByteArray test_data;
+	test_data.push_back(4);
+	test_data.push_back(5);
+	SWC::Result result = networking_messages->send_message_to_peer(test_data, peer, 0, 1);
+	CHECK_MESSAGE(result == SWC::RESULT_OK, "Sending a message to a peer handle should succeed.");
+
+	TypedArray<HBSteamNetworkingMessage> messages;
+	for (int i = 0; i < 40; i++) {
+		Steamworks::get_singleton()->run_callbacks();
+		messages = networking_messages->poll_messages(1);
+		if (messages.size() > 0) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(50000);
+	}
+	REQUIRE_MESSAGE(messages.size() == 1, "The message sent to the local peer should be received.");
+	Ref<HBSteamNetworkingMessage> message = messages[0];
+	CHECK_MESSAGE(message->get_sender_peer() == peer, "Received messages should report the sender's peer handle.");
+	CHECK_MESSAGE(message->get_sender() == local_user, "Received messages should report the sender.");
+	CHECK_MESSAGE(message->get_data() == test_data, "The received message should match the sent data.");
+}
+
+TEST_CASE("[SteamNetworking] Test peer group membership") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	Ref<HBSteamPeerGroup> peer_group = networking_messages->create_peer_group();
+	REQUIRE(peer_group.is_valid());
+
+	int peer = networking_messages->get_peer_handle(Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id());
+	peer_group->add_peer(peer);
+	peer_group->add_peer(peer);
+	CHECK_MESSAGE(peer_group->get_peer_count() == 1, "Adding the same peer twice should not duplicate it.");
+	CHECK_MESSAGE(peer_group->has_peer(peer), "The peer group should contain the added peer.");
+
+	PackedByteArray test_data;
+	test_data.push_back(6);
+	CHECK_MESSAGE(peer_group->send_to_group(test_data, 0, 2, peer) == SWC::RESULT_OK, "Sending to a group where every peer is excluded should succeed.");
+
+	peer_group->remove_peer(peer);
+	CHECK_MESSAGE(peer_group->get_peer_count() == 0, "Removing a peer should remove it from the group.");
+
+	ERR_PRINT_OFF;
+	peer_group->add_peer(999);
+	ERR_PRINT_ON;
+	CHECK_MESSAGE(peer_group->get_peer_count() == 0, "Unknown peer handles should not be added to a group.");
+}
+
+TEST_CASE("[SteamNetworking] Test releasing peer handles") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	Ref<HBSteamPeerGroup> peer_group = networking_messages->create_peer_group();
+	const uint64_t steam_id = 76561198000000001ULL;
+
+	int peer = networking_messages->get_peer_handle(steam_id);
+	REQUIRE(networking_messages->is_peer_valid(peer));
+	peer_group->add_peer(peer);
+	networking_messages->close_session_with_peer(peer);
+	CHECK_MESSAGE(networking_messages->is_peer_valid(peer), "Handles held by a peer group should survive their session closing.");
+
+	peer_group->remove_peer(peer);
+	CHECK_MESSAGE(!networking_messages->is_peer_valid(peer), "Handles should be released once no group holds a closed peer.");
+	CHECK_MESSAGE(networking_messages->find_peer_handle(steam_id) == HBSteamNetworkingMessages::INVALID_PEER, "Released peers should no longer be found.");
+
+	int new_peer = networking_messages->get_peer_handle(steam_id + 1);
+	REQUIRE(networking_messages->is_peer_valid(new_peer));
+	CHECK_MESSAGE(new_peer != peer, "Handles that reuse a released slot should differ from the released handle.");
+	ERR_PRINT_OFF;
+	CHECK_MESSAGE(networking_messages->get_peer_steam_id(peer) == 0, "Stale handles shouldn't map to the peer that reused their slot.");
+	PackedByteArray test_data;
+	test_data.push_back(1);
+	CHECK_MESSAGE(networking_messages->send_message_to_peer(test_data, peer, 0, 3) == SWC::RESULT_FAIL, "Sending to a stale handle should fail.");
+	peer_group->add_peer(peer);
+	ERR_PRINT_ON;
+	CHECK_MESSAGE(peer_group->get_peer_count() == 0, "Stale handles should not be added to a group.");
+	networking_messages->close_session_with_peer(new_peer);
+}
+
+TEST_CASE("[SteamNetworking] Test schema message encoding") {
+	Ref<HBSteamTestMessage> message;
+	message.instantiate();
+	message->set_entity_id(1234);
+	message->set_delta(-7);
+	message->set_grounded(true);
+	message->set_position(Vector3(12.5, -300.25, 1000.0));
+	message->set_yaw(1.0);
+	message->set_speed(3.25);
+	message->set_steam_id(76561198000000000ULL);
+	message->set_nickname("Heartbeat");
+	PackedByteArray payload;
+	payload.push_back(7);
+	payload.push_back(8);
+	message->set_payload(payload);
+
+	PackedByteArray encoded = message->encode();
+	CHECK_MESSAGE(encoded.size() > 0, "Encoding a schema message should produce data.");
+	CHECK_MESSAGE(encoded.size() <= (int)HBSteamTestMessage::MAX_ENCODED_SIZE, "Encoded messages should fit their maximum encoded size.");
+	CHECK_MESSAGE(encoded[0] == HBSteamTestMessage::MESSAGE_ID, "Encoded messages should start with their message ID.");
+
+	Ref<HBSteamTestMessage> decoded = HBSteamSchemaMessage::decode(encoded);
+	REQUIRE_MESSAGE(decoded.is_valid(), "Decoding an encoded message should produce a message of the same type.");
+	CHECK(decoded->get_entity_id() == 1234);
+	CHECK(decoded->get_delta() == -7);
+	CHECK(decoded->get_grounded());
+	CHECK_MESSAGE(decoded->get_position().distance_to(Vector3(12.5, -300.25, 1000.0)) < 0.01, "Quantized vectors should be decoded within the quantization step.");
+	CHECK_MESSAGE(Math::abs(decoded->get_yaw() - 1.0) < 0.01, "Quantized floats should be decoded within the quantization step.");
+	CHECK(decoded->get_speed() == 3.25);
+	CHECK(decoded->get_steam_id() == 76561198000000000ULL);
+	CHECK_MESSAGE(!decoded->has_health(), "Unset optional fields should stay unset.");
+	CHECK_MESSAGE(decoded->has_nickname(), "Set optional fields should be decoded.");
+	CHECK(decoded->get_nickname() == "Heartbeat");
+	CHECK(decoded->get_payload() == payload);
+
+	encoded.resize(encoded.size() / 2);
+	ERR_PRINT_OFF;
+	CHECK_MESSAGE(HBSteamSchemaMessage::decode(encoded).is_null(), "Truncated messages should fail to decode.");
+	ERR_PRINT_ON;
+}
+
+TEST_CASE("[SteamNetworking] Test sending schema messages") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	int peer = networking_messages->get_peer_handle(Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id());
+
+	Ref<HBSteamTestMessage> message;
+	message.instantiate();
+	message->set_entity_id(42);
+	message->set_health(-20);
+	CHECK_MESSAGE(message->send_to_peer(networking_messages, peer, 0, 3) == SWC::RESULT_OK, "Sending a schema message to a peer should succeed.");
+
+	TypedArray<HBSteamNetworkingMessage> messages;
+	for (int i = 0; i < 40; i++) {
+		Steamworks::get_singleton()->run_callbacks();
+		messages = networking_messages->poll_messages(3);
+		if (messages.size() > 0) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(50000);
+	}
+	REQUIRE_MESSAGE(messages.size() == 1, "The schema message sent to the local peer should be received.");
+	Ref<HBSteamTestMessage> received = HBSteamSchemaMessage::decode_network_message(messages[0]);
+	REQUIRE_MESSAGE(received.is_valid(), "The received schema message should decode.");
+	CHECK(received->get_sender_peer() == peer);
+	CHECK(received->get_entity_id() == 42);
+	CHECK(received->has_health());
+	CHECK(received->get_health() == -20);
+}
+
+TEST_CASE("[SteamNetworking] Test delta compressed snapshot replication") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	int peer = networking_messages->get_peer_handle(Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id());
+	Ref<HBSteamPeerGroup> peer_group = networking_messages->create_peer_group();
+	peer_group->add_peer(peer);
+	Ref<HBSteamSnapshotReplicator> replicator = networking_messages->create_snapshot_replicator(peer_group, 4);
+	REQUIRE(replicator.is_valid());
+
+	PackedByteArray snapshot;
+	snapshot.resize(2048);
+	for (int i = 0; i < snapshot.size(); i++) {
+		snapshot.set(i, i % 251);
+	}
+	CHECK(replicator->send_snapshot(snapshot) == SWC::RESULT_OK);
+
+	// The first snapshot has no baseline, the loopback peer acks it from the next poll.
+	for (int i = 0; i < 40; i++) {
+		Steamworks::get_singleton()->run_callbacks();
+		replicator->poll();
+		if (replicator->get_peer_acked_sequence(peer) == 0) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(50000);
+	}
+	REQUIRE_MESSAGE(replicator->get_peer_acked_sequence(peer) == 0, "The first snapshot should be acknowledged.");
+	CHECK(replicator->get_latest_snapshot(peer) == snapshot);
+
+	snapshot.set(100, 0);
+	snapshot.set(1500, 0);
+	CHECK(replicator->send_snapshot(snapshot) == SWC::RESULT_OK);
+	for (int i = 0; i < 40; i++) {
+		Steamworks::get_singleton()->run_callbacks();
+		replicator->poll();
+		if (replicator->get_latest_snapshot(peer) == snapshot) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(50000);
+	}
+	CHECK_MESSAGE(replicator->get_latest_snapshot(peer) == snapshot, "The delta compressed snapshot should be reconstructed.");
+
+	Dictionary stats = replicator->get_peer_stats(peer);
+	CHECK(int(stats["full_snapshots_sent"]) == 1);
+	CHECK(int(stats["delta_snapshots_sent"]) == 1);
+	CHECK_MESSAGE(int64_t(stats["bytes_sent"]) < snapshot.size() + 100, "The second snapshot should be much smaller than the first.");
+
+	PackedByteArray oversized_snapshot;
+	oversized_snapshot.resize(512 * 1024);
+	ERR_PRINT_OFF;
+	CHECK_MESSAGE(replicator->send_snapshot(oversized_snapshot) == SWC::RESULT_FAIL, "Snapshots that don't fit in a Steam message should be rejected.");
+	ERR_PRINT_ON;
+	CHECK_MESSAGE(int(replicator->get_peer_stats(peer)["full_snapshots_sent"]) == 1, "Rejected snapshots shouldn't be sent.");
+}
+
+TEST_CASE("[SteamNetworking] Test redundant input transport") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	int peer = networking_messages->get_peer_handle(Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id());
+	Ref<HBSteamPeerGroup> peer_group = networking_messages->create_peer_group();
+	peer_group->add_peer(peer);
+	Ref<HBSteamInputTransport> transport = networking_messages->create_input_transport(peer_group, 5, 4);
+	REQUIRE(transport.is_valid());
+
+	// Asking for a frame before it was sent makes it count as late input once it arrives.
+	CHECK(transport->get_input(peer, 5).is_empty());
+
+	for (int frame = 0; frame < 6; frame++) {
+		PackedByteArray input;
+		input.push_back(frame);
+		input.push_back(0xFF);
+		CHECK(transport->send_input(frame, input) == SWC::RESULT_OK);
+	}
+	for (int i = 0; i < 40; i++) {
+		Steamworks::get_singleton()->run_callbacks();
+		transport->poll();
+		if (transport->get_latest_frame(peer) == 5) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(50000);
+	}
+	REQUIRE_MESSAGE(transport->get_latest_frame(peer) == 5, "Every frame of input should be received.");
+	for (int frame = 0; frame < 6; frame++) {
+		CHECK(transport->has_input(peer, frame));
+		PackedByteArray input = transport->get_input(peer, frame);
+		REQUIRE(input.size() == 2);
+		CHECK(input[0] == frame);
+		CHECK(input[1] == 0xFF);
+	}
+	CHECK_MESSAGE(transport->get_peer_late_input_count(peer) == 1, "The frame asked for early should be counted as late.");
+	Dictionary stats = transport->get_peer_stats(peer);
+	CHECK_MESSAGE(int(stats["duplicate_inputs"]) > 0, "Redundant copies of received frames should be discarded as duplicates.");
+
+	ERR_PRINT_OFF;
+	CHECK_MESSAGE(transport->send_input(3, PackedByteArray()) == SWC::RESULT_FAIL, "Frames sent out of order should be rejected.");
+	ERR_PRINT_ON;
+}
+
+TEST_CASE("[SteamNetworking] Test clock synchronization") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	int peer = networking_messages->get_peer_handle(Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id());
+	Ref<HBSteamPeerGroup> peer_group = networking_messages->create_peer_group();
+	peer_group->add_peer(peer);
+	Ref<HBSteamClockSync> clock_sync = networking_messages->create_clock_sync(peer_group, 6);
+	REQUIRE(clock_sync.is_valid());
+	clock_sync->set_ping_interval(0.05);
+
+	CHECK_FALSE(clock_sync->is_peer_synchronized(peer));
+	for (int i = 0; i < 40; i++) {
+		Steamworks::get_singleton()->run_callbacks();
+		clock_sync->poll();
+		if (clock_sync->is_peer_synchronized(peer)) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(50000);
+	}
+	REQUIRE_MESSAGE(clock_sync->is_peer_synchronized(peer), "Pinging ourselves should synchronize the clock.");
+	// Our own clock is only off by however unevenly the round trip was split.
+	CHECK(Math::abs(clock_sync->get_peer_offset_usec(peer)) <= int64_t(clock_sync->get_peer_rtt_ms(peer) * 1000.0f) + 1000);
+	CHECK(Math::abs(clock_sync->get_estimated_server_time() - clock_sync->get_local_time()) < 0.01);
+	clock_sync->set_server_peer(peer);
+	CHECK(Math::abs(clock_sync->get_estimated_server_time() - clock_sync->get_peer_time(peer)) < 0.01);
+}
 } //namespace TestSteamNetworking
 
 #endif // TEST_STEAM_NETWORKING_H
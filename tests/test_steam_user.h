@@ -62,6 +62,115 @@ TEST_CASE("[SteamUser] Test app tickets") {
 	CHECK_MESSAGE(signal_tester->got_ticket_received_signal, "Ticket received signal must get emitted");
 	CHECK_MESSAGE(ticket->get_ticket_data().size() > 0, "Ticket must not be empty");
 }
+
+TEST_CASE("[SteamUser] Test voice chat frame decoding") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	int peer = networking_messages->get_peer_handle(Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id());
+	Ref<HBSteamPeerGroup> peer_group = networking_messages->create_peer_group();
+	peer_group->add_peer(peer);
+	Ref<HBSteamVoiceChat> voice_chat = Steamworks::get_singleton()->get_user()->create_voice_chat(peer_group, 7);
+	REQUIRE(voice_chat.is_valid());
+
+	// Sequence number followed by data that isn't valid compressed voice.
+	PackedByteArray frame;
+	frame.push_back(1);
+	frame.push_back(0);
+	for (int i = 0; i < 32; i++) {
+		frame.push_back(i * 7);
+	}
+	CHECK(peer_group->send_to_group(frame, 0, 7) == SWC::RESULT_OK);
+	ERR_PRINT_OFF;
+	for (int i = 0; i < 40; i++) {
+		Steamworks::get_singleton()->run_callbacks();
+		voice_chat->poll();
+		if (voice_chat->get_speakers().has(peer)) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(50000);
+	}
+	ERR_PRINT_ON;
+	REQUIRE_MESSAGE(voice_chat->get_speakers().has(peer), "Receiving a voice frame should add its sender as a speaker.");
+	CHECK_MESSAGE(voice_chat->get_speaker_latency_ms(peer) == 0.0f, "Frames that fail to decompress should not produce audio.");
+
+	// Frames at or behind the last sequence number are dropped before decoding.
+	CHECK(peer_group->send_to_group(frame, 0, 7) == SWC::RESULT_OK);
+	for (int i = 0; i < 40; i++) {
+		Steamworks::get_singleton()->run_callbacks();
+		voice_chat->poll();
+		if (int(voice_chat->get_speaker_stats(peer)["late_frames"]) > 0) {
+			break;
+		}
+		OS::get_singleton()->delay_usec(50000);
+	}
+	CHECK_MESSAGE(int(voice_chat->get_speaker_stats(peer)["late_frames"]) == 1, "A repeated sequence number should be counted as a late frame.");
+}
+
+TEST_CASE("[SteamUser] Test voice chat jitter buffer") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	int peer = networking_messages->get_peer_handle(Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id());
+	Ref<HBSteamVoiceChat> voice_chat = Steamworks::get_singleton()->get_user()->create_voice_chat(networking_messages->create_peer_group(), 8);
+	REQUIRE(voice_chat.is_valid());
+	voice_chat->set_sample_rate(48000);
+
+	LocalVector<int16_t> samples;
+	samples.resize(4800);
+	for (uint32_t i = 0; i < samples.size(); i++) {
+		samples[i] = (i % 100) * 300;
+	}
+	voice_chat->push_speaker_samples(peer, samples.ptr(), samples.size());
+	CHECK_MESSAGE(voice_chat->get_speakers().has(peer), "Pushing samples should add a speaker.");
+	CHECK_MESSAGE(Math::is_equal_approx(voice_chat->get_speaker_latency_ms(peer), 100.0f), "Buffered samples should count towards the speaker's latency.");
+	CHECK(int(voice_chat->get_speaker_stats(peer)["dropped_samples"]) == 0);
+
+	// A second of voice arriving at once is way past the jitter buffer's limit.
+	for (int i = 0; i < 10; i++) {
+		voice_chat->push_speaker_samples(peer, samples.ptr(), samples.size());
+	}
+	CHECK_MESSAGE(int(voice_chat->get_speaker_stats(peer)["dropped_samples"]) > 0, "Samples past the buffer limit should be dropped.");
+	CHECK_MESSAGE(voice_chat->get_speaker_latency_ms(peer) <= voice_chat->get_max_jitter_buffer_ms(), "The buffer should skip ahead instead of growing past its limit.");
+
+	// Without a playback there is nowhere for the samples to go, they are discarded.
+	voice_chat->poll();
+	CHECK(voice_chat->get_speaker_latency_ms(peer) == 0.0f);
+}
+
+TEST_CASE("[SteamUser][Audio] Test voice chat playback") {
+	TestSteamworks::reinit_steamworks_if_needed();
+	Ref<HBSteamNetworkingMessages> networking_messages = Steamworks::get_singleton()->get_networking_messages();
+	int peer = networking_messages->get_peer_handle(Steamworks::get_singleton()->get_user()->get_local_user()->get_steam_id());
+	Ref<HBSteamVoiceChat> voice_chat = Steamworks::get_singleton()->get_user()->create_voice_chat(networking_messages->create_peer_group(), 9);
+	REQUIRE(voice_chat.is_valid());
+	voice_chat->set_sample_rate(48000);
+
+	Ref<AudioStreamGenerator> generator;
+	generator.instantiate();
+	Ref<AudioStreamGeneratorPlayback> playback = generator->instantiate_playback();
+	REQUIRE(playback.is_valid());
+	voice_chat->set_speaker_playback(peer, playback);
+	const int frames_available = playback->get_frames_available();
+
+	LocalVector<int16_t> samples;
+	samples.resize(960);
+	for (uint32_t i = 0; i < samples.size(); i++) {
+		samples[i] = 16384;
+	}
+	// 20 ms of voice is below the minimum jitter buffer delay, playback waits for more.
+	voice_chat->push_speaker_samples(peer, samples.ptr(), samples.size());
+	voice_chat->poll();
+	CHECK_MESSAGE(playback->get_frames_available() == frames_available, "Playback should not start before the jitter buffer fills up.");
+
+	for (int i = 0; i < 4; i++) {
+		voice_chat->push_speaker_samples(peer, samples.ptr(), samples.size());
+	}
+	voice_chat->poll();
+	const int pushed = frames_available - playback->get_frames_available();
+	CHECK_MESSAGE(pushed > 0, "Playback should start once the jitter buffer is full.");
+	CHECK_MESSAGE(pushed <= 5 * 960, "Only buffered samples should be pushed to the playback.");
+	CHECK_MESSAGE(Math::is_equal_approx(voice_chat->get_speaker_latency_ms(peer), 100.0f), "Samples queued in the playback should still count towards latency.");
+	CHECK(voice_chat->get_speaker_underrun_count(peer) == 0);
+}
 }; //namespace TestSteamUser
 
 #endif // TEST_STEAM_USER_H